@@ -46,6 +46,9 @@ if ("${CMAKE_SCRIPT_MODE_FILE}" STREQUAL "")
     # Beware! The prefix passed to pkg_check_modules(PREFIX ...) shouldn't contain underscores!
     pkg_check_modules(STMMINPUTGTKDM   REQUIRED  stmm-input-gtk-dm>=${SONOREM_REQ_STMM_INPUT_GTK_DM_VERSION})
     pkg_check_modules(STMMINPUTGTKBT   REQUIRED  stmm-input-gtk-bt>=${SONOREM_REQ_STMM_INPUT_GTK_BT_VERSION})
+    # optional, needed by --capture alsa
+    pkg_check_modules(ALSAPKG                    alsa)
+    find_package(Threads REQUIRED)
 endif()
 
 # include dirs
@@ -55,3 +58,10 @@ list(APPEND SONOREM_EXTRA_INCLUDE_DIRS  "${STMMINPUTGTKBT_INCLUDE_DIRS}")
 # libs
 list(APPEND SONOREM_EXTRA_LIBRARIES     "${STMMINPUTGTKDM_LIBRARIES}")
 list(APPEND SONOREM_EXTRA_LIBRARIES     "${STMMINPUTGTKBT_LIBRARIES}")
+list(APPEND SONOREM_EXTRA_LIBRARIES     "${CMAKE_THREAD_LIBS_INIT}")
+
+if (ALSAPKG_FOUND)
+    list(APPEND SONOREM_EXTRA_INCLUDE_DIRS  "${ALSAPKG_INCLUDE_DIRS}")
+    list(APPEND SONOREM_EXTRA_LIBRARIES     "${ALSAPKG_LIBRARIES}")
+    list(APPEND SONOREM_EXTRA_DEFINITIONS   "SONOREM_HAS_ALSA")
+endif()
@@ -0,0 +1,84 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   childsupervisor.cc
+ */
+
+#include "childsupervisor.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+namespace sono
+{
+
+ChildSupervisor::~ChildSupervisor() noexcept
+{
+	waitAll();
+}
+void ChildSupervisor::watch(Glib::Pid oPid, const sigc::slot<void, Glib::Pid, int>& oExitedSlot) noexcept
+{
+	assert(! isWatched(oPid));
+	Child oChild;
+	oChild.m_oPid = oPid;
+	oChild.m_oExitedSlot = oExitedSlot;
+	oChild.m_oChildWatchConn = Glib::signal_child_watch().connect(
+										sigc::mem_fun(*this, &ChildSupervisor::onChildExited), oPid);
+	m_aChildren.push_back(std::move(oChild));
+}
+bool ChildSupervisor::isWatched(Glib::Pid oPid) const noexcept
+{
+	const auto itFind = std::find_if(m_aChildren.begin(), m_aChildren.end(), [&](const Child& oChild)
+	{
+		return (oChild.m_oPid == oPid);
+	});
+	return (itFind != m_aChildren.end());
+}
+int32_t ChildSupervisor::getTotWatched() const noexcept
+{
+	return static_cast<int32_t>(m_aChildren.size());
+}
+void ChildSupervisor::waitAll() noexcept
+{
+	for (auto& oChild : m_aChildren) {
+		// Remove the source first so that the main loop doesn't try to reap the child too
+		oChild.m_oChildWatchConn.disconnect();
+		::waitpid(oChild.m_oPid, nullptr, 0);
+		Glib::spawn_close_pid(oChild.m_oPid);
+	}
+	m_aChildren.clear();
+}
+void ChildSupervisor::onChildExited(Glib::Pid oPid, int nWaitStatus) noexcept
+{
+	const auto itFind = std::find_if(m_aChildren.begin(), m_aChildren.end(), [&](const Child& oChild)
+	{
+		return (oChild.m_oPid == oPid);
+	});
+	if (itFind == m_aChildren.end()) {
+		return; //--------------------------------------------------------------
+	}
+	// The slot might watch other children, remove the entry before calling it
+	auto oExitedSlot = std::move(itFind->m_oExitedSlot);
+	m_aChildren.erase(itFind);
+	Glib::spawn_close_pid(oPid);
+	oExitedSlot(oPid, nWaitStatus);
+}
+
+} // namespace sono
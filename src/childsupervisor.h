@@ -0,0 +1,85 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   childsupervisor.h
+ */
+
+#ifndef SONO_CHILD_SUPERVISOR_H
+#define SONO_CHILD_SUPERVISOR_H
+
+#include <glibmm.h>
+
+#include <sigc++/sigc++.h>
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Reaps child processes as soon as they exit.
+ * The children must be spawned with Glib::SPAWN_DO_NOT_REAP_CHILD and
+ * must not be waited for (::waitpid) by anybody else.
+ * Uses the main loop's child watch sources, so nothing is polled.
+ */
+class ChildSupervisor
+{
+public:
+	ChildSupervisor() noexcept = default;
+	/** Destructor.
+	 * Blocks until all the still watched children have exited.
+	 */
+	~ChildSupervisor() noexcept;
+
+	/** Watches a child process.
+	 * The slot is called from the main loop right after the child
+	 * exited. At that point the child was already reaped.
+	 * @param oPid The child process.
+	 * @param oExitedSlot Called with the pid and the wait status (see ::waitpid).
+	 */
+	void watch(Glib::Pid oPid, const sigc::slot<void, Glib::Pid, int>& oExitedSlot) noexcept;
+	/** Whether a child is watched (hasn't exited yet).
+	 * @param oPid The child process.
+	 * @return Whether watched.
+	 */
+	bool isWatched(Glib::Pid oPid) const noexcept;
+	/** The number of watched children. */
+	int32_t getTotWatched() const noexcept;
+	/** Blocks until all the watched children have exited.
+	 * The exited slots are not called.
+	 */
+	void waitAll() noexcept;
+
+private:
+	void onChildExited(Glib::Pid oPid, int nWaitStatus) noexcept;
+
+	struct Child
+	{
+		Glib::Pid m_oPid;
+		sigc::connection m_oChildWatchConn;
+		sigc::slot<void, Glib::Pid, int> m_oExitedSlot;
+	};
+	std::vector<Child> m_aChildren;
+private:
+	ChildSupervisor(const ChildSupervisor& oSource) = delete;
+	ChildSupervisor& operator=(const ChildSupervisor& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_CHILD_SUPERVISOR_H */
@@ -0,0 +1,175 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   controlsocket.cc
+ */
+
+#include "controlsocket.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+// The client sends its command right after connecting
+static constexpr int32_t s_nReceiveCommandTimeoutMillisec = 200;
+// The listening process replies from its main loop
+static constexpr int32_t s_nReceiveReplyTimeoutMillisec = 5000;
+
+static socklen_t initAbstractAddress(const std::string& sName, struct sockaddr_un& oAddr) noexcept
+{
+	::memset(&oAddr, 0, sizeof(oAddr));
+	oAddr.sun_family = AF_UNIX;
+	// The leading zero byte selects the abstract namespace
+	const size_t nNameLen = std::min(sName.size(), sizeof(oAddr.sun_path) - 1);
+	::memcpy(oAddr.sun_path + 1, sName.c_str(), nNameLen);
+	return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + 1 + nNameLen);
+}
+static void setReceiveTimeout(int nFd, int32_t nMillisec) noexcept
+{
+	struct timeval oTimeout;
+	oTimeout.tv_sec = nMillisec / 1000;
+	oTimeout.tv_usec = (nMillisec % 1000) * 1000;
+	::setsockopt(nFd, SOL_SOCKET, SO_RCVTIMEO, &oTimeout, sizeof(oTimeout));
+}
+
+ControlSocket::ControlSocket() noexcept
+: m_nListenFd(-1)
+{
+}
+ControlSocket::~ControlSocket() noexcept
+{
+	m_oIoConn.disconnect();
+	if (m_nListenFd >= 0) {
+		// releases the name
+		::close(m_nListenFd);
+	}
+}
+std::string ControlSocket::listen(const std::string& sName, bool& bAlreadyBound) noexcept
+{
+	assert(! sName.empty());
+	assert(m_nListenFd < 0);
+	bAlreadyBound = false;
+	const int nFd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (nFd < 0) {
+		return "Could not create control socket: " + getErrnoString(errno); //--
+	}
+	struct sockaddr_un oAddr;
+	const socklen_t nAddrLen = initAbstractAddress(sName, oAddr);
+	if (::bind(nFd, reinterpret_cast<const struct sockaddr*>(&oAddr), nAddrLen) < 0) {
+		const int nErrno = errno;
+		::close(nFd);
+		bAlreadyBound = (nErrno == EADDRINUSE);
+		return "Could not bind control socket: " + getErrnoString(nErrno); //---
+	}
+	if (::listen(nFd, 4) < 0) {
+		const int nErrno = errno;
+		::close(nFd);
+		return "Could not listen on control socket: " + getErrnoString(nErrno); //--
+	}
+	m_nListenFd = nFd;
+	m_oIoConn = Glib::signal_io().connect(sigc::mem_fun(*this, &ControlSocket::onListenReadable)
+										, m_nListenFd, Glib::IO_IN);
+	return "";
+}
+bool ControlSocket::isListening() const noexcept
+{
+	return (m_nListenFd >= 0);
+}
+bool ControlSocket::onListenReadable(Glib::IOCondition /*eCondition*/) noexcept
+{
+	const bool bContinue = true;
+	while (true) {
+		const int nFd = ::accept4(m_nListenFd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (nFd < 0) {
+			// EAGAIN: no more pending connections
+			break; // while ----------------------------------------------------
+		}
+		// The name is visible to all users, only accept the own user (and root)
+		struct ucred oCred;
+		socklen_t nCredLen = sizeof(oCred);
+		const bool bAllowed = (::getsockopt(nFd, SOL_SOCKET, SO_PEERCRED, &oCred, &nCredLen) == 0)
+								&& ((oCred.uid == ::getuid()) || (oCred.uid == 0));
+		if (bAllowed) {
+			// A client that connects and doesn't send can block the main loop only briefly
+			setReceiveTimeout(nFd, s_nReceiveCommandTimeoutMillisec);
+			char aBuffer[s_nMaxPacketSize];
+			const ssize_t nRead = ::recv(nFd, aBuffer, sizeof(aBuffer), 0);
+			if (nRead > 0) {
+				const std::string sCommand = strStrip(std::string(aBuffer, nRead));
+				const std::string sReply = m_oCommandSignal.emit(sCommand);
+				::send(nFd, sReply.c_str(), std::min<size_t>(sReply.size(), s_nMaxPacketSize), MSG_NOSIGNAL);
+			}
+		}
+		::close(nFd);
+	}
+	return bContinue;
+}
+std::string ControlSocket::send(const std::string& sName, const std::string& sCommand, std::string& sReply) noexcept
+{
+	assert(! sName.empty());
+	assert(! sCommand.empty());
+	sReply.clear();
+	if (static_cast<int32_t>(sCommand.size()) > s_nMaxPacketSize) {
+		return "Command too long"; //-------------------------------------------
+	}
+	const int nFd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (nFd < 0) {
+		return "Could not create socket: " + getErrnoString(errno); //----------
+	}
+	struct sockaddr_un oAddr;
+	const socklen_t nAddrLen = initAbstractAddress(sName, oAddr);
+	if (::connect(nFd, reinterpret_cast<const struct sockaddr*>(&oAddr), nAddrLen) < 0) {
+		const int nErrno = errno;
+		::close(nFd);
+		if (nErrno == ECONNREFUSED) {
+			return "No running instance"; //------------------------------------
+		}
+		return "Could not connect: " + getErrnoString(nErrno); //---------------
+	}
+	if (::send(nFd, sCommand.c_str(), sCommand.size(), MSG_NOSIGNAL) < 0) {
+		const int nErrno = errno;
+		::close(nFd);
+		return "Could not send command: " + getErrnoString(nErrno); //----------
+	}
+	setReceiveTimeout(nFd, s_nReceiveReplyTimeoutMillisec);
+	char aBuffer[s_nMaxPacketSize];
+	const ssize_t nRead = ::recv(nFd, aBuffer, sizeof(aBuffer), 0);
+	const int nErrno = errno;
+	::close(nFd);
+	if (nRead < 0) {
+		return "No reply: " + getErrnoString(nErrno); //------------------------
+	}
+	if (nRead == 0) {
+		return "Command refused"; //--------------------------------------------
+	}
+	sReply.assign(aBuffer, nRead);
+	return "";
+}
+
+} // namespace sono
@@ -0,0 +1,82 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   controlsocket.h
+ */
+
+#ifndef SONO_CONTROL_SOCKET_H
+#define SONO_CONTROL_SOCKET_H
+
+#include <glibmm.h>
+
+#include <sigc++/sigc++.h>
+
+#include <string>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Local control socket in the abstract namespace.
+ * Binding it guards against a second instance: the kernel releases the name
+ * when the process exits, however it ends, so no stale lock is left behind.
+ * Other processes of the same user can connect to it to send a command.
+ * Each connection carries exactly one command packet and one reply packet.
+ */
+class ControlSocket
+{
+public:
+	ControlSocket() noexcept;
+	~ControlSocket() noexcept;
+
+	/** Binds the socket and starts accepting commands in the main loop.
+	 * @param sName The name in the abstract namespace. Cannot be empty.
+	 * @param bAlreadyBound Set to true if another process already bound the name.
+	 * @return The error or empty if successful.
+	 */
+	std::string listen(const std::string& sName, bool& bAlreadyBound) noexcept;
+	/** Whether listen() was successful. */
+	bool isListening() const noexcept;
+
+	/** Sends a command to the process listening on a socket and waits for the reply.
+	 * @param sName The name in the abstract namespace. Cannot be empty.
+	 * @param sCommand The command. Cannot be empty.
+	 * @param sReply The reply of the listening process.
+	 * @return The error or empty if successful.
+	 */
+	static std::string send(const std::string& sName, const std::string& sCommand, std::string& sReply) noexcept;
+
+	/** Emitted in the main loop for each received command.
+	 * Params: the command. Returns the reply.
+	 */
+	sigc::signal<std::string, const std::string&> m_oCommandSignal;
+
+	static constexpr int32_t s_nMaxPacketSize = 4096;
+private:
+	bool onListenReadable(Glib::IOCondition eCondition) noexcept;
+
+	int m_nListenFd;
+	sigc::connection m_oIoConn;
+private:
+	ControlSocket(const ControlSocket& oSource) = delete;
+	ControlSocket& operator=(const ControlSocket& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_CONTROL_SOCKET_H */
@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   dirwatcher.cc
+ */
+
+#include "dirwatcher.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+DirWatcher::DirWatcher() noexcept
+: m_nInotifyFd(-1)
+{
+}
+DirWatcher::~DirWatcher() noexcept
+{
+	m_oIoConn.disconnect();
+	if (m_nInotifyFd >= 0) {
+		// also removes the watches
+		::close(m_nInotifyFd);
+	}
+}
+std::string DirWatcher::addDir(const std::string& sDirPath, uint32_t nMask) noexcept
+{
+	if (isWatched(sDirPath)) {
+		return ""; //-----------------------------------------------------------
+	}
+	if (m_nInotifyFd < 0) {
+		// Created lazily, most runs have nothing to watch at first
+		m_nInotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_nInotifyFd < 0) {
+			return "Could not create inotify instance: " + getErrnoString(errno); //--
+		}
+		m_oIoConn = Glib::signal_io().connect(sigc::mem_fun(*this, &DirWatcher::onInotifyReadable)
+											, m_nInotifyFd, Glib::IO_IN);
+	}
+	const int nWd = ::inotify_add_watch(m_nInotifyFd, sDirPath.c_str(), nMask | IN_ONLYDIR);
+	if (nWd < 0) {
+		return "Could not watch " + sDirPath + ": " + getErrnoString(errno); //-
+	}
+	m_aWatches.push_back(Watch{nWd, sDirPath});
+	return "";
+}
+void DirWatcher::removeDir(const std::string& sDirPath) noexcept
+{
+	auto itWatch = std::find_if(m_aWatches.begin(), m_aWatches.end(), [&](const Watch& oWatch)
+	{
+		return (oWatch.m_sDirPath == sDirPath);
+	});
+	if (itWatch == m_aWatches.end()) {
+		return; //--------------------------------------------------------------
+	}
+	// Fails if the kernel already removed it because of an unmount
+	::inotify_rm_watch(m_nInotifyFd, itWatch->m_nWd);
+	m_aWatches.erase(itWatch);
+}
+bool DirWatcher::isWatched(const std::string& sDirPath) const noexcept
+{
+	return std::find_if(m_aWatches.begin(), m_aWatches.end(), [&](const Watch& oWatch)
+	{
+		return (oWatch.m_sDirPath == sDirPath);
+	}) != m_aWatches.end();
+}
+bool DirWatcher::onInotifyReadable(Glib::IOCondition /*eCondition*/) noexcept
+{
+	const bool bContinue = true;
+	// Aligned as required by the inotify man page
+	alignas(struct inotify_event) char aBuffer[4096];
+	while (true) {
+		const ssize_t nRead = ::read(m_nInotifyFd, aBuffer, sizeof(aBuffer));
+		if (nRead <= 0) {
+			// EAGAIN: all events read
+			break; // while ----------------------------------------------------
+		}
+		for (char* p0Cur = aBuffer; p0Cur < aBuffer + nRead; ) {
+			const struct inotify_event* p0Event = reinterpret_cast<const struct inotify_event*>(p0Cur);
+			p0Cur += sizeof(struct inotify_event) + p0Event->len;
+			auto itWatch = std::find_if(m_aWatches.begin(), m_aWatches.end(), [&](const Watch& oWatch)
+			{
+				return (oWatch.m_nWd == p0Event->wd);
+			});
+			if (itWatch == m_aWatches.end()) {
+				// removed in the meantime
+				continue;
+			}
+			const std::string sDirPath = itWatch->m_sDirPath;
+			if ((p0Event->mask & IN_IGNORED) != 0) {
+				// The watch was removed by the kernel
+				m_aWatches.erase(itWatch);
+			}
+			// The name is padded with zeroes
+			const std::string sName = ((p0Event->len > 0) ? std::string{p0Event->name} : std::string{});
+			// Might remove watches
+			m_oChangedSignal.emit(sDirPath, sName, p0Event->mask);
+		}
+	}
+	return bContinue;
+}
+
+} // namespace sono
@@ -0,0 +1,85 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   dirwatcher.h
+ */
+
+#ifndef SONO_DIR_WATCHER_H
+#define SONO_DIR_WATCHER_H
+
+#include <glibmm.h>
+
+#include <sigc++/sigc++.h>
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Watches directories for changes with inotify.
+ * The events are read from the main loop through an io watch, so nothing is polled.
+ */
+class DirWatcher
+{
+public:
+	DirWatcher() noexcept;
+	~DirWatcher() noexcept;
+
+	/** Watches a directory.
+	 * Does nothing if already watched.
+	 * @param sDirPath The directory.
+	 * @param nMask The inotify events (IN_CREATE, ...) to watch for.
+	 * @return The error or empty if successful.
+	 */
+	std::string addDir(const std::string& sDirPath, uint32_t nMask) noexcept;
+	/** Stops watching a directory.
+	 * Does nothing if not watched.
+	 * @param sDirPath The directory.
+	 */
+	void removeDir(const std::string& sDirPath) noexcept;
+	/** Whether a directory is watched. */
+	bool isWatched(const std::string& sDirPath) const noexcept;
+
+	/** Emitted in the main loop for each event.
+	 * Params: the directory, the name of the file within the directory (might be empty),
+	 * the inotify event mask. When the file system of the directory is unmounted
+	 * the directory stops being watched.
+	 */
+	sigc::signal<void, const std::string&, const std::string&, uint32_t> m_oChangedSignal;
+
+private:
+	bool onInotifyReadable(Glib::IOCondition eCondition) noexcept;
+
+	int m_nInotifyFd;
+	sigc::connection m_oIoConn;
+	struct Watch
+	{
+		int m_nWd;
+		std::string m_sDirPath;
+	};
+	std::vector<Watch> m_aWatches;
+private:
+	DirWatcher(const DirWatcher& oSource) = delete;
+	DirWatcher& operator=(const DirWatcher& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_DIR_WATCHER_H */
@@ -0,0 +1,515 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   filecopier.cc
+ */
+
+#include "filecopier.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+// Big enough for the kernel to do large requests to the device,
+// small enough for a cancel to be quick even with slow sticks
+static constexpr int64_t s_nChunkBytes = 8 * 1024 * 1024;
+static constexpr size_t s_nBufferAlignment = 4096;
+// Following: how often the source is checked for new data
+static constexpr int32_t s_nFollowPollMillisec = 1000;
+static const std::string s_sChecksumFileExt = ".crc32c";
+// Following or resuming: the part of the file that might be rewritten
+// by the recorder when it finishes (wav header)
+static constexpr int64_t s_nHeaderBytes = 4096;
+
+FileCopier::FileCopier(const std::string& sFromPath, const std::string& sToPath, bool bFollow, bool bResume) noexcept
+: WorkerThread("copy", false)
+, m_sFromPath(sFromPath)
+, m_sToPath(sToPath)
+, m_refCopy(std::make_shared<Copy>(sFromPath, sToPath, bFollow, bResume))
+{
+}
+FileCopier::~FileCopier() noexcept
+{
+	cancel();
+}
+void FileCopier::cancel(bool bKeepPartial) noexcept
+{
+	if (bKeepPartial) {
+		m_refCopy->m_bKeepPartial = true;
+	}
+	WorkerThread::cancel();
+	std::lock_guard<std::mutex> oLock(m_refCopy->m_oMutex);
+	m_refCopy->m_oFollowCondition.notify_all();
+}
+void FileCopier::finishFollowing() noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_refCopy->m_oMutex);
+	m_refCopy->m_bFollow = false;
+	m_refCopy->m_oFollowCondition.notify_all();
+}
+bool FileCopier::isFollowing() const noexcept
+{
+	return m_refCopy->m_bFollow;
+}
+int64_t FileCopier::getTotalBytes() const noexcept
+{
+	return m_refCopy->m_nTotalBytes;
+}
+int64_t FileCopier::getCopiedBytes() const noexcept
+{
+	return m_refCopy->m_nCopiedBytes;
+}
+int64_t FileCopier::getResumedBytes() const noexcept
+{
+	return m_refCopy->m_nResumedBytes;
+}
+FileCopier::METHOD FileCopier::getMethod() const noexcept
+{
+	return static_cast<METHOD>(m_refCopy->m_nMethod.load());
+}
+uint32_t FileCopier::getChecksum() const noexcept
+{
+	return m_refCopy->m_nChecksum;
+}
+std::string FileCopier::getChecksumFilePath(const std::string& sFilePath) noexcept
+{
+	return sFilePath + s_sChecksumFileExt;
+}
+std::function<void(WorkerThread::Status& oStatus)> FileCopier::createJob() noexcept
+{
+	const std::shared_ptr<Copy> refCopy = m_refCopy;
+	return [refCopy](Status& oStatus)
+	{
+		refCopy->run(oStatus);
+	};
+}
+
+FileCopier::Copy::Copy(const std::string& sFromPath, const std::string& sToPath, bool bFollow, bool bResume) noexcept
+: m_sFromPath(sFromPath)
+, m_sToPath(sToPath)
+, m_bResume(bResume)
+, m_bFollow(bFollow)
+, m_bKeepPartial(false)
+, m_nTotalBytes(-1)
+, m_nCopiedBytes(0)
+, m_nResumedBytes(0)
+, m_nMethod(METHOD_NONE)
+, m_p0Status(nullptr)
+, m_p0Buffer(nullptr)
+, m_nPrevChunkOffset(0)
+, m_nPrevChunkBytes(0)
+, m_nBufferOffset(0)
+, m_nBufferBytes(0)
+, m_nChecksumBytes(0)
+, m_nChecksum(0)
+{
+}
+FileCopier::Copy::~Copy() noexcept
+{
+	std::free(m_p0Buffer);
+}
+void FileCopier::Copy::setError(const std::string& sError) noexcept
+{
+	m_p0Status->setError(sError);
+}
+bool FileCopier::Copy::isCanceled() const noexcept
+{
+	return m_p0Status->isCanceled();
+}
+void FileCopier::Copy::run(Status& oStatus) noexcept
+{
+	m_p0Status = &oStatus;
+	bool bOk = false;
+	const int nFromFd = openSource();
+	if (nFromFd >= 0) {
+		struct stat oStat;
+		if (::fstat(nFromFd, &oStat) != 0) {
+			setError("Could not stat " + m_sFromPath + ": " + getErrnoString(errno));
+		} else {
+			const int nToFd = ::open(m_sToPath.c_str(), (m_bResume ? O_RDWR : (O_WRONLY | O_TRUNC)) | O_CREAT | O_CLOEXEC
+									, oStat.st_mode & 0777);
+			if (nToFd < 0) {
+				setError("Could not create " + m_sToPath + ": " + getErrnoString(errno));
+			} else {
+				::posix_fadvise(nFromFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+				const int64_t nStartOffset = (m_bResume ? verifyResumable(nFromFd, nToFd, oStat.st_size) : 0);
+				// When following, the header is rewritten at the end:
+				// the checksum has to be computed once the copy is done
+				m_nChecksumBytes = (m_bFollow ? -1 : 0);
+				if (nStartOffset < 0) {
+					// error already set
+				} else if (m_bFollow) {
+					bOk = followData(nFromFd, nToFd, nStartOffset);
+				} else {
+					m_nTotalBytes = oStat.st_size;
+					bOk = copyData(nFromFd, nToFd, nStartOffset, oStat.st_size);
+					if (bOk && (nStartOffset > 0)) {
+						// The header wasn't verified
+						bOk = copyHeader(nFromFd, nToFd, oStat.st_size);
+					}
+				}
+				if (bOk && (m_nChecksumBytes != m_nTotalBytes)) {
+					// The source wasn't read in sequence while copying
+					bOk = computeChecksum(nFromFd, m_nTotalBytes);
+				}
+				if (bOk) {
+					bOk = writeChecksumFile();
+				}
+				finishWriteBack(nToFd);
+				if ((::close(nToFd) != 0) && bOk) {
+					setError("Error closing " + m_sToPath + ": " + getErrnoString(errno));
+					bOk = false;
+				}
+				if ((! bOk) && ! m_bKeepPartial) {
+					::unlink(m_sToPath.c_str());
+					::unlink(getChecksumFilePath(m_sToPath).c_str());
+				}
+			}
+		}
+		::close(nFromFd);
+	}
+}
+int FileCopier::Copy::openSource() noexcept
+{
+	while (true) {
+		const int nFromFd = ::open(m_sFromPath.c_str(), O_RDONLY | O_CLOEXEC);
+		if (nFromFd >= 0) {
+			return nFromFd; //--------------------------------------------------
+		}
+		if ((errno != ENOENT) || ! m_bFollow) {
+			setError("Could not open " + m_sFromPath + ": " + getErrnoString(errno));
+			return -1; //-------------------------------------------------------
+		}
+		// The recorder hasn't created the file yet
+		if (! waitForFollowing()) {
+			setError("Canceled");
+			return -1; //-------------------------------------------------------
+		}
+	}
+}
+int64_t FileCopier::Copy::verifyResumable(int nFromFd, int nToFd, int64_t nFromBytes) noexcept
+{
+	struct stat oStat;
+	if (::fstat(nToFd, &oStat) != 0) {
+		setError("Could not stat " + m_sToPath + ": " + getErrnoString(errno));
+		return -1; //-----------------------------------------------------------
+	}
+	if (! allocBuffer()) {
+		return -1; //-----------------------------------------------------------
+	}
+	// Compare the checksums of blocks of source and destination, the first
+	// block that differs (ex. wasn't written to the device when the stick
+	// was removed) and what follows is copied again.
+	// The header might legitimately differ, it is copied again at the end.
+	const int64_t nBytes = std::min<int64_t>(oStat.st_size, nFromBytes);
+	const int64_t nBlockBytes = s_nChunkBytes / 2;
+	// The buffer is used as two blocks
+	m_nBufferBytes = 0;
+	char* p0FromBlock = m_p0Buffer;
+	char* p0ToBlock = m_p0Buffer + nBlockBytes;
+	int64_t nVerified = std::min(s_nHeaderBytes, nBytes);
+	while (nVerified < nBytes) {
+		if (isCanceled()) {
+			setError("Canceled");
+			return -1; //-------------------------------------------------------
+		}
+		const int64_t nCurBytes = std::min(nBlockBytes, nBytes - nVerified);
+		const int64_t nFromRead = preadAll(nFromFd, p0FromBlock, nCurBytes, nVerified);
+		if (nFromRead < 0) {
+			setError("Error reading " + m_sFromPath + ": " + getErrnoString(errno));
+			return -1; //-------------------------------------------------------
+		}
+		const int64_t nToRead = preadAll(nToFd, p0ToBlock, nCurBytes, nVerified);
+		if (nToRead < 0) {
+			setError("Error reading " + m_sToPath + ": " + getErrnoString(errno));
+			return -1; //-------------------------------------------------------
+		}
+		if ((nFromRead != nCurBytes) || (nToRead != nCurBytes)
+				|| (crc32c(0, p0FromBlock, nCurBytes) != crc32c(0, p0ToBlock, nCurBytes))) {
+			break;
+		}
+		::posix_fadvise(nFromFd, nVerified, nCurBytes, POSIX_FADV_DONTNEED);
+		::posix_fadvise(nToFd, nVerified, nCurBytes, POSIX_FADV_DONTNEED);
+		nVerified += nCurBytes;
+	}
+	if (nVerified <= s_nHeaderBytes) {
+		// Nothing worth keeping
+		nVerified = 0;
+	}
+	if (::ftruncate(nToFd, nVerified) != 0) {
+		setError("Could not truncate " + m_sToPath + ": " + getErrnoString(errno));
+		return -1; //-----------------------------------------------------------
+	}
+	m_nResumedBytes = nVerified;
+	m_nCopiedBytes = nVerified;
+	return nVerified;
+}
+bool FileCopier::Copy::copyHeader(int nFromFd, int nToFd, int64_t nFileBytes) noexcept
+{
+	const int64_t nHeaderBytes = std::min(s_nHeaderBytes, nFileBytes);
+	if ((nHeaderBytes > 0) && (copyChunk(nFromFd, nToFd, 0, nHeaderBytes) != nHeaderBytes)) {
+		setError("Could not copy the header of " + m_sFromPath);
+		return false; //--------------------------------------------------------
+	}
+	return true;
+}
+bool FileCopier::Copy::followData(int nFromFd, int nToFd, int64_t nStartOffset) noexcept
+{
+	int64_t nCopiedBytes = nStartOffset;
+	while (true) {
+		// Once finished the recorder doesn't write anymore, the size is final
+		const bool bFinishing = ! m_bFollow;
+		struct stat oStat;
+		if (::fstat(nFromFd, &oStat) != 0) {
+			setError("Could not stat " + m_sFromPath + ": " + getErrnoString(errno));
+			return false; //----------------------------------------------------
+		}
+		m_nTotalBytes = oStat.st_size;
+		if (oStat.st_size > nCopiedBytes) {
+			if (! copyData(nFromFd, nToFd, nCopiedBytes, oStat.st_size)) {
+				return false; //------------------------------------------------
+			}
+			nCopiedBytes = oStat.st_size;
+		}
+		if (bFinishing) {
+			break;
+		}
+		if (! waitForFollowing()) {
+			setError("Canceled");
+			return false; //----------------------------------------------------
+		}
+	}
+	// The recorder might have rewritten the header (sizes) since it was copied.
+	// It's only done at the end to spare the flash of the stick.
+	return copyHeader(nFromFd, nToFd, nCopiedBytes);
+}
+bool FileCopier::Copy::waitForFollowing() noexcept
+{
+	std::unique_lock<std::mutex> oLock(m_oMutex);
+	m_oFollowCondition.wait_for(oLock, std::chrono::milliseconds(s_nFollowPollMillisec), [&]()
+	{
+		return isCanceled() || ! m_bFollow;
+	});
+	return ! isCanceled();
+}
+bool FileCopier::Copy::copyData(int nFromFd, int nToFd, int64_t nFromOffset, int64_t nToOffset) noexcept
+{
+	if (m_nMethod == METHOD_NONE) {
+		m_nMethod = METHOD_COPY_FILE_RANGE;
+	}
+	int64_t nOffset = nFromOffset;
+	while (nOffset < nToOffset) {
+		if (isCanceled()) {
+			setError("Canceled");
+			return false; //----------------------------------------------------
+		}
+		const int64_t nChunkBytes = std::min(s_nChunkBytes, nToOffset - nOffset);
+		if (m_nChecksumBytes == nOffset) {
+			// The data is read anyway, a kernel copy then gets it from the page cache
+			if (! readChunk(nFromFd, nOffset, nChunkBytes)) {
+				return false; //------------------------------------------------
+			}
+			m_nChecksum = crc32c(m_nChecksum, m_p0Buffer, m_nBufferBytes);
+			m_nChecksumBytes += m_nBufferBytes;
+		}
+		const int64_t nCopied = copyChunk(nFromFd, nToFd, nOffset, nChunkBytes);
+		if (nCopied < 0) {
+			return false; //----------------------------------------------------
+		}
+		if (nCopied == 0) {
+			setError("File " + m_sFromPath + " has shrunk");
+			return false; //----------------------------------------------------
+		}
+		// Start writing back this chunk, then wait for the previous one
+		// and remove it from the page cache. This keeps the amount of dirty
+		// pages small, which otherwise would stall the recording when flushed.
+		::sync_file_range(nToFd, nOffset, nCopied, SYNC_FILE_RANGE_WRITE);
+		finishWriteBack(nToFd);
+		::posix_fadvise(nFromFd, nOffset, nCopied, POSIX_FADV_DONTNEED);
+		m_nPrevChunkOffset = nOffset;
+		m_nPrevChunkBytes = nCopied;
+		nOffset += nCopied;
+		m_nCopiedBytes = nOffset;
+		m_p0Status->notifyProgress();
+	}
+	return true;
+}
+void FileCopier::Copy::finishWriteBack(int nToFd) noexcept
+{
+	if (m_nPrevChunkBytes <= 0) {
+		return; //--------------------------------------------------------------
+	}
+	::sync_file_range(nToFd, m_nPrevChunkOffset, m_nPrevChunkBytes
+					, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+	::posix_fadvise(nToFd, m_nPrevChunkOffset, m_nPrevChunkBytes, POSIX_FADV_DONTNEED);
+	m_nPrevChunkBytes = 0;
+}
+int64_t FileCopier::Copy::copyChunk(int nFromFd, int nToFd, int64_t nOffset, int64_t nChunkBytes) noexcept
+{
+	// Errors that mean the method is not supported for these files
+	auto isNotSupported = [](int nErrno)
+	{
+		return (nErrno == EXDEV) || (nErrno == EINVAL) || (nErrno == ENOSYS)
+				|| (nErrno == EOPNOTSUPP) || (nErrno == EBADF);
+	};
+	if (m_nMethod == METHOD_COPY_FILE_RANGE) {
+		while (true) {
+			loff_t nFromOffset = nOffset;
+			loff_t nToOffset = nOffset;
+			const auto nCopied = ::copy_file_range(nFromFd, &nFromOffset, nToFd, &nToOffset, nChunkBytes, 0);
+			if (nCopied >= 0) {
+				return nCopied; //----------------------------------------------
+			}
+			if (errno == EINTR) {
+				continue;
+			}
+			if (! isNotSupported(errno)) {
+				setError("Error copying " + m_sFromPath + ": " + getErrnoString(errno));
+				return -1; //---------------------------------------------------
+			}
+			m_nMethod = METHOD_SENDFILE;
+			break;
+		}
+	}
+	if (m_nMethod == METHOD_SENDFILE) {
+		// sendfile writes at the current position of the destination
+		if (::lseek(nToFd, nOffset, SEEK_SET) < 0) {
+			setError("Error seeking " + m_sToPath + ": " + getErrnoString(errno));
+			return -1; //-------------------------------------------------------
+		}
+		while (true) {
+			off_t nFromOffset = nOffset;
+			const auto nCopied = ::sendfile(nToFd, nFromFd, &nFromOffset, nChunkBytes);
+			if (nCopied >= 0) {
+				return nCopied; //----------------------------------------------
+			}
+			if (errno == EINTR) {
+				continue;
+			}
+			if (! isNotSupported(errno)) {
+				setError("Error copying " + m_sFromPath + ": " + getErrnoString(errno));
+				return -1; //---------------------------------------------------
+			}
+			m_nMethod = METHOD_READ_WRITE;
+			break;
+		}
+	}
+	return readWriteChunk(nFromFd, nToFd, nOffset, nChunkBytes);
+}
+bool FileCopier::Copy::allocBuffer() noexcept
+{
+	if (m_p0Buffer != nullptr) {
+		return true; //---------------------------------------------------------
+	}
+	void* p0Buffer = nullptr;
+	if (::posix_memalign(&p0Buffer, s_nBufferAlignment, s_nChunkBytes) != 0) {
+		setError("Could not allocate copy buffer");
+		return false; //--------------------------------------------------------
+	}
+	m_p0Buffer = static_cast<char*>(p0Buffer);
+	return true;
+}
+bool FileCopier::Copy::readChunk(int nFromFd, int64_t nOffset, int64_t nChunkBytes) noexcept
+{
+	if (! allocBuffer()) {
+		return false; //--------------------------------------------------------
+	}
+	assert(nChunkBytes <= s_nChunkBytes);
+	const int64_t nRead = preadAll(nFromFd, m_p0Buffer, nChunkBytes, nOffset);
+	if (nRead < 0) {
+		m_nBufferBytes = 0;
+		setError("Error reading " + m_sFromPath + ": " + getErrnoString(errno));
+		return false; //--------------------------------------------------------
+	}
+	m_nBufferOffset = nOffset;
+	m_nBufferBytes = nRead;
+	return true;
+}
+bool FileCopier::Copy::computeChecksum(int nFromFd, int64_t nFileBytes) noexcept
+{
+	m_nChecksum = 0;
+	m_nChecksumBytes = 0;
+	while (m_nChecksumBytes < nFileBytes) {
+		if (isCanceled()) {
+			setError("Canceled");
+			return false; //----------------------------------------------------
+		}
+		if (! readChunk(nFromFd, m_nChecksumBytes, std::min(s_nChunkBytes, nFileBytes - m_nChecksumBytes))) {
+			return false; //----------------------------------------------------
+		}
+		if (m_nBufferBytes == 0) {
+			setError("File " + m_sFromPath + " has shrunk");
+			return false; //----------------------------------------------------
+		}
+		m_nChecksum = crc32c(m_nChecksum, m_p0Buffer, m_nBufferBytes);
+		::posix_fadvise(nFromFd, m_nChecksumBytes, m_nBufferBytes, POSIX_FADV_DONTNEED);
+		m_nChecksumBytes += m_nBufferBytes;
+	}
+	return true;
+}
+bool FileCopier::Copy::writeChecksumFile() noexcept
+{
+	const std::string sChecksumFilePath = getChecksumFilePath(m_sToPath);
+	const std::string sFileName = Glib::path_get_basename(m_sToPath);
+	char aChecksum[16];
+	std::snprintf(aChecksum, sizeof(aChecksum), "%08x", m_nChecksum);
+	const std::string sContent = std::string{aChecksum} + "  " + sFileName + "\n";
+	const int nFd = ::open(sChecksumFilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (nFd < 0) {
+		setError("Could not create " + sChecksumFilePath + ": " + getErrnoString(errno));
+		return false; //--------------------------------------------------------
+	}
+	// The sync of the recording doesn't include this file
+	bool bOk = pwriteAll(nFd, sContent.data(), sContent.size(), 0) && (::fdatasync(nFd) == 0);
+	if (! bOk) {
+		setError("Error writing " + sChecksumFilePath + ": " + getErrnoString(errno));
+	}
+	if ((::close(nFd) != 0) && bOk) {
+		setError("Error closing " + sChecksumFilePath + ": " + getErrnoString(errno));
+		bOk = false;
+	}
+	return bOk;
+}
+int64_t FileCopier::Copy::readWriteChunk(int nFromFd, int nToFd, int64_t nOffset, int64_t nChunkBytes) noexcept
+{
+	if ((m_nBufferOffset != nOffset) || (m_nBufferBytes != nChunkBytes)) {
+		if (! readChunk(nFromFd, nOffset, nChunkBytes)) {
+			return -1; //-------------------------------------------------------
+		}
+	}
+	const int64_t nRead = m_nBufferBytes;
+	if (! pwriteAll(nToFd, m_p0Buffer, nRead, nOffset)) {
+		setError("Error writing " + m_sToPath + ": " + getErrnoString(errno));
+		return -1; //-----------------------------------------------------------
+	}
+	return nRead;
+}
+
+} // namespace sono
@@ -0,0 +1,184 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   filecopier.h
+ */
+
+#ifndef SONO_FILE_COPIER_H
+#define SONO_FILE_COPIER_H
+
+#include "workerthread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Copies a file in a worker thread.
+ * The kernel copies the data if possible (copy_file_range, then sendfile),
+ * otherwise a read/write loop with a large aligned buffer is used.
+ * The page cache is not filled with the data of the file and the
+ * destination is written back to the device while copying.
+ *
+ * In follow mode the source is still being written (a recording): the copier
+ * keeps mirroring it as it grows until finishFollowing() is called.
+ *
+ * In resume mode an existing destination (a copy that was interrupted) is
+ * checked block by block against the source, the copy continues after
+ * the last block with the same checksum.
+ *
+ * The CRC-32C checksum of the source is computed while copying and written
+ * to a sidecar file next to the destination (see getChecksumFilePath()).
+ *
+ * m_oProgressSignal is emitted each time a chunk was copied.
+ * m_oFinishedSignal is emitted once when the copy has terminated, the
+ * destination file is removed if the copy wasn't successful unless canceled
+ * keeping the partial copy.
+ */
+class FileCopier : public WorkerThread
+{
+public:
+	/** Constructor.
+	 * @param sFromPath The source file.
+	 * @param sToPath The destination file. Is overwritten if it exists and not resuming.
+	 * @param bFollow Whether the source is still growing. The source might not exist yet.
+	 * @param bResume Whether to keep the verified prefix of an existing destination.
+	 */
+	FileCopier(const std::string& sFromPath, const std::string& sToPath, bool bFollow = false, bool bResume = false) noexcept;
+	/** Destructor.
+	 * Cancels the copy if still running and waits for the thread to terminate.
+	 */
+	~FileCopier() noexcept;
+
+	/** Cancels the copy.
+	 * m_oFinishedSignal will be emitted with an error.
+	 * @param bKeepPartial Whether the partially copied destination should not be
+	 * removed so that the copy can later be resumed.
+	 */
+	void cancel(bool bKeepPartial = false) noexcept;
+	/** Tells the copier that the source won't change anymore.
+	 * The rest of the file and the (possibly rewritten) header are copied
+	 * before finishing.
+	 */
+	void finishFollowing() noexcept;
+	/** Whether in follow mode and finishFollowing() wasn't called yet. */
+	bool isFollowing() const noexcept;
+
+	const std::string& getFromPath() const noexcept { return m_sFromPath; }
+	const std::string& getToPath() const noexcept { return m_sToPath; }
+	/** The size of the source or -1 if not known yet. Grows while following. */
+	int64_t getTotalBytes() const noexcept;
+	/** The number of bytes copied so far. Includes the resumed bytes. */
+	int64_t getCopiedBytes() const noexcept;
+	/** The number of bytes of the existing destination that were kept when resuming. */
+	int64_t getResumedBytes() const noexcept;
+
+	enum METHOD
+	{
+		  METHOD_NONE = 0
+		, METHOD_COPY_FILE_RANGE = 1
+		, METHOD_SENDFILE = 2
+		, METHOD_READ_WRITE = 3
+	};
+	/** The method currently (or last) used to copy the data. */
+	METHOD getMethod() const noexcept;
+	/** The CRC-32C of the source.
+	 * Only meaningful when finished successfully.
+	 */
+	uint32_t getChecksum() const noexcept;
+
+	/** The path of the checksum sidecar file of a file.
+	 * It contains the checksum as 8 hex digits followed by two spaces and the file name.
+	 * @param sFilePath The file.
+	 * @return The path.
+	 */
+	static std::string getChecksumFilePath(const std::string& sFilePath) noexcept;
+
+protected:
+	std::function<void(Status& oStatus)> createJob() noexcept override;
+
+private:
+	// The state of a copy, shared with the worker thread
+	class Copy
+	{
+	public:
+		Copy(const std::string& sFromPath, const std::string& sToPath, bool bFollow, bool bResume) noexcept;
+		~Copy() noexcept;
+		void run(Status& oStatus) noexcept;
+	private:
+		friend class FileCopier;
+		int openSource() noexcept;
+		int64_t verifyResumable(int nFromFd, int nToFd, int64_t nFromBytes) noexcept;
+		bool copyHeader(int nFromFd, int nToFd, int64_t nFileBytes) noexcept;
+		bool readChunk(int nFromFd, int64_t nOffset, int64_t nChunkBytes) noexcept;
+		bool computeChecksum(int nFromFd, int64_t nFileBytes) noexcept;
+		bool writeChecksumFile() noexcept;
+		bool followData(int nFromFd, int nToFd, int64_t nStartOffset) noexcept;
+		bool copyData(int nFromFd, int nToFd, int64_t nFromOffset, int64_t nToOffset) noexcept;
+		void finishWriteBack(int nToFd) noexcept;
+		bool waitForFollowing() noexcept;
+		int64_t copyChunk(int nFromFd, int nToFd, int64_t nOffset, int64_t nChunkBytes) noexcept;
+		int64_t readWriteChunk(int nFromFd, int nToFd, int64_t nOffset, int64_t nChunkBytes) noexcept;
+		bool allocBuffer() noexcept;
+		void setError(const std::string& sError) noexcept;
+		bool isCanceled() const noexcept;
+	private:
+		const std::string m_sFromPath;
+		const std::string m_sToPath;
+		const bool m_bResume;
+
+		std::atomic<bool> m_bFollow;
+		std::atomic<bool> m_bKeepPartial;
+		std::atomic<int64_t> m_nTotalBytes;
+		std::atomic<int64_t> m_nCopiedBytes;
+		std::atomic<int64_t> m_nResumedBytes;
+		std::atomic<int32_t> m_nMethod;
+
+		// Only used by the worker thread
+		Status* m_p0Status;
+		char* m_p0Buffer;
+		int64_t m_nPrevChunkOffset; // the chunk being written back to the device
+		int64_t m_nPrevChunkBytes;
+		int64_t m_nBufferOffset; // the part of the source in m_p0Buffer
+		int64_t m_nBufferBytes;
+		int64_t m_nChecksumBytes; // the bytes from the start included in m_nChecksum, -1 if not in sequence
+		// Read by the main thread only when finished
+		uint32_t m_nChecksum;
+
+		std::mutex m_oMutex;
+		std::condition_variable m_oFollowCondition; // notified on finishFollowing() and cancel()
+	};
+
+private:
+	const std::string m_sFromPath;
+	const std::string m_sToPath;
+	const std::shared_ptr<Copy> m_refCopy;
+private:
+	FileCopier() = delete;
+	FileCopier(const FileCopier& oSource) = delete;
+	FileCopier& operator=(const FileCopier& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_FILE_COPIER_H */
@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   filesyncer.cc
+ */
+
+#include "filesyncer.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+FileSyncer::FileSyncer(const std::vector<std::string>& aFilePaths) noexcept
+: WorkerThread("sync", true)
+, m_aFilePaths(aFilePaths)
+{
+	assert(! m_aFilePaths.empty());
+}
+std::function<void(WorkerThread::Status& oStatus)> FileSyncer::createJob() noexcept
+{
+	const std::vector<std::string> aFilePaths = m_aFilePaths;
+	return [aFilePaths](Status& oStatus)
+	{
+		sync(aFilePaths, oStatus);
+	};
+}
+void FileSyncer::sync(const std::vector<std::string>& aFilePaths, Status& oStatus) noexcept
+{
+	bool bOk = true;
+	if (aFilePaths.size() == 1) {
+		bOk = syncFile(aFilePaths[0], oStatus);
+	} else {
+		// One pass over the file system instead of one per file
+		bOk = syncFileSystem(aFilePaths[0], oStatus);
+		// Also makes sure the other files (still) exist
+		for (auto it = aFilePaths.begin() + 1; bOk && (it != aFilePaths.end()); ++it) {
+			bOk = (::access(it->c_str(), F_OK) == 0);
+			if (! bOk) {
+				oStatus.setError("Could not access " + *it + ": " + getErrnoString(errno));
+			}
+		}
+	}
+	if (bOk) {
+		std::vector<std::string> aDirPaths;
+		for (const auto& sFilePath : aFilePaths) {
+			const auto nPos = sFilePath.rfind('/');
+			const std::string sDirPath = ((nPos == std::string::npos) ? "." : ((nPos == 0) ? "/" : sFilePath.substr(0, nPos)));
+			if (std::find(aDirPaths.begin(), aDirPaths.end(), sDirPath) == aDirPaths.end()) {
+				aDirPaths.push_back(sDirPath);
+			}
+		}
+		for (auto it = aDirPaths.begin(); bOk && (it != aDirPaths.end()); ++it) {
+			bOk = syncDir(*it, oStatus);
+		}
+	}
+}
+bool FileSyncer::syncFile(const std::string& sFilePath, Status& oStatus) noexcept
+{
+	const int nFd = ::open(sFilePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (nFd < 0) {
+		oStatus.setError("Could not open " + sFilePath + ": " + getErrnoString(errno));
+		return false; //--------------------------------------------------------
+	}
+	const bool bOk = (::fdatasync(nFd) == 0);
+	if (! bOk) {
+		oStatus.setError("fdatasync " + sFilePath + ": " + getErrnoString(errno));
+	}
+	::close(nFd);
+	return bOk;
+}
+bool FileSyncer::syncFileSystem(const std::string& sFilePath, Status& oStatus) noexcept
+{
+	const int nFd = ::open(sFilePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (nFd < 0) {
+		oStatus.setError("Could not open " + sFilePath + ": " + getErrnoString(errno));
+		return false; //--------------------------------------------------------
+	}
+	// Since Linux 5.8 syncfs also reports write back errors
+	const bool bOk = (::syncfs(nFd) == 0);
+	if (! bOk) {
+		oStatus.setError("syncfs " + sFilePath + ": " + getErrnoString(errno));
+	}
+	::close(nFd);
+	return bOk;
+}
+bool FileSyncer::syncDir(const std::string& sDirPath, Status& oStatus) noexcept
+{
+	const int nFd = ::open(sDirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (nFd < 0) {
+		oStatus.setError("Could not open " + sDirPath + ": " + getErrnoString(errno));
+		return false; //--------------------------------------------------------
+	}
+	// Some file systems don't support syncing a directory
+	const bool bOk = (::fsync(nFd) == 0) || (errno == EINVAL);
+	if (! bOk) {
+		oStatus.setError("fsync " + sDirPath + ": " + getErrnoString(errno));
+	}
+	::close(nFd);
+	return bOk;
+}
+
+} // namespace sono
@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   filesyncer.h
+ */
+
+#ifndef SONO_FILE_SYNCER_H
+#define SONO_FILE_SYNCER_H
+
+#include "workerthread.h"
+
+#include <string>
+#include <vector>
+
+namespace sono
+{
+
+/** Makes files durable on their device in a worker thread.
+ * A single file is flushed with fdatasync, several files of the same
+ * file system with one syncfs. The parent directories are then fsync'ed
+ * so that the directory entries are on the device too.
+ *
+ * The flush itself can't be interrupted: when canceled the thread is
+ * abandoned and m_oFinishedSignal is emitted with an error right away.
+ */
+class FileSyncer : public WorkerThread
+{
+public:
+	/** Constructor.
+	 * @param aFilePaths The files to sync. Must be on the same file system. Cannot be empty.
+	 */
+	explicit FileSyncer(const std::vector<std::string>& aFilePaths) noexcept;
+
+	const std::vector<std::string>& getFilePaths() const noexcept { return m_aFilePaths; }
+
+protected:
+	std::function<void(Status& oStatus)> createJob() noexcept override;
+
+private:
+	static void sync(const std::vector<std::string>& aFilePaths, Status& oStatus) noexcept;
+	static bool syncFile(const std::string& sFilePath, Status& oStatus) noexcept;
+	static bool syncFileSystem(const std::string& sFilePath, Status& oStatus) noexcept;
+	static bool syncDir(const std::string& sDirPath, Status& oStatus) noexcept;
+
+private:
+	const std::vector<std::string> m_aFilePaths;
+private:
+	FileSyncer() = delete;
+	FileSyncer(const FileSyncer& oSource) = delete;
+	FileSyncer& operator=(const FileSyncer& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_FILE_SYNCER_H */
@@ -0,0 +1,130 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   fileverifier.cc
+ */
+
+#include "fileverifier.h"
+
+#include "filecopier.h"
+#include "util.h"
+
+#include <cassert>
+#include <cstdlib>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+static constexpr int64_t s_nReadBytes = 4 * 1024 * 1024;
+static constexpr size_t s_nBufferAlignment = 4096;
+
+FileVerifier::FileVerifier(const std::string& sFilePath) noexcept
+: WorkerThread("verify", false)
+, m_sFilePath(sFilePath)
+{
+}
+std::function<void(WorkerThread::Status& oStatus)> FileVerifier::createJob() noexcept
+{
+	const std::string sFilePath = m_sFilePath;
+	return [sFilePath](Status& oStatus)
+	{
+		verify(sFilePath, oStatus);
+	};
+}
+bool FileVerifier::readChecksumFile(const std::string& sFilePath, uint32_t& nChecksum, Status& oStatus) noexcept
+{
+	const std::string sChecksumFilePath = FileCopier::getChecksumFilePath(sFilePath);
+	const int nFd = ::open(sChecksumFilePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (nFd < 0) {
+		oStatus.setError("Could not open " + sChecksumFilePath + ": " + getErrnoString(errno));
+		return false; //--------------------------------------------------------
+	}
+	// Drop what was written so that the device is read
+	::posix_fadvise(nFd, 0, 0, POSIX_FADV_DONTNEED);
+	char aHex[8];
+	const int64_t nRead = preadAll(nFd, aHex, sizeof(aHex), 0);
+	::close(nFd);
+	if (nRead != static_cast<int64_t>(sizeof(aHex))) {
+		oStatus.setError("Could not read " + sChecksumFilePath);
+		return false; //--------------------------------------------------------
+	}
+	nChecksum = 0;
+	for (const char cHex : aHex) {
+		int32_t nDigit;
+		if ((cHex >= '0') && (cHex <= '9')) {
+			nDigit = cHex - '0';
+		} else if ((cHex >= 'a') && (cHex <= 'f')) {
+			nDigit = 10 + (cHex - 'a');
+		} else {
+			oStatus.setError("Malformed checksum in " + sChecksumFilePath);
+			return false; //----------------------------------------------------
+		}
+		nChecksum = (nChecksum << 4) | static_cast<uint32_t>(nDigit);
+	}
+	return true;
+}
+void FileVerifier::verify(const std::string& sFilePath, Status& oStatus) noexcept
+{
+	uint32_t nExpectedChecksum;
+	if (readChecksumFile(sFilePath, nExpectedChecksum, oStatus)) {
+		const int nFd = ::open(sFilePath.c_str(), O_RDONLY | O_CLOEXEC);
+		void* p0Buffer = nullptr;
+		if (nFd < 0) {
+			oStatus.setError("Could not open " + sFilePath + ": " + getErrnoString(errno));
+		} else if (::posix_memalign(&p0Buffer, s_nBufferAlignment, s_nReadBytes) != 0) {
+			oStatus.setError("Could not allocate verify buffer");
+		} else {
+			// The file was synced, its pages are clean and can be dropped:
+			// the data then comes from the device, not from what was copied
+			::posix_fadvise(nFd, 0, 0, POSIX_FADV_DONTNEED);
+			::posix_fadvise(nFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+			uint32_t nChecksum = 0;
+			int64_t nOffset = 0;
+			while (true) {
+				if (oStatus.isCanceled()) {
+					oStatus.setError("Canceled");
+					break;
+				}
+				const int64_t nRead = preadAll(nFd, p0Buffer, s_nReadBytes, nOffset);
+				if (nRead < 0) {
+					oStatus.setError("Error reading " + sFilePath + ": " + getErrnoString(errno));
+					break;
+				}
+				if (nRead == 0) {
+					if (nChecksum != nExpectedChecksum) {
+						oStatus.setError("Checksum mismatch for " + sFilePath);
+					}
+					break;
+				}
+				nChecksum = crc32c(nChecksum, p0Buffer, nRead);
+				::posix_fadvise(nFd, nOffset, nRead, POSIX_FADV_DONTNEED);
+				nOffset += nRead;
+			}
+		}
+		std::free(p0Buffer);
+		if (nFd >= 0) {
+			::close(nFd);
+		}
+	}
+}
+
+} // namespace sono
@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   fileverifier.h
+ */
+
+#ifndef SONO_FILE_VERIFIER_H
+#define SONO_FILE_VERIFIER_H
+
+#include "workerthread.h"
+
+#include <string>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Checks a copied file against its checksum sidecar file in a worker thread.
+ * The sidecar is written by FileCopier. The cached pages of the file are
+ * dropped before reading so that what is on the device is checked.
+ * The file should therefore be synced before verifying it.
+ * When canceled m_oFinishedSignal is emitted with an error.
+ */
+class FileVerifier : public WorkerThread
+{
+public:
+	/** Constructor.
+	 * @param sFilePath The file to verify.
+	 */
+	explicit FileVerifier(const std::string& sFilePath) noexcept;
+
+	const std::string& getFilePath() const noexcept { return m_sFilePath; }
+
+protected:
+	std::function<void(Status& oStatus)> createJob() noexcept override;
+
+private:
+	static void verify(const std::string& sFilePath, Status& oStatus) noexcept;
+	static bool readChecksumFile(const std::string& sFilePath, uint32_t& nChecksum, Status& oStatus) noexcept;
+
+private:
+	const std::string m_sFilePath;
+private:
+	FileVerifier() = delete;
+	FileVerifier(const FileVerifier& oSource) = delete;
+	FileVerifier& operator=(const FileVerifier& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_FILE_VERIFIER_H */
@@ -0,0 +1,223 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   iopool.cc
+ */
+
+#include "iopool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <system_error>
+
+namespace sono
+{
+
+static constexpr int32_t s_nCheckTimeoutsMillisec = 250;
+
+IoPool::IoPool(int32_t nTotWorkers) noexcept
+: m_refShared(std::make_shared<SharedData>())
+{
+	assert(nTotWorkers > 0);
+	m_refShared->m_p0Dispatcher = &m_oDispatcher;
+	m_oDispatcher.connect(sigc::mem_fun(*this, &IoPool::onDispatched));
+	for (int32_t nIdx = 0; nIdx < nTotWorkers; ++nIdx) {
+		startWorker();
+	}
+}
+IoPool::~IoPool() noexcept
+{
+	m_oCheckTimeoutsConn.disconnect();
+	{
+		std::lock_guard<std::mutex> oLock(m_refShared->m_oMutex);
+		m_refShared->m_bStop = true;
+		// A worker finishing late must not touch the pool
+		m_refShared->m_p0Dispatcher = nullptr;
+		m_refShared->m_aQueuedJobs.clear();
+	}
+	m_refShared->m_oCondition.notify_all();
+	for (auto& oWorker : m_aWorkers) {
+		if (oWorker.m_oThread.joinable()) {
+			oWorker.m_oThread.join();
+		}
+	}
+}
+void IoPool::startWorker() noexcept
+{
+	Worker oWorker;
+	oWorker.m_refData = std::make_shared<WorkerData>();
+	try {
+		oWorker.m_oThread = std::thread(&IoPool::run, m_refShared, oWorker.m_refData);
+	} catch (const std::system_error& /*oErr*/) {
+		// The other workers will do the jobs
+		return; //--------------------------------------------------------------
+	}
+	m_aWorkers.push_back(std::move(oWorker));
+}
+bool IoPool::post(const std::string& sKey, int32_t nTimeoutMillisec, std::function<void()>&& oWork
+					, std::function<void(bool bTimedOut)>&& oDone) noexcept
+{
+	assert(! sKey.empty());
+	assert(nTimeoutMillisec > 0);
+	if (isHung(sKey)) {
+		return false; //--------------------------------------------------------
+	}
+	Job oJob;
+	oJob.m_sKey = sKey;
+	oJob.m_nTimeoutMillisec = nTimeoutMillisec;
+	oJob.m_oWork = std::move(oWork);
+	oJob.m_oDone = std::move(oDone);
+	{
+		std::lock_guard<std::mutex> oLock(m_refShared->m_oMutex);
+		m_refShared->m_aQueuedJobs.push_back(std::move(oJob));
+	}
+	m_refShared->m_oCondition.notify_one();
+	if (! m_oCheckTimeoutsConn.connected()) {
+		m_oCheckTimeoutsConn = Glib::signal_timeout().connect(sigc::mem_fun(*this, &IoPool::checkTimeouts)
+															, s_nCheckTimeoutsMillisec);
+	}
+	return true;
+}
+bool IoPool::isHung(const std::string& sKey) const noexcept
+{
+	return (std::find(m_aHungKeys.begin(), m_aHungKeys.end(), sKey) != m_aHungKeys.end());
+}
+void IoPool::clearHung(const std::string& sKey) noexcept
+{
+	m_aHungKeys.erase(std::remove(m_aHungKeys.begin(), m_aHungKeys.end(), sKey), m_aHungKeys.end());
+}
+void IoPool::run(std::shared_ptr<SharedData> refShared, std::shared_ptr<WorkerData> refWorker) noexcept
+{
+	SharedData& oShared = *refShared;
+	WorkerData& oWorker = *refWorker;
+	std::unique_lock<std::mutex> oLock(oShared.m_oMutex);
+	while (true) {
+		oShared.m_oCondition.wait(oLock, [&]()
+		{
+			return oShared.m_bStop || ! oShared.m_aQueuedJobs.empty();
+		});
+		if (oShared.m_bStop) {
+			break; // while ----------------------------------------------------
+		}
+		oWorker.m_oJob = std::move(oShared.m_aQueuedJobs.front());
+		oShared.m_aQueuedJobs.pop_front();
+		oWorker.m_bRunning = true;
+		oWorker.m_oStartTime = std::chrono::steady_clock::now();
+		std::function<void()> oWork = std::move(oWorker.m_oJob.m_oWork);
+		oLock.unlock();
+		//
+		oWork();
+		//
+		oLock.lock();
+		if (oWorker.m_bAbandoned) {
+			// The completion was already called, a new worker took this one's place
+			break; // while ----------------------------------------------------
+		}
+		oWorker.m_bRunning = false;
+		oShared.m_aFinishedJobs.push_back(std::move(oWorker.m_oJob));
+		if (oShared.m_p0Dispatcher != nullptr) {
+			oShared.m_p0Dispatcher->emit();
+		}
+	}
+}
+void IoPool::onDispatched() noexcept
+{
+	std::vector<Job> aFinishedJobs;
+	{
+		std::lock_guard<std::mutex> oLock(m_refShared->m_oMutex);
+		aFinishedJobs.swap(m_refShared->m_aFinishedJobs);
+	}
+	for (auto& oJob : aFinishedJobs) {
+		// Might post new jobs
+		oJob.m_oDone(false);
+	}
+}
+bool IoPool::checkTimeouts() noexcept
+{
+	const bool bContinue = true;
+	std::vector<Job> aTimedOutJobs;
+	std::vector<std::string> aNewHungKeys;
+	int32_t nTotAbandoned = 0;
+	{
+		std::lock_guard<std::mutex> oLock(m_refShared->m_oMutex);
+		const auto oNow = std::chrono::steady_clock::now();
+		for (auto& oWorker : m_aWorkers) {
+			WorkerData& oData = *oWorker.m_refData;
+			if (! oData.m_bRunning) {
+				continue;
+			}
+			const int64_t nElapsedMillisec = std::chrono::duration_cast<std::chrono::milliseconds>(oNow - oData.m_oStartTime).count();
+			if (nElapsedMillisec < oData.m_oJob.m_nTimeoutMillisec) {
+				continue;
+			}
+			oData.m_bAbandoned = true;
+			oData.m_bRunning = false;
+			if (std::find(aNewHungKeys.begin(), aNewHungKeys.end(), oData.m_oJob.m_sKey) == aNewHungKeys.end()) {
+				aNewHungKeys.push_back(oData.m_oJob.m_sKey);
+			}
+			aTimedOutJobs.push_back(std::move(oData.m_oJob));
+			// Can't be joined, the thread exits by itself if it ever returns
+			oWorker.m_oThread.detach();
+			++nTotAbandoned;
+		}
+		// The queued jobs of a hung key would hang too
+		auto& aQueuedJobs = m_refShared->m_aQueuedJobs;
+		for (auto itJob = aQueuedJobs.begin(); itJob != aQueuedJobs.end(); ) {
+			if (std::find(aNewHungKeys.begin(), aNewHungKeys.end(), itJob->m_sKey) != aNewHungKeys.end()) {
+				aTimedOutJobs.push_back(std::move(*itJob));
+				itJob = aQueuedJobs.erase(itJob);
+			} else {
+				++itJob;
+			}
+		}
+	}
+	if (nTotAbandoned > 0) {
+		m_aWorkers.erase(std::remove_if(m_aWorkers.begin(), m_aWorkers.end(), [](const Worker& oWorker)
+		{
+			return ! oWorker.m_oThread.joinable();
+		}), m_aWorkers.end());
+		for (int32_t nIdx = 0; nIdx < nTotAbandoned; ++nIdx) {
+			startWorker();
+		}
+	}
+	for (auto& sKey : aNewHungKeys) {
+		m_aHungKeys.push_back(sKey);
+	}
+	for (auto& oJob : aTimedOutJobs) {
+		oJob.m_oDone(true);
+	}
+	for (auto& sKey : aNewHungKeys) {
+		m_oHungSignal.emit(sKey);
+	}
+	bool bIdle = true;
+	{
+		// The callbacks might have posted jobs
+		std::lock_guard<std::mutex> oLock(m_refShared->m_oMutex);
+		bIdle = m_refShared->m_aQueuedJobs.empty()
+				&& std::none_of(m_aWorkers.begin(), m_aWorkers.end(), [](const Worker& oWorker)
+				{
+					return oWorker.m_refData->m_bRunning;
+				});
+	}
+	if (bIdle) {
+		// Reconnected by the next post()
+		return ! bContinue; //--------------------------------------------------
+	}
+	return bContinue;
+}
+
+} // namespace sono
@@ -0,0 +1,134 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   iopool.h
+ */
+
+#ifndef SONO_IO_POOL_H
+#define SONO_IO_POOL_H
+
+#include <glibmm.h>
+
+#include <sigc++/sigc++.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Runs blocking file system calls in worker threads.
+ * The completion of a job is called in the main loop. A job that doesn't
+ * finish in time marks its key (usually a mount root path) as hung: its worker
+ * is abandoned and replaced, since a thread blocked in the kernel can't be
+ * canceled, and no more jobs are accepted for the key.
+ */
+class IoPool
+{
+public:
+	/** Constructor.
+	 * @param nTotWorkers The number of worker threads. Must be positive.
+	 */
+	explicit IoPool(int32_t nTotWorkers) noexcept;
+	/** Destructor.
+	 * Waits for the running jobs to terminate, except the hung ones.
+	 * The completion of the queued jobs isn't called.
+	 */
+	~IoPool() noexcept;
+
+	/** Queues a job.
+	 * The work function might still be running after the pool is deleted
+	 * if it hangs, therefore it must only access what it captured by value.
+	 * @param sKey The file system accessed by the job. Cannot be empty.
+	 * @param nTimeoutMillisec The max time the work function may take once started.
+	 * @param oWork The work called in a worker thread.
+	 * @param oDone The completion called in the main loop, bTimedOut is true if
+	 *              the work didn't finish in time or the key became hung while queued.
+	 * @return Whether queued. False if the key is hung.
+	 */
+	bool post(const std::string& sKey, int32_t nTimeoutMillisec, std::function<void()>&& oWork
+				, std::function<void(bool bTimedOut)>&& oDone) noexcept;
+	/** Whether a job with the key has timed out. */
+	bool isHung(const std::string& sKey) const noexcept;
+	/** Accepts jobs for a hung key again.
+	 * Ex. when the mount was removed and another could get the same path.
+	 */
+	void clearHung(const std::string& sKey) noexcept;
+
+	/** Emitted in the main loop when a key becomes hung.
+	 * Params: the key. Called after the completions of the affected jobs.
+	 */
+	sigc::signal<void, const std::string&> m_oHungSignal;
+
+private:
+	struct Job
+	{
+		std::string m_sKey;
+		int32_t m_nTimeoutMillisec = 0;
+		std::function<void()> m_oWork;
+		std::function<void(bool bTimedOut)> m_oDone;
+	};
+	// Shared with the worker threads, outlives the pool if a worker hangs
+	struct WorkerData
+	{
+		bool m_bRunning = false;
+		bool m_bAbandoned = false;
+		Job m_oJob;
+		std::chrono::steady_clock::time_point m_oStartTime;
+	};
+	struct SharedData
+	{
+		std::mutex m_oMutex;
+		std::condition_variable m_oCondition;
+		bool m_bStop = false;
+		std::deque<Job> m_aQueuedJobs;
+		std::vector<Job> m_aFinishedJobs;
+		Glib::Dispatcher* m_p0Dispatcher = nullptr; // null when the pool is being deleted
+	};
+	struct Worker
+	{
+		std::thread m_oThread;
+		std::shared_ptr<WorkerData> m_refData;
+	};
+	void startWorker() noexcept;
+	static void run(std::shared_ptr<SharedData> refShared, std::shared_ptr<WorkerData> refWorker) noexcept;
+	void onDispatched() noexcept;
+	bool checkTimeouts() noexcept;
+
+	std::shared_ptr<SharedData> m_refShared;
+	std::vector<Worker> m_aWorkers;
+	Glib::Dispatcher m_oDispatcher;
+	sigc::connection m_oCheckTimeoutsConn;
+	std::vector<std::string> m_aHungKeys;
+private:
+	IoPool() = delete;
+	IoPool(const IoPool& oSource) = delete;
+	IoPool& operator=(const IoPool& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_IO_POOL_H */
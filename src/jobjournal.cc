@@ -0,0 +1,250 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   jobjournal.cc
+ */
+
+#include "jobjournal.h"
+
+#include "util.h"
+
+#include <glibmm.h>
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+static const char* const s_aStateNames[] = {"recording", "queued", "copied", "synced", "verified", "removed"};
+static constexpr int32_t s_nTotStates = sizeof(s_aStateNames) / sizeof(s_aStateNames[0]);
+// Written instead of an empty mount UUID
+static const std::string s_sNoUUID = "-";
+
+JobJournal::JobJournal(const std::string& sFilePath) noexcept
+: m_sFilePath(sFilePath)
+, m_nFd(-1)
+, m_nFileBytes(0)
+, m_nFileLines(0)
+, m_nPendingLines(0)
+, m_nTotEntries(0)
+{
+}
+JobJournal::~JobJournal() noexcept
+{
+	if (m_nFd >= 0) {
+		flush();
+		::close(m_nFd);
+	}
+}
+const char* JobJournal::getStateName(STATE eState) noexcept
+{
+	assert((eState >= 0) && (eState < s_nTotStates));
+	return s_aStateNames[eState];
+}
+std::string JobJournal::getLine(const Entry& oEntry) noexcept
+{
+	// The file name is last, it could contain spaces
+	return std::string{getStateName(oEntry.m_eState)} + " " + (oEntry.m_sMountUUID.empty() ? s_sNoUUID : oEntry.m_sMountUUID)
+			+ " " + oEntry.m_sFileName + "\n";
+}
+bool JobJournal::parseLine(const std::string& sLine, Entry& oEntry) noexcept
+{
+	std::istringstream oLineStream(sLine);
+	std::string sStateName;
+	std::string sMountUUID;
+	if (! (oLineStream >> sStateName >> sMountUUID)) {
+		return false; //--------------------------------------------------------
+	}
+	auto itState = std::find(s_aStateNames, s_aStateNames + s_nTotStates, sStateName);
+	if (itState == s_aStateNames + s_nTotStates) {
+		return false; //--------------------------------------------------------
+	}
+	std::string sFileName;
+	std::getline(oLineStream >> std::ws, sFileName);
+	if (sFileName.empty()) {
+		return false; //--------------------------------------------------------
+	}
+	oEntry.m_sFileName = std::move(sFileName);
+	oEntry.m_eState = static_cast<STATE>(itState - s_aStateNames);
+	oEntry.m_sMountUUID = ((sMountUUID == s_sNoUUID) ? "" : std::move(sMountUUID));
+	return true;
+}
+void JobJournal::applyTransition(const std::string& sFileName, STATE eState, const std::string& sMountUUID) noexcept
+{
+	auto itIdx = m_oEntryIdxs.find(sFileName);
+	if (eState == STATE_REMOVED) {
+		if (itIdx != m_oEntryIdxs.end()) {
+			m_aEntries[itIdx->second].m_sFileName.clear();
+			m_oEntryIdxs.erase(itIdx);
+			--m_nTotEntries;
+		}
+		return; //--------------------------------------------------------------
+	}
+	if (itIdx == m_oEntryIdxs.end()) {
+		itIdx = m_oEntryIdxs.emplace(sFileName, static_cast<int32_t>(m_aEntries.size())).first;
+		m_aEntries.emplace_back();
+		m_aEntries.back().m_sFileName = sFileName;
+		++m_nTotEntries;
+	}
+	Entry& oEntry = m_aEntries[itIdx->second];
+	oEntry.m_eState = eState;
+	oEntry.m_sMountUUID = sMountUUID;
+}
+bool JobJournal::isOpen() const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	return (m_nFd >= 0);
+}
+std::vector<JobJournal::Entry> JobJournal::getEntries() const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	std::vector<Entry> aEntries;
+	aEntries.reserve(m_nTotEntries);
+	for (const Entry& oEntry : m_aEntries) {
+		if (! oEntry.m_sFileName.empty()) {
+			aEntries.push_back(oEntry);
+		}
+	}
+	return aEntries;
+}
+std::string JobJournal::open(bool& bExisted) noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	assert(m_nFd < 0);
+	bExisted = Glib::file_test(m_sFilePath, Glib::FILE_TEST_EXISTS);
+	if (bExisted) {
+		std::string sContents;
+		try {
+			sContents = Glib::file_get_contents(m_sFilePath);
+		} catch (const Glib::FileError& oErr) {
+			return "Could not read " + m_sFilePath + ": " + oErr.what(); //-----
+		}
+		std::size_t nLineStart = 0;
+		while (true) {
+			const std::size_t nLineEnd = sContents.find('\n', nLineStart);
+			if (nLineEnd == std::string::npos) {
+				// No newline: the line was being written when the program died
+				break; // while ------------------------------------------------
+			}
+			Entry oEntry;
+			if (parseLine(sContents.substr(nLineStart, nLineEnd - nLineStart), oEntry)) {
+				applyTransition(oEntry.m_sFileName, oEntry.m_eState, oEntry.m_sMountUUID);
+			}
+			nLineStart = nLineEnd + 1;
+		}
+	}
+	// Also gets rid of a truncated line
+	return compactLocked();
+}
+void JobJournal::append(const std::string& sFileName, STATE eState, const std::string& sMountUUID) noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	applyTransition(sFileName, eState, sMountUUID);
+	Entry oEntry;
+	oEntry.m_sFileName = sFileName;
+	oEntry.m_eState = eState;
+	oEntry.m_sMountUUID = sMountUUID;
+	m_sPending += getLine(oEntry);
+	++m_nPendingLines;
+}
+std::string JobJournal::flush() noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	if (m_sPending.empty()) {
+		return ""; //-----------------------------------------------------------
+	}
+	if (m_nFd < 0) {
+		return "Journal not open: " + m_sFilePath; //---------------------------
+	}
+	// Written at the same offset again if it fails
+	if ((! pwriteAll(m_nFd, m_sPending.data(), m_sPending.size(), m_nFileBytes)) || (::fdatasync(m_nFd) != 0)) {
+		return "Error writing " + m_sFilePath + ": " + getErrnoString(errno); //--
+	}
+	m_nFileBytes += m_sPending.size();
+	m_nFileLines += m_nPendingLines;
+	m_sPending.clear();
+	m_nPendingLines = 0;
+	return "";
+}
+bool JobJournal::needsCompaction() const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	const int32_t nTotLines = m_nFileLines + m_nPendingLines;
+	return (nTotLines >= s_nMinLinesToCompact)
+			&& (nTotLines > s_nLinesPerEntryToCompact * m_nTotEntries);
+}
+std::string JobJournal::compact() noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	return compactLocked();
+}
+std::string JobJournal::compactLocked() noexcept
+{
+	// Also fills the holes left by removed entries
+	auto itEnd = std::remove_if(m_aEntries.begin(), m_aEntries.end(), [](const Entry& oEntry)
+	{
+		return oEntry.m_sFileName.empty();
+	});
+	m_aEntries.erase(itEnd, m_aEntries.end());
+	std::string sContents;
+	for (int32_t nIdx = 0; nIdx < m_nTotEntries; ++nIdx) {
+		const Entry& oEntry = m_aEntries[nIdx];
+		m_oEntryIdxs[oEntry.m_sFileName] = nIdx;
+		sContents += getLine(oEntry);
+	}
+	// Replaced atomically, a crash leaves either the old or the new journal
+	const std::string sTempFilePath = m_sFilePath + ".tmp";
+	const int nFd = ::open(sTempFilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (nFd < 0) {
+		return "Could not create " + sTempFilePath + ": " + getErrnoString(errno); //--
+	}
+	if ((! pwriteAll(nFd, sContents.data(), sContents.size(), 0)) || (::fdatasync(nFd) != 0)) {
+		const int nErrno = errno;
+		::close(nFd);
+		::unlink(sTempFilePath.c_str());
+		return "Error writing " + sTempFilePath + ": " + getErrnoString(nErrno); //--
+	}
+	if (::rename(sTempFilePath.c_str(), m_sFilePath.c_str()) != 0) {
+		const int nErrno = errno;
+		::close(nFd);
+		::unlink(sTempFilePath.c_str());
+		return "Could not rename " + sTempFilePath + ": " + getErrnoString(nErrno); //--
+	}
+	// The rename is only durable once the directory is synced
+	const int nDirFd = ::open(Glib::path_get_dirname(m_sFilePath).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (nDirFd >= 0) {
+		::fsync(nDirFd);
+		::close(nDirFd);
+	}
+	if (m_nFd >= 0) {
+		::close(m_nFd);
+	}
+	m_nFd = nFd;
+	m_nFileBytes = sContents.size();
+	m_nFileLines = m_nTotEntries;
+	m_sPending.clear();
+	m_nPendingLines = 0;
+	return "";
+}
+
+} // namespace sono
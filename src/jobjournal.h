@@ -0,0 +1,129 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   jobjournal.h
+ */
+
+#ifndef SONO_JOB_JOURNAL_H
+#define SONO_JOB_JOURNAL_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Append-only journal of the state of the recordings in the recording directory.
+ * Each transition is a line appended to the file, the appended lines are
+ * only written and synced by flush(), so that transitions happening together
+ * cost one sync. A transition lost in a crash just makes the recording
+ * go through a stage again. The journal is rewritten with only the last
+ * state of each recording when opened and by compact().
+ * Apart from open() the methods can be called from any thread.
+ */
+class JobJournal
+{
+public:
+	enum STATE
+	{
+		STATE_RECORDING = 0 /**< Being recorded. */
+		, STATE_QUEUED = 1 /**< Waiting to be copied. */
+		, STATE_COPIED = 2 /**< Copied to a mount but not synced. */
+		, STATE_SYNCED = 3 /**< Copied and synced, not verified. */
+		, STATE_VERIFIED = 4 /**< The copy was verified, can be removed. */
+		, STATE_REMOVED = 5 /**< Removed from the recording directory. */
+	};
+	struct Entry
+	{
+		std::string m_sFileName;
+		STATE m_eState = STATE_RECORDING;
+		std::string m_sMountUUID; // only for STATE_COPIED and STATE_SYNCED, might be empty
+	};
+	/** Constructor.
+	 * @param sFilePath The journal file.
+	 */
+	explicit JobJournal(const std::string& sFilePath) noexcept;
+	/** Destructor.
+	 * Flushes the appended transitions.
+	 */
+	~JobJournal() noexcept;
+
+	/** Reads the journal, if it exists, and rewrites it compacted.
+	 * A truncated last line, left by a crash, is ignored.
+	 * @param bExisted Set to whether the journal file existed.
+	 * @return The error or empty if successful.
+	 */
+	std::string open(bool& bExisted) noexcept;
+	/** Whether open() succeeded. */
+	bool isOpen() const noexcept;
+	/** The last state of each recording not removed, oldest first. */
+	std::vector<Entry> getEntries() const noexcept;
+
+	/** Appends a transition.
+	 * It's only written to the file by flush().
+	 * @param sFileName The name of the recording.
+	 * @param eState The new state.
+	 * @param sMountUUID The UUID of the mount for STATE_COPIED and STATE_SYNCED.
+	 */
+	void append(const std::string& sFileName, STATE eState, const std::string& sMountUUID) noexcept;
+	/** Writes and syncs the transitions appended since the last flush.
+	 * On failure the transitions are kept and written by the next flush.
+	 * @return The error or empty if successful.
+	 */
+	std::string flush() noexcept;
+	/** Whether the file has many more lines than recordings. */
+	bool needsCompaction() const noexcept;
+	/** Replaces the journal with one containing only the last state of each recording.
+	 * @return The error or empty if successful.
+	 */
+	std::string compact() noexcept;
+
+	static const char* getStateName(STATE eState) noexcept;
+private:
+	std::string compactLocked() noexcept;
+	void applyTransition(const std::string& sFileName, STATE eState, const std::string& sMountUUID) noexcept;
+	static std::string getLine(const Entry& oEntry) noexcept;
+	static bool parseLine(const std::string& sLine, Entry& oEntry) noexcept;
+
+private:
+	const std::string m_sFilePath;
+	mutable std::mutex m_oMutex;
+	int m_nFd;
+	int64_t m_nFileBytes;
+	int32_t m_nFileLines;
+	std::string m_sPending;
+	int32_t m_nPendingLines;
+	// Removed entries are left as holes with an empty name until compact()
+	std::vector<Entry> m_aEntries;
+	int32_t m_nTotEntries; // not removed
+	std::unordered_map<std::string, int32_t> m_oEntryIdxs; // Key: file name, Value: index into m_aEntries
+
+	static constexpr const int32_t s_nMinLinesToCompact = 256;
+	static constexpr const int32_t s_nLinesPerEntryToCompact = 4;
+private:
+	JobJournal() = delete;
+	JobJournal(const JobJournal& oSource) = delete;
+	JobJournal& operator=(const JobJournal& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_JOB_JOURNAL_H */
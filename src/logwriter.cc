@@ -0,0 +1,339 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   logwriter.cc
+ */
+
+#include "logwriter.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+static constexpr int32_t s_nRingBufferLines = 16 * 1024;
+// The writer thread wakes up this often to write what was queued
+static constexpr int32_t s_nWriterIdleMillisec = 100;
+// A batch is written as soon as it's this big
+static constexpr int32_t s_nMaxBatchBytes = 64 * 1024;
+
+LogRingBuffer::LogRingBuffer(int32_t nMinCapacity) noexcept
+: m_nPushPos(0)
+, m_nPopPos(0)
+{
+	assert(nMinCapacity > 0);
+	uint32_t nCapacity = 1;
+	while (nCapacity < static_cast<uint32_t>(nMinCapacity)) {
+		nCapacity <<= 1;
+	}
+	m_aSlots.reset(new Slot[nCapacity]);
+	for (uint32_t nIdx = 0; nIdx < nCapacity; ++nIdx) {
+		m_aSlots[nIdx].m_nSeq.store(nIdx, std::memory_order_relaxed);
+	}
+	m_nCapacity = nCapacity;
+	m_nMask = nCapacity - 1;
+}
+bool LogRingBuffer::push(const TimePoint& oTime, std::string&& sStr) noexcept
+{
+	uint32_t nPos = m_nPushPos.load(std::memory_order_relaxed);
+	Slot* p0Slot;
+	while (true) {
+		p0Slot = &(m_aSlots[nPos & m_nMask]);
+		const uint32_t nSeq = p0Slot->m_nSeq.load(std::memory_order_acquire);
+		const int32_t nDiff = static_cast<int32_t>(nSeq - nPos);
+		if (nDiff == 0) {
+			// The slot is free, claim it
+			if (m_nPushPos.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed)) {
+				break; // while ----------------------------------------------------
+			}
+		} else if (nDiff < 0) {
+			// The consumer hasn't freed the slot yet
+			return false; //----------------------------------------------------
+		} else {
+			// Claimed by another producer
+			nPos = m_nPushPos.load(std::memory_order_relaxed);
+		}
+	}
+	p0Slot->m_oTime = oTime;
+	p0Slot->m_sStr = std::move(sStr);
+	p0Slot->m_nSeq.store(nPos + 1, std::memory_order_release);
+	return true;
+}
+bool LogRingBuffer::pop(TimePoint& oTime, std::string& sStr) noexcept
+{
+	Slot& oSlot = m_aSlots[m_nPopPos & m_nMask];
+	const uint32_t nSeq = oSlot.m_nSeq.load(std::memory_order_acquire);
+	if (nSeq != m_nPopPos + 1) {
+		// Not written yet
+		return false; //--------------------------------------------------------
+	}
+	oTime = oSlot.m_oTime;
+	sStr = std::move(oSlot.m_sStr);
+	oSlot.m_sStr.clear();
+	// Free for the push one round later
+	oSlot.m_nSeq.store(m_nPopPos + m_nCapacity, std::memory_order_release);
+	++m_nPopPos;
+	return true;
+}
+int32_t LogRingBuffer::getCapacity() const noexcept
+{
+	return static_cast<int32_t>(m_nCapacity);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+LogWriter::LogWriter(Init&& oInit) noexcept
+: m_oInit(std::move(oInit))
+, m_oRing(s_nRingBufferLines)
+, m_bStopping(false)
+, m_nTotDropped(0)
+, m_nFd(-1)
+, m_nFileBytes(0)
+, m_nLastStrRepeated(0)
+, m_nReportedDropped(0)
+, m_bUnsynced(false)
+, m_bErrorReported(false)
+{
+	assert(! m_oInit.m_sFilePath.empty());
+	assert(m_oInit.m_nSyncMillisec >= 0);
+	assert(m_oInit.m_nMaxFileBytes >= 0);
+	assert(m_oInit.m_nTotRotatedFiles >= 0);
+}
+LogWriter::~LogWriter() noexcept
+{
+	stop();
+}
+std::string LogWriter::start() noexcept
+{
+	assert(! m_oWriterThread.joinable());
+	m_nFd = ::open(m_oInit.m_sFilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+	if (m_nFd < 0) {
+		return "Could not create log " + m_oInit.m_sFilePath + ": " + getErrnoString(errno); //--
+	}
+	m_nFileBytes = 0;
+	m_oSyncTime = std::chrono::steady_clock::now();
+	try {
+		m_oWriterThread = std::thread(&LogWriter::writerThreadRun, this);
+	} catch (const std::system_error& oErr) {
+		::close(m_nFd);
+		m_nFd = -1;
+		return std::string{"Could not start log writer thread: "} + oErr.what(); //--
+	}
+	return "";
+}
+void LogWriter::stop() noexcept
+{
+	if (! m_oWriterThread.joinable()) {
+		return; //--------------------------------------------------------------
+	}
+	{
+		std::lock_guard<std::mutex> oLock(m_oWakeMutex);
+		m_bStopping = true;
+	}
+	m_oWakeCondition.notify_one();
+	m_oWriterThread.join();
+	if (m_nFd >= 0) {
+		::close(m_nFd);
+		m_nFd = -1;
+	}
+}
+void LogWriter::log(const std::string& sStr) noexcept
+{
+	if (! m_oRing.push(std::chrono::system_clock::now(), std::string{sStr})) {
+		++m_nTotDropped;
+		// Make room as soon as possible
+		m_oWakeCondition.notify_one();
+	}
+}
+int64_t LogWriter::getTotDropped() const noexcept
+{
+	return m_nTotDropped;
+}
+void LogWriter::writerThreadRun() noexcept
+{
+	LogRingBuffer::TimePoint oTime;
+	std::string sStr;
+	while (true) {
+		// Read before emptying the ring, the lines queued before stop() are written
+		const bool bStopping = m_bStopping;
+		while (m_oRing.pop(oTime, sStr)) {
+			addLine(oTime, std::move(sStr));
+			if (static_cast<int32_t>(m_sBatch.size()) >= s_nMaxBatchBytes) {
+				writeBatch();
+			}
+		}
+		const int64_t nTotDropped = m_nTotDropped;
+		if (nTotDropped != m_nReportedDropped) {
+			addLine(std::chrono::system_clock::now(), "Log lines dropped: " + std::to_string(nTotDropped - m_nReportedDropped));
+			m_nReportedDropped = nTotDropped;
+		}
+		int32_t nWaitMillisec = s_nWriterIdleMillisec;
+		if (bStopping) {
+			addRepeated();
+		} else if (m_nLastStrRepeated > 0) {
+			// Also the repetitions are durable within the bound
+			const int64_t nMillisec = std::chrono::duration_cast<std::chrono::milliseconds>(
+												std::chrono::steady_clock::now() - m_oRepeatedTime).count();
+			if (nMillisec >= m_oInit.m_nSyncMillisec) {
+				addRepeated();
+			}
+		}
+		writeBatch();
+		if (m_bUnsynced) {
+			const int64_t nMillisec = std::chrono::duration_cast<std::chrono::milliseconds>(
+												std::chrono::steady_clock::now() - m_oSyncTime).count();
+			if (bStopping || (nMillisec >= m_oInit.m_nSyncMillisec)) {
+				syncFile();
+			} else {
+				nWaitMillisec = std::min<int64_t>(nWaitMillisec, m_oInit.m_nSyncMillisec - nMillisec);
+			}
+		}
+		if (bStopping) {
+			break; // while --------------------------------------------------------
+		}
+		std::unique_lock<std::mutex> oLock(m_oWakeMutex);
+		m_oWakeCondition.wait_for(oLock, std::chrono::milliseconds(nWaitMillisec), [&]()
+		{
+			return m_bStopping.load();
+		});
+	}
+}
+void LogWriter::addLine(const LogRingBuffer::TimePoint& oTime, std::string&& sStr) noexcept
+{
+	if (sStr.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	if (sStr == m_sLastStr) {
+		if (m_nLastStrRepeated == 0) {
+			m_oRepeatedTime = std::chrono::steady_clock::now();
+		}
+		++m_nLastStrRepeated;
+		m_oLastStrTime = oTime;
+		return; //--------------------------------------------------------------
+	}
+	addRepeated();
+	m_sBatch += getTimeString(oTime) + " " + sStr + "\n";
+	m_sLastStr = std::move(sStr);
+	m_oLastStrTime = oTime;
+}
+void LogWriter::addRepeated() noexcept
+{
+	if (m_nLastStrRepeated == 0) {
+		return; //--------------------------------------------------------------
+	}
+	m_sBatch += getTimeString(m_oLastStrTime) + " " + m_sLastStr + "  (x" + std::to_string(m_nLastStrRepeated) + ")\n";
+	m_nLastStrRepeated = 0;
+}
+void LogWriter::writeBatch() noexcept
+{
+	if (m_sBatch.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	if ((m_oInit.m_nMaxFileBytes > 0) && (m_nFileBytes > 0)
+			&& (m_nFileBytes + static_cast<int64_t>(m_sBatch.size()) > m_oInit.m_nMaxFileBytes)) {
+		rotateFile();
+	}
+	if ((m_nFd < 0) && ! openFile()) {
+		// The lines are lost
+		m_sBatch.clear();
+		return; //--------------------------------------------------------------
+	}
+	const char* p0Cur = m_sBatch.c_str();
+	std::size_t nLeft = m_sBatch.size();
+	while (nLeft > 0) {
+		const ssize_t nWritten = ::write(m_nFd, p0Cur, nLeft);
+		if (nWritten < 0) {
+			if (errno == EINTR) {
+				continue; // while ------------------------------------------------
+			}
+			reportError("Could not write log " + m_oInit.m_sFilePath + ": " + getErrnoString(errno));
+			break; // while ----------------------------------------------------
+		}
+		p0Cur += nWritten;
+		nLeft -= nWritten;
+		m_nFileBytes += nWritten;
+		m_bUnsynced = true;
+	}
+	m_sBatch.clear();
+}
+void LogWriter::syncFile() noexcept
+{
+	if (m_nFd >= 0) {
+		::fdatasync(m_nFd);
+	}
+	m_bUnsynced = false;
+	m_oSyncTime = std::chrono::steady_clock::now();
+}
+void LogWriter::rotateFile() noexcept
+{
+	if (m_nFd >= 0) {
+		syncFile();
+		::close(m_nFd);
+		m_nFd = -1;
+	}
+	const std::string& sFilePath = m_oInit.m_sFilePath;
+	const int32_t nTotRotated = m_oInit.m_nTotRotatedFiles;
+	if (nTotRotated > 0) {
+		// The oldest is overwritten
+		for (int32_t nIdx = nTotRotated - 1; nIdx >= 1; --nIdx) {
+			::rename((sFilePath + "." + std::to_string(nIdx)).c_str(), (sFilePath + "." + std::to_string(nIdx + 1)).c_str());
+		}
+		::rename(sFilePath.c_str(), (sFilePath + ".1").c_str());
+	}
+	// If not renamed it's truncated
+	openFile();
+}
+bool LogWriter::openFile() noexcept
+{
+	m_nFd = ::open(m_oInit.m_sFilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+	if (m_nFd < 0) {
+		reportError("Could not create log " + m_oInit.m_sFilePath + ": " + getErrnoString(errno));
+		return false; //--------------------------------------------------------
+	}
+	m_nFileBytes = 0;
+	m_bErrorReported = false;
+	return true;
+}
+void LogWriter::reportError(const std::string& sError) noexcept
+{
+	if (m_bErrorReported) {
+		return; //--------------------------------------------------------------
+	}
+	m_bErrorReported = true;
+	std::cerr << "Error: " << sError << '\n';
+}
+std::string LogWriter::getTimeString(const LogRingBuffer::TimePoint& oTime) noexcept
+{
+	// Like SonoModel::getShortNowString()
+	const time_t nTime = std::chrono::system_clock::to_time_t(oTime);
+	struct tm oTm;
+	::localtime_r(&nTime, &oTm);
+	char aBuffer[16];
+	const std::size_t nLen = ::strftime(aBuffer, sizeof(aBuffer), "%H%M%S", &oTm);
+	return std::string(aBuffer, nLen);
+}
+
+} // namespace sono
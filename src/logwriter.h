@@ -0,0 +1,161 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   logwriter.h
+ */
+
+#ifndef SONO_LOG_WRITER_H
+#define SONO_LOG_WRITER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+using std::unique_ptr;
+
+/** Lock-free multiple producer single consumer ring buffer of log lines.
+ * The producers are the threads that log, the consumer the writer thread.
+ */
+class LogRingBuffer
+{
+public:
+	using TimePoint = std::chrono::system_clock::time_point;
+	/** Constructor.
+	 * @param nMinCapacity The minimum number of lines. Is rounded up to a power of two.
+	 */
+	explicit LogRingBuffer(int32_t nMinCapacity) noexcept;
+	/** Adds a line.
+	 * Can be called by any thread.
+	 * @return Whether there was space.
+	 */
+	bool push(const TimePoint& oTime, std::string&& sStr) noexcept;
+	/** Removes the oldest line.
+	 * Must only be called by the consumer.
+	 * @return Whether there was a line.
+	 */
+	bool pop(TimePoint& oTime, std::string& sStr) noexcept;
+	int32_t getCapacity() const noexcept;
+private:
+	struct Slot
+	{
+		// The push position the slot can be written for, that plus one once written
+		std::atomic<uint32_t> m_nSeq;
+		TimePoint m_oTime;
+		std::string m_sStr;
+	};
+	unique_ptr<Slot[]> m_aSlots;
+	uint32_t m_nCapacity;
+	uint32_t m_nMask;
+	// The positions are free running, the index is obtained with m_nMask
+	std::atomic<uint32_t> m_nPushPos; // claimed by the producers
+	char m_aPadding[64]; // keep the positions in different cache lines
+	uint32_t m_nPopPos; // only used by the consumer
+};
+
+/** Writes a log file in a background thread.
+ * The lines are queued without blocking and written in batches. A line
+ * repeated several times in a row is written once, followed by a line
+ * with the number of repetitions. The file is synced periodically and
+ * rotated when too big.
+ */
+class LogWriter
+{
+public:
+	struct Init
+	{
+		std::string m_sFilePath;
+		// The max time a written line might not be on the device, if 0 each batch is synced
+		int32_t m_nSyncMillisec = 2000;
+		// The file is rotated when bigger, never if 0
+		int64_t m_nMaxFileBytes = 10 * 1000 * 1000;
+		// The rotated files are m_sFilePath.1 (the most recent) to m_sFilePath.N
+		int32_t m_nTotRotatedFiles = 3;
+	};
+	explicit LogWriter(Init&& oInit) noexcept;
+	/** Destructor.
+	 * Writes the queued lines. See stop().
+	 */
+	~LogWriter() noexcept;
+
+	/** Creates the file and starts the writer thread.
+	 * An existing file is truncated.
+	 * @return The error or empty if successful.
+	 */
+	std::string start() noexcept;
+	/** Writes the queued lines, syncs the file and stops the thread.
+	 * Blocks until the thread has terminated.
+	 */
+	void stop() noexcept;
+
+	/** Queues a line.
+	 * Can be called by any thread. Doesn't block: if the queue is full
+	 * the line is dropped and the number of dropped lines is logged later.
+	 * @param sStr The line. Cannot contain newlines.
+	 */
+	void log(const std::string& sStr) noexcept;
+
+	/** The number of lines that were dropped because the queue was full. */
+	int64_t getTotDropped() const noexcept;
+
+private:
+	void writerThreadRun() noexcept;
+	void addLine(const LogRingBuffer::TimePoint& oTime, std::string&& sStr) noexcept;
+	void addRepeated() noexcept;
+	void writeBatch() noexcept;
+	void syncFile() noexcept;
+	void rotateFile() noexcept;
+	bool openFile() noexcept;
+	void reportError(const std::string& sError) noexcept;
+	static std::string getTimeString(const LogRingBuffer::TimePoint& oTime) noexcept;
+
+	const Init m_oInit;
+	LogRingBuffer m_oRing;
+	std::thread m_oWriterThread;
+	std::atomic<bool> m_bStopping;
+	std::atomic<int64_t> m_nTotDropped;
+	std::mutex m_oWakeMutex;
+	std::condition_variable m_oWakeCondition;
+	// Only used by the writer thread
+	int m_nFd;
+	int64_t m_nFileBytes;
+	std::string m_sBatch;
+	std::string m_sLastStr;
+	LogRingBuffer::TimePoint m_oLastStrTime; // of the last repetition
+	int32_t m_nLastStrRepeated; // not written yet
+	std::chrono::steady_clock::time_point m_oRepeatedTime; // of the first repetition not written yet
+	int64_t m_nReportedDropped;
+	bool m_bUnsynced;
+	std::chrono::steady_clock::time_point m_oSyncTime;
+	bool m_bErrorReported;
+private:
+	LogWriter() = delete;
+	LogWriter(const LogWriter& oSource) = delete;
+	LogWriter& operator=(const LogWriter& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_LOG_WRITER_H */
@@ -19,10 +19,12 @@
  */
 
 #include "config.h"
+#include "controlsocket.h"
 #include "sonowindow.h"
 #include "sonomodel.h"
 #include "sonodevicemanager.h"
 #include "evalargs.h"
+#include "logwriter.h"
 #include "util.h"
 
 #include <stmm-input-gtk/gtkaccessor.h>
@@ -36,7 +38,6 @@
 #include <string>
 #include <stdexcept>
 #include <memory>
-#include <fstream>
 
 #include <stdint.h>
 #include <unistd.h>
@@ -93,6 +94,28 @@ static void printUsage() noexcept
 	std::cout << "                   String to prepend to name of generated recordings (default is nothing)." << '\n';
 	std::cout << "                   The string can only contain letters (A-Za-z), numbers (0-9), dashes (-)." << '\n';
 	std::cout << "                   The un-prepended format of a file is for example '" << SonoModel::getNowString() << ".ogg'." << '\n';
+	std::cout << "                   A recording started within the same second as the previous one" << '\n';
+	std::cout << "                   gets the milliseconds appended, for example '" << SonoModel::getNowString() << "-317.ogg'." << '\n';
+	std::cout << "  --gapless        Start the next recording before the current one ends," << '\n';
+	std::cout << "                   so that no sound is lost when switching file." << '\n';
+	std::cout << "  --capture SOURCE Record in-process instead of with the '" << SonoModel::s_sRecordingProgram << "' program." << '\n';
+	std::cout << "                   SOURCE is 'alsa' (default device), 'alsa:DEVICE'" << '\n';
+	std::cout << "                   or, for testing, 'tone', 'noise' or 'fake[:OPTIONS]'." << '\n';
+	std::cout << "                   The fake source writes noise as fast as requested, OPTIONS is a" << '\n';
+	std::cout << "                   comma separated list of rate=SIZE (bytes per second), fail=SIZE," << '\n';
+	std::cout << "                   stall=SIZE, stallsec=N, xrun=N. Ex. 'fake:rate=200MB,fail=1GB'." << '\n';
+	std::cout << "                   Implies --sound-format wav." << '\n';
+	std::cout << "  --max-parallel-copies N" << '\n';
+	std::cout << "                   Max number of sticks recordings are copied to at the same time" << '\n';
+	std::cout << "                   (default: " << SonoModel::Init{}.m_nMaxParallelCopies << "). Each stick gets one file at a time." << '\n';
+	std::cout << "  --follow-copy    Copy the current recording to a stick while it is being recorded," << '\n';
+	std::cout << "                   so that only its tail is left to copy when it ends." << '\n';
+	std::cout << "  --direct-to-stick" << '\n';
+	std::cout << "                   Record directly to a stick with enough space, if there is one," << '\n';
+	std::cout << "                   instead of the recording directory. Not with --capture." << '\n';
+	std::cout << "  --mirror-to-stick" << '\n';
+	std::cout << "                   Also write the recording to a stick with enough space, if there is" << '\n';
+	std::cout << "                   one, so that it only has to be verified. Only with --capture." << '\n';
 	std::cout << "  -x --exclude-mount NAME" << '\n';
 	std::cout << "                   Exclude mount name. Repeat this option to exclude more than one name." << '\n';
 	std::cout << "  -p --speech-app CMD" << '\n';
@@ -101,15 +124,37 @@ static void printUsage() noexcept
 	std::cout << "                   Directory path where log files should be stored." << '\n';
 	std::cout << "                   If the directory doesn't exist, it is created." << '\n';
 	std::cout << "                   Example: \"/home/pi/logs\"." << '\n';
+	std::cout << "  --log-max-size FILESIZE" << '\n';
+	std::cout << "                   Size after which the log file is rotated (default: " << LogWriter::Init{}.m_nMaxFileBytes << "B)." << '\n';
+	std::cout << "                   The last " << LogWriter::Init{}.m_nTotRotatedFiles << " rotated files are kept. If 0 the log is never rotated." << '\n';
+	std::cout << "                   Number can be followed by B, KB, MB, GB." << '\n';
+	std::cout << "  --log-sync MILLISEC" << '\n';
+	std::cout << "                   Max time a logged line might not be written to the device" << '\n';
+	std::cout << "                   (default: " << LogWriter::Init{}.m_nSyncMillisec << "). If 0 each written batch is synced." << '\n';
 	std::cout << "  --wifi-on        Turn on wifi. Has precedence over --wifi-off." << '\n';
 	std::cout << "  --wifi-off       Shutdown wifi, unless a file named 'sonorem.wifi' is found" << '\n';
 	std::cout << "                   on a mounted stick when the program is started." << '\n';
 	std::cout << "  --bluetooth-on   Turn on bluetooth. Has precedence over --bluetooth-off." << '\n';
 	std::cout << "  --bluetooth-off  Shutdown bluetooth, unless a file named 'sonorem.bluetooth' is found" << '\n';
 	std::cout << "                   on a mounted stick when the program is started." << '\n';
+	std::cout << "  --send CMD       Send a command to the running instance, print its reply and exit." << '\n';
+	std::cout << "                   CMD is one of 'start', 'stop', 'status', 'tell', 'unmount', 'quit'." << '\n';
+}
+
+static int sendCommand(const std::string& sCommand) noexcept
+{
+	std::string sReply;
+	const std::string sError = ControlSocket::send(SonoModel::s_sControlSocketName, sCommand, sReply);
+	if (! sError.empty()) {
+		std::cerr << "Error: " << sError << '\n';
+		return EXIT_FAILURE; //-------------------------------------------------
+	}
+	std::cout << sReply << '\n';
+	return EXIT_SUCCESS;
 }
 
-static int startWindow(SonoModel::Init&& oInit, const std::string& sSpeechApp, const std::string& sLogDirPath, bool bKeepOnTop) noexcept
+static int startWindow(SonoModel::Init&& oInit, const std::string& sSpeechApp, const std::string& sLogDirPath
+						, LogWriter::Init&& oLogInit, bool bKeepOnTop) noexcept
 {
 	if (oInit.m_bAutoStart) {
 		::sleep(s_nInitialAutostartSleepSeconds);
@@ -137,24 +182,16 @@ static int startWindow(SonoModel::Init&& oInit, const std::string& sSpeechApp, c
 	const bool bDebug = oInit.m_bDebug;
 	//
 	const bool bLogToFile = ! sLogDirPath.empty();
-	struct LogData
-	{
-		std::ofstream m_oStream;
-		std::ofstream::pos_type m_nLastStrPos = 0;
-		std::string m_sLastStr;
-		std::string m_sLastTime;
-		int32_t m_nLastStrRepeated = 0;
-	};
-	unique_ptr<LogData> refLogData;
-	const std::string sLogFilePath = sLogDirPath + "/sonorem" + SonoModel::getNowString() + ".log";
+	// Written in the background, the model logs a lot with --debug
+	unique_ptr<LogWriter> refLogWriter;
 	if (bLogToFile) {
-        refLogData = std::make_unique<LogData>();
-		refLogData->m_oStream.open(sLogFilePath, std::ios_base::out | std::ios_base::trunc);
-		if (! refLogData->m_oStream) {
-			std::cerr << "Error: could not create log " << sLogFilePath << '\n';
+		oLogInit.m_sFilePath = sLogDirPath + "/sonorem" + SonoModel::getNowString() + ".log";
+		refLogWriter = std::make_unique<LogWriter>(std::move(oLogInit));
+		const std::string sLogError = refLogWriter->start();
+		if (! sLogError.empty()) {
+			std::cerr << "Error: " << sLogError << '\n';
 			return EXIT_FAILURE; //---------------------------------------------
 		}
-		refLogData->m_oStream.close();
 	}
 	//
 	std::string sPreWindow;
@@ -165,26 +202,8 @@ static int startWindow(SonoModel::Init&& oInit, const std::string& sSpeechApp, c
 		if (bVerbose) {
 			std::cout << "sonorem: " << sStr << '\n';
 		}
-		if (bLogToFile && ! sStr.empty()) {
-			refLogData->m_oStream.open(sLogFilePath, std::ios_base::out | std::ios_base::in);
-			if (! refLogData->m_oStream) {
-				std::cerr << "Error: could not open log " << sLogFilePath << '\n';
-			} else {
-				if (refLogData->m_sLastStr == sStr) {
-					refLogData->m_oStream.seekp(refLogData->m_nLastStrPos);
-					++(refLogData->m_nLastStrRepeated);
-					refLogData->m_oStream << refLogData->m_sLastTime << " " << sStr << std::endl;
-					refLogData->m_oStream << SonoModel::getShortNowString() << " " << sStr << " " << " (x" << refLogData->m_nLastStrRepeated - 1 << ")" << std::endl;
-				} else {
-					refLogData->m_oStream.seekp(0, std::ios_base::end);
-					refLogData->m_nLastStrPos = refLogData->m_oStream.tellp();
-					refLogData->m_sLastStr = sStr;
-					refLogData->m_sLastTime = SonoModel::getShortNowString();
-					refLogData->m_nLastStrRepeated = 1;
-					refLogData->m_oStream << refLogData->m_sLastTime << " " << sStr << std::endl;
-				}
-				refLogData->m_oStream.close();
-			}
+		if (bLogToFile) {
+			refLogWriter->log(sStr);
 		}
 		if (refWindow) {
 			if (! sPreWindow.empty()) {
@@ -235,6 +254,8 @@ int sonoremMain(int nArgC, char** aArgV) noexcept
 	int32_t nSeconds = 0;
 	std::string sSpeechApp;
 	std::string sLogDirPath;
+	std::string sSendCommand;
+	LogWriter::Init oLogInit;
 	//
 	bool bHelp = false;
 	bool bVersion = false;
@@ -273,6 +294,14 @@ int sonoremMain(int nArgC, char** aArgV) noexcept
 		//
 		evalBoolArg(nArgC, aArgV, "--exclude-all-mounts", "", sMatch, oInit.m_bExcludeAllMountNames);
 		//
+		evalBoolArg(nArgC, aArgV, "--gapless", "", sMatch, oInit.m_bGaplessRotation);
+		//
+		evalBoolArg(nArgC, aArgV, "--follow-copy", "", sMatch, oInit.m_bFollowCopy);
+		//
+		evalBoolArg(nArgC, aArgV, "--direct-to-stick", "", sMatch, oInit.m_bDirectToStick);
+		//
+		evalBoolArg(nArgC, aArgV, "--mirror-to-stick", "", sMatch, oInit.m_bMirrorToStick);
+		//
 		bool bOk = evalIntArg(nArgC, aArgV, "--hours", "-H", sMatch, nHours, 0);
 		if (!bOk) {
 			return EXIT_FAILURE; //---------------------------------------------
@@ -318,6 +347,16 @@ int sonoremMain(int nArgC, char** aArgV) noexcept
 			return EXIT_FAILURE; //---------------------------------------------
 		}
 		//
+		bOk = evalDirPathArg(nArgC, aArgV, false, "--capture", "", true, sMatch, oInit.m_sCaptureSource);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--max-parallel-copies", "", sMatch, oInit.m_nMaxParallelCopies, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
 		std::string sMountName;
 		bOk = evalDirPathArg(nArgC, aArgV, true, "-x", "--exclude-mount", true, sMatch, sMountName);
 		if (bOk) {
@@ -338,6 +377,21 @@ int sonoremMain(int nArgC, char** aArgV) noexcept
 			return EXIT_FAILURE; //---------------------------------------------
 		}
 		//
+		bOk = evalMemSizeArg(nArgC, aArgV, "--log-max-size", "", sMatch, oLogInit.m_nMaxFileBytes, 0);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--log-sync", "", sMatch, oLogInit.m_nSyncMillisec, 0);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalDirPathArg(nArgC, aArgV, true, "--send", "", true, sMatch, sSendCommand);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
 		if (nOldArgC == nArgC) {
 			std::cerr << "Unknown argument: " << ((aArgV[1] == nullptr) ? "(null)" : std::string(aArgV[1])) << '\n';
 			std::cerr << "Run with --help for details." << '\n';
@@ -345,6 +399,10 @@ int sonoremMain(int nArgC, char** aArgV) noexcept
 		}
 		aArgV[0] = p0ArgVZeroSave;
 	}
+	if (! sSendCommand.empty()) {
+		// The other options are ignored
+		return sendCommand(strStrip(sSendCommand));
+	}
 
 	if (nHours + nMinutes + nSeconds == 0) {
 		nHours = 1;
@@ -397,7 +455,7 @@ int sonoremMain(int nArgC, char** aArgV) noexcept
 		sSpeechApp = s_sDefaultSpeechApp;
 	}
 
-	return startWindow(std::move(oInit), sSpeechApp, sLogDirPath, bKeepOnTop);
+	return startWindow(std::move(oInit), sSpeechApp, sLogDirPath, std::move(oLogInit), bKeepOnTop);
 }
 
 } // namespace sono
@@ -0,0 +1,278 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   mirrorwriter.cc
+ */
+
+#include "mirrorwriter.h"
+
+#include "util.h"
+
+#include <cassert>
+#include <chrono>
+#include <system_error>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+MirrorWriter::MirrorWriter(int64_t nMaxQueuedBytes) noexcept
+: m_nMaxQueuedBytes(nMaxQueuedBytes)
+, m_refShared(std::make_shared<SharedData>())
+, m_nFileNr(-1)
+{
+	assert(nMaxQueuedBytes > 0);
+}
+MirrorWriter::~MirrorWriter() noexcept
+{
+	stop(-1);
+}
+std::string MirrorWriter::start() noexcept
+{
+	assert(! m_oThread.joinable());
+	try {
+		m_oThread = std::thread(&MirrorWriter::run, m_refShared);
+	} catch (const std::system_error& oErr) {
+		return std::string{"Could not start mirror thread: "} + oErr.what(); //--
+	}
+	return "";
+}
+bool MirrorWriter::stop(int32_t nMaxWaitMillisec) noexcept
+{
+	if (! m_oThread.joinable()) {
+		return true; //---------------------------------------------------------
+	}
+	SharedData& oShared = *m_refShared;
+	std::unique_lock<std::mutex> oLock(oShared.m_oMutex);
+	oShared.m_bStop = true;
+	oShared.m_oCondition.notify_one();
+	auto oIsFinished = [&]()
+	{
+		return oShared.m_bFinished;
+	};
+	bool bFinished = true;
+	if (nMaxWaitMillisec < 0) {
+		oShared.m_oFinishedCondition.wait(oLock, oIsFinished);
+	} else {
+		bFinished = oShared.m_oFinishedCondition.wait_for(oLock, std::chrono::milliseconds(nMaxWaitMillisec), oIsFinished);
+	}
+	if (! bFinished) {
+		// Blocked in the kernel, can't be canceled
+		oShared.m_bAbandoned = true;
+	}
+	oLock.unlock();
+	if (bFinished) {
+		m_oThread.join();
+	} else {
+		m_oThread.detach();
+	}
+	return bFinished;
+}
+void MirrorWriter::open(const std::string& sPath) noexcept
+{
+	++m_nFileNr;
+	m_sPath = sPath;
+	Op oOp;
+	oOp.m_eType = Op::OP_TYPE_OPEN;
+	oOp.m_nFileNr = m_nFileNr;
+	oOp.m_sPath = sPath;
+	std::lock_guard<std::mutex> oLock(m_refShared->m_oMutex);
+	m_refShared->m_aOps.push_back(std::move(oOp));
+	m_refShared->m_oCondition.notify_one();
+}
+bool MirrorWriter::write(const void* p0Buf, int64_t nBytes, int64_t nOffset) noexcept
+{
+	assert(m_nFileNr >= 0);
+	SharedData& oShared = *m_refShared;
+	std::lock_guard<std::mutex> oLock(oShared.m_oMutex);
+	if (oShared.m_nFailedFileNr == m_nFileNr) {
+		return false; //--------------------------------------------------------
+	}
+	if (oShared.m_nQueuedBytes + nBytes > m_nMaxQueuedBytes) {
+		// The thread can't keep up: drop the file rather than using more memory
+		oShared.m_nFailedFileNr = m_nFileNr;
+		oShared.m_sDroppedError = "Mirror " + m_sPath + " dropped: writing to it is too slow";
+		while ((! oShared.m_aOps.empty()) && (oShared.m_aOps.back().m_eType == Op::OP_TYPE_WRITE)
+				&& (oShared.m_aOps.back().m_nFileNr == m_nFileNr)) {
+			oShared.m_nQueuedBytes -= static_cast<int64_t>(oShared.m_aOps.back().m_sData.size());
+			oShared.m_aOps.pop_back();
+		}
+		oShared.m_oCondition.notify_one();
+		return false; //--------------------------------------------------------
+	}
+	Op oOp;
+	oOp.m_eType = Op::OP_TYPE_WRITE;
+	oOp.m_nFileNr = m_nFileNr;
+	oOp.m_sData.assign(static_cast<const char*>(p0Buf), nBytes);
+	oOp.m_nOffset = nOffset;
+	oShared.m_aOps.push_back(std::move(oOp));
+	oShared.m_nQueuedBytes += nBytes;
+	oShared.m_oCondition.notify_one();
+	return true;
+}
+void MirrorWriter::close(const std::string& sChecksumFilePath, std::string&& sChecksumContent
+						, std::function<void(const std::string& sError)>&& oDone) noexcept
+{
+	assert(m_nFileNr >= 0);
+	Op oOp;
+	oOp.m_eType = Op::OP_TYPE_CLOSE;
+	oOp.m_nFileNr = m_nFileNr;
+	oOp.m_sPath = sChecksumFilePath;
+	oOp.m_sData = std::move(sChecksumContent);
+	oOp.m_oDone = std::move(oDone);
+	std::lock_guard<std::mutex> oLock(m_refShared->m_oMutex);
+	m_refShared->m_aOps.push_back(std::move(oOp));
+	m_refShared->m_oCondition.notify_one();
+}
+bool MirrorWriter::hasFileFailed() const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_refShared->m_oMutex);
+	return (m_refShared->m_nFailedFileNr == m_nFileNr);
+}
+MirrorWriter::WriteStats MirrorWriter::getWriteStats() const noexcept
+{
+	WriteStats oStats;
+	oStats.m_nWrites = m_refShared->m_nWrites.load(std::memory_order_relaxed);
+	oStats.m_nTotalMicrosec = m_refShared->m_nTotalMicrosec.load(std::memory_order_relaxed);
+	oStats.m_nMaxMicrosec = m_refShared->m_nMaxMicrosec.load(std::memory_order_relaxed);
+	return oStats;
+}
+void MirrorWriter::run(std::shared_ptr<SharedData> refShared) noexcept
+{
+	SharedData& oShared = *refShared;
+	int nFd = -1;
+	std::string sPath;
+	int32_t nFileNr = -1;
+	bool bCreated = false; // only the file created by the thread is ever removed
+	std::string sError; // of the current file
+	auto oRemoveFile = [&]()
+	{
+		if (nFd >= 0) {
+			::close(nFd);
+			nFd = -1;
+		}
+		if (bCreated) {
+			::unlink(sPath.c_str());
+			bCreated = false;
+		}
+	};
+	while (true) {
+		Op oOp;
+		{
+			std::unique_lock<std::mutex> oLock(oShared.m_oMutex);
+			oShared.m_oCondition.wait(oLock, [&]()
+			{
+				return oShared.m_bStop || ! oShared.m_aOps.empty();
+			});
+			if (oShared.m_aOps.empty()) {
+				break; //-------------------------------------------------------
+			}
+			oOp = std::move(oShared.m_aOps.front());
+			oShared.m_aOps.pop_front();
+			if (oOp.m_eType == Op::OP_TYPE_OPEN) {
+				nFileNr = oOp.m_nFileNr;
+				sPath = oOp.m_sPath;
+				bCreated = false;
+				sError.clear();
+			}
+			if ((oShared.m_nFailedFileNr == nFileNr) && ! oShared.m_sDroppedError.empty() && sError.empty()) {
+				sError = oShared.m_sDroppedError;
+				if (oOp.m_eType != Op::OP_TYPE_OPEN) {
+					oRemoveFile();
+				}
+			}
+		}
+		if (oOp.m_eType == Op::OP_TYPE_OPEN) {
+			if (sError.empty()) {
+				nFd = ::open(sPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+				if (nFd < 0) {
+					sError = "Could not create " + sPath + ": " + getErrnoString(errno);
+				} else {
+					bCreated = true;
+				}
+			}
+		} else if (oOp.m_eType == Op::OP_TYPE_WRITE) {
+			const int64_t nBytes = static_cast<int64_t>(oOp.m_sData.size());
+			if (nFd >= 0) {
+				const auto oStart = std::chrono::steady_clock::now();
+				const bool bWritten = pwriteAll(nFd, oOp.m_sData.data(), nBytes, oOp.m_nOffset);
+				const int nErrno = errno;
+				const int64_t nMicrosec = std::chrono::duration_cast<std::chrono::microseconds>(
+														std::chrono::steady_clock::now() - oStart).count();
+				oShared.m_nWrites.fetch_add(1, std::memory_order_relaxed);
+				oShared.m_nTotalMicrosec.fetch_add(nMicrosec, std::memory_order_relaxed);
+				if (nMicrosec > oShared.m_nMaxMicrosec.load(std::memory_order_relaxed)) {
+					oShared.m_nMaxMicrosec.store(nMicrosec, std::memory_order_relaxed);
+				}
+				if (! bWritten) {
+					sError = "Error writing " + sPath + ": " + getErrnoString(nErrno);
+					oRemoveFile();
+				}
+			}
+			std::lock_guard<std::mutex> oLock(oShared.m_oMutex);
+			oShared.m_nQueuedBytes -= nBytes;
+			if ((! sError.empty()) && (oShared.m_nFailedFileNr != nFileNr)) {
+				// The producer stops queuing writes
+				oShared.m_nFailedFileNr = nFileNr;
+				oShared.m_sDroppedError.clear();
+			}
+		} else {
+			assert(oOp.m_eType == Op::OP_TYPE_CLOSE);
+			if (nFd >= 0) {
+				if (::close(nFd) != 0) {
+					sError = "Error closing " + sPath + ": " + getErrnoString(errno);
+				}
+				nFd = -1;
+			}
+			const std::string& sChecksumFilePath = oOp.m_sPath;
+			if (sError.empty() && ! sChecksumFilePath.empty()) {
+				const int nChecksumFd = ::open(sChecksumFilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+				if (nChecksumFd < 0) {
+					sError = "Could not create " + sChecksumFilePath + ": " + getErrnoString(errno);
+				} else {
+					// The sync of the recording doesn't include this file
+					const bool bOk = pwriteAll(nChecksumFd, oOp.m_sData.data(), oOp.m_sData.size(), 0)
+									&& (::fdatasync(nChecksumFd) == 0);
+					const int nErrno = errno;
+					if ((::close(nChecksumFd) != 0) || ! bOk) {
+						sError = "Error writing " + sChecksumFilePath + ": " + getErrnoString(bOk ? errno : nErrno);
+						::unlink(sChecksumFilePath.c_str());
+					}
+				}
+			}
+			if (! sError.empty()) {
+				oRemoveFile();
+			}
+			std::lock_guard<std::mutex> oLock(oShared.m_oMutex);
+			if ((! oShared.m_bAbandoned) && oOp.m_oDone) {
+				// Within the lock: once abandoned the producer might be gone
+				oOp.m_oDone(sError);
+			}
+		}
+	}
+	if (nFd >= 0) {
+		::close(nFd);
+	}
+	std::lock_guard<std::mutex> oLock(oShared.m_oMutex);
+	oShared.m_bFinished = true;
+	oShared.m_oFinishedCondition.notify_all();
+}
+
+} // namespace sono
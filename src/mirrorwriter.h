@@ -0,0 +1,151 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   mirrorwriter.h
+ */
+
+#ifndef SONO_MIRROR_WRITER_H
+#define SONO_MIRROR_WRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Writes a sequence of files in its own thread.
+ * Used for the mirrors of the captured segments: the encoder thread only
+ * queues the operations, a slow or hung stick can't make it lose frames.
+ * When more than a max number of bytes are waiting to be written the file
+ * is dropped: the rest of its writes are ignored and it is removed.
+ *
+ * Apart from the constructor, the destructor and stop() the methods must
+ * be called by one thread (the producer).
+ */
+class MirrorWriter
+{
+public:
+	/** Constructor.
+	 * @param nMaxQueuedBytes The max number of bytes waiting to be written. Must be positive.
+	 */
+	explicit MirrorWriter(int64_t nMaxQueuedBytes) noexcept;
+	/** Destructor.
+	 * Calls stop() if not already done, waiting as long as needed.
+	 */
+	~MirrorWriter() noexcept;
+
+	/** Starts the thread.
+	 * @return The error or empty if successful.
+	 */
+	std::string start() noexcept;
+	/** Writes what was queued and terminates the thread.
+	 * If the thread doesn't terminate in time it is abandoned, the completions
+	 * of the files not yet closed are never called.
+	 * @param nMaxWaitMillisec The max time to wait or -1 for no limit.
+	 * @return Whether the thread terminated in time.
+	 */
+	bool stop(int32_t nMaxWaitMillisec) noexcept;
+
+	/** Queues the creation of a file.
+	 * The previous file must have been closed.
+	 * @param sPath The file. Must not exist.
+	 */
+	void open(const std::string& sPath) noexcept;
+	/** Queues a write to the file.
+	 * @param p0Buf The bytes. Are copied.
+	 * @param nBytes The number of bytes.
+	 * @param nOffset The offset in the file.
+	 * @return Whether queued. False if the file failed or was dropped, now or before.
+	 */
+	bool write(const void* p0Buf, int64_t nBytes, int64_t nOffset) noexcept;
+	/** Queues the closing of the file.
+	 * @param sChecksumFilePath The file to create with sChecksumContent once closed or empty if none.
+	 * @param sChecksumContent The content of the checksum file.
+	 * @param oDone Called from the thread with the error or empty if successful.
+	 *              If not successful the file (and its checksum file) was removed.
+	 */
+	void close(const std::string& sChecksumFilePath, std::string&& sChecksumContent
+				, std::function<void(const std::string& sError)>&& oDone) noexcept;
+	/** Whether the file failed or was dropped. */
+	bool hasFileFailed() const noexcept;
+
+	struct WriteStats
+	{
+		int64_t m_nWrites = 0;
+		int64_t m_nTotalMicrosec = 0;
+		int64_t m_nMaxMicrosec = 0;
+	};
+	/** The latency of the writes. Can be called from any thread. */
+	WriteStats getWriteStats() const noexcept;
+
+private:
+	struct Op
+	{
+		enum OP_TYPE
+		{
+			OP_TYPE_OPEN = 0
+			, OP_TYPE_WRITE = 1
+			, OP_TYPE_CLOSE = 2
+		};
+		OP_TYPE m_eType = OP_TYPE_OPEN;
+		int32_t m_nFileNr = 0;
+		std::string m_sPath; // open: the file, close: the checksum file
+		std::string m_sData; // write: the bytes, close: the content of the checksum file
+		int64_t m_nOffset = 0;
+		std::function<void(const std::string& sError)> m_oDone;
+	};
+	// Shared with the thread, outlives the writer if the thread is abandoned
+	struct SharedData
+	{
+		mutable std::mutex m_oMutex;
+		std::condition_variable m_oCondition; // the thread waits for operations
+		std::condition_variable m_oFinishedCondition; // stop() waits for the thread
+		std::deque<Op> m_aOps;
+		int64_t m_nQueuedBytes = 0; // including the write being done
+		int32_t m_nFailedFileNr = -1; // the file that failed or was dropped
+		std::string m_sDroppedError; // why m_nFailedFileNr was dropped, empty if it failed
+		bool m_bStop = false;
+		bool m_bAbandoned = false;
+		bool m_bFinished = false;
+		std::atomic<int64_t> m_nWrites{0};
+		std::atomic<int64_t> m_nTotalMicrosec{0};
+		std::atomic<int64_t> m_nMaxMicrosec{0};
+	};
+	static void run(std::shared_ptr<SharedData> refShared) noexcept;
+
+	const int64_t m_nMaxQueuedBytes;
+	std::shared_ptr<SharedData> m_refShared;
+	std::thread m_oThread;
+	int32_t m_nFileNr; // of the producer
+	std::string m_sPath; // of the producer
+private:
+	MirrorWriter() = delete;
+	MirrorWriter(const MirrorWriter& oSource) = delete;
+	MirrorWriter& operator=(const MirrorWriter& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_MIRROR_WRITER_H */
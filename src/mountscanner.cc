@@ -0,0 +1,130 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   mountscanner.cc
+ */
+
+#include "mountscanner.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+MountScanner::MountScanner(const std::string& sRootPath, const std::string& sFileNamePrefix) noexcept
+: WorkerThread("scan", false)
+, m_sRootPath(sRootPath)
+, m_sFileNamePrefix(sFileNamePrefix)
+, m_refResult(std::make_shared<Result>())
+{
+}
+std::function<void(WorkerThread::Status& oStatus)> MountScanner::createJob() noexcept
+{
+	const std::string sRootPath = m_sRootPath;
+	const std::string sFileNamePrefix = m_sFileNamePrefix;
+	auto refResult = m_refResult;
+	return [sRootPath, sFileNamePrefix, refResult](Status& /*oStatus*/)
+	{
+		scan(sRootPath, sFileNamePrefix, *refResult);
+	};
+}
+const std::vector<MountScanner::File>& MountScanner::getFiles() const noexcept
+{
+	assert(isFinished());
+	return m_refResult->m_aFiles;
+}
+const std::vector<std::string>& MountScanner::getDirNames() const noexcept
+{
+	assert(isFinished());
+	return m_refResult->m_aDirNames;
+}
+int64_t MountScanner::getFreeBytes() const noexcept
+{
+	assert(isFinished());
+	return m_refResult->m_nFreeBytes;
+}
+void MountScanner::scan(const std::string& sRootPath, const std::string& sFileNamePrefix, Result& oResult) noexcept
+{
+	scanRoot(sRootPath, sFileNamePrefix, oResult);
+	oResult.m_nFreeBytes = getFsFreeBytes(sRootPath);
+}
+void MountScanner::scanRoot(const std::string& sRootPath, const std::string& sFileNamePrefix, Result& oResult) noexcept
+{
+	DIR* p0Dir = ::opendir(sRootPath.c_str());
+	if (p0Dir == nullptr) {
+		return; //--------------------------------------------------------------
+	}
+	// The files are opened relative to the directory, the path isn't resolved again
+	const int nDirFd = ::dirfd(p0Dir);
+	while (const struct dirent* p0Entry = ::readdir(p0Dir)) {
+		const std::string sName = p0Entry->d_name;
+		// Case insensitive: vfat sticks written on other systems might
+		// show 'Sonorem.stop' or 'SONOREM.NAME'
+		if ((sName.size() < sFileNamePrefix.size())
+				|| (::strncasecmp(sName.c_str(), sFileNamePrefix.c_str(), sFileNamePrefix.size()) != 0)) {
+			if (sName[0] == '.') {
+				continue;
+			}
+			bool bIsDir = (p0Entry->d_type == DT_DIR);
+			if ((p0Entry->d_type == DT_LNK) || (p0Entry->d_type == DT_UNKNOWN)) {
+				struct stat oStat;
+				bIsDir = (::fstatat(nDirFd, sName.c_str(), &oStat, 0) == 0) && S_ISDIR(oStat.st_mode);
+			}
+			if (bIsDir) {
+				oResult.m_aDirNames.push_back(sName);
+			}
+			continue;
+		}
+		File oFile;
+		oFile.m_sName = sName.substr(sFileNamePrefix.size());
+		std::transform(oFile.m_sName.begin(), oFile.m_sName.end(), oFile.m_sName.begin(), [](char c)
+		{
+			return (((c >= 'A') && (c <= 'Z')) ? static_cast<char>(c - 'A' + 'a') : c);
+		});
+		const bool bMaybeRegular = (p0Entry->d_type == DT_REG) || (p0Entry->d_type == DT_UNKNOWN);
+		if (bMaybeRegular) {
+			const int nFd = ::openat(nDirFd, sName.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK);
+			struct stat oStat;
+			if ((nFd >= 0) && (::fstat(nFd, &oStat) == 0) && S_ISREG(oStat.st_mode)
+					&& (oStat.st_size > 0) && (oStat.st_size <= s_nMaxFileContentsBytes)) {
+				std::string sContents(oStat.st_size, '\0');
+				const int64_t nRead = preadAll(nFd, &(sContents[0]), oStat.st_size, 0);
+				if (nRead > 0) {
+					sContents.resize(nRead);
+					oFile.m_sContents = std::move(sContents);
+				}
+			}
+			if (nFd >= 0) {
+				::close(nFd);
+			}
+		}
+		oResult.m_aFiles.push_back(std::move(oFile));
+	}
+	::closedir(p0Dir);
+}
+
+} // namespace sono
@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   mountscanner.h
+ */
+
+#ifndef SONO_MOUNT_SCANNER_H
+#define SONO_MOUNT_SCANNER_H
+
+#include "workerthread.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Looks at the root of a mount in a worker thread.
+ * Lists the files of the root starting with a prefix (ignoring case) in one pass over the
+ * directory, reads the small ones and gets the free space of the file system,
+ * all operations that can take seconds on a stick that has to wake up.
+ */
+class MountScanner : public WorkerThread
+{
+public:
+	/** Constructor.
+	 * @param sRootPath The root of the mount.
+	 * @param sFileNamePrefix The prefix of the names of the files in the root to look for.
+	 */
+	MountScanner(const std::string& sRootPath, const std::string& sFileNamePrefix) noexcept;
+
+	const std::string& getRootPath() const noexcept { return m_sRootPath; }
+	struct File
+	{
+		std::string m_sName; // without the prefix, lower case
+		std::string m_sContents; // empty if not a regular file or too big
+	};
+	/** The files found with the prefix.
+	 * Only meaningful when finished.
+	 */
+	const std::vector<File>& getFiles() const noexcept;
+	/** The names of the sub-directories of the root, not hidden and not with the prefix.
+	 * Symbolic links to directories included. Only meaningful when finished.
+	 */
+	const std::vector<std::string>& getDirNames() const noexcept;
+	/** The free space of the file system or -1 if it couldn't be determined.
+	 * Also -1 if the thread couldn't be started. Only meaningful when finished.
+	 */
+	int64_t getFreeBytes() const noexcept;
+
+protected:
+	std::function<void(Status& oStatus)> createJob() noexcept override;
+
+private:
+	struct Result
+	{
+		std::vector<File> m_aFiles;
+		std::vector<std::string> m_aDirNames;
+		int64_t m_nFreeBytes = -1;
+	};
+	static void scan(const std::string& sRootPath, const std::string& sFileNamePrefix, Result& oResult) noexcept;
+	static void scanRoot(const std::string& sRootPath, const std::string& sFileNamePrefix, Result& oResult) noexcept;
+
+private:
+	const std::string m_sRootPath;
+	const std::string m_sFileNamePrefix;
+	// Written by the thread, read by the main thread only when finished
+	std::shared_ptr<Result> m_refResult;
+
+	static constexpr const int64_t s_nMaxFileContentsBytes = 4096;
+private:
+	MountScanner() = delete;
+	MountScanner(const MountScanner& oSource) = delete;
+	MountScanner& operator=(const MountScanner& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_MOUNT_SCANNER_H */
@@ -0,0 +1,135 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   recordingtail.cc
+ */
+
+#include "recordingtail.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+// The file is read back in chunks of this size at most
+static constexpr int64_t s_nReadChunkBytes = 64 * 1024;
+
+RecordingTail::RecordingTail(const std::string& sFilePath, int32_t nHeadBytes, int64_t nMaxTailBytes) noexcept
+: m_sFilePath(sFilePath)
+, m_nHeadBytes(nHeadBytes)
+, m_nMaxTailBytes(nMaxTailBytes)
+, m_nFd(-1)
+, m_nReadBytes(0)
+, m_nTailOffset(0)
+, m_nSyncedBytes(0)
+, m_bUpdating(false)
+{
+	assert(nHeadBytes >= 0);
+	assert(nMaxTailBytes > 0);
+}
+RecordingTail::~RecordingTail() noexcept
+{
+	if (m_nFd >= 0) {
+		::close(m_nFd);
+	}
+}
+int64_t RecordingTail::update(bool bSync) noexcept
+{
+	if (m_nFd < 0) {
+		m_nFd = ::open(m_sFilePath.c_str(), O_RDONLY | O_CLOEXEC);
+		if (m_nFd < 0) {
+			return -1; //-------------------------------------------------------
+		}
+	}
+	struct stat oStat;
+	if (::fstat(m_nFd, &oStat) != 0) {
+		return -1; //-----------------------------------------------------------
+	}
+	const int64_t nSizeBytes = oStat.st_size;
+	while (m_nReadBytes < nSizeBytes) {
+		// Usually still in the page cache, the stick isn't read
+		const int64_t nChunkBytes = std::min(nSizeBytes - m_nReadBytes, s_nReadChunkBytes);
+		m_sBuffer.resize(nChunkBytes);
+		const int64_t nRead = preadAll(m_nFd, &(m_sBuffer[0]), nChunkBytes, m_nReadBytes);
+		if (nRead <= 0) {
+			return -1; //-------------------------------------------------------
+		}
+		std::lock_guard<std::mutex> oLock(m_oMutex);
+		if (m_nReadBytes < m_nHeadBytes) {
+			m_sHead.append(m_sBuffer.data(), std::min(nRead, m_nHeadBytes - m_nReadBytes));
+		}
+		m_sTail.append(m_sBuffer.data(), nRead);
+		const int64_t nTailBytes = static_cast<int64_t>(m_sTail.size());
+		if (nTailBytes > m_nMaxTailBytes) {
+			// Not synced for too long, lose the oldest
+			m_sTail.erase(0, nTailBytes - m_nMaxTailBytes);
+			m_nTailOffset += nTailBytes - m_nMaxTailBytes;
+		}
+		m_nReadBytes += nRead;
+	}
+	if (bSync) {
+		// Everything read was written before the sync
+		if (::fdatasync(m_nFd) != 0) {
+			return -1; //-------------------------------------------------------
+		}
+		std::lock_guard<std::mutex> oLock(m_oMutex);
+		m_sTail.clear();
+		m_nTailOffset = m_nReadBytes;
+		m_nSyncedBytes = m_nReadBytes;
+	}
+	return nSizeBytes;
+}
+int64_t RecordingTail::getSyncedBytes() const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	return m_nSyncedBytes;
+}
+int64_t RecordingTail::getUnsyncedBytes() const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	return static_cast<int64_t>(m_sTail.size());
+}
+std::string RecordingTail::save(const std::string& sFilePath) const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	const int nFd = ::open(sFilePath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (nFd < 0) {
+		return "Could not create " + sFilePath + ": " + getErrnoString(errno); //--
+	}
+	// Short files: the tail might start within the head
+	const int64_t nHeadBytes = static_cast<int64_t>(m_sHead.size());
+	const int64_t nTailBytes = static_cast<int64_t>(m_sTail.size());
+	const int64_t nSkipBytes = std::min(nTailBytes, std::max<int64_t>(0, nHeadBytes - m_nTailOffset));
+	const bool bOk = pwriteAll(nFd, m_sHead.data(), nHeadBytes, 0)
+					&& pwriteAll(nFd, m_sTail.data() + nSkipBytes, nTailBytes - nSkipBytes, nHeadBytes)
+					&& (::fdatasync(nFd) == 0);
+	const int nErrno = errno;
+	if ((::close(nFd) != 0) || ! bOk) {
+		return "Error writing " + sFilePath + ": " + getErrnoString(bOk ? errno : nErrno); //--
+	}
+	return "";
+}
+
+} // namespace sono
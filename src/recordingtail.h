@@ -0,0 +1,101 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   recordingtail.h
+ */
+
+#ifndef SONO_RECORDING_TAIL_H
+#define SONO_RECORDING_TAIL_H
+
+#include <mutex>
+#include <string>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Keeps the end of a recording that another process writes to a stick.
+ * The writes only reach the stick through the page cache, a stick pulled
+ * before the data was synced has nothing of it. The bytes not known to be on
+ * the stick yet are read back from the cache and kept in memory together
+ * with the head of the file (the header of the sound format), so that they
+ * can be saved elsewhere when the stick goes away.
+ *
+ * update() can block on the stick: it must be called from a worker thread
+ * and never by two threads at the same time. The other methods can be
+ * called from any thread.
+ */
+class RecordingTail
+{
+public:
+	/** Constructor.
+	 * @param sFilePath The file. Might not exist yet.
+	 * @param nHeadBytes The number of bytes at the start of the file that are always kept. Cannot be negative.
+	 * @param nMaxTailBytes The max number of unsynced bytes kept. Must be positive.
+	 */
+	RecordingTail(const std::string& sFilePath, int32_t nHeadBytes, int64_t nMaxTailBytes) noexcept;
+	~RecordingTail() noexcept;
+
+	const std::string& getFilePath() const noexcept { return m_sFilePath; }
+	/** Reads the bytes added to the file since the last call and optionally syncs it.
+	 * When the sync succeeds the bytes read are known to be on the stick and aren't kept anymore.
+	 * If more than the max tail bytes aren't synced the oldest are lost.
+	 * @param bSync Whether to also sync the file.
+	 * @return The size of the file or -1 if it couldn't be read or synced.
+	 */
+	int64_t update(bool bSync) noexcept;
+	/** The number of bytes of the file that are on the stick. */
+	int64_t getSyncedBytes() const noexcept;
+	/** The number of kept bytes that might not be on the stick. */
+	int64_t getUnsyncedBytes() const noexcept;
+	/** Writes the head and the kept bytes to a new file.
+	 * @param sFilePath The file to create. Must not exist.
+	 * @return The error or empty if successful.
+	 */
+	std::string save(const std::string& sFilePath) const noexcept;
+
+	/** Whether an update was started and not finished.
+	 * Not used by the class, it's up to the caller to set it.
+	 */
+	bool isUpdating() const noexcept { return m_bUpdating; }
+	void setUpdating(bool bUpdating) noexcept { m_bUpdating = bUpdating; }
+private:
+	const std::string m_sFilePath;
+	const int32_t m_nHeadBytes;
+	const int64_t m_nMaxTailBytes;
+	// Only used by update()
+	int m_nFd;
+	int64_t m_nReadBytes;
+	std::string m_sBuffer;
+	//
+	mutable std::mutex m_oMutex;
+	std::string m_sHead;
+	int64_t m_nTailOffset; // the offset in the file of the first byte of m_sTail
+	std::string m_sTail;
+	int64_t m_nSyncedBytes;
+	//
+	bool m_bUpdating;
+private:
+	RecordingTail() = delete;
+	RecordingTail(const RecordingTail& oSource) = delete;
+	RecordingTail& operator=(const RecordingTail& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_RECORDING_TAIL_H */
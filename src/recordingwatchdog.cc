@@ -0,0 +1,153 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   recordingwatchdog.cc
+ */
+
+#include "recordingwatchdog.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+// The stall is checked this many times within the stall time
+static constexpr int32_t s_nStallChecksPerStall = 4;
+static constexpr int32_t s_nMinStallCheckMillisec = 50;
+
+RecordingWatchdog::RecordingWatchdog(const std::string& sFilePath, int32_t nStallMillisec, int32_t nStartStallMillisec) noexcept
+: m_sFilePath(sFilePath)
+, m_sFileName(Glib::path_get_basename(sFilePath))
+, m_nStallMillisec(nStallMillisec)
+, m_nStartStallMillisec(nStartStallMillisec)
+, m_nFd(-1)
+, m_nSizeBytes(-1)
+, m_bGrown(false)
+, m_bClosed(false)
+{
+	assert(nStallMillisec > 0);
+	assert(nStartStallMillisec > 0);
+}
+RecordingWatchdog::~RecordingWatchdog() noexcept
+{
+	m_oModifiedConn.disconnect();
+	m_oCheckStalledConn.disconnect();
+	if (m_nFd >= 0) {
+		::close(m_nFd);
+	}
+}
+std::string RecordingWatchdog::start() noexcept
+{
+	const std::string sDirPath = Glib::path_get_dirname(m_sFilePath);
+	const std::string sError = m_oDirWatcher.addDir(sDirPath, IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE);
+	if (! sError.empty()) {
+		return sError; //-------------------------------------------------------
+	}
+	m_oDirWatcher.m_oChangedSignal.connect(sigc::mem_fun(*this, &RecordingWatchdog::onDirChanged));
+	m_oLastGrowthTime = std::chrono::steady_clock::now();
+	// The file might have been created before the watch
+	updateSize();
+	const int32_t nCheckMillisec = std::max(s_nMinStallCheckMillisec, m_nStallMillisec / s_nStallChecksPerStall);
+	m_oCheckStalledConn = Glib::signal_timeout().connect(sigc::mem_fun(*this, &RecordingWatchdog::checkStalled), nCheckMillisec);
+	return "";
+}
+void RecordingWatchdog::onDirChanged(const std::string& /*sDirPath*/, const std::string& sName, uint32_t nMask) noexcept
+{
+	if (sName != m_sFileName) {
+		return; //--------------------------------------------------------------
+	}
+	if ((nMask & IN_CLOSE_WRITE) != 0) {
+		m_bClosed = true;
+	}
+	if (m_oModifiedConn.connected()) {
+		// already scheduled
+		return; //--------------------------------------------------------------
+	}
+	// Not emitted from here since the handlers might delete this instance
+	// and with it the DirWatcher that is calling
+	m_oModifiedConn = Glib::signal_idle().connect(sigc::mem_fun(*this, &RecordingWatchdog::onModified));
+}
+bool RecordingWatchdog::onModified() noexcept
+{
+	m_oModifiedConn.disconnect();
+	if (updateSize()) {
+		// Might delete this instance
+		m_oSizeChangedSignal.emit(m_nSizeBytes);
+	}
+	return false; // connect once
+}
+bool RecordingWatchdog::checkStalled() noexcept
+{
+	const bool bContinue = true;
+
+	// Also catches the modifications inotify doesn't report (ex. network file systems)
+	const bool bChanged = updateSize();
+	if (m_bClosed) {
+		// The writer is done
+		if (bChanged) {
+			m_oSizeChangedSignal.emit(m_nSizeBytes);
+		}
+		return ! bContinue; //--------------------------------------------------
+	}
+	const int64_t nMillisec = std::chrono::duration_cast<std::chrono::milliseconds>(
+										std::chrono::steady_clock::now() - m_oLastGrowthTime).count();
+	if (bChanged) {
+		// Might delete this instance
+		m_oSizeChangedSignal.emit(m_nSizeBytes);
+		return bContinue; //----------------------------------------------------
+	}
+	if (nMillisec >= (m_bGrown ? m_nStallMillisec : m_nStartStallMillisec)) {
+		// Might delete this instance
+		m_oStalledSignal.emit();
+		return ! bContinue; //--------------------------------------------------
+	}
+	return bContinue;
+}
+bool RecordingWatchdog::updateSize() noexcept
+{
+	if (m_nFd < 0) {
+		m_nFd = ::open(m_sFilePath.c_str(), O_RDONLY | O_CLOEXEC);
+		if (m_nFd < 0) {
+			// Not created yet
+			return false; //----------------------------------------------------
+		}
+	}
+	struct stat oStat;
+	if (::fstat(m_nFd, &oStat) != 0) {
+		return false; //--------------------------------------------------------
+	}
+	const int64_t nSizeBytes = static_cast<int64_t>(oStat.st_size);
+	if (nSizeBytes == m_nSizeBytes) {
+		return false; //--------------------------------------------------------
+	}
+	if (nSizeBytes > m_nSizeBytes) {
+		if (m_nSizeBytes >= 0) {
+			m_bGrown = true;
+		}
+		m_oLastGrowthTime = std::chrono::steady_clock::now();
+	}
+	m_nSizeBytes = nSizeBytes;
+	return true;
+}
+
+} // namespace sono
@@ -0,0 +1,110 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   recordingwatchdog.h
+ */
+
+#ifndef SONO_RECORDING_WATCHDOG_H
+#define SONO_RECORDING_WATCHDOG_H
+
+#include "dirwatcher.h"
+
+#include <glibmm.h>
+
+#include <sigc++/sigc++.h>
+
+#include <chrono>
+#include <string>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Follows the size of a file being written by another process.
+ * The directory of the file is watched with inotify and the file, once
+ * created, is kept open so that its size is taken with fstat as soon as it
+ * is modified. A writer that stops producing bytes before closing the file
+ * is reported as stalled.
+ */
+class RecordingWatchdog
+{
+public:
+	/** Constructor.
+	 * @param sFilePath The file. Might not exist yet.
+	 * @param nStallMillisec The time without growth after which the writer is stalled. Must be positive.
+	 * @param nStartStallMillisec Like nStallMillisec but before the file has grown for the first time.
+	 */
+	RecordingWatchdog(const std::string& sFilePath, int32_t nStallMillisec, int32_t nStartStallMillisec) noexcept;
+	/** Destructor.
+	 * Might be called from within the handlers of the signals.
+	 */
+	~RecordingWatchdog() noexcept;
+
+	/** Starts watching.
+	 * @return The error or empty if successful.
+	 */
+	std::string start() noexcept;
+
+	const std::string& getFilePath() const noexcept { return m_sFilePath; }
+	/** The last size.
+	 * @return The size or -1 if the file wasn't opened yet.
+	 */
+	int64_t getSizeBytes() const noexcept { return m_nSizeBytes; }
+	/** Whether the writer has closed the file.
+	 * A closed file is never stalled.
+	 */
+	bool isClosed() const noexcept { return m_bClosed; }
+
+	/** Emitted from the main loop when the size has changed.
+	 * The modifications are merged so that it's emitted at most once
+	 * for each main loop iteration.
+	 * Param: the size.
+	 */
+	sigc::signal<void, int64_t> m_oSizeChangedSignal;
+	/** Emitted at most once when the file hasn't grown for too long.
+	 */
+	sigc::signal<void> m_oStalledSignal;
+
+private:
+	void onDirChanged(const std::string& sDirPath, const std::string& sName, uint32_t nMask) noexcept;
+	bool onModified() noexcept;
+	bool checkStalled() noexcept;
+	// Returns whether the size has changed
+	bool updateSize() noexcept;
+
+	const std::string m_sFilePath;
+	const std::string m_sFileName;
+	const int32_t m_nStallMillisec;
+	const int32_t m_nStartStallMillisec;
+	DirWatcher m_oDirWatcher;
+	int m_nFd;
+	int64_t m_nSizeBytes;
+	bool m_bGrown;
+	bool m_bClosed;
+	std::chrono::steady_clock::time_point m_oLastGrowthTime;
+	sigc::connection m_oModifiedConn;
+	sigc::connection m_oCheckStalledConn;
+private:
+	RecordingWatchdog() = delete;
+	RecordingWatchdog(const RecordingWatchdog& oSource) = delete;
+	RecordingWatchdog& operator=(const RecordingWatchdog& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_RECORDING_WATCHDOG_H */
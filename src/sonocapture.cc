@@ -0,0 +1,1021 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   sonocapture.cc
+ */
+
+#include "sonocapture.h"
+
+#include "filecopier.h"
+#include "util.h"
+
+#ifdef SONOREM_HAS_ALSA
+#include <alsa/asoundlib.h>
+#endif //SONOREM_HAS_ALSA
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <system_error>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+static constexpr int32_t s_nCapturePeriodFrames = 1024;
+static constexpr int32_t s_nCaptureRealTimePriority = 40;
+static constexpr int32_t s_nRingBufferSeconds = 4;
+static constexpr int32_t s_nEncoderChunkFrames = 4096;
+static constexpr int32_t s_nEncoderIdleMillisec = 20;
+// Sources that can wait are drained as fast as possible
+static constexpr int32_t s_nEncoderIdleWaitingSourceMillisec = 1;
+static constexpr int32_t s_nCaptureWaitForEncoderMillisec = 1;
+// The header of the file being written is rewritten this often, so that
+// it stays playable if the program crashes
+static constexpr int32_t s_nHeaderRefreshSeconds = 10;
+
+static constexpr int32_t s_nWavHeaderBytes = 44;
+// Stay well within the 32 bit sizes of the wav format
+static constexpr int64_t s_nWavMaxDataBytes = 0x7FFFFFFF;
+// How many names to try when the segment file already exists
+static constexpr int32_t s_nMaxSegmentNameAttempts = 10;
+// The mirror is dropped when more than this many seconds of sound wait to be written to it
+static constexpr int32_t s_nMirrorMaxQueuedSeconds = 10;
+// When stopping, the mirror of the last segment is given this long to be written
+static constexpr int32_t s_nMirrorStopMillisec = 5000;
+
+static constexpr double s_fToneFrequency = 440.0;
+static constexpr double s_fSynthAmplitude = 8000.0;
+
+static constexpr int32_t s_nFakePeriodFrames = 16 * 1024;
+static constexpr int32_t s_nFakeStallCheckMillisec = 10;
+
+////////////////////////////////////////////////////////////////////////////////
+SampleRingBuffer::SampleRingBuffer(int32_t nMinCapacity) noexcept
+: m_nWritePos(0)
+, m_nReadPos(0)
+{
+	assert(nMinCapacity > 0);
+	uint32_t nCapacity = 1;
+	while (nCapacity < static_cast<uint32_t>(nMinCapacity)) {
+		nCapacity <<= 1;
+	}
+	m_aSamples.resize(nCapacity);
+	m_nMask = nCapacity - 1;
+}
+bool SampleRingBuffer::write(const int16_t* p0Samples, int32_t nTotSamples) noexcept
+{
+	const uint32_t nWritePos = m_nWritePos.load(std::memory_order_relaxed);
+	const uint32_t nReadPos = m_nReadPos.load(std::memory_order_acquire);
+	const uint32_t nFree = static_cast<uint32_t>(m_aSamples.size()) - (nWritePos - nReadPos);
+	if (static_cast<uint32_t>(nTotSamples) > nFree) {
+		return false; //--------------------------------------------------------
+	}
+	const uint32_t nIdx = nWritePos & m_nMask;
+	const uint32_t nFirst = std::min(static_cast<uint32_t>(nTotSamples), static_cast<uint32_t>(m_aSamples.size()) - nIdx);
+	std::copy(p0Samples, p0Samples + nFirst, m_aSamples.data() + nIdx);
+	std::copy(p0Samples + nFirst, p0Samples + nTotSamples, m_aSamples.data());
+	m_nWritePos.store(nWritePos + nTotSamples, std::memory_order_release);
+	return true;
+}
+int32_t SampleRingBuffer::read(int16_t* p0Samples, int32_t nMaxSamples) noexcept
+{
+	const uint32_t nReadPos = m_nReadPos.load(std::memory_order_relaxed);
+	const uint32_t nWritePos = m_nWritePos.load(std::memory_order_acquire);
+	const uint32_t nTotSamples = std::min(nWritePos - nReadPos, static_cast<uint32_t>(nMaxSamples));
+	const uint32_t nIdx = nReadPos & m_nMask;
+	const uint32_t nFirst = std::min(nTotSamples, static_cast<uint32_t>(m_aSamples.size()) - nIdx);
+	std::copy(m_aSamples.data() + nIdx, m_aSamples.data() + nIdx + nFirst, p0Samples);
+	std::copy(m_aSamples.data(), m_aSamples.data() + (nTotSamples - nFirst), p0Samples + nFirst);
+	m_nReadPos.store(nReadPos + nTotSamples, std::memory_order_release);
+	return static_cast<int32_t>(nTotSamples);
+}
+int32_t SampleRingBuffer::getCapacity() const noexcept
+{
+	return static_cast<int32_t>(m_aSamples.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/* Generates a sine tone or white noise in real time. */
+class SynthCaptureSource : public CaptureSource
+{
+public:
+	explicit SynthCaptureSource(bool bNoise) noexcept
+	: m_bNoise(bNoise)
+	{
+	}
+	bool open(int32_t nSampleRate, int32_t nChannels) noexcept override
+	{
+		m_nSampleRate = nSampleRate;
+		m_nChannels = nChannels;
+		m_nTotFrames = 0;
+		m_fPhase = 0.0;
+		m_nNoiseState = 0x2545F491;
+		m_oStartTime = std::chrono::steady_clock::now();
+		return true;
+	}
+	int32_t read(int16_t* p0Samples, int32_t nMaxFrames, bool& bXrun) noexcept override
+	{
+		bXrun = false;
+		m_nTotFrames += nMaxFrames;
+		// deliver the frames no faster than a real device would
+		std::this_thread::sleep_until(m_oStartTime + std::chrono::microseconds(m_nTotFrames * 1000000 / m_nSampleRate));
+		const double fPhaseInc = 2.0 * M_PI * s_fToneFrequency / m_nSampleRate;
+		for (int32_t nFrame = 0; nFrame < nMaxFrames; ++nFrame) {
+			int16_t nValue;
+			if (m_bNoise) {
+				// xorshift32
+				m_nNoiseState ^= m_nNoiseState << 13;
+				m_nNoiseState ^= m_nNoiseState >> 17;
+				m_nNoiseState ^= m_nNoiseState << 5;
+				nValue = static_cast<int16_t>((static_cast<int32_t>(m_nNoiseState & 0xFFFF) - 0x8000) / 4);
+			} else {
+				nValue = static_cast<int16_t>(s_fSynthAmplitude * std::sin(m_fPhase));
+				m_fPhase += fPhaseInc;
+				if (m_fPhase >= 2.0 * M_PI) {
+					m_fPhase -= 2.0 * M_PI;
+				}
+			}
+			for (int32_t nChannel = 0; nChannel < m_nChannels; ++nChannel) {
+				*p0Samples = nValue;
+				++p0Samples;
+			}
+		}
+		return nMaxFrames;
+	}
+	void close() noexcept override
+	{
+	}
+private:
+	const bool m_bNoise;
+	int32_t m_nSampleRate = 0;
+	int32_t m_nChannels = 0;
+	int64_t m_nTotFrames = 0;
+	double m_fPhase = 0.0;
+	uint32_t m_nNoiseState = 0;
+	std::chrono::steady_clock::time_point m_oStartTime;
+};
+
+/* Delivers noise at a given byte rate, possibly much faster than real time,
+ * and fails as scripted. Used to stress the copy, sync and remove pipeline. */
+class FakeCaptureSource : public CaptureSource
+{
+public:
+	struct Script
+	{
+		int64_t m_nBytesPerSecond = 10 * 1000 * 1000;
+		int64_t m_nFailAfterBytes = -1; // never if negative
+		int64_t m_nStallAfterBytes = -1; // never if negative
+		int32_t m_nStallSeconds = 10;
+		int32_t m_nXrunEveryPeriods = 0; // never if 0
+	};
+	explicit FakeCaptureSource(const Script& oScript) noexcept
+	: m_oScript(oScript)
+	{
+	}
+	bool open(int32_t /*nSampleRate*/, int32_t nChannels) noexcept override
+	{
+		m_nFrameBytes = nChannels * static_cast<int32_t>(sizeof(int16_t));
+		m_nTotBytes = 0;
+		m_nTotPeriods = 0;
+		m_bStalled = false;
+		// the same noise is repeated each period
+		m_aPeriodSamples.resize(s_nFakePeriodFrames * nChannels);
+		uint32_t nNoiseState = 0x2545F491;
+		for (auto& nSample : m_aPeriodSamples) {
+			nNoiseState ^= nNoiseState << 13;
+			nNoiseState ^= nNoiseState >> 17;
+			nNoiseState ^= nNoiseState << 5;
+			nSample = static_cast<int16_t>((static_cast<int32_t>(nNoiseState & 0xFFFF) - 0x8000) / 4);
+		}
+		m_oStartTime = std::chrono::steady_clock::now();
+		return true;
+	}
+	int32_t read(int16_t* p0Samples, int32_t nMaxFrames, bool& bXrun) noexcept override
+	{
+		bXrun = false;
+		if ((m_oScript.m_nFailAfterBytes >= 0) && (m_nTotBytes >= m_oScript.m_nFailAfterBytes)) {
+			m_sError = "Scripted failure after " + std::to_string(m_nTotBytes) + " bytes";
+			return -1; //-------------------------------------------------------
+		}
+		if ((m_oScript.m_nStallAfterBytes >= 0) && (m_nTotBytes >= m_oScript.m_nStallAfterBytes)) {
+			const auto oNow = std::chrono::steady_clock::now();
+			if (! m_bStalled) {
+				m_bStalled = true;
+				m_oStallEndTime = oNow + std::chrono::seconds(m_oScript.m_nStallSeconds);
+			}
+			if (oNow < m_oStallEndTime) {
+				// return often so that the capture thread can be stopped
+				std::this_thread::sleep_for(std::chrono::milliseconds(s_nFakeStallCheckMillisec));
+				return 0; //----------------------------------------------------
+			}
+			m_oScript.m_nStallAfterBytes = -1;
+			// don't try to catch up
+			m_oStartTime += std::chrono::seconds(m_oScript.m_nStallSeconds);
+		}
+		++m_nTotPeriods;
+		if ((m_oScript.m_nXrunEveryPeriods > 0) && ((m_nTotPeriods % m_oScript.m_nXrunEveryPeriods) == 0)) {
+			bXrun = true;
+		}
+		const int32_t nFrames = std::min(nMaxFrames, s_nFakePeriodFrames);
+		std::copy(m_aPeriodSamples.data(), m_aPeriodSamples.data() + nFrames * m_nFrameBytes / sizeof(int16_t), p0Samples);
+		m_nTotBytes += nFrames * m_nFrameBytes;
+		std::this_thread::sleep_until(m_oStartTime + std::chrono::microseconds(m_nTotBytes * 1000000 / m_oScript.m_nBytesPerSecond));
+		return nFrames;
+	}
+	void close() noexcept override
+	{
+	}
+	int32_t getPeriodFrames() const noexcept override
+	{
+		return s_nFakePeriodFrames;
+	}
+	bool canWait() const noexcept override
+	{
+		return true;
+	}
+private:
+	Script m_oScript;
+	int32_t m_nFrameBytes = 0;
+	int64_t m_nTotBytes = 0;
+	int64_t m_nTotPeriods = 0;
+	bool m_bStalled = false;
+	std::vector<int16_t> m_aPeriodSamples;
+	std::chrono::steady_clock::time_point m_oStartTime;
+	std::chrono::steady_clock::time_point m_oStallEndTime;
+};
+
+#ifdef SONOREM_HAS_ALSA
+/* Also captures from PulseAudio or PipeWire through their ALSA plugins (device "default"). */
+class AlsaCaptureSource : public CaptureSource
+{
+public:
+	explicit AlsaCaptureSource(std::string&& sDevice) noexcept
+	: m_sDevice(std::move(sDevice))
+	{
+	}
+	~AlsaCaptureSource() noexcept
+	{
+		close();
+	}
+	bool open(int32_t nSampleRate, int32_t nChannels) noexcept override
+	{
+		assert(m_p0Pcm == nullptr);
+		int nRet = ::snd_pcm_open(&m_p0Pcm, m_sDevice.c_str(), SND_PCM_STREAM_CAPTURE, 0);
+		if (nRet < 0) {
+			m_p0Pcm = nullptr;
+			m_sError = "Could not open ALSA device '" + m_sDevice + "': " + ::snd_strerror(nRet);
+			return false; //----------------------------------------------------
+		}
+		// Samples are written to the wav files as they are: little endian hosts only
+		nRet = ::snd_pcm_set_params(m_p0Pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED
+									, nChannels, nSampleRate, 1, s_nLatencyMicrosec);
+		if (nRet < 0) {
+			m_sError = "Could not set ALSA parameters of '" + m_sDevice + "': " + ::snd_strerror(nRet);
+			close();
+			return false; //----------------------------------------------------
+		}
+		return true;
+	}
+	int32_t read(int16_t* p0Samples, int32_t nMaxFrames, bool& bXrun) noexcept override
+	{
+		bXrun = false;
+		const snd_pcm_sframes_t nFrames = ::snd_pcm_readi(m_p0Pcm, p0Samples, nMaxFrames);
+		if (nFrames >= 0) {
+			return static_cast<int32_t>(nFrames); //----------------------------
+		}
+		bXrun = (nFrames == -EPIPE);
+		const int nRet = ::snd_pcm_recover(m_p0Pcm, static_cast<int>(nFrames), 1);
+		if (nRet < 0) {
+			m_sError = "Error capturing from '" + m_sDevice + "': " + ::snd_strerror(nRet);
+			return -1; //-------------------------------------------------------
+		}
+		return 0;
+	}
+	void close() noexcept override
+	{
+		if (m_p0Pcm != nullptr) {
+			::snd_pcm_close(m_p0Pcm);
+			m_p0Pcm = nullptr;
+		}
+	}
+private:
+	static constexpr unsigned int s_nLatencyMicrosec = 100 * 1000;
+	const std::string m_sDevice;
+	snd_pcm_t* m_p0Pcm = nullptr;
+};
+#endif //SONOREM_HAS_ALSA
+
+static const std::string s_sSourceTone = "tone";
+static const std::string s_sSourceNoise = "noise";
+static const std::string s_sSourceAlsa = "alsa";
+static const std::string s_sSourceAlsaDefaultDevice = "default";
+static const std::string s_sSourceFake = "fake";
+
+static bool parseFakeScript(const std::string& sOptions, FakeCaptureSource::Script& oScript, std::string& sError) noexcept
+{
+	for (const auto& sOption : strSplit(sOptions, ",")) {
+		const auto nEqualPos = sOption.find('=');
+		if (nEqualPos == std::string::npos) {
+			sError = "Fake capture option '" + sOption + "' has no value";
+			return false; //----------------------------------------------------
+		}
+		const std::string sKey = strStrip(sOption.substr(0, nEqualPos));
+		const std::string sValue = strStrip(sOption.substr(nEqualPos + 1));
+		int64_t nValue;
+		if ((sKey == "stallsec") || (sKey == "xrun")) {
+			int32_t nInt32;
+			sError = strToInt32(sValue, nInt32);
+			nValue = nInt32;
+		} else {
+			sError = strToMemSize(sValue, nValue);
+		}
+		if (! sError.empty()) {
+			sError = "Fake capture option '" + sOption + "': " + sError;
+			return false; //----------------------------------------------------
+		}
+		if (sKey == "rate") {
+			if (nValue <= 0) {
+				sError = "Fake capture option '" + sOption + "': must be positive";
+				return false; //------------------------------------------------
+			}
+			oScript.m_nBytesPerSecond = nValue;
+		} else if (sKey == "fail") {
+			oScript.m_nFailAfterBytes = nValue;
+		} else if (sKey == "stall") {
+			oScript.m_nStallAfterBytes = nValue;
+		} else if (sKey == "stallsec") {
+			oScript.m_nStallSeconds = std::max<int32_t>(0, nValue);
+		} else if (sKey == "xrun") {
+			oScript.m_nXrunEveryPeriods = std::max<int32_t>(0, nValue);
+		} else {
+			sError = "Unknown fake capture option '" + sOption + "'";
+			return false; //----------------------------------------------------
+		}
+	}
+	return true;
+}
+
+int32_t CaptureSource::getPeriodFrames() const noexcept
+{
+	return s_nCapturePeriodFrames;
+}
+bool CaptureSource::canWait() const noexcept
+{
+	return false;
+}
+unique_ptr<CaptureSource> CaptureSource::create(const std::string& sSource, std::string& sError) noexcept
+{
+	if ((sSource == s_sSourceTone) || (sSource == s_sSourceNoise)) {
+		return std::make_unique<SynthCaptureSource>(sSource == s_sSourceNoise); //-----
+	}
+	if ((sSource == s_sSourceFake) || (sSource.substr(0, s_sSourceFake.size() + 1) == s_sSourceFake + ":")) {
+		FakeCaptureSource::Script oScript;
+		if (! parseFakeScript(sSource.substr(std::min(sSource.size(), s_sSourceFake.size() + 1)), oScript, sError)) {
+			return unique_ptr<CaptureSource>{}; //------------------------------
+		}
+		return std::make_unique<FakeCaptureSource>(oScript); //-----------------
+	}
+	if ((sSource == s_sSourceAlsa) || (sSource.substr(0, s_sSourceAlsa.size() + 1) == s_sSourceAlsa + ":")) {
+		#ifdef SONOREM_HAS_ALSA
+		std::string sDevice = ((sSource.size() > s_sSourceAlsa.size() + 1)
+								? sSource.substr(s_sSourceAlsa.size() + 1) : s_sSourceAlsaDefaultDevice);
+		return std::make_unique<AlsaCaptureSource>(std::move(sDevice)); //------
+		#else
+		sError = "Not compiled with ALSA support: " + sSource;
+		return unique_ptr<CaptureSource>{}; //----------------------------------
+		#endif //SONOREM_HAS_ALSA
+	}
+	sError = "Unknown capture source: " + sSource;
+	return unique_ptr<CaptureSource>{};
+}
+bool CaptureSource::isSupported(const std::string& sSource) noexcept
+{
+	std::string sError;
+	return (create(sSource, sError) != nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SonoCapture::SonoCapture(Init&& oInit) noexcept
+: m_oInit(std::move(oInit))
+, m_nFrameBytes(m_oInit.m_nChannels * static_cast<int32_t>(sizeof(int16_t)))
+, m_nEncoderIdleMillisec(s_nEncoderIdleMillisec)
+, m_bStopping(false)
+, m_bCaptureDone(false)
+, m_bEncoderDone(false)
+, m_bRealTime(false)
+, m_bFailed(false)
+, m_nSegmentBytes(0)
+, m_nTotalBytes(0)
+, m_nXruns(0)
+, m_nSegmentFd(-1)
+, m_bMirrorOpened(false)
+, m_bMirroring(false)
+, m_nDataCrc(0)
+, m_nSegmentFrames(0)
+, m_nHeaderWrittenFrames(0)
+{
+	assert(m_oInit.m_nSampleRate > 0);
+	assert(m_oInit.m_nChannels > 0);
+	assert(m_oInit.m_nMaxSegmentSeconds > 0);
+	assert(m_oInit.m_oNextSegmentPath);
+	const int64_t nMaxDataBytes = std::min(m_oInit.m_nMaxSegmentBytes - s_nWavHeaderBytes, s_nWavMaxDataBytes);
+	m_nMaxSegmentFrames = std::max<int64_t>(1, std::min(static_cast<int64_t>(m_oInit.m_nMaxSegmentSeconds) * m_oInit.m_nSampleRate
+														, nMaxDataBytes / m_nFrameBytes));
+	m_refMirror = std::make_unique<MirrorWriter>(static_cast<int64_t>(m_oInit.m_nSampleRate) * m_nFrameBytes * s_nMirrorMaxQueuedSeconds);
+	m_oDispatcher.connect(sigc::mem_fun(*this, &SonoCapture::onDispatched));
+}
+SonoCapture::~SonoCapture() noexcept
+{
+	m_bStopping = true;
+	joinThreads();
+}
+std::string SonoCapture::start() noexcept
+{
+	assert(! m_oEncoderThread.joinable());
+	assert(! m_refSource);
+	std::string sError;
+	m_refSource = CaptureSource::create(m_oInit.m_sSource, sError);
+	if (! m_refSource) {
+		return sError; //-------------------------------------------------------
+	}
+	if (! m_refSource->open(m_oInit.m_nSampleRate, m_oInit.m_nChannels)) {
+		return m_refSource->getError(); //--------------------------------------
+	}
+	const int32_t nPeriodSamples = m_refSource->getPeriodFrames() * m_oInit.m_nChannels;
+	m_refRing = std::make_unique<SampleRingBuffer>(std::max(m_oInit.m_nSampleRate * m_oInit.m_nChannels * s_nRingBufferSeconds
+															, nPeriodSamples * 4));
+	if (m_refSource->canWait()) {
+		m_nEncoderIdleMillisec = s_nEncoderIdleWaitingSourceMillisec;
+	}
+	const std::string sMirrorError = m_refMirror->start();
+	if (! sMirrorError.empty()) {
+		// Not fatal, the segments just aren't mirrored
+		m_refMirror.reset();
+	}
+	if (! openSegment(m_oInit.m_oNextSegmentPath())) {
+		m_refSource->close();
+		return getError(); //---------------------------------------------------
+	}
+	if (! sMirrorError.empty()) {
+		m_sDroppedError = sMirrorError;
+	}
+	try {
+		m_oEncoderThread = std::thread(&SonoCapture::encoderThreadRun, this);
+		m_oCaptureThread = std::thread(&SonoCapture::captureThreadRun, this);
+	} catch (const std::system_error& oErr) {
+		sError = std::string{"Could not start capture thread: "} + oErr.what();
+		m_bCaptureDone = true;
+		if (m_oEncoderThread.joinable()) {
+			// finishes the segment
+			m_oEncoderThread.join();
+		} else {
+			if (m_nSegmentFd >= 0) {
+				::close(m_nSegmentFd);
+				m_nSegmentFd = -1;
+				::unlink(getSegmentPath().c_str());
+			}
+			if (m_bMirrorOpened) {
+				const std::string sMirrorPath = getMirrorSegmentPath();
+				m_refMirror->close("", "", {});
+				m_bMirrorOpened = false;
+				m_bMirroring = false;
+				if (m_refMirror->stop(s_nMirrorStopMillisec)) {
+					::unlink(sMirrorPath.c_str());
+				}
+			}
+		}
+		m_refSource->close();
+		return sError; //-------------------------------------------------------
+	}
+	return "";
+}
+void SonoCapture::stop() noexcept
+{
+	// The encoder finishes the last segment and stops the mirror,
+	// then onDispatched() joins the threads
+	m_bStopping = true;
+}
+bool SonoCapture::isStopped() const noexcept
+{
+	return ! m_oEncoderThread.joinable();
+}
+void SonoCapture::joinThreads() noexcept
+{
+	if (m_oCaptureThread.joinable()) {
+		m_oCaptureThread.join();
+	}
+	if (m_oEncoderThread.joinable()) {
+		// the encoder drains the ring buffer before finishing the last segment
+		m_oEncoderThread.join();
+	}
+}
+void SonoCapture::captureThreadRun() noexcept
+{
+	sched_param oParam;
+	oParam.sched_priority = s_nCaptureRealTimePriority;
+	// Usually needs rtprio permission in /etc/security/limits.conf
+	m_bRealTime = (::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &oParam) == 0);
+	//
+	const int32_t nChannels = m_oInit.m_nChannels;
+	const int32_t nPeriodFrames = m_refSource->getPeriodFrames();
+	const bool bCanWait = m_refSource->canWait();
+	std::vector<int16_t> aSamples(nPeriodFrames * nChannels);
+	while (! m_bStopping.load(std::memory_order_acquire)) {
+		bool bXrun = false;
+		const int32_t nFrames = m_refSource->read(aSamples.data(), nPeriodFrames, bXrun);
+		if (nFrames < 0) {
+			setError(m_refSource->getError());
+			break; //-----------------------------------------------------------
+		}
+		if (bXrun) {
+			m_nXruns.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (nFrames == 0) {
+			continue; //--------------------------------------------------------
+		}
+		bool bWritten = m_refRing->write(aSamples.data(), nFrames * nChannels);
+		if (bCanWait) {
+			while ((! bWritten) && ! m_bStopping.load(std::memory_order_acquire)) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(s_nCaptureWaitForEncoderMillisec));
+				bWritten = m_refRing->write(aSamples.data(), nFrames * nChannels);
+			}
+		} else if (! bWritten) {
+			// Never block a real device: if the encoder can't keep up the period is lost
+			m_nXruns.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	m_refSource->close();
+	m_bCaptureDone.store(true, std::memory_order_release);
+}
+void SonoCapture::encoderThreadRun() noexcept
+{
+	const int32_t nChannels = m_oInit.m_nChannels;
+	// Since the capture thread only writes whole frames, whole frames are read
+	std::vector<int16_t> aSamples(s_nEncoderChunkFrames * nChannels);
+	bool bOk = true;
+	while (bOk) {
+		const bool bCaptureDone = m_bCaptureDone.load(std::memory_order_acquire);
+		const int32_t nTotSamples = m_refRing->read(aSamples.data(), static_cast<int32_t>(aSamples.size()));
+		if (nTotSamples == 0) {
+			if (bCaptureDone) {
+				break; //-------------------------------------------------------
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(m_nEncoderIdleMillisec));
+			continue; //--------------------------------------------------------
+		}
+		bOk = writeFrames(aSamples.data(), nTotSamples / nChannels);
+	}
+	if (! bOk) {
+		// also stop capturing
+		m_bStopping = true;
+	}
+	finishSegment();
+	// Waiting for the mirror here doesn't block the main thread
+	stopMirror();
+	// After a failure the capture thread might still be in a read
+	while (! m_bCaptureDone.load(std::memory_order_acquire)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(m_nEncoderIdleMillisec));
+	}
+	m_bEncoderDone.store(true, std::memory_order_release);
+	m_oDispatcher.emit();
+}
+void SonoCapture::stopMirror() noexcept
+{
+	// Called from the encoder thread
+	if ((! m_refMirror) || m_refMirror->stop(s_nMirrorStopMillisec)) {
+		return; //--------------------------------------------------------------
+	}
+	// The stick doesn't respond, the mirrors not yet closed are lost
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	for (MirroringSegment& oMirroring : m_aMirroringSegments) {
+		if (oMirroring.m_bMirrorClosed) {
+			continue;
+		}
+		oMirroring.m_bMirrorClosed = true;
+		FinishedSegment& oSegment = oMirroring.m_oSegment;
+		if ((! oSegment.m_sMirrorPath.empty()) && oSegment.m_sError.empty()) {
+			oSegment.m_sError = "Mirror " + oSegment.m_sMirrorPath + " not responding";
+		}
+		oSegment.m_sMirrorPath.clear();
+	}
+	pushFinishedSegments();
+}
+bool SonoCapture::writeFrames(const int16_t* p0Samples, int32_t nTotFrames) noexcept
+{
+	while (nTotFrames > 0) {
+		int64_t nFrames = nTotFrames;
+		if (m_nSegmentFrames >= m_nMaxSegmentFrames) {
+			if (! finishSegment()) {
+				return false; //------------------------------------------------
+			}
+			if (! openSegment(m_oInit.m_oNextSegmentPath())) {
+				return false; //------------------------------------------------
+			}
+			nFrames = std::min(nFrames, m_nMaxSegmentFrames);
+		} else {
+			nFrames = std::min(nFrames, m_nMaxSegmentFrames - m_nSegmentFrames);
+		}
+		const int64_t nBytes = nFrames * m_nFrameBytes;
+		const int64_t nOffset = s_nWavHeaderBytes + m_nSegmentFrames * m_nFrameBytes;
+		if (! writeSegmentFiles(p0Samples, nBytes, nOffset, "Error writing ")) {
+			return false; //----------------------------------------------------
+		}
+		if (m_bMirroring) {
+			// Only the mirror gets a checksum file
+			m_nDataCrc = crc32c(m_nDataCrc, p0Samples, nBytes);
+		}
+		m_nSegmentFrames += nFrames;
+		m_nSegmentBytes.store(nOffset + nBytes, std::memory_order_relaxed);
+		m_nTotalBytes.fetch_add(nBytes, std::memory_order_relaxed);
+		p0Samples += nFrames * m_oInit.m_nChannels;
+		nTotFrames -= static_cast<int32_t>(nFrames);
+		//
+		if (m_nSegmentFrames - m_nHeaderWrittenFrames >= static_cast<int64_t>(s_nHeaderRefreshSeconds) * m_oInit.m_nSampleRate) {
+			if (! writeWavHeader()) {
+				return false; //------------------------------------------------
+			}
+		}
+	}
+	return true;
+}
+bool SonoCapture::openSegment(std::string&& sPath) noexcept
+{
+	assert((m_nSegmentFd < 0) && ! m_bMirrorOpened);
+	std::string sMirrorDirPath;
+	{
+		std::lock_guard<std::mutex> oLock(m_oMutex);
+		sMirrorDirPath = m_sMirrorDirPath;
+	}
+	std::string sMirrorPath;
+	if ((! sMirrorDirPath.empty()) && m_refMirror) {
+		sMirrorPath = sMirrorDirPath + "/" + Glib::path_get_basename(sPath);
+	}
+	m_sDroppedError.clear();
+	std::string sError;
+	// Never overwrite an existing (possibly finished and queued) recording
+	int nFd = ::open(sPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	for (int32_t nAttempt = 0; (nFd < 0) && (errno == EEXIST) && (nAttempt < s_nMaxSegmentNameAttempts); ++nAttempt) {
+		// Names are unique within the process, the file must be a leftover
+		// of a previous run: the next name is at least a millisecond later
+		sPath = m_oInit.m_oNextSegmentPath();
+		if (! sMirrorPath.empty()) {
+			sMirrorPath = sMirrorDirPath + "/" + Glib::path_get_basename(sPath);
+		}
+		nFd = ::open(sPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	}
+	if (nFd < 0) {
+		sError = "Could not create " + sPath + ": " + getErrnoString(errno);
+	} else if (m_oInit.m_oSegmentCreated) {
+		m_oInit.m_oSegmentCreated(sPath);
+	}
+	if (nFd < 0) {
+		if (sMirrorPath.empty()) {
+			setError(sError);
+			return false; //----------------------------------------------------
+		}
+		// Keep recording to the mirror only
+		m_sDroppedError = sError;
+	}
+	if (! sMirrorPath.empty()) {
+		// Created by the mirror thread, if it fails the error is
+		// reported when the segment is finished
+		m_refMirror->open(sMirrorPath);
+	}
+	m_nSegmentFd = nFd;
+	m_bMirrorOpened = ! sMirrorPath.empty();
+	m_bMirroring = m_bMirrorOpened;
+	m_nDataCrc = 0;
+	m_nSegmentFrames = 0;
+	{
+		std::lock_guard<std::mutex> oLock(m_oMutex);
+		m_sSegmentPath = std::move(sPath);
+		m_sMirrorSegmentPath = std::move(sMirrorPath);
+	}
+	m_nSegmentBytes.store(s_nWavHeaderBytes, std::memory_order_relaxed);
+	return writeWavHeader();
+}
+bool SonoCapture::finishSegment() noexcept
+{
+	if ((m_nSegmentFd < 0) && ! m_bMirrorOpened) {
+		return true; //---------------------------------------------------------
+	}
+	bool bOk = writeWavHeader();
+	const bool bSegmentOk = (m_nSegmentFd >= 0);
+	if (bSegmentOk) {
+		if ((::close(m_nSegmentFd) != 0) && bOk) {
+			setError("Error closing " + getSegmentPath() + ": " + getErrnoString(errno));
+			bOk = false;
+		}
+		m_nSegmentFd = -1;
+	}
+	FinishedSegment oSegment;
+	if (bSegmentOk) {
+		oSegment.m_sPath = getSegmentPath();
+	}
+	oSegment.m_sError = std::move(m_sDroppedError);
+	m_sDroppedError.clear();
+	if (! m_bMirrorOpened) {
+		std::lock_guard<std::mutex> oLock(m_oMutex);
+		// Keep the order of the segments
+		MirroringSegment oMirroring;
+		oMirroring.m_oSegment = std::move(oSegment);
+		oMirroring.m_bMirrorClosed = true;
+		m_aMirroringSegments.push_back(std::move(oMirroring));
+		pushFinishedSegments();
+	} else {
+		// Even if failed or dropped, the writer reports why
+		std::string sChecksumFilePath;
+		std::string sChecksumContent;
+		if (m_bMirroring) {
+			oSegment.m_sMirrorPath = getMirrorSegmentPath();
+			sChecksumFilePath = FileCopier::getChecksumFilePath(oSegment.m_sMirrorPath);
+			sChecksumContent = getMirrorChecksumContent();
+		}
+		{
+			std::lock_guard<std::mutex> oLock(m_oMutex);
+			MirroringSegment oMirroring;
+			oMirroring.m_oSegment = std::move(oSegment);
+			m_aMirroringSegments.push_back(std::move(oMirroring));
+			m_sMirrorSegmentPath.clear();
+		}
+		m_refMirror->close(sChecksumFilePath, std::move(sChecksumContent), [this](const std::string& sError)
+		{
+			onMirrorClosed(sError);
+		});
+		m_bMirrorOpened = false;
+		m_bMirroring = false;
+	}
+	m_oDispatcher.emit();
+	return bOk;
+}
+void SonoCapture::onMirrorClosed(const std::string& sError) noexcept
+{
+	// Called from the mirror thread
+	bool bLost = false;
+	{
+		std::lock_guard<std::mutex> oLock(m_oMutex);
+		auto itMirroring = std::find_if(m_aMirroringSegments.begin(), m_aMirroringSegments.end(), [](const MirroringSegment& oMirroring)
+		{
+			return ! oMirroring.m_bMirrorClosed;
+		});
+		assert(itMirroring != m_aMirroringSegments.end());
+		itMirroring->m_bMirrorClosed = true;
+		FinishedSegment& oSegment = itMirroring->m_oSegment;
+		if (! sError.empty()) {
+			oSegment.m_sMirrorPath.clear();
+			if (oSegment.m_sError.empty()) {
+				oSegment.m_sError = sError;
+			}
+			bLost = oSegment.m_sPath.empty();
+		}
+		pushFinishedSegments();
+	}
+	if (bLost) {
+		// Both files of the segment failed
+		setError(sError);
+	} else {
+		m_oDispatcher.emit();
+	}
+}
+void SonoCapture::pushFinishedSegments() noexcept
+{
+	// m_oMutex is locked
+	while ((! m_aMirroringSegments.empty()) && m_aMirroringSegments.front().m_bMirrorClosed) {
+		FinishedSegment& oSegment = m_aMirroringSegments.front().m_oSegment;
+		if (! (oSegment.m_sPath.empty() && oSegment.m_sMirrorPath.empty())) {
+			m_aFinishedSegments.push_back(std::move(oSegment));
+		}
+		m_aMirroringSegments.pop_front();
+	}
+}
+std::string SonoCapture::getMirrorChecksumContent() const noexcept
+{
+	// The header is rewritten last, the checksum of the data is combined with it
+	uint8_t aHeader[s_nWavHeaderBytes];
+	fillWavHeader(aHeader);
+	const int64_t nDataBytes = m_nSegmentFrames * m_nFrameBytes;
+	const uint32_t nChecksum = crc32cCombine(crc32c(0, aHeader, s_nWavHeaderBytes), m_nDataCrc, nDataBytes);
+	char aChecksum[16];
+	std::snprintf(aChecksum, sizeof(aChecksum), "%08x", nChecksum);
+	return std::string{aChecksum} + "  " + Glib::path_get_basename(getMirrorSegmentPath()) + "\n";
+}
+bool SonoCapture::writeSegmentFiles(const void* p0Buf, int64_t nBytes, int64_t nOffset, const char* p0What) noexcept
+{
+	if (m_nSegmentFd >= 0) {
+		const auto oStart = std::chrono::steady_clock::now();
+		const bool bWritten = pwriteAll(m_nSegmentFd, p0Buf, nBytes, nOffset);
+		const int nErrno = errno;
+		const int64_t nMicrosec = std::chrono::duration_cast<std::chrono::microseconds>(
+												std::chrono::steady_clock::now() - oStart).count();
+		// Only the encoder thread writes the stats
+		AtomicWriteStats& oStats = m_oSegmentWriteStats;
+		oStats.m_nWrites.fetch_add(1, std::memory_order_relaxed);
+		oStats.m_nTotalMicrosec.fetch_add(nMicrosec, std::memory_order_relaxed);
+		if (nMicrosec > oStats.m_nMaxMicrosec.load(std::memory_order_relaxed)) {
+			oStats.m_nMaxMicrosec.store(nMicrosec, std::memory_order_relaxed);
+		}
+		if (! bWritten) {
+			const std::string sError = std::string{p0What} + getSegmentPath() + ": " + getErrnoString(nErrno);
+			if (! m_bMirroring) {
+				// nothing left to write to
+				setError(sError);
+				return false; //----------------------------------------------------
+			}
+			dropSegmentFile(sError);
+		}
+	}
+	if (m_bMirroring && ! m_refMirror->write(p0Buf, nBytes, nOffset)) {
+		// Failed or dropped because it's too slow, the writer tells
+		// why when the segment is finished
+		const std::string sMirrorPath = getMirrorSegmentPath();
+		stopMirroring();
+		if (m_nSegmentFd < 0) {
+			setError(std::string{p0What} + sMirrorPath + ": mirror failed");
+			return false; //--------------------------------------------------------
+		}
+	}
+	return true;
+}
+void SonoCapture::dropSegmentFile(const std::string& sError) noexcept
+{
+	assert(m_nSegmentFd >= 0);
+	::close(m_nSegmentFd);
+	m_nSegmentFd = -1;
+	// The mirror is complete, a partial segment would only be in the way
+	::unlink(getSegmentPath().c_str());
+	if (m_sDroppedError.empty()) {
+		m_sDroppedError = sError;
+	}
+}
+void SonoCapture::stopMirroring() noexcept
+{
+	m_bMirroring = false;
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	m_sMirrorSegmentPath.clear();
+}
+bool SonoCapture::writeWavHeader() noexcept
+{
+	uint8_t aHeader[s_nWavHeaderBytes];
+	fillWavHeader(aHeader);
+	if (! writeSegmentFiles(aHeader, s_nWavHeaderBytes, 0, "Error writing header of ")) {
+		return false; //--------------------------------------------------------
+	}
+	m_nHeaderWrittenFrames = m_nSegmentFrames;
+	return true;
+}
+void SonoCapture::fillWavHeader(uint8_t* p0Header) const noexcept
+{
+	uint8_t* p0Cur = p0Header;
+	auto oPutTag = [&](const char* p0Tag)
+	{
+		::memcpy(p0Cur, p0Tag, 4);
+		p0Cur += 4;
+	};
+	auto oPutLE = [&](uint32_t nValue, int32_t nTotBytes)
+	{
+		for (int32_t nByte = 0; nByte < nTotBytes; ++nByte) {
+			*p0Cur = static_cast<uint8_t>(nValue >> (8 * nByte));
+			++p0Cur;
+		}
+	};
+	const uint32_t nDataBytes = static_cast<uint32_t>(m_nSegmentFrames * m_nFrameBytes);
+	oPutTag("RIFF");
+	oPutLE(s_nWavHeaderBytes - 8 + nDataBytes, 4);
+	oPutTag("WAVE");
+	oPutTag("fmt ");
+	oPutLE(16, 4); // size of fmt chunk
+	oPutLE(1, 2); // PCM
+	oPutLE(m_oInit.m_nChannels, 2);
+	oPutLE(m_oInit.m_nSampleRate, 4);
+	oPutLE(m_oInit.m_nSampleRate * m_nFrameBytes, 4); // bytes per second
+	oPutLE(m_nFrameBytes, 2); // block align
+	oPutLE(16, 2); // bits per sample
+	oPutTag("data");
+	oPutLE(nDataBytes, 4);
+	assert(p0Cur - p0Header == s_nWavHeaderBytes);
+}
+void SonoCapture::setError(const std::string& sError) noexcept
+{
+	{
+		std::lock_guard<std::mutex> oLock(m_oMutex);
+		if (m_sError.empty()) {
+			m_sError = sError;
+		}
+	}
+	m_bFailed = true;
+	m_oDispatcher.emit();
+}
+void SonoCapture::onDispatched() noexcept
+{
+	// The encoder thread is about to return, joining doesn't block
+	const bool bStopped = m_bEncoderDone.load(std::memory_order_acquire) && m_oEncoderThread.joinable();
+	if (bStopped) {
+		joinThreads();
+	}
+	m_oChangedSignal.emit();
+	if (bStopped) {
+		m_oStoppedSignal.emit();
+	}
+}
+std::string SonoCapture::getSegmentPath() const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	return m_sSegmentPath;
+}
+std::string SonoCapture::getMirrorSegmentPath() const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	return m_sMirrorSegmentPath;
+}
+void SonoCapture::setMirrorDirPath(const std::string& sDirPath) noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	m_sMirrorDirPath = sDirPath;
+}
+bool SonoCapture::popFinishedSegment(FinishedSegment& oSegment) noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	if (m_aFinishedSegments.empty()) {
+		return false; //--------------------------------------------------------
+	}
+	oSegment = std::move(m_aFinishedSegments.front());
+	m_aFinishedSegments.erase(m_aFinishedSegments.begin());
+	return true;
+}
+bool SonoCapture::popFinishedSegment(std::string& sPath) noexcept
+{
+	FinishedSegment oSegment;
+	if (! popFinishedSegment(oSegment)) {
+		return false; //--------------------------------------------------------
+	}
+	sPath = (oSegment.m_sPath.empty() ? std::move(oSegment.m_sMirrorPath) : std::move(oSegment.m_sPath));
+	return true;
+}
+int64_t SonoCapture::getSegmentBytes() const noexcept
+{
+	return m_nSegmentBytes.load(std::memory_order_relaxed);
+}
+int64_t SonoCapture::getTotalBytes() const noexcept
+{
+	return m_nTotalBytes.load(std::memory_order_relaxed);
+}
+int32_t SonoCapture::getXruns() const noexcept
+{
+	return m_nXruns.load(std::memory_order_relaxed);
+}
+bool SonoCapture::isRealTime() const noexcept
+{
+	return m_bRealTime;
+}
+SonoCapture::WriteStats SonoCapture::getWriteStats(bool bMirror) const noexcept
+{
+	WriteStats oWriteStats;
+	if (bMirror) {
+		if (m_refMirror) {
+			const MirrorWriter::WriteStats oStats = m_refMirror->getWriteStats();
+			oWriteStats.m_nWrites = oStats.m_nWrites;
+			oWriteStats.m_nTotalMicrosec = oStats.m_nTotalMicrosec;
+			oWriteStats.m_nMaxMicrosec = oStats.m_nMaxMicrosec;
+		}
+		return oWriteStats; //--------------------------------------------------
+	}
+	const AtomicWriteStats& oStats = m_oSegmentWriteStats;
+	oWriteStats.m_nWrites = oStats.m_nWrites.load(std::memory_order_relaxed);
+	oWriteStats.m_nTotalMicrosec = oStats.m_nTotalMicrosec.load(std::memory_order_relaxed);
+	oWriteStats.m_nMaxMicrosec = oStats.m_nMaxMicrosec.load(std::memory_order_relaxed);
+	return oWriteStats;
+}
+bool SonoCapture::hasFailed() const noexcept
+{
+	return m_bFailed;
+}
+std::string SonoCapture::getError() const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	return m_sError;
+}
+
+} // namespace sono
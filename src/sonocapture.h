@@ -0,0 +1,319 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   sonocapture.h
+ */
+
+#ifndef SONO_SONO_CAPTURE_H
+#define SONO_SONO_CAPTURE_H
+
+#include "mirrorwriter.h"
+
+#include <glibmm.h>
+
+#include <sigc++/sigc++.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+using std::unique_ptr;
+
+/** Lock-free single producer single consumer ring buffer of samples.
+ * The producer is the capture thread, the consumer the encoder thread.
+ */
+class SampleRingBuffer
+{
+public:
+	/** Constructor.
+	 * @param nMinCapacity The minimum number of samples. Is rounded up to a power of two.
+	 */
+	explicit SampleRingBuffer(int32_t nMinCapacity) noexcept;
+	/** Writes all the samples or none.
+	 * Must only be called by the producer.
+	 * @return Whether there was enough space.
+	 */
+	bool write(const int16_t* p0Samples, int32_t nTotSamples) noexcept;
+	/** Reads the available samples.
+	 * Must only be called by the consumer.
+	 * @return The number of samples read. Is at most nMaxSamples.
+	 */
+	int32_t read(int16_t* p0Samples, int32_t nMaxSamples) noexcept;
+	int32_t getCapacity() const noexcept;
+private:
+	std::vector<int16_t> m_aSamples;
+	uint32_t m_nMask;
+	// The positions are free running, the index is obtained with m_nMask
+	std::atomic<uint32_t> m_nWritePos; // only modified by the producer
+	char m_aPadding[64]; // keep the positions in different cache lines
+	std::atomic<uint32_t> m_nReadPos; // only modified by the consumer
+};
+
+/** Audio capture backend.
+ * Apart from the constructor all methods are called from the capture thread.
+ */
+class CaptureSource
+{
+public:
+	virtual ~CaptureSource() noexcept = default;
+	/** Opens the device.
+	 * Samples are signed 16 bit interleaved.
+	 * @return Whether successful. If false see getError().
+	 */
+	virtual bool open(int32_t nSampleRate, int32_t nChannels) noexcept = 0;
+	/** Blocks until frames are available and reads them.
+	 * @param p0Samples The buffer. Must have size nMaxFrames * channels.
+	 * @param nMaxFrames The maximum number of frames to read.
+	 * @param bXrun Set to true if frames were lost by the device.
+	 * @return The number of frames read or -1 if an error occurred (see getError()).
+	 */
+	virtual int32_t read(int16_t* p0Samples, int32_t nMaxFrames, bool& bXrun) noexcept = 0;
+	virtual void close() noexcept = 0;
+	/** The number of frames read() is called with. */
+	virtual int32_t getPeriodFrames() const noexcept;
+	/** Whether the source can wait for the encoder when the ring buffer is full.
+	 * Real devices can't: frames are lost.
+	 */
+	virtual bool canWait() const noexcept;
+
+	const std::string& getError() const noexcept { return m_sError; }
+
+	/** Creates a source.
+	 * The supported sources are "tone" and "noise" (synthetic, real time),
+	 * "fake" or "fake:OPTIONS" (synthetic, for load testing)
+	 * and if compiled with ALSA support "alsa" or "alsa:DEVICE".
+	 *
+	 * OPTIONS is a comma separated list of:
+	 * - rate=SIZE: the bytes written per second (default 10MB)
+	 * - fail=SIZE: the source fails after SIZE bytes
+	 * - stall=SIZE: the source stops delivering after SIZE bytes ...
+	 * - stallsec=N: ... for N seconds (default 10)
+	 * - xrun=N: an overrun is reported every N periods
+	 *
+	 * SIZE is a number optionally followed by B, KB, MB or GB.
+	 * Example: "fake:rate=200MB,fail=1GB".
+	 * @param sSource The source.
+	 * @param sError Set if the source is not supported.
+	 * @return The source or null if not supported.
+	 */
+	static unique_ptr<CaptureSource> create(const std::string& sSource, std::string& sError) noexcept;
+	/** Whether the source is supported.
+	 * @param sSource The source.
+	 * @return Whether create() would succeed.
+	 */
+	static bool isSupported(const std::string& sSource) noexcept;
+protected:
+	std::string m_sError;
+};
+
+/** In-process recording.
+ * A real-time capture thread reads from a CaptureSource into a SampleRingBuffer
+ * that is drained by an encoder thread writing wav files. The encoder switches
+ * to a new file (segment) at sample boundaries when either the max duration or
+ * the max size of a segment is reached.
+ * Each segment can also be written to a mirror file in another directory
+ * (see setMirrorDirPath()) by a third thread, so that a slow stick never holds
+ * up the encoder: if the mirror falls behind it is dropped for the segment.
+ * Capturing only fails when both files fail.
+ */
+class SonoCapture
+{
+public:
+	struct Init
+	{
+		std::string m_sSource; // See CaptureSource::create()
+		int32_t m_nSampleRate = 48000;
+		int32_t m_nChannels = 2;
+		int32_t m_nMaxSegmentSeconds = 60 * 60;
+		int64_t m_nMaxSegmentBytes = 1 * 1000 * 1000 * 1000;
+		// Returns the file path of the next segment. Called from the encoder thread!
+		std::function<std::string()> m_oNextSegmentPath;
+		// Optional. Called with the path of each segment file once it was created,
+		// before anything is written to it. Called from the encoder thread!
+		std::function<void(const std::string&)> m_oSegmentCreated;
+	};
+	explicit SonoCapture(Init&& oInit) noexcept;
+	/** Destructor.
+	 * If not stopped yet, blocks until the threads have terminated.
+	 */
+	~SonoCapture() noexcept;
+
+	/** Opens the first segment and starts capturing.
+	 * @return The error or empty if successful.
+	 */
+	std::string start() noexcept;
+	/** Stops capturing and finishes the current segment.
+	 * Doesn't block: m_oStoppedSignal is emitted once the threads have terminated.
+	 * The mirror is given s_nMirrorStopMillisec to write what was queued.
+	 */
+	void stop() noexcept;
+	/** Whether the threads have terminated after stop() or a failure.
+	 * The stats and the finished segments don't change anymore.
+	 */
+	bool isStopped() const noexcept;
+
+	/** Sets the directory where the next segments are mirrored.
+	 * Starting with the next segment, each segment is also written to a file
+	 * with the same name in this directory, followed by a checksum file
+	 * (see FileCopier::getChecksumFilePath()) when the segment is finished.
+	 * @param sDirPath The directory or empty to stop mirroring.
+	 */
+	void setMirrorDirPath(const std::string& sDirPath) noexcept;
+
+	/** The path of the segment currently being written. */
+	std::string getSegmentPath() const noexcept;
+	/** The path of the mirror of the segment currently being written or empty. */
+	std::string getMirrorSegmentPath() const noexcept;
+	struct FinishedSegment
+	{
+		std::string m_sPath; // empty if writing it failed while the mirror was fine
+		std::string m_sMirrorPath; // empty if not mirrored or if writing the mirror failed
+		std::string m_sError; // why one of the two files failed, if it did
+	};
+	/** Pops the oldest finished segment not yet popped.
+	 * @param oSegment Set to the finished segment.
+	 * @return Whether a segment was popped.
+	 */
+	bool popFinishedSegment(FinishedSegment& oSegment) noexcept;
+	/** Pops the oldest finished segment not yet popped.
+	 * @param sPath Set to the path of the segment, or of its mirror if the segment failed.
+	 * @return Whether a segment was popped.
+	 */
+	bool popFinishedSegment(std::string& sPath) noexcept;
+	/** The size of the segment currently being written. */
+	int64_t getSegmentBytes() const noexcept;
+	/** The number of bytes written to all segments. */
+	int64_t getTotalBytes() const noexcept;
+	/** The number of device overruns and of periods dropped because the encoder was too slow. */
+	int32_t getXruns() const noexcept;
+	/** Whether the capture thread could be given a real-time priority. */
+	bool isRealTime() const noexcept;
+	struct WriteStats
+	{
+		int64_t m_nWrites = 0;
+		int64_t m_nTotalMicrosec = 0;
+		int64_t m_nMaxMicrosec = 0;
+	};
+	/** The latency of the writes to the segments or to their mirrors.
+	 * @param bMirror Whether the mirrors.
+	 * @return The accumulated stats.
+	 */
+	WriteStats getWriteStats(bool bMirror) const noexcept;
+	/** Whether capturing failed. See getError(). */
+	bool hasFailed() const noexcept;
+	std::string getError() const noexcept;
+
+	/** Emitted in the main thread when a segment was finished or capturing failed. */
+	sigc::signal<void> m_oChangedSignal;
+	/** Emitted in the main thread when the threads have terminated. See stop(). */
+	sigc::signal<void> m_oStoppedSignal;
+
+private:
+	void captureThreadRun() noexcept;
+	void encoderThreadRun() noexcept;
+	bool writeFrames(const int16_t* p0Samples, int32_t nTotFrames) noexcept;
+	bool openSegment(std::string&& sPath) noexcept;
+	bool finishSegment() noexcept;
+	bool writeWavHeader() noexcept;
+	void fillWavHeader(uint8_t* p0Header) const noexcept;
+	bool writeSegmentFiles(const void* p0Buf, int64_t nBytes, int64_t nOffset, const char* p0What) noexcept;
+	void dropSegmentFile(const std::string& sError) noexcept;
+	void stopMirroring() noexcept;
+	std::string getMirrorChecksumContent() const noexcept;
+	void onMirrorClosed(const std::string& sError) noexcept;
+	void pushFinishedSegments() noexcept;
+	void setError(const std::string& sError) noexcept;
+	void stopMirror() noexcept;
+	void joinThreads() noexcept;
+	void onDispatched() noexcept;
+
+private:
+	Init m_oInit;
+	int32_t m_nFrameBytes;
+	int64_t m_nMaxSegmentFrames;
+
+	unique_ptr<CaptureSource> m_refSource;
+	unique_ptr<SampleRingBuffer> m_refRing;
+	int32_t m_nEncoderIdleMillisec;
+
+	std::thread m_oCaptureThread;
+	std::thread m_oEncoderThread;
+	std::atomic<bool> m_bStopping;
+	std::atomic<bool> m_bCaptureDone;
+	std::atomic<bool> m_bEncoderDone; // the mirror was stopped too, the threads can be joined
+	std::atomic<bool> m_bRealTime;
+	std::atomic<bool> m_bFailed;
+
+	std::atomic<int64_t> m_nSegmentBytes;
+	std::atomic<int64_t> m_nTotalBytes;
+	std::atomic<int32_t> m_nXruns;
+
+	struct AtomicWriteStats
+	{
+		std::atomic<int64_t> m_nWrites{0};
+		std::atomic<int64_t> m_nTotalMicrosec{0};
+		std::atomic<int64_t> m_nMaxMicrosec{0};
+	};
+	AtomicWriteStats m_oSegmentWriteStats;
+
+	// Writes the mirrors, null if its thread couldn't be started
+	unique_ptr<MirrorWriter> m_refMirror;
+
+	// Only used by the encoder thread (and start())
+	int m_nSegmentFd; // -1 if failed while mirroring
+	bool m_bMirrorOpened; // whether the current segment is mirrored
+	bool m_bMirroring; // whether the mirror of the current segment is still written
+	std::string m_sDroppedError; // why a file of the current segment was dropped
+	uint32_t m_nDataCrc; // of the data written so far to the current segment
+	int64_t m_nSegmentFrames;
+	int64_t m_nHeaderWrittenFrames;
+
+	mutable std::mutex m_oMutex;
+	// Protected by m_oMutex
+	std::string m_sSegmentPath;
+	std::string m_sMirrorSegmentPath;
+	std::string m_sMirrorDirPath;
+	std::vector<FinishedSegment> m_aFinishedSegments;
+	struct MirroringSegment
+	{
+		FinishedSegment m_oSegment;
+		bool m_bMirrorClosed = false;
+	};
+	// Finished by the encoder, moved to m_aFinishedSegments in order once their mirror is closed
+	std::deque<MirroringSegment> m_aMirroringSegments;
+	std::string m_sError;
+
+	Glib::Dispatcher m_oDispatcher;
+private:
+	SonoCapture() = delete;
+	SonoCapture(const SonoCapture& oSource) = delete;
+	SonoCapture& operator=(const SonoCapture& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_SONO_CAPTURE_H */
@@ -30,13 +30,19 @@
 #include <cassert>
 #include <iostream>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include <algorithm>
 #include <iterator>
+#include <sstream>
+#include <cmath>
+#include <tuple>
 
 #include <signal.h>
 #include <wait.h>
 #include <string.h>
-#include <sys/resource.h>
+#include <strings.h>
+#include <sys/inotify.h>
 #include <unistd.h>
 
 namespace sono
@@ -45,19 +51,65 @@ namespace sono
 static constexpr int32_t s_nMillionBytes = 1000 * 1000;
 
 static constexpr int32_t s_nMountAfterMillisec = 2000;
-static constexpr int32_t s_nCheckWaitingChildMillisec = 500;
-static constexpr int32_t s_nCheckToBeCopiedRecordingsSeconds = 17;
-static constexpr int32_t s_nCheckToBeSyncedRecordingsSeconds = 19;
-static constexpr int32_t s_nCheckToBeRemovedRecordingsSeconds = 15;
-
+// A recording that couldn't be (re)started is retried after this time
+static constexpr int32_t s_nRelaunchRecordingMillisec = 500;
+// The copy, sync and remove pipeline is run as soon as something changes,
+// this is only for retrying what failed or couldn't be done
+static constexpr int32_t s_nRetryPipelineSeconds = 17;
+
+// The size of the recording is polled only if it can't be watched,
+// otherwise the window is just refreshed
 static constexpr int32_t s_nCheckRecordingMaxFileSizeSeconds = 11;
+// A "rec" whose file doesn't grow for longer is restarted. Ogg pages
+// are written about every half second at the lowest quality.
+static constexpr int32_t s_nRecordingStallMillisec = 1500;
+// Like s_nRecordingStallMillisec while "rec" opens the audio device
+static constexpr int32_t s_nRecordingStartStallMillisec = 5000;
+// A stalled "rec" that doesn't exit after being interrupted is killed after this time
+static constexpr int32_t s_nKillStalledRecordingMillisec = 3000;
+// Recording directly to a stick: the new bytes are kept in memory this often
+// and synced to the stick every s_nRecordingTailSyncTicks times
+static constexpr int32_t s_nRecordingTailMillisec = 1000;
+static constexpr int32_t s_nRecordingTailSyncTicks = 10;
+// The format header at the start of the file is kept with the tail
+static constexpr int32_t s_nRecordingTailHeadBytes = 64 * 1024;
+static constexpr int64_t s_nRecordingTailMaxBytes = 64 * 1024 * 1024;
+
+// Gapless rotation: the next "rec" is launched this long before the current ends
+static constexpr int32_t s_nGaplessPreSpawnMillisec = 1500;
+// Gapless rotation: how often the next recording is checked for having started
+static constexpr int32_t s_nGaplessCheckOverlapMillisec = 50;
+// Gapless rotation: the previous recording is interrupted after this time at the latest
+static constexpr int32_t s_nGaplessMaxOverlapMillisec = 5000;
+static constexpr int32_t s_nGaplessMinDurationSeconds = 5;
 
 static constexpr int32_t s_nUpdateMountsFreeSpaceSeconds = 47;
+// The free space of the main disk is checked more often the nearer the limit
+static constexpr int32_t s_nCheckRecordingFsFreeSpaceMinSeconds = 1;
+static constexpr int32_t s_nCheckRecordingFsFreeSpaceMaxSeconds = 20;
+static constexpr int32_t s_nCheckWaitingForFreeSpaceMaxSeconds = 5;
+static constexpr int32_t s_nRecordingFsSmoothingSeconds = 60;
+// A warning is logged when the main disk is estimated to be full within
+static constexpr int32_t s_nRecordingFsFullWarningSeconds = 10 * 60;
+// A stick whose file system calls take longer is considered hung and blacklisted
+static constexpr int32_t s_nIoTimeoutMillisec = 15000;
 static constexpr int32_t s_nCheckSonoremQuitFileSeconds = 59;
 static constexpr int32_t s_nUnmountAfterStoppedSeconds = 30;
 
 static constexpr double s_fMountFreeSpaceToMaxRecordingSizeRatio = 1.2;
 
+// Copy progress: shorter intervals are merged into the next
+static constexpr double s_fCopyProgressMinSeconds = 0.2;
+// Copy progress: weight of the newest throughput in the moving average
+static constexpr double s_fCopyThroughputSmoothing = 0.25;
+// Copy progress: max rate of m_oCopyProgressSignal
+static constexpr int32_t s_nCopyProgressSignalMillisec = 1000;
+
+// Sticks whose write speed differs by less than this ratio are considered equally fast
+static constexpr double s_fMountSpeedClassRatio = 1.25;
+// Max number of probed sticks remembered in the speeds file
+static constexpr int32_t s_nMaxMountSpeeds = 100;
+
 static const std::string s_sMountFileExtTagName = "name";
 static const std::string s_sMountFileExtTagFolder = "folder";
 static const std::string s_sMountFileExtTagExclude = "excl";
@@ -68,15 +120,17 @@ static const std::string s_sFileExtTellStatus = "tell"; // secret
 static const std::string s_sFileExtQuitProgram = "quit"; // secret
 static const std::string s_sFileExtDontRfkillWifi = "wifi";
 static const std::string s_sFileExtDontRfkillBluetooth = "bluetooth";
+static const std::string s_sFileExtMountSpeeds = "speeds"; // in the recording directory
+static const std::string s_sFileExtJournal = "journal"; // in the recording directory
 
 const std::string SonoModel::s_sRecordingProgram = "rec";
+const std::string SonoModel::s_sControlSocketName = "sonorem";
+static const std::string s_sCaptureFileExt = "wav";
 const std::string SonoModel::s_sRecordingDefaultFileExt = "ogg";
 const int32_t SonoModel::s_nMaxSonoremNameLen = 30;
 
-static const std::string s_sSyncProgram = "sync";
 
 static constexpr int16_t s_nSignalToInterruptChildren = SIGINT;
-static constexpr int16_t s_nSignalToTerminateChildren = SIGTERM;
 
 
 SonoModel::RecordingData::RecordingData(SonoModel* p0This, Glib::Pid&& oPid, int nRecordingCoutFd, int nRecordingCerrFd) noexcept
@@ -88,12 +142,18 @@ SonoModel::RecordingData::RecordingData(SonoModel* p0This, Glib::Pid&& oPid, int
 	//
 	m_nCurrentRecordingSizeBytes = 0;
 	m_nCurrentRecordingLastSizeBytes = -1;
+	m_nNextRecordingFirstSizeBytes = -1;
+	m_nRotationOverlapMillisec = 0;
 	//
-	const int32_t nStartCheckingSeconds = std::max(0, p0This->m_oInit.m_nMaxRecordingDurationSeconds - 3);
-	//
-	m_oRecordingTimedOutConn = Glib::signal_timeout().connect_seconds(
-											sigc::mem_fun(*p0This, &SonoModel::checkRecordingTimedOut)
-											, nStartCheckingSeconds);
+	// Without gapless rotation "rec" ends by itself when the max duration
+	// is reached and the child supervisor takes care of it
+	if (p0This->m_oInit.m_bGaplessRotation) {
+		const int32_t nRotateMillisec = p0This->m_oInit.m_nMaxRecordingDurationSeconds * 1000 - s_nGaplessPreSpawnMillisec;
+		//
+		m_oRecordingTimedOutConn = Glib::signal_timeout().connect(
+												sigc::mem_fun(*p0This, &SonoModel::checkRecordingRotate)
+												, nRotateMillisec);
+	}
 	//
 	if (p0This->m_oInit.m_bDebug) {
 		m_refRecordingCout = Glib::RefPtr<PipeInputSource>(new PipeInputSource(nRecordingCoutFd));
@@ -109,31 +169,10 @@ SonoModel::RecordingData::~RecordingData() noexcept
 	m_oRecordingTimedOutConn.disconnect();
 	m_oRecordingCoutConn.disconnect();
 	m_oRecordingCerrConn.disconnect();
+	m_oRotationOverlapConn.disconnect();
+	m_oTailConn.disconnect();
 }
 ////////////////////////////////////////////////////////////////////////////////
-SonoModel::SyncingData::SyncingData(SonoModel* p0This, std::string&& sSyncingFileName, std::string&& sSyncingFilePath
-									, Glib::Pid&& oPid, int nSyncingCoutFd, int nSyncingCerrFd) noexcept
-: m_sSyncingFileName(std::move(sSyncingFileName))
-, m_sSyncingFilePath(std::move(sSyncingFilePath))
-, m_oSyncingPid(std::move(oPid))
-{
-	assert(p0This != nullptr);
-	DebugCtx<SonoModel> oCtx(p0This, "SyncingData::SyncingData");
-	//
-	if (p0This->m_oInit.m_bDebug) {
-		m_refSyncingCout = Glib::RefPtr<PipeInputSource>(new PipeInputSource(nSyncingCoutFd));
-		m_oSyncingCoutConn = m_refSyncingCout->connect(sigc::mem_fun(*p0This, &SonoModel::onSyncingCout));
-		m_refSyncingCout->attach();
-		m_refSyncingCerr = Glib::RefPtr<PipeInputSource>(new PipeInputSource(nSyncingCerrFd));
-		m_oSyncingCerrConn = m_refSyncingCerr->connect(sigc::mem_fun(*p0This, &SonoModel::onSyncingCerr));
-		m_refSyncingCerr->attach();
-	}
-}
-SonoModel::SyncingData::~SyncingData() noexcept
-{
-	m_oSyncingCoutConn.disconnect();
-	m_oSyncingCerrConn.disconnect();
-}
 
 ////////////////////////////////////////////////////////////////////////////////
 SonoModel::~SonoModel() noexcept
@@ -141,8 +180,11 @@ SonoModel::~SonoModel() noexcept
 	if (! m_sCurrentRecordingFilePath.empty()) {
 		interruptRecordingProcess();
 	}
-	if (m_refAsyncCopyCancellable) {
-		m_refAsyncCopyCancellable->cancel();
+	if (m_refRotatedRecordingData) {
+		interruptRotatedRecordingProcess();
+	}
+	for (auto& refCopyingData : m_aCopyingDatas) {
+		refCopyingData->m_refCopier->cancel();
 	}
 	if (m_refAsyncRemoveCancellable) {
 		m_refAsyncRemoveCancellable->cancel();
@@ -150,15 +192,17 @@ SonoModel::~SonoModel() noexcept
 	if (m_refAsyncUnmountCancellable) {
 		m_refAsyncUnmountCancellable->cancel();
 	}
-	for (auto& oPair : m_aWaitingRecPids) {
-		::waitpid(oPair.first, nullptr, 0);
-	}
-	if (m_refSyncingData) {
-		::waitpid(m_refSyncingData->m_oSyncingPid, nullptr, 0);
-	}
-	if (! m_sSyncingMountRootPath.empty()) {
-		maybeTerminateSyncingProcess();
+	m_oRelaunchRecordingConn.disconnect();
+	m_oSchedulePipelineConn.disconnect();
+	for (auto& oPair : m_aStalledRecPids) {
+		// Otherwise waiting for it might never end
+		oPair.second.disconnect();
+		::kill(oPair.first, SIGKILL);
 	}
+	m_oChildSupervisor.waitAll();
+	// Their encoder threads use the journal
+	m_aStoppingCaptures.clear();
+	m_refStoppedCapture.reset();
 }
 
 std::function<void(const std::string&)>& SonoModel::getLogger() noexcept
@@ -166,19 +210,6 @@ std::function<void(const std::string&)>& SonoModel::getLogger() noexcept
 	return m_oLogger;
 }
 
-static bool isUniqueInstance() noexcept
-{
-	const std::string sCmd = "ps -eo pid,comm | grep \" sonorem\" | grep -v " + std::to_string(::getpid());
-	std::string sResult;
-	std::string sError;
-	if (execCmd(sCmd.c_str(), sResult, sError)) {
-		sResult = strStrip(sResult);
-		if ((! sResult.empty()) && (sResult.substr(sResult.size() - 1 - 7) == " sonorem")) {
-			return false; //----------------------------------------------------
-		}
-	}
-	return true;
-}
 void SonoModel::pickupLeftoverToBeCopiedRecordings() noexcept
 {
 	Glib::Dir oDir(m_oInit.m_sRecordingDirPath);
@@ -194,73 +225,231 @@ void SonoModel::pickupLeftoverToBeCopiedRecordings() noexcept
 			m_oLogger("Picked up leftover recording: " + sFilePath);
 		}
 		m_aToBeCopiedRecordings.push_back(sFilePath);
+		journalTransition(sFilePath, JobJournal::STATE_QUEUED);
+	}
+	flushJournal();
+}
+void SonoModel::replayJournal() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::replayJournal");
+
+	// Appending transitions modifies the entries
+	const std::vector<JobJournal::Entry> aEntries = m_refJournal->getEntries();
+	for (const JobJournal::Entry& oEntry : aEntries) {
+		const std::string sFilePath = m_oInit.m_sRecordingDirPath + "/" + oEntry.m_sFileName;
+		if (! Glib::file_test(sFilePath, Glib::FILE_TEST_EXISTS)) {
+			// Removed while the transition wasn't flushed yet, or by the user
+			m_refJournal->append(oEntry.m_sFileName, JobJournal::STATE_REMOVED, "");
+			continue;
+		}
+		if (m_oInit.m_bVerbose) {
+			m_oLogger(std::string{"Resumed "} + JobJournal::getStateName(oEntry.m_eState) + " recording: " + sFilePath);
+		}
+		switch (oEntry.m_eState) {
+		case JobJournal::STATE_VERIFIED:
+		{
+			// The copy is known to be good
+			m_aToBeRemovedRecordings.push_back(sFilePath);
+		}
+		break;
+		case JobJournal::STATE_COPIED:
+		case JobJournal::STATE_SYNCED:
+		{
+			m_aToBeCopiedRecordings.push_back(sFilePath);
+			if (! oEntry.m_sMountUUID.empty()) {
+				// Not copied again if its stick is inserted first
+				m_aJournaledCopies.push_back(oEntry);
+			}
+		}
+		break;
+		default:
+		{
+			// A recording interrupted by the end of the program is copied as is
+			m_aToBeCopiedRecordings.push_back(sFilePath);
+		}
+		break;
+		}
 	}
+	flushJournal();
 }
-int64_t SonoModel::getFileSizeBytes(const std::string& sPath) const noexcept
+void SonoModel::journalTransition(const std::string& sRecordingFilePath, JobJournal::STATE eState
+									, const std::string& sMountRootPath) noexcept
 {
-	auto refFile = Gio::File::create_for_path(sPath);
-	return getFileSizeBytes(*(refFile.operator->()));
+	if (! m_refJournal) {
+		return; //--------------------------------------------------------------
+	}
+	if (Glib::path_get_dirname(sRecordingFilePath) != m_oInit.m_sRecordingDirPath) {
+		// Recorded directly to a mount
+		return; //--------------------------------------------------------------
+	}
+	std::string sMountUUID;
+	const int32_t nMountIdx = getMountIdxFromRootPath(sMountRootPath);
+	if (nMountIdx >= 0) {
+		sMountUUID = m_aMountInfos[nMountIdx].m_sUUID;
+	}
+	m_refJournal->append(Glib::path_get_basename(sRecordingFilePath), eState, sMountUUID);
 }
-int64_t SonoModel::getFileSizeBytes(Gio::File& oFile) const noexcept
+void SonoModel::flushJournal() noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::getFileSizeBytes");
-
-	Glib::RefPtr<Gio::FileInfo> refFileInfo;
-	try {
-		refFileInfo = oFile.query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE);
-	} catch (const Gio::Error& oErr) {
-		m_oLogger("Failed query_info: " + oErr.what());
-		return -1; //-----------------------------------------------------------
+	if (! m_refJournal) {
+		return; //--------------------------------------------------------------
 	}
-	//std::uint64_t n64FreeB = refFileInfo->get_size();
-	auto sFree = refFileInfo->get_attribute_as_string(G_FILE_ATTRIBUTE_STANDARD_SIZE);
-	std::uint64_t n64FreeB;
-	try {
-		n64FreeB = std::stoull(sFree);
-	} catch (const std::invalid_argument& /*oErr*/) {
-		n64FreeB = refFileInfo->get_attribute_uint64(G_FILE_ATTRIBUTE_STANDARD_SIZE);
-	} catch (const std::out_of_range& /*oErr*/) {
-		assert(false);
-		return -1; //-----------------------------------------------------------
+	std::string sError = m_refJournal->flush();
+	if (sError.empty() && m_refJournal->needsCompaction()) {
+		sError = m_refJournal->compact();
+	}
+	if (! sError.empty()) {
+		m_oLogger("! " + sError);
 	}
-	return static_cast<int64_t>(n64FreeB);
 }
+bool SonoModel::checkJournaledCopies() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkJournaledCopies");
+
+	const bool bContinue = true;
+	m_aJournaledCopies.erase(std::remove_if(m_aJournaledCopies.begin(), m_aJournaledCopies.end()
+								, [&](const JobJournal::Entry& oEntry)
+	{
+		const std::string sRecordingFilePath = m_oInit.m_sRecordingDirPath + "/" + oEntry.m_sFileName;
+		auto itRecording = std::find(m_aToBeCopiedRecordings.begin(), m_aToBeCopiedRecordings.end(), sRecordingFilePath);
+		if ((itRecording == m_aToBeCopiedRecordings.end()) || isBeingCopied(sRecordingFilePath)) {
+			// Already taken care of
+			return true;
+		}
+		auto itMountInfo = std::find_if(m_aMountInfos.begin(), m_aMountInfos.end(), [&](const MountInfo& oMountInfo)
+		{
+			return (oMountInfo.m_sUUID == oEntry.m_sMountUUID) && ! oMountInfo.m_bUnmounting;
+		});
+		if ((itMountInfo == m_aMountInfos.end()) || itMountInfo->isBlacklisted()) {
+			// Wait for its stick
+			return false;
+		}
+		if (std::find(m_aCheckingJournaledCopies.begin(), m_aCheckingJournaledCopies.end(), oEntry.m_sFileName)
+				!= m_aCheckingJournaledCopies.end()) {
+			return false;
+		}
+		const std::string sRootPath = itMountInfo->m_sRootPath;
+		const std::string sCopyPath = sRootPath + (itMountInfo->m_sFolder.empty() ? "" : "/" + itMountInfo->m_sFolder)
+										+ "/" + oEntry.m_sFileName;
+		auto refExists = std::make_shared<bool>(false);
+		const bool bPosted = m_oIoPool.post(sRootPath, s_nIoTimeoutMillisec, [refExists, sCopyPath]()
+		{
+			*refExists = Glib::file_test(sCopyPath, Glib::FILE_TEST_EXISTS);
+		}, [this, refExists, oEntry, sRootPath](bool bTimedOut)
+		{
+			m_aCheckingJournaledCopies.erase(std::remove(m_aCheckingJournaledCopies.begin(), m_aCheckingJournaledCopies.end()
+														, oEntry.m_sFileName), m_aCheckingJournaledCopies.end());
+			if (! bTimedOut) {
+				onJournaledCopyChecked(oEntry, sRootPath, *refExists);
+			}
+		});
+		if (bPosted) {
+			m_aCheckingJournaledCopies.push_back(oEntry.m_sFileName);
+		}
+		return false;
+	}), m_aJournaledCopies.end());
+	return bContinue;
+}
+void SonoModel::onJournaledCopyChecked(const JobJournal::Entry& oEntry, const std::string& sMountRootPath, bool bExists) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onJournaledCopyChecked");
 
-int64_t SonoModel::getFsFreeMB(const std::string& sPath) const noexcept
+	auto itEntry = std::find_if(m_aJournaledCopies.begin(), m_aJournaledCopies.end(), [&](const JobJournal::Entry& oCurEntry)
+	{
+		return (oCurEntry.m_sFileName == oEntry.m_sFileName);
+	});
+	if (itEntry == m_aJournaledCopies.end()) {
+		return; //--------------------------------------------------------------
+	}
+	// Things might have changed while the stick was looked at
+	const std::string sRecordingFilePath = m_oInit.m_sRecordingDirPath + "/" + oEntry.m_sFileName;
+	auto itRecording = std::find(m_aToBeCopiedRecordings.begin(), m_aToBeCopiedRecordings.end(), sRecordingFilePath);
+	if ((itRecording == m_aToBeCopiedRecordings.end()) || isBeingCopied(sRecordingFilePath)) {
+		// Already taken care of
+		m_aJournaledCopies.erase(itEntry);
+		return; //--------------------------------------------------------------
+	}
+	const int32_t nMountIdx = getMountIdxFromRootPath(sMountRootPath);
+	if ((nMountIdx < 0) || m_aMountInfos[nMountIdx].m_bUnmounting || (m_aMountInfos[nMountIdx].m_sUUID != oEntry.m_sMountUUID)) {
+		// Wait for its stick
+		return; //--------------------------------------------------------------
+	}
+	m_aJournaledCopies.erase(itEntry);
+	const MountInfo& oMountInfo = m_aMountInfos[nMountIdx];
+	if (! bExists) {
+		m_oLogger("Copy of " + oEntry.m_sFileName + " no longer on " + sMountRootPath);
+		return; //--------------------------------------------------------------
+	}
+	m_aToBeCopiedRecordings.erase(itRecording);
+	// The verification against the checksum file catches incomplete copies
+	const auto oPair = std::make_pair(sMountRootPath, oEntry.m_sFileName);
+	if (oEntry.m_eState == JobJournal::STATE_COPIED) {
+		m_aToBeSyncedRecordings.push_back(oPair);
+	} else {
+		m_aToBeVerifiedRecordings.push_back(oPair);
+	}
+	const std::string sFolderPath = sMountRootPath + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder);
+	m_oLogger("Resuming " + oEntry.m_sFileName + " on " + sFolderPath + " without copying");
+	schedulePipeline();
+}
+int64_t SonoModel::sampleRecordingFsFreeMB() noexcept
 {
-	auto refFile = Gio::File::create_for_path(sPath);
-	return getFsFreeMB(*(refFile.operator->()));
+	// Might call onRecordingFsFreeBytesChanged()
+	const int64_t nFreeBytes = m_oRecordingFsSampler.getFreeBytes(m_oInit.m_sRecordingDirPath);
+	m_refRecordingFsPredictor->addFreeSample(std::chrono::steady_clock::now(), nFreeBytes);
+	return ((nFreeBytes < 0) ? -1 : nFreeBytes / s_nMillionBytes);
 }
-int64_t SonoModel::getFsFreeMB(Gio::File& oFile) const noexcept
+bool SonoModel::checkRecordingFsFreeSpace() noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::getFsFreeMB");
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkRecordingFsFreeSpace");
 
-	Glib::RefPtr<Gio::FileInfo> refFileInfo;
-	try {
-		refFileInfo = oFile.query_filesystem_info(G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
-	} catch (const Gio::Error& oErr) {
-		m_oLogger("Failed query_filesystem_info: " + oErr.what());
-		return -1; //-----------------------------------------------------------
+	const bool bContinue = true;
+
+	if (m_sCurrentRecordingFilePath.empty()) {
+		m_refRecordingFsPredictor->recordingStopped();
 	}
-	if (! refFileInfo) {
-		const std::string sErr = "Failed query_filesystem_info: try creating a Gtk::Application object"
-								"\ninstead of Glib::init() which apparently isn't enough";
-		std::cerr << sErr << '\n';
-		m_oLogger(sErr);
-		return -1; //-----------------------------------------------------------
+	m_nRecordingFsFreeMB = sampleRecordingFsFreeMB();
+	checkRecordingFsFull();
+
+	const int32_t nSeconds = m_refRecordingFsPredictor->getCheckIntervalSeconds(s_nCheckRecordingFsFreeSpaceMinSeconds
+																				, s_nCheckRecordingFsFreeSpaceMaxSeconds);
+	if (nSeconds == m_nCheckRecordingFsFreeSpaceSeconds) {
+		return bContinue; //----------------------------------------------------
 	}
-	auto sFree = refFileInfo->get_attribute_as_string(G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
-	std::uint64_t n64FreeB;
-	try {
-		n64FreeB = std::stoull(sFree);
-	} catch (const std::invalid_argument& /*oErr*/) {
-		n64FreeB = refFileInfo->get_attribute_uint64(G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
-	} catch (const std::out_of_range& /*oErr*/) {
-		assert(false);
-		return -1; //-----------------------------------------------------------
+	m_nCheckRecordingFsFreeSpaceSeconds = nSeconds;
+	m_oCheckRecordingFsFreeSpaceConn = Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this
+											, &SonoModel::checkRecordingFsFreeSpace), nSeconds);
+	return ! bContinue;
+}
+void SonoModel::checkRecordingFsFull() noexcept
+{
+	const int64_t nFullSeconds = getRecordingFsFullSeconds();
+	const bool bNearFull = (m_eState == STATE_RECORDING) && (nFullSeconds >= 0)
+							&& (nFullSeconds < s_nRecordingFsFullWarningSeconds);
+	if (! bNearFull) {
+		m_bRecordingFsFullWarned = false;
+		return; //--------------------------------------------------------------
+	}
+	if (m_bRecordingFsFullWarned) {
+		return; //--------------------------------------------------------------
+	}
+	m_bRecordingFsFullWarned = true;
+	m_oLogger("! Main disk full in about " + getDurationInSecondsAsString(nFullSeconds)
+				+ " (written " + std::to_string(static_cast<int64_t>(m_refRecordingFsPredictor->getWrittenBytesPerSecond()))
+				+ " B/s, freed " + std::to_string(static_cast<int64_t>(m_refRecordingFsPredictor->getDrainedBytesPerSecond()))
+				+ " B/s)");
+	if (m_aMountInfos.empty()) {
+		m_oLogger("Insert a usb memory stick to free space.");
+	}
+}
+void SonoModel::onRecordingFsFreeBytesChanged(const std::string& /*sDirPath*/, int64_t nFreeBytes) noexcept
+{
+	const int64_t nFreeMB = ((nFreeBytes < 0) ? -1 : nFreeBytes / s_nMillionBytes);
+	if (nFreeMB == m_nRecordingFsFreeMB) {
+		return; //--------------------------------------------------------------
 	}
-	const int64_t nFreeMB = n64FreeB / s_nMillionBytes;
-	return nFreeMB;
+	m_nRecordingFsFreeMB = nFreeMB;
+	m_oRecordingFsFreeMBChangedSignal.emit();
 }
 
 static bool strIsSonoremName(const std::string& sStr) noexcept
@@ -342,7 +531,8 @@ bool SonoModel::isAutoStart() const noexcept
 {
 	return m_oInit.m_bAutoStart;
 }
-bool SonoModel::isMountExcluded(Gio::Mount& oMount, const std::string& sName, const std::string& sRootPath) noexcept
+bool SonoModel::isMountExcluded(Gio::Mount& oMount, const MountControlFiles& oControlFiles, const std::string& sName
+								, const std::string& sRootPath) noexcept
 {
 	DebugCtx<SonoModel> oCtx(this, " SonoModel::isMountExcluded");
 
@@ -352,7 +542,7 @@ bool SonoModel::isMountExcluded(Gio::Mount& oMount, const std::string& sName, co
 	if (oMount.is_shadowed()) {
 		return true;
 	}
-	if (sonoremFileExists(sRootPath, s_sMountFileExtTagExclude)) {
+	if (oControlFiles.m_bExclude) {
 		return true;
 	}
 	const auto itFind = std::find(m_oInit.m_aExclMountNames.begin(), m_oInit.m_aExclMountNames.end(), sName);
@@ -375,50 +565,81 @@ bool SonoModel::isMountExcluded(Gio::Mount& oMount, const std::string& sName, co
 	}
 	return false;
 }
-void SonoModel::getMountOverridables(const std::string& sRootPath, std::string& sName, std::string& sFolder) noexcept
+void SonoModel::getMountOverridables(const MountControlFiles& oControlFiles, const std::string& sRootPath
+										, std::string& sName, std::string& sFolder) noexcept
 {
 	DebugCtx<SonoModel> oCtx(this, "SonoModel::getMountOverridables");
 
-	const std::string sNameFilePath = sRootPath + "/sonorem." + s_sMountFileExtTagName;
-	if (Glib::file_test(sNameFilePath, Glib::FILE_TEST_EXISTS)) {
-		const std::string sCmd = "cat " + sNameFilePath;
-		std::string sResult;
-		std::string sError;
-		if (execCmd(sCmd.c_str(), sResult, sError)) {
-			sResult = strStrip(sResult);
-			if (strIsSonoremName(sResult)) {
-				m_oLogger("Renamed mount '" + sName + "' to '" + sResult + "'");
-				sName = sResult;
-			} else if (m_oInit.m_bVerbose) {
-				m_oLogger("Renaming mount error: invalid characters");
-			}
+	if (oControlFiles.m_bHasName) {
+		const std::string& sResult = oControlFiles.m_sName;
+		if (strIsSonoremName(sResult)) {
+			m_oLogger("Renamed mount '" + sName + "' to '" + sResult + "'");
+			sName = sResult;
+		} else if (m_oInit.m_bVerbose) {
+			m_oLogger("Renaming mount error: invalid characters");
 		}
 	}
-	const std::string sFolderFilePath = sRootPath + "/sonorem." + s_sMountFileExtTagFolder;
-	if (Glib::file_test(sFolderFilePath, Glib::FILE_TEST_EXISTS)) {
-		const std::string sCmd = "cat " + sFolderFilePath;
-		std::string sResult;
-		std::string sError;
-		if (execCmd(sCmd.c_str(), sResult, sError)) {
-			sResult = strStrip(sResult);
-			if (strIsSonoremFolder(sResult)) {
-				sFolder = sResult;
-				const std::string sFolderPath = sRootPath + "/" + sFolder;
-				if (Glib::file_test(sFolderPath, Glib::FILE_TEST_EXISTS)
-						&& Glib::file_test(sFolderPath, Glib::FILE_TEST_IS_DIR)) {
-					m_oLogger("Mount folder of '" + sName + "' is '" + sFolder + "/'");
-				} else {
-					m_oLogger("Setting mount folder error: " + sFolderPath + " not found or not a directory");
-				}
-			} else if (m_oInit.m_bVerbose) {
-				m_oLogger("Setting mount folder error: invalid characters");
+	if (oControlFiles.m_bHasFolder) {
+		const std::string& sResult = oControlFiles.m_sFolder;
+		if (strIsSonoremFolder(sResult)) {
+			sFolder = sResult;
+			const std::string sFolderPath = sRootPath + "/" + sFolder;
+			if (oControlFiles.m_bFolderExists) {
+				m_oLogger("Mount folder of '" + sName + "' is '" + sFolder + "/'");
+			} else {
+				m_oLogger("Setting mount folder error: " + sFolderPath + " not found or not a directory");
 			}
+		} else if (m_oInit.m_bVerbose) {
+			m_oLogger("Setting mount folder error: invalid characters");
 		}
 	}
 }
-bool SonoModel::sonoremFileExists(const std::string& sRootPath, const std::string& sFileExt) noexcept
-{
-	return Glib::file_test(sRootPath + "/sonorem." + sFileExt, Glib::FILE_TEST_EXISTS);
+static SonoModel::MountControlFiles getMountControlFiles(const MountScanner& oScanner) noexcept
+{
+	SonoModel::MountControlFiles oControlFiles;
+	for (const MountScanner::File& oFile : oScanner.getFiles()) {
+		const std::string& sFileExt = oFile.m_sName;
+		if (sFileExt == s_sMountFileExtTagName) {
+			oControlFiles.m_bHasName = true;
+			oControlFiles.m_sName = strStrip(oFile.m_sContents);
+		} else if (sFileExt == s_sMountFileExtTagFolder) {
+			oControlFiles.m_bHasFolder = true;
+			oControlFiles.m_sFolder = strStrip(oFile.m_sContents);
+		} else if (sFileExt == s_sMountFileExtTagExclude) {
+			oControlFiles.m_bExclude = true;
+		} else if (sFileExt == s_sFileExtStopRecording) {
+			oControlFiles.m_bStopRecording = true;
+		} else if (sFileExt == s_sFileExtStartRecording) {
+			oControlFiles.m_bStartRecording = true;
+		} else if (sFileExt == s_sFileExtUnmountNonBusyDirty) {
+			oControlFiles.m_bUnmountNonBusyDirty = true;
+		} else if (sFileExt == s_sFileExtTellStatus) {
+			oControlFiles.m_bTellStatus = true;
+		} else if (sFileExt == s_sFileExtQuitProgram) {
+			oControlFiles.m_bQuitProgram = true;
+		} else if (sFileExt == s_sFileExtDontRfkillWifi) {
+			oControlFiles.m_bDontRfkillWifi = true;
+		} else if (sFileExt == s_sFileExtDontRfkillBluetooth) {
+			oControlFiles.m_bDontRfkillBluetooth = true;
+		}
+	}
+	if (oControlFiles.m_bHasFolder) {
+		const auto& aDirNames = oScanner.getDirNames();
+		auto itDirName = std::find(aDirNames.begin(), aDirNames.end(), oControlFiles.m_sFolder);
+		if (itDirName == aDirNames.end()) {
+			// Case insensitive like the control files: on vfat sticks 'Rec' might show as 'REC'
+			itDirName = std::find_if(aDirNames.begin(), aDirNames.end(), [&](const std::string& sDirName)
+			{
+				return (::strcasecmp(sDirName.c_str(), oControlFiles.m_sFolder.c_str()) == 0);
+			});
+			if (itDirName != aDirNames.end()) {
+				// The name as it is on the stick
+				oControlFiles.m_sFolder = *itDirName;
+			}
+		}
+		oControlFiles.m_bFolderExists = (itDirName != aDirNames.end());
+	}
+	return oControlFiles;
 }
 
 std::string SonoModel::init(Init&& oInit) noexcept
@@ -432,16 +653,78 @@ std::string SonoModel::init(Init&& oInit) noexcept
 	assert(! oInit.m_sRecordingDirPath.empty());
 	assert(m_oInit.m_sRecordingDirPath.empty()); // Called more than once
 	//
-	if (! isUniqueInstance()) {
+	// Binding is atomic, unlike looking for a process with the same name
+	bool bAlreadyBound = false;
+	const std::string sSocketError = m_oControlSocket.listen((oInit.m_sControlSocketName.empty()
+																? s_sControlSocketName : oInit.m_sControlSocketName)
+															, bAlreadyBound);
+	if (bAlreadyBound) {
 		const std::string sErr = "An instance of sonorem is already running";
 		return sErr; //---------------------------------------------------------
+	} else if (! sSocketError.empty()) {
+		return sSocketError; //-------------------------------------------------
 	}
+	m_oControlSocket.m_oCommandSignal.connect(sigc::mem_fun(*this, &SonoModel::onControlCommand));
+	m_oIoPool.m_oHungSignal.connect(sigc::mem_fun(*this, &SonoModel::onIoHung));
 	//
 	m_oInit = std::move(oInit);
 
-	m_nRecordingFsFreeMB = getFsFreeMB(m_oInit.m_sRecordingDirPath);
+	if (m_oInit.m_bGaplessRotation && (m_oInit.m_nMaxRecordingDurationSeconds < s_nGaplessMinDurationSeconds)) {
+		m_oLogger("Gapless rotation disabled: recordings must last at least "
+					+ std::to_string(s_nGaplessMinDurationSeconds) + " seconds");
+		m_oInit.m_bGaplessRotation = false;
+	}
+	if (! m_oInit.m_sCaptureSource.empty()) {
+		std::string sError;
+		if (! CaptureSource::create(m_oInit.m_sCaptureSource, sError)) {
+			return sError; //---------------------------------------------------
+		}
+		if (m_oInit.m_sRecordingFileExt != s_sCaptureFileExt) {
+			m_oLogger("In-process recording only supports the " + s_sCaptureFileExt + " sound format");
+			m_oInit.m_sRecordingFileExt = s_sCaptureFileExt;
+		}
+		// The capture engine switches file without losing samples
+		m_oInit.m_bGaplessRotation = false;
+		if (m_oInit.m_bDirectToStick) {
+			// The segment paths are chosen by the encoder thread
+			m_oLogger("Recording directly to a stick is not supported by in-process recording");
+			m_oInit.m_bDirectToStick = false;
+		}
+	} else if (m_oInit.m_bMirrorToStick) {
+		m_oLogger("Mirroring to a stick is only supported by in-process recording");
+		m_oInit.m_bMirrorToStick = false;
+	}
+
+	if (m_oInit.m_nMaxParallelCopies < 1) {
+		return "Max parallel copies must be at least 1"; //---------------------
+	}
+
+	const std::string sSamplerError = m_oRecordingFsSampler.addDir(m_oInit.m_sRecordingDirPath);
+	if (! sSamplerError.empty()) {
+		// Sampled by path
+		m_oLogger(sSamplerError);
+	}
+	m_refRecordingFsPredictor = std::make_unique<SpacePredictor>(m_oInit.m_nMinFreeSpaceBytes, s_nRecordingFsSmoothingSeconds);
+	m_nRecordingFsFreeMB = sampleRecordingFsFreeMB();
+	m_oRecordingFsSampler.m_oFreeBytesChangedSignal.connect(sigc::mem_fun(*this, &SonoModel::onRecordingFsFreeBytesChanged));
 
-	pickupLeftoverToBeCopiedRecordings();
+	m_refJournal = std::make_unique<JobJournal>(m_oInit.m_sRecordingDirPath + "/sonorem." + s_sFileExtJournal);
+	bool bJournalExisted = false;
+	const std::string sJournalError = m_refJournal->open(bJournalExisted);
+	if (! sJournalError.empty()) {
+		m_oLogger("! " + sJournalError);
+		m_refJournal.reset();
+	}
+	if (m_refJournal && bJournalExisted) {
+		// Much faster than scanning and doesn't copy what was already copied.
+		// Every recording, capture segments included, is journaled when created
+		replayJournal();
+	} else {
+		pickupLeftoverToBeCopiedRecordings();
+	}
+	//
+	m_sMountSpeedsFilePath = m_oInit.m_sRecordingDirPath + "/sonorem." + s_sFileExtMountSpeeds;
+	loadMountSpeeds();
 	//
 	m_refVolumeMonitor = Gio::VolumeMonitor::get();
 	//
@@ -457,82 +740,55 @@ std::string SonoModel::init(Init&& oInit) noexcept
 	m_refVolumeMonitor->signal_volume_removed().connect(
 								sigc::mem_fun(*this, &SonoModel::onVolumeRemoved) );
 	//
+	m_oMountRootsWatcher.m_oChangedSignal.connect(
+								sigc::mem_fun(*this, &SonoModel::onMountRootChanged) );
+	//
+	// The mounts are added as soon as they are scanned, recording doesn't have to wait
 	std::vector<Glib::RefPtr<Gio::Mount>> aMounts = m_refVolumeMonitor->get_mounts();
+	m_nPendingStartupMountScans = static_cast<int32_t>(aMounts.size());
 	for (auto& refMount : aMounts) {
-		Gio::Mount& oMount = *(refMount.operator->());
-		auto refRootFile = oMount.get_root();
-		std::string sRootPath = refRootFile->get_path();
-		std::string sName = oMount.get_name();
-		std::string sUUID = getMountUUID(oMount);
-		std::string sFolder;
-
-		auto oOverrideOptionToFalse = [&](bool& bOption, const std::string& sOption, const std::string& sFileExt, const std::string& sComment)
-		{
-			if (bOption && sonoremFileExists(sRootPath, sFileExt)) {
-				m_oLogger("Overriding " + sOption + " option: " + sComment);
-				bOption = false;
-			}
-		};
-		oOverrideOptionToFalse(m_oInit.m_bAutoStart, "--auto", s_sFileExtStopRecording, "no autostart!");
-		//
-		auto oForcingOption = [&](bool& bOption, const std::string& sOption, const std::string& sFileExt, const std::string& sComment)
-		{
-			if ((! bOption) && sonoremFileExists(sRootPath,  sFileExt)) {
-				m_oLogger("Forcing " + sOption + " option: " + sComment);
-				bOption = true;
-			}
-		};
-		oForcingOption(m_oInit.m_bRfkillWifiOn, "--wifi-on", s_sFileExtDontRfkillWifi, "starting wifi!");
-		oForcingOption(m_oInit.m_bRfkillBluetoothOn, "--bluetooth-on", s_sFileExtDontRfkillBluetooth, "starting bluetooth!");
-		//
-		m_oLogger("Found mount with root path: " + sRootPath + " (name: " + sName + ")");
-		//
-		getMountOverridables(sRootPath, sName, sFolder);
-		//
-		if (isMountExcluded(oMount, sName, sRootPath)) {
-			m_oLogger("       EXCLUDED!");
-			continue;
-		}
-		const int64_t nMountFreeSpace = getFsFreeMB(*(refRootFile.operator->()));
-		if (nMountFreeSpace < 0) {
-			m_oLogger("  Could not get free space of fs: " + sRootPath);
-			m_oLogger("       EXCLUDED!");
-			continue;
-		}
-		m_aMountInfos.emplace_back();
-		MountInfo& oMountInfo = m_aMountInfos.back();
-		oMountInfo.m_sName = std::move(sName);
-		oMountInfo.m_sFolder = std::move(sFolder);
-		oMountInfo.m_sRootPath = std::move(sRootPath);
-		oMountInfo.m_sUUID = std::move(sUUID);
-		oMountInfo.m_nFreeMB = nMountFreeSpace;
+		startMountScan(refMount, true, false);
 	}
 	//
-	sortMounts();
-	//
 	if (m_oInit.m_bVerbose) {
 		m_oLogger("Initialized model");
 		m_oLogger("  Max. recording file duration (seconds): " + std::to_string(m_oInit.m_nMaxRecordingDurationSeconds ));
 		m_oLogger("  Max. recording file size (bytes):       " + std::to_string(m_oInit.m_nMaxFileSizeBytes));
 		m_oLogger("  Min. free space on main disk (bytes):   " + std::to_string(m_oInit.m_nMinFreeSpaceBytes));
+		m_oLogger(std::string{"  Gapless rotation:                       "} + (m_oInit.m_bGaplessRotation ? "yes" : "no"));
+		m_oLogger("  Max. parallel copies:                   " + std::to_string(m_oInit.m_nMaxParallelCopies));
+		m_oLogger(std::string{"  Follow copy:                            "} + (m_oInit.m_bFollowCopy ? "yes" : "no"));
+		m_oLogger(std::string{"  Direct to stick:                        "} + (m_oInit.m_bDirectToStick ? "yes" : "no"));
+		m_oLogger(std::string{"  Mirror to stick:                        "} + (m_oInit.m_bMirrorToStick ? "yes" : "no"));
+		m_oLogger("  Capture source:                         " + (m_oInit.m_sCaptureSource.empty()
+																	? s_sRecordingProgram : m_oInit.m_sCaptureSource));
 	}
 	//
 	m_sSonoremQuitFilePath = m_oInit.m_sRecordingDirPath + "/sonorem." + s_sFileExtQuitProgram;
 	//
-	Glib::signal_timeout().connect(sigc::mem_fun(*this, &SonoModel::checkWaitingChild), s_nCheckWaitingChildMillisec);
-	Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &SonoModel::checkToBeCopiedRecordings)
-										, std::min(s_nCheckToBeCopiedRecordingsSeconds, m_oInit.m_nMaxRecordingDurationSeconds));
-	Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &SonoModel::checkToBeSyncedRecordings)
-										, std::min(s_nCheckToBeSyncedRecordingsSeconds, m_oInit.m_nMaxRecordingDurationSeconds));
-	Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &SonoModel::checkToBeRemovedRecordings)
-										, std::min(s_nCheckToBeRemovedRecordingsSeconds, m_oInit.m_nMaxRecordingDurationSeconds));
+	Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &SonoModel::checkPipeline), s_nRetryPipelineSeconds);
+	// leftover recordings
+	schedulePipeline();
 	// The following also updates m_nCurrentRecordingSizeBytes
 	Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &SonoModel::checkRecordingMaxFileSize), s_nCheckRecordingMaxFileSizeSeconds);
 	//
 	Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &SonoModel::updateMountsFreeSpace), s_nUpdateMountsFreeSpaceSeconds);
 	//
+	m_nCheckRecordingFsFreeSpaceSeconds = s_nCheckRecordingFsFreeSpaceMinSeconds;
+	m_oCheckRecordingFsFreeSpaceConn = Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this
+											, &SonoModel::checkRecordingFsFreeSpace), m_nCheckRecordingFsFreeSpaceSeconds);
+	//
 	Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &SonoModel::checkSonoremQuitFile), s_nCheckSonoremQuitFileSeconds);
 
+	if (m_nPendingStartupMountScans == 0) {
+		applyRfkillOptions();
+	}
+	return "";
+}
+void SonoModel::applyRfkillOptions() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::applyRfkillOptions");
+
 	std::string sError;
 	if (m_oInit.m_bRfkillWifiOn) {
 		sError = setWifiSoftwareEnabled(true);
@@ -547,7 +803,6 @@ std::string SonoModel::init(Init&& oInit) noexcept
 	if (! sError.empty()) {
 		m_oLogger(sError);
 	}
-	return "";
 }
 SonoModel::STATE SonoModel::getState() const noexcept
 {
@@ -562,6 +817,13 @@ int64_t SonoModel::getRecordingFsFreeMB() const noexcept
 {
 	return m_nRecordingFsFreeMB;
 }
+int64_t SonoModel::getRecordingFsFullSeconds() const noexcept
+{
+	if (! m_refRecordingFsPredictor) {
+		return -1; //-----------------------------------------------------------
+	}
+	return m_refRecordingFsPredictor->getSecondsToLimit();
+}
 const std::string& SonoModel::getRecordingFileExt() const noexcept
 {
 	return m_oInit.m_sRecordingFileExt;
@@ -612,60 +874,100 @@ void SonoModel::onMountAdded(const Glib::RefPtr<Gio::Mount>& refMount) noexcept
 {
 	DebugCtx<SonoModel> oCtx(this, "SonoModel::onMountAdded");
 
-	Gio::Mount& oMount = *(refMount.operator->());
-	auto refRootFile = oMount.get_root();
-	std::string sName = oMount.get_name();
-	std::string sUUID = getMountUUID(oMount);
-	std::string sFolder;
-	std::string sRootPath = refRootFile->get_path();
+	auto refRootFile = refMount->get_root();
+	const std::string sRootPath = refRootFile->get_path();
+	const std::string sUUID = getMountUUID(*(refMount.operator->()));
 
 	m_oLogger("Mount added: " + sRootPath);
 	if (! sUUID.empty()) {
 		m_oLogger("       UUID: " + sRootPath);
 	}
-	//
-	bool bQuitting = false;
-	if (sonoremFileExists(sRootPath, s_sFileExtQuitProgram)) {
-		bQuitting = true;
-	} else if (sonoremFileExists(sRootPath, s_sFileExtTellStatus)) {
-		m_oTellStatusSignal.emit();
+	// The control files are only looked at when the stick has woken up
+	startMountScan(refMount, false, false);
+}
+void SonoModel::startMountScan(const Glib::RefPtr<Gio::Mount>& refMount, bool bAtStartup, bool bRefresh) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::startMountScan");
+
+	Gio::Mount& oMount = *(refMount.operator->());
+	auto refRootFile = oMount.get_root();
+	auto refScanData = std::make_unique<MountScanData>();
+	refScanData->m_refMount = refMount;
+	refScanData->m_sName = oMount.get_name();
+	refScanData->m_sUUID = getMountUUID(oMount);
+	refScanData->m_bAtStartup = bAtStartup;
+	refScanData->m_bRefresh = bRefresh;
+	refScanData->m_refScanner = std::make_unique<MountScanner>(refRootFile->get_path(), "sonorem.");
+	MountScanner* p0Scanner = refScanData->m_refScanner.get();
+	p0Scanner->m_oFinishedSignal.connect(sigc::bind(sigc::mem_fun(*this, &SonoModel::onMountScanFinished), p0Scanner));
+	m_aMountScans.push_back(std::move(refScanData));
+	// even if the thread can't be started onMountScanFinished() is called
+	p0Scanner->start();
+}
+void SonoModel::onMountScanFinished(MountScanner* p0Scanner) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onMountScanFinished");
+
+	auto itScanData = std::find_if(m_aMountScans.begin(), m_aMountScans.end(), [&](const unique_ptr<MountScanData>& refScanData)
+	{
+		return (refScanData->m_refScanner.get() == p0Scanner);
+	});
+	assert(itScanData != m_aMountScans.end());
+	// We are within a signal of the scanner, it's deleted later
+	m_aFinishedMountScans.push_back(std::move(*itScanData));
+	m_aMountScans.erase(itScanData);
+	MountScanData& oScanData = *(m_aFinishedMountScans.back());
+	const MountScanner& oScanner = *(oScanData.m_refScanner);
+	std::string sRootPath = oScanner.getRootPath();
+	std::string sName = oScanData.m_sName;
+	std::string sFolder;
+	const bool bAtStartup = oScanData.m_bAtStartup;
+	const MountControlFiles oControlFiles = getMountControlFiles(oScanner);
+	// Changed while being scanned, might be stale
+	const bool bRescan = oScanData.m_bRescan;
+	auto oRescan = [&]()
+	{
+		auto refMount = getGioMountFromRootPath(oScanner.getRootPath());
+		if (bRescan && refMount) {
+			startMountScan(refMount, false, true);
+		}
+	};
+	if (oScanData.m_bRefresh) {
+		refreshMountControlFiles(sRootPath, oControlFiles);
+		oRescan();
+		return; //--------------------------------------------------------------
 	}
-	bool bStopped = false;
-	if ((m_eState != STATE_STOPPED)
-			&& (bQuitting || sonoremFileExists(sRootPath, s_sFileExtStopRecording))) {
-		//
-		stopRecording();
-		//
-		m_oLogger("Stopped recording because detected sonorem." + (bQuitting ? s_sFileExtQuitProgram : s_sFileExtStopRecording)
-					+ "\n  on mount " + sRootPath);
-		bStopped = true;
+	//
+	if (bAtStartup) {
+		applyStartupMountFiles(oControlFiles);
+		--m_nPendingStartupMountScans;
+		if (m_nPendingStartupMountScans == 0) {
+			// A stick might have forced an option
+			applyRfkillOptions();
+		}
+	} else {
+		applyMountControlFiles(oControlFiles, sRootPath);
 	}
-	if ((! bQuitting) && (! bStopped) && (m_eState != STATE_RECORDING)
-				&& (sonoremFileExists(sRootPath, s_sFileExtStartRecording))) {
-		startRecording();
+	if (! getGioMountFromRootPath(sRootPath)) {
+		m_oLogger("Mount removed while being scanned: " + sRootPath);
+		return; //--------------------------------------------------------------
 	}
-	if (sonoremFileExists(sRootPath, s_sFileExtUnmountNonBusyDirty)) {
-		m_oLogger("Unmounting because detected sonorem." + s_sFileExtUnmountNonBusyDirty
-					+ (bStopped ? "\n  in " + std::to_string(s_nUnmountAfterStoppedSeconds) + " seconds" : ""));
-		// if stopped or quitting wait a little bit for the recording to possibly be moved to mount
-		Glib::signal_timeout().connect_seconds_once(sigc::mem_fun(*this, &SonoModel::unmountNonBusy), bStopped ? s_nUnmountAfterStoppedSeconds : 0);
+	if (getMountIdxFromRootPath(sRootPath) >= 0) {
+		// Added twice while starting up
+		return; //--------------------------------------------------------------
 	}
-	//
-	if (bQuitting) {
-		Glib::signal_timeout().connect_seconds_once(sigc::mem_fun(*this, &SonoModel::sonoremQuit), s_nCheckSonoremQuitFileSeconds);
+	if (bAtStartup) {
+		m_oLogger("Found mount with root path: " + sRootPath + " (name: " + sName + ")");
 	}
 	//
-	getMountOverridables(sRootPath, sName, sFolder);
+	getMountOverridables(oControlFiles, sRootPath, sName, sFolder);
 	//
-	if (isMountExcluded(oMount, sName, sRootPath)) {
+	if (isMountExcluded(*(oScanData.m_refMount.operator->()), oControlFiles, sName, sRootPath)) {
 		m_oLogger("       EXCLUDED!");
 		return; //--------------------------------------------------------------
 	}
-
-//std::cout << "Mount added: " << refMount->get_name() << '\n';
-//std::cout << "       UUID: " << sUUID << '\n';
-	const int64_t nMountFreeSpace =  getFsFreeMB(*(refRootFile.operator->()));
-	if (nMountFreeSpace < 0) {
+	const int64_t nMountFreeBytes = oScanner.getFreeBytes();
+	if (nMountFreeBytes < 0) {
 		m_oLogger("  Could not get free space of fs: " + sRootPath);
 		m_oLogger("       EXCLUDED!");
 		return; //--------------------------------------------------------------
@@ -676,86 +978,321 @@ void SonoModel::onMountAdded(const Glib::RefPtr<Gio::Mount>& refMount) noexcept
 	oMountInfo.m_sRootPath = std::move(sRootPath);
 	oMountInfo.m_sName = std::move(sName);
 	oMountInfo.m_sFolder = std::move(sFolder);
-	oMountInfo.m_sUUID = std::move(sUUID);
-
-	oMountInfo.m_nFreeMB = nMountFreeSpace;
+	oMountInfo.m_sUUID = oScanData.m_sUUID;
+	oMountInfo.m_oControlFiles = oControlFiles;
+
+	oMountInfo.m_nFreeMB = nMountFreeBytes / s_nMillionBytes;
+	// Otherwise it is measured by the pipeline
+	oMountInfo.m_nWriteBytesPerSecond = getKnownMountSpeed(oMountInfo.m_sUUID);
+	if ((oMountInfo.m_nWriteBytesPerSecond > 0) && m_oInit.m_bVerbose) {
+		m_oLogger("  Known write speed: " + std::to_string(oMountInfo.m_nWriteBytesPerSecond / s_nMillionBytes) + " MB/s");
+	}
+	// A control file created later is acted upon without reinserting the stick
+	const std::string sError = m_oMountRootsWatcher.addDir(oMountInfo.m_sRootPath
+															, IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO);
+	if ((! sError.empty()) && m_oInit.m_bVerbose) {
+		m_oLogger(sError);
+	}
 	//
 	sortMounts();
 	//
 	m_oMountsChangedSignal.emit();
+	// there might be recordings waiting for a mount
+	schedulePipeline();
+	oRescan();
 }
-void SonoModel::sortMounts() noexcept
+void SonoModel::onMountRootChanged(const std::string& sRootPath, const std::string& sFileName, uint32_t /*nMask*/) noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::sortMounts");
-
-	if (m_aMountInfos.empty()) {
-		return;
+	if (sFileName.compare(0, 8, "sonorem.") != 0) {
+		// Recordings, checksum files, ...
+		return; //--------------------------------------------------------------
 	}
-	auto itBegin = [&]()
-	{
-		if (m_sCopyingToMountRootPath.empty()) {
-			return m_aMountInfos.begin();
-		} else {
-			assert(m_aMountInfos[0].m_sRootPath == m_sCopyingToMountRootPath);
-			return ++m_aMountInfos.begin();
-		}
-	}();
-	std::sort(itBegin, m_aMountInfos.end(), [&](const MountInfo& oMI1, const MountInfo& oMI2)
+	auto itScanData = std::find_if(m_aMountScans.begin(), m_aMountScans.end(), [&](const unique_ptr<MountScanData>& refScanData)
 	{
-		if (oMI1.m_bUnmounting != oMI2.m_bUnmounting) {
-			// favor non unmounting mounts
-			return oMI2.m_bUnmounting;
-		}
-		if (oMI1.m_nFailedCopyAttempts != oMI2.m_nFailedCopyAttempts) {
-			// favor mounts with no failed copy attempts
-			return (oMI1.m_nFailedCopyAttempts < oMI2.m_nFailedCopyAttempts);
-		}
-		if (oMI1.m_bDirty != oMI2.m_bDirty) {
-			// favor the dirty mount if it still has enough space
-			if (oMI1.m_bDirty) {
-				return oMI1.m_nFreeMB * s_nMillionBytes >= m_oInit.m_nMaxFileSizeBytes * s_fMountFreeSpaceToMaxRecordingSizeRatio;
-			} else {
-				return oMI2.m_nFreeMB * s_nMillionBytes >= m_oInit.m_nMaxFileSizeBytes * s_fMountFreeSpaceToMaxRecordingSizeRatio;
-			}
-		}
-		return (oMI1.m_nFreeMB > oMI2.m_nFreeMB);
+		return (refScanData->m_refScanner->getRootPath() == sRootPath);
 	});
+	if (itScanData != m_aMountScans.end()) {
+		// One scan at a time
+		(*itScanData)->m_bRescan = true;
+		return; //--------------------------------------------------------------
+	}
+	auto refMount = getGioMountFromRootPath(sRootPath);
+	if ((! refMount) || (getMountIdxFromRootPath(sRootPath) < 0)) {
+		return; //--------------------------------------------------------------
+	}
+	startMountScan(refMount, false, true);
 }
-void SonoModel::onMountRemoved(const Glib::RefPtr<Gio::Mount>& refMount) noexcept
+void SonoModel::refreshMountControlFiles(const std::string& sRootPath, const MountControlFiles& oControlFiles) noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::onMountRemoved");
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::refreshMountControlFiles");
 
-//std::cout << "Mount removed: " << refMount->get_name() << '\n';
-//std::cout << "         UUID: " << getMountUUID(*(refMount.operator->())) << '\n';
-	const std::string sUUID = getMountUUID(*(refMount.operator->()));
-	auto refRootFile = refMount->get_root();
-	const std::string sRootPath = refRootFile->get_path();
-	m_oLogger("Mount removed: " + sRootPath);
-	if (! sUUID.empty()) {
-		m_oLogger("         UUID: " + sUUID);
-	}
 	const int32_t nMountIdx = getMountIdxFromRootPath(sRootPath);
 	if (nMountIdx < 0) {
-		return; //----------------------------------------------------
+		return; //--------------------------------------------------------------
 	}
-	if (sRootPath == m_sCopyingToMountRootPath) {
-		assert(m_refAsyncCopyCancellable);
-		m_oLogger("Canceling copying of " + m_sCopyingFileName);
-		m_refAsyncCopyCancellable->cancel();
-		m_refAsyncCopyCancellable.reset();
+	MountInfo& oMountInfo = m_aMountInfos[nMountIdx];
+	const MountControlFiles oOldControlFiles = oMountInfo.m_oControlFiles;
+	oMountInfo.m_oControlFiles = oControlFiles;
+	// Only the files that appeared trigger an action
+	MountControlFiles oAppeared = oControlFiles;
+	oAppeared.m_bStopRecording = oControlFiles.m_bStopRecording && ! oOldControlFiles.m_bStopRecording;
+	oAppeared.m_bStartRecording = oControlFiles.m_bStartRecording && ! oOldControlFiles.m_bStartRecording;
+	oAppeared.m_bUnmountNonBusyDirty = oControlFiles.m_bUnmountNonBusyDirty && ! oOldControlFiles.m_bUnmountNonBusyDirty;
+	oAppeared.m_bTellStatus = oControlFiles.m_bTellStatus && ! oOldControlFiles.m_bTellStatus;
+	oAppeared.m_bQuitProgram = oControlFiles.m_bQuitProgram && ! oOldControlFiles.m_bQuitProgram;
+	if ((oControlFiles.m_bHasName != oOldControlFiles.m_bHasName) || (oControlFiles.m_sName != oOldControlFiles.m_sName)) {
+		if (oControlFiles.m_bHasName && strIsSonoremName(oControlFiles.m_sName)) {
+			m_oLogger("Renamed mount '" + oMountInfo.m_sName + "' to '" + oControlFiles.m_sName + "'");
+			oMountInfo.m_sName = oControlFiles.m_sName;
+			m_oMountsChangedSignal.emit();
+		}
 	}
-	if (sRootPath == m_sSyncingMountRootPath) {
-		// do nothing, hopefully the sync process will exit
-		// with an error or a signal without hanging
-		// so that checkToBeSyncedRecordings() can catch it
+	if ((oControlFiles.m_sFolder != oOldControlFiles.m_sFolder) || (oControlFiles.m_bExclude != oOldControlFiles.m_bExclude)) {
+		// Files might be being copied to the current folder
+		m_oLogger("Changed folder or exclusion of " + sRootPath + " only apply when reinserted");
 	}
-	m_aMountInfos.erase(m_aMountInfos.begin() + nMountIdx);
-	m_oMountsChangedSignal.emit();
+	// Might change m_aMountInfos
+	applyMountControlFiles(oAppeared, sRootPath);
 }
-void SonoModel::onMountChanged(const Glib::RefPtr<Gio::Mount>& refMount) noexcept
+void SonoModel::applyStartupMountFiles(const MountControlFiles& oControlFiles) noexcept
 {
-//std::cout << "Mount changed: " << refMount->get_name() << '\n';
-//std::cout << "         UUID: " << getMountUUID(*(refMount.operator->())) << '\n';
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::applyStartupMountFiles");
+
+	auto oOverrideOptionToFalse = [&](bool& bOption, const std::string& sOption, bool bFileExists, const std::string& sComment)
+	{
+		if (bOption && bFileExists) {
+			m_oLogger("Overriding " + sOption + " option: " + sComment);
+			bOption = false;
+			return true;
+		}
+		return false;
+	};
+	if (oOverrideOptionToFalse(m_oInit.m_bAutoStart, "--auto", oControlFiles.m_bStopRecording, "no autostart!")
+			&& (m_eState != STATE_STOPPED)) {
+		// The scan took longer than the autostart delay
+		stopRecording();
+	}
+	//
+	auto oForcingOption = [&](bool& bOption, const std::string& sOption, bool bFileExists, const std::string& sComment)
+	{
+		if ((! bOption) && bFileExists) {
+			m_oLogger("Forcing " + sOption + " option: " + sComment);
+			bOption = true;
+		}
+	};
+	oForcingOption(m_oInit.m_bRfkillWifiOn, "--wifi-on", oControlFiles.m_bDontRfkillWifi, "starting wifi!");
+	oForcingOption(m_oInit.m_bRfkillBluetoothOn, "--bluetooth-on", oControlFiles.m_bDontRfkillBluetooth, "starting bluetooth!");
+}
+void SonoModel::applyMountControlFiles(const MountControlFiles& oControlFiles, const std::string& sRootPath) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::applyMountControlFiles");
+
+	bool bQuitting = false;
+	if (oControlFiles.m_bQuitProgram) {
+		bQuitting = true;
+	} else if (oControlFiles.m_bTellStatus) {
+		m_oTellStatusSignal.emit();
+	}
+	bool bStopped = false;
+	if ((m_eState != STATE_STOPPED)
+			&& (bQuitting || oControlFiles.m_bStopRecording)) {
+		//
+		stopRecording();
+		//
+		m_oLogger("Stopped recording because detected sonorem." + (bQuitting ? s_sFileExtQuitProgram : s_sFileExtStopRecording)
+					+ "\n  on mount " + sRootPath);
+		bStopped = true;
+	}
+	if ((! bQuitting) && (! bStopped) && (m_eState != STATE_RECORDING)
+				&& oControlFiles.m_bStartRecording) {
+		startRecording();
+	}
+	if (oControlFiles.m_bUnmountNonBusyDirty) {
+		m_oLogger("Unmounting because detected sonorem." + s_sFileExtUnmountNonBusyDirty
+					+ (bStopped ? "\n  in " + std::to_string(s_nUnmountAfterStoppedSeconds) + " seconds" : ""));
+		// if stopped or quitting wait a little bit for the recording to possibly be moved to mount
+		Glib::signal_timeout().connect_seconds_once(sigc::mem_fun(*this, &SonoModel::unmountNonBusy), bStopped ? s_nUnmountAfterStoppedSeconds : 0);
+	}
+	//
+	if (bQuitting) {
+		Glib::signal_timeout().connect_seconds_once(sigc::mem_fun(*this, &SonoModel::sonoremQuit), s_nCheckSonoremQuitFileSeconds);
+	}
+}
+// Speed classes are compared instead of speeds so that measurement noise
+// doesn't override the other criteria. Unknown speeds are in class 0.
+static int32_t getMountSpeedClass(int64_t nWriteBytesPerSecond) noexcept
+{
+	if (nWriteBytesPerSecond <= 0) {
+		return 0; //------------------------------------------------------------
+	}
+	// 100 KB/s is the slowest class
+	const double fRatio = std::max(1.0, nWriteBytesPerSecond / 100000.0);
+	return 1 + static_cast<int32_t>(std::floor(std::log(fRatio) / std::log(s_fMountSpeedClassRatio)));
+}
+void SonoModel::sortMounts() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::sortMounts");
+
+	if (m_aMountInfos.empty()) {
+		return;
+	}
+	auto hasSpaceForMaxFileSize = [&](const MountInfo& oMI)
+	{
+		return oMI.m_nFreeMB * s_nMillionBytes >= m_oInit.m_nMaxFileSizeBytes * s_fMountFreeSpaceToMaxRecordingSizeRatio;
+	};
+	// Copies are identified by the mount root path, not the position
+	std::sort(m_aMountInfos.begin(), m_aMountInfos.end(), [&](const MountInfo& oMI1, const MountInfo& oMI2)
+	{
+		if (oMI1.m_bUnmounting != oMI2.m_bUnmounting) {
+			// favor non unmounting mounts
+			return oMI2.m_bUnmounting;
+		}
+		if (oMI1.m_nFailedCopyAttempts != oMI2.m_nFailedCopyAttempts) {
+			// favor mounts with no failed copy attempts
+			return (oMI1.m_nFailedCopyAttempts < oMI2.m_nFailedCopyAttempts);
+		}
+		const bool bEnoughSpace1 = hasSpaceForMaxFileSize(oMI1);
+		const bool bEnoughSpace2 = hasSpaceForMaxFileSize(oMI2);
+		if (bEnoughSpace1 != bEnoughSpace2) {
+			return bEnoughSpace1;
+		}
+		if (bEnoughSpace1) {
+			// favor the mount that drains the backlog faster
+			const int32_t nSpeedClass1 = getMountSpeedClass(oMI1.m_nWriteBytesPerSecond);
+			const int32_t nSpeedClass2 = getMountSpeedClass(oMI2.m_nWriteBytesPerSecond);
+			if (nSpeedClass1 != nSpeedClass2) {
+				return (nSpeedClass1 > nSpeedClass2);
+			}
+			if (oMI1.m_bDirty != oMI2.m_bDirty) {
+				// favor the dirty mount so that the others can stay unmountable
+				return oMI1.m_bDirty;
+			}
+		}
+		return (oMI1.m_nFreeMB > oMI2.m_nFreeMB);
+	});
+}
+int64_t SonoModel::getKnownMountSpeed(const std::string& sUUID) const noexcept
+{
+	if (sUUID.empty()) {
+		// can't be recognized, always measured
+		return 0; //------------------------------------------------------------
+	}
+	auto itFind = std::find_if(m_aMountSpeeds.begin(), m_aMountSpeeds.end(), [&](const std::pair<std::string, int64_t>& oPair)
+	{
+		return (oPair.first == sUUID);
+	});
+	if (itFind == m_aMountSpeeds.end()) {
+		return 0; //------------------------------------------------------------
+	}
+	return itFind->second;
+}
+void SonoModel::loadMountSpeeds() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::loadMountSpeeds");
+
+	if (! Glib::file_test(m_sMountSpeedsFilePath, Glib::FILE_TEST_EXISTS)) {
+		return; //--------------------------------------------------------------
+	}
+	std::string sContents;
+	try {
+		sContents = Glib::file_get_contents(m_sMountSpeedsFilePath);
+	} catch (const Glib::FileError& oErr) {
+		m_oLogger("Could not read " + m_sMountSpeedsFilePath + ": " + oErr.what());
+		return; //--------------------------------------------------------------
+	}
+	// Each line: UUID write-bytes-per-second
+	std::istringstream oStream(sContents);
+	std::string sLine;
+	while (std::getline(oStream, sLine)) {
+		std::istringstream oLineStream(sLine);
+		std::string sUUID;
+		int64_t nWriteBytesPerSecond = 0;
+		if (! (oLineStream >> sUUID >> nWriteBytesPerSecond) || (nWriteBytesPerSecond <= 0)) {
+			if (m_oInit.m_bVerbose) {
+				m_oLogger("Ignoring invalid line in " + m_sMountSpeedsFilePath + ": " + sLine);
+			}
+			continue;
+		}
+		m_aMountSpeeds.emplace_back(std::move(sUUID), nWriteBytesPerSecond);
+	}
+}
+void SonoModel::saveMountSpeeds() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::saveMountSpeeds");
+
+	std::string sContents;
+	for (const auto& oPair : m_aMountSpeeds) {
+		sContents += oPair.first + " " + std::to_string(oPair.second) + "\n";
+	}
+	try {
+		Glib::file_set_contents(m_sMountSpeedsFilePath, sContents);
+	} catch (const Glib::FileError& oErr) {
+		m_oLogger("Could not write " + m_sMountSpeedsFilePath + ": " + oErr.what());
+	}
+}
+void SonoModel::onMountRemoved(const Glib::RefPtr<Gio::Mount>& refMount) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onMountRemoved");
+
+//std::cout << "Mount removed: " << refMount->get_name() << '\n';
+//std::cout << "         UUID: " << getMountUUID(*(refMount.operator->())) << '\n';
+	const std::string sUUID = getMountUUID(*(refMount.operator->()));
+	auto refRootFile = refMount->get_root();
+	const std::string sRootPath = refRootFile->get_path();
+	m_oLogger("Mount removed: " + sRootPath);
+	if (! sUUID.empty()) {
+		m_oLogger("         UUID: " + sUUID);
+	}
+	// Another stick might get the same path
+	m_oIoPool.clearHung(sRootPath);
+	const int32_t nMountIdx = getMountIdxFromRootPath(sRootPath);
+	if (nMountIdx < 0) {
+		return; //----------------------------------------------------
+	}
+	m_oMountRootsWatcher.removeDir(sRootPath);
+	const int32_t nCopyingIdx = getCopyingIdxFromRootPath(sRootPath);
+	if (nCopyingIdx >= 0) {
+		// onCopyFinished() will be called with an error
+		CopyingData& oCD = *(m_aCopyingDatas[nCopyingIdx]);
+		m_oLogger("Canceling copying of " + oCD.m_sCopyingFileName);
+		// Without UUID the stick can't be recognized when it comes back
+		const std::string& sMountUUID = m_aMountInfos[nMountIdx].m_sUUID;
+		const bool bResumable = ! sMountUUID.empty();
+		if (bResumable) {
+			auto oInterrupted = std::make_pair(sMountUUID, oCD.m_sCopyingFileName);
+			if (std::find(m_aInterruptedCopies.begin(), m_aInterruptedCopies.end(), oInterrupted) == m_aInterruptedCopies.end()) {
+				m_aInterruptedCopies.push_back(std::move(oInterrupted));
+			}
+		}
+		oCD.m_refCopier->cancel(bResumable);
+	}
+	if (sRootPath == m_sVerifyingMountRootPath) {
+		// onVerifyFinished() will be called with an error
+		m_refVerifier->cancel();
+	}
+	if (sRootPath == m_sProbingMountRootPath) {
+		// onProbeFinished() will be called with an error
+		m_refProbe->cancel();
+	}
+	if (sRootPath == m_sSyncingMountRootPath) {
+		// onSyncFinished() will be called with an error even if
+		// the sync hangs in the kernel
+		m_refSyncer->cancel();
+	}
+	// The recording written directly to the mount can't go on
+	const bool bSwitchRecording = interruptDirectRecording(sRootPath, "Stick removed while recording to ");
+	m_aMountInfos.erase(m_aMountInfos.begin() + nMountIdx);
+	m_oMountsChangedSignal.emit();
+	if (bSwitchRecording) {
+		switchInterruptedRecording();
+	}
+	// the recordings planned for it are assigned to the other mounts
+	schedulePipeline();
+}
+void SonoModel::onMountChanged(const Glib::RefPtr<Gio::Mount>& refMount) noexcept
+{
+//std::cout << "Mount changed: " << refMount->get_name() << '\n';
+//std::cout << "         UUID: " << getMountUUID(*(refMount.operator->())) << '\n';
 	const std::string sUUID = getMountUUID(*(refMount.operator->()));
 	auto refRootFile = refMount->get_root();
 	const std::string sRootPath = refRootFile->get_path();
@@ -770,26 +1307,123 @@ bool SonoModel::updateMountsFreeSpace() noexcept
 	DebugCtx<SonoModel> oCtx(this, "SonoModel::updateMountsFreeSpace");
 
 	const bool bContinue = true;
-	bool bChanged = false;
 	for (auto itMountInfo = m_aMountInfos.begin(); itMountInfo != m_aMountInfos.end(); ++itMountInfo) {
 		auto& oMountInfo = *itMountInfo;
 		if (oMountInfo.m_bUnmounting) {
 			continue;
 		}
-		if (oMountInfo.m_sRootPath == m_sCopyingToMountRootPath) {
+		if (getCopyingIdxFromRootPath(oMountInfo.m_sRootPath) >= 0) {
 			// don't disturb the copying
 			continue;
 		}
-		const int64_t nFreeMB = getFsFreeMB(oMountInfo.m_sRootPath);
-		if (nFreeMB != oMountInfo.m_nFreeMB) {
-			oMountInfo.m_nFreeMB = nFreeMB;
-			bChanged = true;
+		queryMountFreeSpace(oMountInfo.m_sRootPath);
+	}
+	return bContinue;
+}
+void SonoModel::queryMountFreeSpace(const std::string& sRootPath) noexcept
+{
+	auto refFreeBytes = std::make_shared<int64_t>(-1);
+	m_oIoPool.post(sRootPath, s_nIoTimeoutMillisec, [refFreeBytes, sRootPath]()
+	{
+		*refFreeBytes = getFsFreeBytes(sRootPath);
+	}, [this, refFreeBytes, sRootPath](bool bTimedOut)
+	{
+		if (! bTimedOut) {
+			onMountFreeSpaceQueried(sRootPath, *refFreeBytes);
 		}
+	});
+}
+void SonoModel::onMountFreeSpaceQueried(const std::string& sRootPath, int64_t nFreeBytes) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onMountFreeSpaceQueried");
+
+	const int32_t nMountIdx = getMountIdxFromRootPath(sRootPath);
+	if (nMountIdx < 0) {
+		// removed in the meantime
+		return; //--------------------------------------------------------------
+	}
+	auto& oMountInfo = m_aMountInfos[nMountIdx];
+	if (oMountInfo.m_bUnmounting) {
+		return; //--------------------------------------------------------------
 	}
-	if (bChanged) {
+	const int64_t nFreeMB = ((nFreeBytes < 0) ? -1 : nFreeBytes / s_nMillionBytes);
+	if (nFreeMB != oMountInfo.m_nFreeMB) {
+		oMountInfo.m_nFreeMB = nFreeMB;
 		m_oMountsChangedSignal.emit();
 	}
-	return bContinue;
+}
+std::string SonoModel::getIoKeyFromPath(const std::string& sPath) const noexcept
+{
+	for (const MountInfo& oMountInfo : m_aMountInfos) {
+		const std::string& sRootPath = oMountInfo.m_sRootPath;
+		if ((sPath.size() > sRootPath.size()) && (sPath.compare(0, sRootPath.size(), sRootPath) == 0)
+				&& (sPath[sRootPath.size()] == '/')) {
+			return sRootPath; //------------------------------------------------
+		}
+	}
+	return m_oInit.m_sRecordingDirPath;
+}
+void SonoModel::onIoHung(const std::string& sIoKey) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onIoHung");
+
+	const int32_t nMountIdx = getMountIdxFromRootPath(sIoKey);
+	if (nMountIdx < 0) {
+		m_oLogger("! File system of " + sIoKey + " not responding");
+		return; //--------------------------------------------------------------
+	}
+	auto& oMountInfo = m_aMountInfos[nMountIdx];
+	oMountInfo.m_bHung = true;
+	m_oLogger("! Mount " + oMountInfo.m_sName + " (" + sIoKey + ") not responding: blacklisted");
+	// A recording to the mount would block or fail, the next one is written
+	// elsewhere since getRecordingMountIdx() skips blacklisted mounts
+	const bool bSwitchRecording = interruptDirectRecording(sIoKey, "Stick not responding while recording to ");
+	sortMounts();
+	m_oMountsChangedSignal.emit();
+	if (bSwitchRecording) {
+		switchInterruptedRecording();
+	}
+	// The next segments aren't mirrored to it
+	schedulePipeline();
+}
+bool SonoModel::interruptDirectRecording(const std::string& sMountRootPath, const std::string& sLogPrefix) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::interruptDirectRecording");
+
+	const bool bDirect = m_refRecordingData && (std::find(m_aDirectRecordings.begin(), m_aDirectRecordings.end()
+								, std::make_pair(sMountRootPath, m_sCurrentRecordingFilePath)) != m_aDirectRecordings.end());
+	if (! bDirect) {
+		return false; //--------------------------------------------------------
+	}
+	m_oLogger(sLogPrefix + m_sCurrentRecordingFilePath);
+	// onRecordingExited() will be called
+	interruptRecordingProcess();
+	for (const RecordingData* p0RD : {m_refRecordingData.get(), m_refRotatedRecordingData.get()}) {
+		if ((p0RD != nullptr) && p0RD->m_refTail && (getIoKeyFromPath(p0RD->m_refTail->getFilePath()) == sMountRootPath)) {
+			saveRecordingTail(p0RD->m_refTail);
+		}
+	}
+	m_sCurrentRecordingFilePath.clear();
+	m_refRecordingData.reset();
+	return true;
+}
+void SonoModel::switchInterruptedRecording() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::switchInterruptedRecording");
+
+	if (! recordingFsHasFreeSpace()) {
+		return; //--------------------------------------------------------------
+	}
+	// Don't wait for the interrupted process to exit
+	if (launchRecordingProcess()) {
+		m_oLogger("Recording switched to " + m_sCurrentRecordingFilePath);
+	} else {
+		m_oRelaunchRecordingConn.disconnect();
+		m_oRelaunchRecordingConn = Glib::signal_timeout().connect(
+										sigc::mem_fun(*this, &SonoModel::relaunchRecording)
+										, s_nRelaunchRecordingMillisec);
+	}
+	m_oStateChangedSignal.emit();
 }
 const std::vector<SonoModel::MountInfo>& SonoModel::getMountInfos() const noexcept
 {
@@ -799,12 +1433,14 @@ bool SonoModel::recordingFsHasFreeSpace() noexcept
 {
 	DebugCtx<SonoModel> oCtx(this, "SonoModel::recordingFsHasFreeSpace");
 
-	m_nRecordingFsFreeMB = getFsFreeMB(m_oInit.m_sRecordingDirPath);
+	m_nRecordingFsFreeMB = sampleRecordingFsFreeMB();
 //std::cout << "startRecording() m_nRecordingFsFreeMB = " << m_nRecordingFsFreeMB << '\n';
-	if (m_nRecordingFsFreeMB * s_nMillionBytes < m_oInit.m_nMinFreeSpaceBytes) {
+	if ((m_nRecordingFsFreeMB * s_nMillionBytes < m_oInit.m_nMinFreeSpaceBytes)
+			&& (getDirectRecordingMountIdx() < 0)) {
 		// change state to waiting for space
+		m_nWaitingForFreeSpaceSeconds = s_nCheckWaitingForFreeSpaceSeconds;
 		m_oWaitingForFreeSpaceConn = Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this
-											, &SonoModel::checkWaitingForFreeSpace), s_nCheckWaitingForFreeSpaceSeconds);
+											, &SonoModel::checkWaitingForFreeSpace), m_nWaitingForFreeSpaceSeconds);
 		m_oLogger("Not enough free space for recording.");
 		if (m_aToBeCopiedRecordings.empty()) {
 			m_oLogger("Please free some memory first.");
@@ -851,6 +1487,29 @@ std::string SonoModel::getNowString() noexcept
 	// 20200721-150854
 	return oNow.format("%Y%m%d-%H%M%S");
 }
+std::string SonoModel::getUniqueNowString() noexcept
+{
+	// Strictly increasing within the process, also when called from the
+	// encoder thread. Only a name within the same second as the previous
+	// one (or after the clock was set back) needs the milliseconds
+	static std::mutex s_oMutex;
+	static int64_t s_nLastMillisec = 0;
+	std::lock_guard<std::mutex> oLock(s_oMutex);
+	Glib::DateTime oNow = Glib::DateTime::create_now_utc();
+	const int64_t nMillisec = std::max(oNow.to_unix() * 1000 + oNow.get_microsecond() / 1000, s_nLastMillisec + 1);
+	const bool bSameSecond = (nMillisec / 1000 == s_nLastMillisec / 1000);
+	s_nLastMillisec = nMillisec;
+	oNow = Glib::DateTime::create_now_local(static_cast<gint64>(nMillisec / 1000));
+	// 20200721-150854
+	const std::string sNow = oNow.format("%Y%m%d-%H%M%S");
+	if (! bSameSecond) {
+		return sNow; //---------------------------------------------------------
+	}
+	// 20200721-150854-042
+	std::string sMillisec = std::to_string(nMillisec % 1000);
+	sMillisec.insert(0, 3 - sMillisec.size(), '0');
+	return sNow + "-" + sMillisec;
+}
 std::string SonoModel::getRecordingFileName(const std::string& sNow) noexcept
 {
 	return m_oInit.m_sPreString + std::move(sNow) + "." + m_oInit.m_sRecordingFileExt;
@@ -858,10 +1517,14 @@ std::string SonoModel::getRecordingFileName(const std::string& sNow) noexcept
 bool SonoModel::matchRecordingFileName(const std::string& sFileName) noexcept
 {
 	// pre20200721-150854.ogg
+	// or with milliseconds if started within the same second as the previous one pre20200721-150854-042.ogg
 	const auto nFileNameSize = sFileName.size();
 	const auto nPreSize = m_oInit.m_sPreString.size();
 	const auto nFileExtSize = m_oInit.m_sRecordingFileExt.size();
-	if (nFileNameSize != nPreSize + 15 + 1 + nFileExtSize) {
+	int32_t nNowSize = 19;
+	if (nFileNameSize == nPreSize + 15 + 1 + nFileExtSize) {
+		nNowSize = 15;
+	} else if (nFileNameSize != nPreSize + 19 + 1 + nFileExtSize) {
 		return false;
 	}
 	if (sFileName.substr(0, nPreSize) != m_oInit.m_sPreString) {
@@ -873,16 +1536,16 @@ bool SonoModel::matchRecordingFileName(const std::string& sFileName) noexcept
 	if (sFileName[nPreSize + 8] != '-') {
 		return false;
 	}
-	if (sFileName[nPreSize + 15] != '.') {
+	if ((nNowSize == 19) && (sFileName[nPreSize + 15] != '-')) {
 		return false;
 	}
-	for (int32_t nIdx = 0; nIdx < 8; ++nIdx) {
-		auto c = sFileName[nPreSize + nIdx];
-		if ((c < '0') || (c > '9')) {
-			return false;
-		}
+	if (sFileName[nPreSize + nNowSize] != '.') {
+		return false;
 	}
-	for (int32_t nIdx = 8 + 1; nIdx < 8 + 1 + 6; ++nIdx) {
+	for (int32_t nIdx = 0; nIdx < nNowSize; ++nIdx) {
+		if ((nIdx == 8) || (nIdx == 15)) {
+			continue;
+		}
 		auto c = sFileName[nPreSize + nIdx];
 		if ((c < '0') || (c > '9')) {
 			return false;
@@ -917,15 +1580,25 @@ bool SonoModel::launchRecordingProcess() noexcept
 {
 	DebugCtx<SonoModel> oCtx(this, "SonoModel::launchRecordingProcess");
 
+	if (! m_oInit.m_sCaptureSource.empty()) {
+		return launchCapture(); //----------------------------------------------
+	}
 	static int32_t s_nCounter = 0;
 	++s_nCounter;
-	const std::string sNow = getNowString();
+	const std::string sNow = getUniqueNowString();
 	const std::string sFile = getRecordingFileName(sNow);
-	const std::string sCurrentRecordingFilePath = m_oInit.m_sRecordingDirPath + "/" + sFile;
+	// A recording written directly to a mount doesn't have to be copied
+	const int32_t nDirectMountIdx = getDirectRecordingMountIdx();
+	std::string sRecordingDirPath = m_oInit.m_sRecordingDirPath;
+	if (nDirectMountIdx >= 0) {
+		const MountInfo& oMountInfo = m_aMountInfos[nDirectMountIdx];
+		sRecordingDirPath = oMountInfo.m_sRootPath + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder);
+	}
+	const std::string sCurrentRecordingFilePath = sRecordingDirPath + "/" + sFile;
 	//
 	std::vector<std::string> aArgv;
 	aArgv.reserve(5);
-	aArgv.push_back(s_sRecordingProgram); // TODO create a fake-rec that simulates rec by increasing file size very quickly
+	aArgv.push_back(s_sRecordingProgram);
 	aArgv.push_back("--comment");
 	aArgv.push_back("\"" + sNow + "_" + std::to_string(s_nCounter) + "\"");
 	aArgv.push_back("-c");
@@ -948,12 +1621,176 @@ bool SonoModel::launchRecordingProcess() noexcept
 		m_oLogger("Error spawning '" + s_sRecordingProgram + "': " + oErr.what());
 		return false; //--------------------------------------------------------
 	}
+	m_oChildSupervisor.watch(oPid, sigc::mem_fun(*this, &SonoModel::onRecordingExited));
 	m_sCurrentRecordingFilePath = sCurrentRecordingFilePath;
 	m_refRecordingData = std::make_unique<RecordingData>(this, std::move(oPid), nRecordingCoutFd, nRecordingCerrFd);
+	watchRecording();
+	// Not batched, it's the only trace of the recording until it's finished
+	journalTransition(m_sCurrentRecordingFilePath, JobJournal::STATE_RECORDING);
+	flushJournal();
 	//m_oStartedCurrentRecordingTime = Glib::DateTime::create_now_local();
+	if (nDirectMountIdx >= 0) {
+		MountInfo& oMountInfo = m_aMountInfos[nDirectMountIdx];
+		// Needs to be unmounted before removal
+		oMountInfo.m_bDirty = true;
+		m_aDirectRecordings.push_back(std::make_pair(oMountInfo.m_sRootPath, sCurrentRecordingFilePath));
+		m_oMountsChangedSignal.emit();
+	}
 	//
+	if (m_oInit.m_bFollowCopy) {
+		schedulePipeline();
+	}
+	return true;
+}
+bool SonoModel::launchCapture() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::launchCapture");
+
+	assert(! m_refCapture);
+	m_refStoppedCapture.reset();
+	SonoCapture::Init oCaptureInit;
+	oCaptureInit.m_sSource = m_oInit.m_sCaptureSource;
+	oCaptureInit.m_nMaxSegmentSeconds = m_oInit.m_nMaxRecordingDurationSeconds;
+	oCaptureInit.m_nMaxSegmentBytes = m_oInit.m_nMaxFileSizeBytes;
+	// Called from the encoder thread: m_oInit doesn't change after init()
+	oCaptureInit.m_oNextSegmentPath = [this]()
+	{
+		return m_oInit.m_sRecordingDirPath + "/" + getRecordingFileName(getUniqueNowString());
+	};
+	// Called from the encoder thread: the journal is thread-safe and isn't replaced after init()
+	oCaptureInit.m_oSegmentCreated = [this](const std::string& sSegmentPath)
+	{
+		if (! m_refJournal) {
+			return; //----------------------------------------------------------
+		}
+		// Not batched, it's the only trace of the segment until it's finished.
+		// If the flush fails it's retried by the next flush of the main thread
+		m_refJournal->append(Glib::path_get_basename(sSegmentPath), JobJournal::STATE_RECORDING, "");
+		m_refJournal->flush();
+	};
+	auto refCapture = std::make_unique<SonoCapture>(std::move(oCaptureInit));
+	m_refCapture = std::move(refCapture);
+	// The first segment is opened by start()
+	m_sCaptureMirrorDirPath.clear();
+	updateMirrorDirPath();
+	const std::string sError = m_refCapture->start();
+	if (! sError.empty()) {
+		m_oLogger("Error starting capture: " + sError);
+		m_refCapture.reset();
+		return false; //--------------------------------------------------------
+	}
+	m_oCaptureChangedConn = m_refCapture->m_oChangedSignal.connect(sigc::mem_fun(*this, &SonoModel::onCaptureChanged));
+	m_sCurrentRecordingFilePath = m_refCapture->getSegmentPath();
+	m_nCaptureLastXruns = 0;
+	trackMirrorSegment();
+	if (m_oInit.m_bFollowCopy) {
+		schedulePipeline();
+	}
 	return true;
 }
+void SonoModel::stopCapture() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::stopCapture");
+
+	assert(m_refCapture);
+	// The last samples are written in the background, see onCaptureStopped()
+	m_oCaptureChangedConn.disconnect();
+	SonoCapture* p0Capture = m_refCapture.get();
+	p0Capture->m_oStoppedSignal.connect(sigc::bind(sigc::mem_fun(*this, &SonoModel::onCaptureStopped)
+													, p0Capture, p0Capture->hasFailed()));
+	p0Capture->stop();
+	const int32_t nXruns = p0Capture->getXruns();
+	if (nXruns != m_nCaptureLastXruns) {
+		m_oLogger("Capture lost frames (xruns): " + std::to_string(nXruns));
+	}
+	// triggers copying to mount
+	SonoCapture::FinishedSegment oSegment;
+	while (p0Capture->popFinishedSegment(oSegment)) {
+		queueFinishedSegment(oSegment);
+	}
+	schedulePipeline();
+	// This might be called from within a signal of the capture
+	m_aStoppingCaptures.push_back(std::move(m_refCapture));
+	m_sCurrentRecordingFilePath.clear();
+}
+void SonoModel::onCaptureStopped(SonoCapture* p0Capture, bool bFailedBeforeStop) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onCaptureStopped");
+
+	auto itCapture = std::find_if(m_aStoppingCaptures.begin(), m_aStoppingCaptures.end(), [&](const unique_ptr<SonoCapture>& refCapture)
+	{
+		return (refCapture.get() == p0Capture);
+	});
+	assert(itCapture != m_aStoppingCaptures.end());
+	if (m_oInit.m_bDebug) {
+		m_oLogger(std::string{"Capture thread was real-time: "} + (p0Capture->isRealTime() ? "yes" : "no"));
+		m_oLogger("Captured bytes: " + std::to_string(p0Capture->getTotalBytes()));
+		for (const bool bMirror : {false, true}) {
+			const SonoCapture::WriteStats oStats = p0Capture->getWriteStats(bMirror);
+			if (oStats.m_nWrites == 0) {
+				continue;
+			}
+			m_oLogger(std::string{bMirror ? "Mirror" : "Segment"} + " writes: " + std::to_string(oStats.m_nWrites)
+						+ "  avg: " + std::to_string(oStats.m_nTotalMicrosec / oStats.m_nWrites) + " us"
+						+ "  max: " + std::to_string(oStats.m_nMaxMicrosec) + " us");
+		}
+	}
+	if (p0Capture->hasFailed() && ! bFailedBeforeStop) {
+		// While finishing the last segment
+		m_oLogger("Recording failed: " + p0Capture->getError());
+	}
+	// The last segment (and the mirrors that were still being written)
+	SonoCapture::FinishedSegment oSegment;
+	while (p0Capture->popFinishedSegment(oSegment)) {
+		queueFinishedSegment(oSegment);
+	}
+	schedulePipeline();
+	// We are within a signal of the capture, it's deleted later
+	m_refStoppedCapture = std::move(*itCapture);
+	m_aStoppingCaptures.erase(itCapture);
+	m_oStateChangedSignal.emit();
+}
+void SonoModel::onCaptureChanged() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onCaptureChanged");
+
+	if (! m_refCapture) {
+		return; //--------------------------------------------------------------
+	}
+	// triggers copying to mount
+	SonoCapture::FinishedSegment oSegment;
+	while (m_refCapture->popFinishedSegment(oSegment)) {
+		queueFinishedSegment(oSegment);
+		schedulePipeline();
+	}
+	if (m_refCapture->hasFailed()) {
+		m_oLogger("Recording failed: " + m_refCapture->getError());
+		stopCapture();
+		if (m_eState == STATE_RECORDING) {
+			// Don't restart right away, a broken device would fail again immediately
+			m_oRelaunchRecordingConn.disconnect();
+			m_oRelaunchRecordingConn = Glib::signal_timeout().connect(
+											sigc::mem_fun(*this, &SonoModel::relaunchRecording)
+											, s_nRelaunchRecordingMillisec);
+		}
+		m_oStateChangedSignal.emit();
+		return; //--------------------------------------------------------------
+	}
+	std::string sSegmentPath = m_refCapture->getSegmentPath();
+	if (sSegmentPath != m_sCurrentRecordingFilePath) {
+		m_sCurrentRecordingFilePath = std::move(sSegmentPath);
+		m_oLogger("Recording switched to " + m_sCurrentRecordingFilePath);
+		trackMirrorSegment();
+		if (m_oInit.m_bFollowCopy) {
+			schedulePipeline();
+		}
+		if (! recordingFsHasFreeSpace()) {
+			assert(m_eState == STATE_WAITING_FOR_SPACE);
+			stopCapture();
+		}
+	}
+	m_oStateChangedSignal.emit();
+}
 void SonoModel::onRecordingCout(bool bError, const std::string sLine) noexcept
 {
 	if (bError) {
@@ -985,11 +1822,17 @@ void SonoModel::stopRecording() noexcept
 		interruptRecordingProcess();
 		m_sCurrentRecordingFilePath.clear();
 		m_refRecordingData.reset();
+		if (m_refRotatedRecordingData) {
+			// no point in waiting for the overlap
+			interruptRotatedRecordingProcess();
+		}
 	} else {
-		assert((m_eState == STATE_WAITING_FOR_SPACE) || ! m_aWaitingRecPids.empty());
+		assert((m_eState == STATE_WAITING_FOR_SPACE) || ! m_aWaitingRecPids.empty()
+				|| m_oRelaunchRecordingConn.connected());
 		m_oLogger("Stopped recording");
 		m_oWaitingForFreeSpaceConn.disconnect();
 	}
+	m_oRelaunchRecordingConn.disconnect();
 	m_eState = STATE_STOPPED;
 
 	m_oStateChangedSignal.emit();
@@ -1006,38 +1849,226 @@ int32_t SonoModel::getMountIdxFromRootPath(const std::string& sMountRootPath) no
 		return -1;
 	}
 }
-Glib::RefPtr<Gio::Mount> SonoModel::getGioMountFromRootPath(const std::string& sMountRootPath) noexcept
+int32_t SonoModel::getCopyingIdxFromRootPath(const std::string& sMountRootPath) const noexcept
 {
-	std::vector<Glib::RefPtr<Gio::Mount>> aMounts = m_refVolumeMonitor->get_mounts();
-	Glib::RefPtr<Gio::Mount> refMount;
-	for (auto& refCurMount : aMounts) {
-		auto refRootFile = refCurMount->get_root();
-		std::string sRootPath = refRootFile->get_path();
-		if (sRootPath == sMountRootPath) {
-			refMount = refCurMount;
-		}
+	const auto itFind = std::find_if(m_aCopyingDatas.begin(), m_aCopyingDatas.end(), [&](const unique_ptr<CopyingData>& refCD)
+	{
+		return sMountRootPath == refCD->m_sCopyingToMountRootPath;
+	});
+	if (itFind != m_aCopyingDatas.end()) {
+		return static_cast<int32_t>(std::distance(m_aCopyingDatas.begin(), itFind));
+	} else {
+		return -1;
 	}
-	return refMount;
 }
-void SonoModel::unmountNonBusy() noexcept
+bool SonoModel::isBeingCopied(const std::string& sRecordingFilePath) const noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::unmountNonBusy");
-
-	if (! m_sUnmountingMountPath.empty()) {
-		// just one at a time
-		return; //--------------------------------------------------------------
+	for (const auto& refCopyingData : m_aCopyingDatas) {
+		if (m_oInit.m_sRecordingDirPath + "/" + refCopyingData->m_sCopyingFileName == sRecordingFilePath) {
+			return true;
+		}
 	}
-//std::cout << "SonoModel::unmountNonBusy 0" << '\n';
-	if (m_aMountInfos.empty()) {
-		// No mounts
-		return; //--------------------------------------------------------------
+	return false;
+}
+int32_t SonoModel::getDirectRecordingMountIdx() noexcept
+{
+	if (! m_oInit.m_bDirectToStick) {
+		return -1; //-----------------------------------------------------------
 	}
-	// find the first ready to be unmounted
-	for (MountInfo& oMountInfo : m_aMountInfos) {
+	return getRecordingMountIdx();
+}
+int32_t SonoModel::getRecordingMountIdx() noexcept
+{
+	const int32_t nTotMounts = static_cast<int32_t>(m_aMountInfos.size());
+	for (int32_t nMountIdx = 0; nMountIdx < nTotMounts; ++nMountIdx) {
+		const MountInfo& oMountInfo = m_aMountInfos[nMountIdx];
+		// Only healthy mounts, a failing write would lose the recording
+		if ((oMountInfo.m_nFailedCopyAttempts > 0) || oMountInfo.m_bUnmounting || oMountInfo.isBlacklisted()) {
+			continue;
+		}
+		int64_t nAvailableBytes = oMountInfo.m_nFreeMB * s_nMillionBytes;
+		for (const auto& refCopyingData : m_aCopyingDatas) {
+			if (refCopyingData->m_sCopyingToMountRootPath == oMountInfo.m_sRootPath) {
+				nAvailableBytes -= refCopyingData->m_nSizeBytes;
+			}
+		}
+		// The mounts are sorted: the first with enough space is the best
+		if (nAvailableBytes >= m_oInit.m_nMaxFileSizeBytes * s_fMountFreeSpaceToMaxRecordingSizeRatio) {
+			return nMountIdx; //------------------------------------------------
+		}
+	}
+	return -1;
+}
+int32_t SonoModel::getMountIdxFromFolderPath(const std::string& sFolderPath) noexcept
+{
+	const int32_t nTotMounts = static_cast<int32_t>(m_aMountInfos.size());
+	for (int32_t nMountIdx = 0; nMountIdx < nTotMounts; ++nMountIdx) {
+		const MountInfo& oMountInfo = m_aMountInfos[nMountIdx];
+		if (oMountInfo.m_sRootPath + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder) == sFolderPath) {
+			return nMountIdx; //------------------------------------------------
+		}
+	}
+	return -1;
+}
+void SonoModel::updateMirrorDirPath() noexcept
+{
+	if ((! m_refCapture) || ! m_oInit.m_bMirrorToStick) {
+		return; //--------------------------------------------------------------
+	}
+	std::string sMirrorDirPath;
+	const int32_t nMountIdx = getRecordingMountIdx();
+	if (nMountIdx >= 0) {
+		const MountInfo& oMountInfo = m_aMountInfos[nMountIdx];
+		sMirrorDirPath = oMountInfo.m_sRootPath + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder);
+	}
+	if (sMirrorDirPath == m_sCaptureMirrorDirPath) {
+		return; //--------------------------------------------------------------
+	}
+	m_sCaptureMirrorDirPath = sMirrorDirPath;
+	// Only takes effect with the next segment
+	m_refCapture->setMirrorDirPath(sMirrorDirPath);
+	if (sMirrorDirPath.empty()) {
+		m_oLogger("Next segments are not mirrored");
+	} else {
+		m_oLogger("Next segments are mirrored to " + sMirrorDirPath);
+	}
+}
+void SonoModel::trackMirrorSegment() noexcept
+{
+	const std::string sMirrorPath = m_refCapture->getMirrorSegmentPath();
+	if (sMirrorPath.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	const int32_t nMountIdx = getMountIdxFromFolderPath(Glib::path_get_dirname(sMirrorPath));
+	if (nMountIdx < 0) {
+		// removed, the writes to the mirror will fail
+		return; //--------------------------------------------------------------
+	}
+	MountInfo& oMountInfo = m_aMountInfos[nMountIdx];
+	const auto oPair = std::make_pair(oMountInfo.m_sRootPath, sMirrorPath);
+	if (std::find(m_aDirectRecordings.begin(), m_aDirectRecordings.end(), oPair) != m_aDirectRecordings.end()) {
+		return; //--------------------------------------------------------------
+	}
+	// Needs to be unmounted before removal
+	oMountInfo.m_bDirty = true;
+	m_aDirectRecordings.push_back(oPair);
+	m_oMountsChangedSignal.emit();
+}
+void SonoModel::queueFinishedSegment(const SonoCapture::FinishedSegment& oSegment) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::queueFinishedSegment");
+
+	if (! oSegment.m_sError.empty()) {
+		m_oLogger("! " + oSegment.m_sError);
+	}
+	const std::string sFileName = Glib::path_get_basename(oSegment.m_sPath.empty() ? oSegment.m_sMirrorPath : oSegment.m_sPath);
+	// The mirror is no longer written
+	m_aDirectRecordings.erase(std::remove_if(m_aDirectRecordings.begin(), m_aDirectRecordings.end()
+								, [&](const std::pair<std::string, std::string>& oPair)
+	{
+		return (Glib::path_get_basename(oPair.second) == sFileName);
+	}), m_aDirectRecordings.end());
+	if (oSegment.m_sMirrorPath.empty()) {
+		// triggers copying to mount
+		m_aToBeCopiedRecordings.push_back(oSegment.m_sPath);
+		journalTransition(oSegment.m_sPath, JobJournal::STATE_QUEUED);
+		return; //--------------------------------------------------------------
+	}
+	const int32_t nMountIdx = getMountIdxFromFolderPath(Glib::path_get_dirname(oSegment.m_sMirrorPath));
+	if (nMountIdx < 0) {
+		if (oSegment.m_sPath.empty()) {
+			m_oLogger("! Recording was interrupted by the removal of its stick: " + oSegment.m_sMirrorPath);
+		} else {
+			m_aToBeCopiedRecordings.push_back(oSegment.m_sPath);
+			journalTransition(oSegment.m_sPath, JobJournal::STATE_QUEUED);
+		}
+		return; //--------------------------------------------------------------
+	}
+	const std::string& sMountRootPath = m_aMountInfos[nMountIdx].m_sRootPath;
+	if (oSegment.m_sPath.empty()) {
+		// Only the mirror is left, there is no source to verify against
+		m_aDirectRecordings.push_back(std::make_pair(sMountRootPath, oSegment.m_sMirrorPath));
+	} else {
+		journalTransition(oSegment.m_sPath, JobJournal::STATE_COPIED, sMountRootPath);
+	}
+	// Already on the mount with its checksum file, it just needs to be synced,
+	// then it's verified and the source removed as if it had been copied
+	m_aToBeSyncedRecordings.push_back(std::make_pair(sMountRootPath, sFileName));
+}
+bool SonoModel::hasDirectRecordings(const std::string& sMountRootPath) const noexcept
+{
+	return std::find_if(m_aDirectRecordings.begin(), m_aDirectRecordings.end(), [&](const std::pair<std::string, std::string>& oPair)
+	{
+		return (oPair.first == sMountRootPath);
+	}) != m_aDirectRecordings.end();
+}
+bool SonoModel::eraseDirectRecording(const std::string& sMountRootPath, const std::string& sFileName) noexcept
+{
+	auto itFind = std::find_if(m_aDirectRecordings.begin(), m_aDirectRecordings.end(), [&](const std::pair<std::string, std::string>& oPair)
+	{
+		return (oPair.first == sMountRootPath) && (Glib::path_get_basename(oPair.second) == sFileName);
+	});
+	if (itFind == m_aDirectRecordings.end()) {
+		return false; //--------------------------------------------------------
+	}
+	m_aDirectRecordings.erase(itFind);
+	return true;
+}
+void SonoModel::queueFinishedRecording(const std::string& sRecordingFilePath) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::queueFinishedRecording");
+
+	auto itDirect = std::find_if(m_aDirectRecordings.begin(), m_aDirectRecordings.end(), [&](const std::pair<std::string, std::string>& oPair)
+	{
+		return (oPair.second == sRecordingFilePath);
+	});
+	if (itDirect == m_aDirectRecordings.end()) {
+		// triggers copying to mount
+		m_aToBeCopiedRecordings.push_back(sRecordingFilePath);
+		journalTransition(sRecordingFilePath, JobJournal::STATE_QUEUED);
+		return; //--------------------------------------------------------------
+	}
+	const std::string sMountRootPath = itDirect->first;
+	if (getMountIdxFromRootPath(sMountRootPath) < 0) {
+		m_aDirectRecordings.erase(itDirect);
+		m_oLogger("! Recording was interrupted by the removal of its stick: " + sRecordingFilePath);
+		return; //--------------------------------------------------------------
+	}
+	// Already on the mount, it just needs to be synced
+	m_aToBeSyncedRecordings.push_back(std::make_pair(sMountRootPath, Glib::path_get_basename(sRecordingFilePath)));
+}
+Glib::RefPtr<Gio::Mount> SonoModel::getGioMountFromRootPath(const std::string& sMountRootPath) noexcept
+{
+	std::vector<Glib::RefPtr<Gio::Mount>> aMounts = m_refVolumeMonitor->get_mounts();
+	Glib::RefPtr<Gio::Mount> refMount;
+	for (auto& refCurMount : aMounts) {
+		auto refRootFile = refCurMount->get_root();
+		std::string sRootPath = refRootFile->get_path();
+		if (sRootPath == sMountRootPath) {
+			refMount = refCurMount;
+		}
+	}
+	return refMount;
+}
+void SonoModel::unmountNonBusy() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::unmountNonBusy");
+
+	if (! m_sUnmountingMountPath.empty()) {
+		// just one at a time
+		return; //--------------------------------------------------------------
+	}
+//std::cout << "SonoModel::unmountNonBusy 0" << '\n';
+	if (m_aMountInfos.empty()) {
+		// No mounts
+		return; //--------------------------------------------------------------
+	}
+	// find the first ready to be unmounted
+	for (MountInfo& oMountInfo : m_aMountInfos) {
 		if (oMountInfo.m_bUnmounting || ! oMountInfo.m_bDirty) {
 			continue;
 		}
-		if (oMountInfo.m_sRootPath == m_sCopyingToMountRootPath) {
+		if (getCopyingIdxFromRootPath(oMountInfo.m_sRootPath) >= 0) {
 			// copying a file skip
 			continue;
 		}
@@ -1045,6 +2076,18 @@ void SonoModel::unmountNonBusy() noexcept
 			// syncing a file skip
 			continue;
 		}
+		if (oMountInfo.m_sRootPath == m_sVerifyingMountRootPath) {
+			// verifying a file skip
+			continue;
+		}
+		if (oMountInfo.m_sRootPath == m_sProbingMountRootPath) {
+			// measuring its speed skip
+			continue;
+		}
+		if (hasDirectRecordings(oMountInfo.m_sRootPath)) {
+			// recording to it or syncing a recording skip
+			continue;
+		}
 		// start unmounting
 		auto refMount = getGioMountFromRootPath(oMountInfo.m_sRootPath);
 		if (! refMount) {
@@ -1121,11 +2164,20 @@ bool SonoModel::checkWaitingForFreeSpace() noexcept
 
 	assert(m_eState == STATE_WAITING_FOR_SPACE);
 
-	m_nRecordingFsFreeMB = getFsFreeMB(m_oInit.m_sRecordingDirPath);
+	m_nRecordingFsFreeMB = sampleRecordingFsFreeMB();
 
-	if (m_nRecordingFsFreeMB * s_nMillionBytes < m_oInit.m_nMinFreeSpaceBytes) {
-		// still not enough space
-		return bContinue; //----------------------------------------------------
+	if ((m_nRecordingFsFreeMB * s_nMillionBytes < m_oInit.m_nMinFreeSpaceBytes)
+			&& (getDirectRecordingMountIdx() < 0)) {
+		// still not enough space, check more often when it's being freed
+		const int32_t nSeconds = m_refRecordingFsPredictor->getCheckIntervalSeconds(s_nCheckWaitingForFreeSpaceSeconds
+																					, s_nCheckWaitingForFreeSpaceMaxSeconds);
+		if (nSeconds == m_nWaitingForFreeSpaceSeconds) {
+			return bContinue; //------------------------------------------------
+		}
+		m_nWaitingForFreeSpaceSeconds = nSeconds;
+		m_oWaitingForFreeSpaceConn = Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this
+											, &SonoModel::checkWaitingForFreeSpace), nSeconds);
+		return ! bContinue; //--------------------------------------------------
 	}
 	if (! launchRecordingProcess()) {
 		return bContinue; //--------------------------------------------
@@ -1145,6 +2197,10 @@ void SonoModel::interruptRecordingProcess() noexcept
 	DebugCtx<SonoModel> oCtx(this, "SonoModel::interruptRecordingProcess");
 
 	assert(! m_sCurrentRecordingFilePath.empty());
+	if (m_refCapture) {
+		stopCapture();
+		return; //--------------------------------------------------------------
+	}
 	assert(m_refRecordingData);
 	//
 	::kill(m_refRecordingData->m_oRecordingPid, s_nSignalToInterruptChildren);
@@ -1158,324 +2214,1050 @@ void SonoModel::interruptRecordingProcess() noexcept
 			break;
 		}
 	}
-	if (! bAlreadyPresent) {
-		m_aWaitingRecPids.push_back(std::make_pair(m_refRecordingData->m_oRecordingPid, m_sCurrentRecordingFilePath));
+	if (! bAlreadyPresent) {
+		m_aWaitingRecPids.push_back(std::make_pair(m_refRecordingData->m_oRecordingPid, m_sCurrentRecordingFilePath));
+	}
+//std::cout << "killed Pid: " << m_oRecordingPid << '\n';
+}
+void SonoModel::onRecordingExited(Glib::Pid oPid, int nWaitStatus) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onRecordingExited");
+
+	std::string sRecordingPath;
+	auto itPair = std::find_if(m_aWaitingRecPids.begin(), m_aWaitingRecPids.end(), [&](const std::pair<Glib::Pid, std::string>& oPair)
+	{
+		return (oPair.first == oPid);
+	});
+	if (itPair != m_aWaitingRecPids.end()) {
+		sRecordingPath = std::move(itPair->second);
+		m_aWaitingRecPids.erase(itPair);
+	} else if (m_refRecordingData && (m_refRecordingData->m_oRecordingPid == oPid)) {
+		// max duration reached or crashed
+		sRecordingPath = m_sCurrentRecordingFilePath;
+	} else {
+		m_oLogger("Internal error: unknown recording process has finished");
+		return; //--------------------------------------------------------------
+	}
+	if (WIFEXITED(nWaitStatus)) {
+		//
+		if (m_oInit.m_bDebug) {
+			m_oLogger("Recording has finished with exit status: " + std::to_string(WEXITSTATUS(nWaitStatus)));
+		}
+	} else if (WIFSIGNALED(nWaitStatus)) {
+		const int32_t nTermSig = WTERMSIG(nWaitStatus);
+		if ((nTermSig != s_nSignalToInterruptChildren) || m_oInit.m_bDebug) {
+			m_oLogger("Recording terminated by signal " + std::to_string(nTermSig));
+		}
+	}
+	if (sRecordingPath == m_sCurrentRecordingFilePath) {
+		m_sCurrentRecordingFilePath.clear();
+		m_refRecordingData.reset();
+	}
+	if (m_refRotatedRecordingData && (m_refRotatedRecordingData->m_oRecordingPid == oPid)) {
+		// the rotated recording ended on its own
+		m_refRotatedRecordingData.reset();
+	}
+	auto itStalled = std::find_if(m_aStalledRecPids.begin(), m_aStalledRecPids.end(), [&](const std::pair<Glib::Pid, sigc::connection>& oPair)
+	{
+		return (oPair.first == oPid);
+	});
+	if (itStalled != m_aStalledRecPids.end()) {
+		// Already queued by onRecordingStalled()
+		itStalled->second.disconnect();
+		m_aStalledRecPids.erase(itStalled);
+	} else {
+		queueFinishedRecording(sRecordingPath);
+	}
+	//
+	keepRecording();
+	m_oStateChangedSignal.emit();
+	//
+	schedulePipeline();
+}
+bool SonoModel::keepRecording() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::keepRecording");
+
+	if (m_eState != STATE_RECORDING) {
+		return false; //--------------------------------------------------------
+	}
+	// With gapless rotation the next recording might already be running
+	if (! (m_aWaitingRecPids.empty() && m_sCurrentRecordingFilePath.empty())) {
+		return false; //--------------------------------------------------------
+	}
+	if (m_oRelaunchRecordingConn.connected()) {
+		// wait for the retry
+		return false; //--------------------------------------------------------
+	}
+	if (! recordingFsHasFreeSpace()) {
+		assert(m_eState == STATE_WAITING_FOR_SPACE);
+		return false; //--------------------------------------------------------
+	}
+	//
+	if (! launchRecordingProcess()) {
+		m_oRelaunchRecordingConn = Glib::signal_timeout().connect(
+										sigc::mem_fun(*this, &SonoModel::relaunchRecording)
+										, s_nRelaunchRecordingMillisec);
+		return false; //--------------------------------------------------------
+	}
+	//
+	m_oLogger("Recording switched to " + m_sCurrentRecordingFilePath);
+	return true;
+}
+bool SonoModel::relaunchRecording() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::relaunchRecording");
+
+	m_oRelaunchRecordingConn.disconnect();
+	if (keepRecording()) {
+		m_oStateChangedSignal.emit();
+	}
+	return false; // connect once
+}
+bool SonoModel::checkRecordingMaxFileSize() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkRecordingMaxFileSize");
+
+	const bool bContinue = true;
+	if (m_sCurrentRecordingFilePath.empty()) {
+		assert(!m_refRecordingData);
+		return bContinue; //----------------------------------------------------
+	}
+	if (m_refCapture) {
+		m_refRecordingFsPredictor->addRecordingSizeSample(std::chrono::steady_clock::now(), m_refCapture->getSegmentBytes());
+		// The capture engine switches file by itself, just report lost frames
+		const int32_t nXruns = m_refCapture->getXruns();
+		if (nXruns != m_nCaptureLastXruns) {
+			m_oLogger("Capture lost frames (xruns): " + std::to_string(nXruns));
+			m_nCaptureLastXruns = nXruns;
+		}
+		m_oStateChangedSignal.emit();
+		return bContinue; //----------------------------------------------------
+	}
+	assert(m_refRecordingData);
+	auto& oRD = *m_refRecordingData;
+	if (oRD.m_refWatchdog) {
+		// The size is up to date
+		m_oStateChangedSignal.emit();
+		return bContinue; //----------------------------------------------------
+	}
+	if (oRD.m_bQueryingSize) {
+		// The file system is slow
+		return bContinue; //----------------------------------------------------
+	}
+	const std::string sFilePath = m_sCurrentRecordingFilePath;
+	auto refSizeBytes = std::make_shared<int64_t>(-1);
+	oRD.m_bQueryingSize = m_oIoPool.post(getIoKeyFromPath(sFilePath), s_nIoTimeoutMillisec, [refSizeBytes, sFilePath]()
+	{
+		*refSizeBytes = getFileSize(sFilePath);
+	}, [this, refSizeBytes, sFilePath](bool bTimedOut)
+	{
+		onRecordingSizeQueried(sFilePath, (bTimedOut ? -1 : *refSizeBytes));
+	});
+	return bContinue;
+}
+void SonoModel::onRecordingSizeQueried(const std::string& sFilePath, int64_t nSizeBytes) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onRecordingSizeQueried");
+
+	if ((! m_refRecordingData) || (sFilePath != m_sCurrentRecordingFilePath)) {
+		// Stopped or rotated in the meantime
+		return; //--------------------------------------------------------------
+	}
+	auto& oRD = *m_refRecordingData;
+	oRD.m_bQueryingSize = false;
+	sampleRecordingSize(sFilePath, nSizeBytes);
+	const int64_t nNewLastSize = oRD.m_nCurrentRecordingSizeBytes;
+	oRD.m_nCurrentRecordingSizeBytes = nSizeBytes;
+	if (oRD.m_nCurrentRecordingLastSizeBytes == oRD.m_nCurrentRecordingSizeBytes) {
+		// If the process had terminated onRecordingExited() would already have been called
+		if (m_oInit.m_bDebug) {
+			m_oLogger("Recording size has stalled: " + m_sCurrentRecordingFilePath);
+		}
+		return; //--------------------------------------------------------------
+	}
+	oRD.m_nCurrentRecordingLastSizeBytes = nNewLastSize;
+	checkRecordingSizeLimit();
+	m_oStateChangedSignal.emit();
+}
+void SonoModel::watchRecording() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::watchRecording");
+
+	assert(m_refRecordingData);
+	const std::string sFilePath = m_sCurrentRecordingFilePath;
+	if (getIoKeyFromPath(sFilePath) != m_oInit.m_sRecordingDirPath) {
+		// Recording directly to a stick: the watchdog would open and stat
+		// the file in the main loop and take the slow writeback of a stick
+		// for a stall. The size is polled through the I/O pool instead,
+		// a call that doesn't return in time marks the mount as hung
+		keepRecordingTail();
+		return; //--------------------------------------------------------------
+	}
+	auto refWatchdog = std::make_unique<RecordingWatchdog>(sFilePath, s_nRecordingStallMillisec, s_nRecordingStartStallMillisec);
+	const std::string sError = refWatchdog->start();
+	if (! sError.empty()) {
+		m_oLogger(sError + ": polling the size of the recording");
+		return; //--------------------------------------------------------------
+	}
+	refWatchdog->m_oSizeChangedSignal.connect([this, sFilePath](int64_t nSizeBytes)
+	{
+		onRecordingSizeChanged(sFilePath, nSizeBytes);
+	});
+	refWatchdog->m_oStalledSignal.connect([this, sFilePath]()
+	{
+		onRecordingStalled(sFilePath);
+	});
+	m_refRecordingData->m_refWatchdog = std::move(refWatchdog);
+}
+void SonoModel::keepRecordingTail() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::keepRecordingTail");
+
+	// A removed stick would lose what wasn't synced yet, possibly the whole
+	// recording: it's synced periodically and the rest kept in memory
+	auto refTail = std::make_shared<RecordingTail>(m_sCurrentRecordingFilePath, s_nRecordingTailHeadBytes, s_nRecordingTailMaxBytes);
+	auto& oRD = *m_refRecordingData;
+	oRD.m_refTail = refTail;
+	int32_t nTicks = 0;
+	oRD.m_oTailConn = Glib::signal_timeout().connect([this, refTail, nTicks]() mutable -> bool
+	{
+		const bool bContinue = true;
+		const bool bSync = (nTicks + 1 >= s_nRecordingTailSyncTicks);
+		if (updateRecordingTail(refTail, bSync)) {
+			nTicks = (bSync ? 0 : nTicks + 1);
+		}
+		return bContinue;
+	}, s_nRecordingTailMillisec);
+}
+bool SonoModel::updateRecordingTail(const shared_ptr<RecordingTail>& refTail, bool bSync) noexcept
+{
+	if (refTail->isUpdating()) {
+		// The stick is slow
+		return false; //--------------------------------------------------------
+	}
+	const bool bPosted = m_oIoPool.post(getIoKeyFromPath(refTail->getFilePath()), s_nIoTimeoutMillisec, [refTail, bSync]()
+	{
+		refTail->update(bSync);
+	}, [refTail](bool /*bTimedOut*/)
+	{
+		// A timeout marks the mount as hung, see onIoHung()
+		refTail->setUpdating(false);
+	});
+	refTail->setUpdating(bPosted);
+	return bPosted;
+}
+void SonoModel::saveRecordingTail(const shared_ptr<RecordingTail>& refTail) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::saveRecordingTail");
+
+	if (refTail->getUnsyncedBytes() == 0) {
+		// Everything is on the stick
+		return; //--------------------------------------------------------------
+	}
+	// Not the same name: when the stick is back the copy mustn't replace the synced part
+	const std::string sSavedPath = m_oInit.m_sRecordingDirPath + "/" + getRecordingFileName(getUniqueNowString());
+	const std::string sFilePath = refTail->getFilePath();
+	auto refError = std::make_shared<std::string>();
+	const bool bPosted = m_oIoPool.post(m_oInit.m_sRecordingDirPath, s_nIoTimeoutMillisec, [refTail, sSavedPath, refError]()
+	{
+		*refError = refTail->save(sSavedPath);
+	}, [this, sFilePath, sSavedPath, refError](bool bTimedOut)
+	{
+		if (bTimedOut || ! refError->empty()) {
+			m_oLogger("! Could not save the unsynced end of " + sFilePath + (bTimedOut ? "" : ": " + *refError));
+			return; //----------------------------------------------------------
+		}
+		m_oLogger("Saved the unsynced end of " + sFilePath + " to " + sSavedPath);
+		queueFinishedRecording(sSavedPath);
+		schedulePipeline();
+	});
+	if (! bPosted) {
+		m_oLogger("! Could not save the unsynced end of " + sFilePath);
+	}
+}
+void SonoModel::onRecordingSizeChanged(const std::string& sFilePath, int64_t nSizeBytes) noexcept
+{
+	if ((! m_refRecordingData) || (sFilePath != m_sCurrentRecordingFilePath)) {
+		return; //--------------------------------------------------------------
+	}
+	auto& oRD = *m_refRecordingData;
+	sampleRecordingSize(sFilePath, nSizeBytes);
+	oRD.m_nCurrentRecordingLastSizeBytes = oRD.m_nCurrentRecordingSizeBytes;
+	oRD.m_nCurrentRecordingSizeBytes = nSizeBytes;
+	// Might delete the watchdog
+	if (checkRecordingSizeLimit()) {
+		m_oStateChangedSignal.emit();
+	}
+}
+void SonoModel::onRecordingStalled(const std::string& sFilePath) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onRecordingStalled");
+
+	if ((! m_refRecordingData) || (sFilePath != m_sCurrentRecordingFilePath)) {
+		return; //--------------------------------------------------------------
+	}
+	m_oLogger("! Recording has stalled: " + sFilePath);
+	const bool bIsProcess = ! m_refCapture;
+	const Glib::Pid oPid = m_refRecordingData->m_oRecordingPid;
+	// Like the size limit but without waiting for the process to exit,
+	// it might not react to the signal
+	interruptRecordingProcess();
+	m_sCurrentRecordingFilePath.clear();
+	m_refRecordingData.reset();
+	if (bIsProcess) {
+		// Blocked in the audio driver or the kernel "rec" might never exit:
+		// what was recorded is copied right away and the process killed
+		// if it doesn't terminate in time
+		sigc::connection oKillConn = Glib::signal_timeout().connect([this, oPid]() -> bool
+		{
+			m_oLogger("! Stalled recording process doesn't terminate: killing it");
+			::kill(oPid, SIGKILL);
+			return false;
+		}, s_nKillStalledRecordingMillisec);
+		m_aStalledRecPids.push_back(std::make_pair(oPid, oKillConn));
+		queueFinishedRecording(sFilePath);
+		schedulePipeline();
+	}
+	if (m_refRotatedRecordingData) {
+		interruptRotatedRecordingProcess();
+	}
+	if (! recordingFsHasFreeSpace()) {
+		assert(m_eState == STATE_WAITING_FOR_SPACE);
+		return; //--------------------------------------------------------------
+	}
+	if (! launchRecordingProcess()) {
+		m_oRelaunchRecordingConn = Glib::signal_timeout().connect(
+										sigc::mem_fun(*this, &SonoModel::relaunchRecording)
+										, s_nRelaunchRecordingMillisec);
+	} else {
+		m_oLogger("Recording restarted to " + m_sCurrentRecordingFilePath);
+	}
+	m_oStateChangedSignal.emit();
+}
+void SonoModel::sampleRecordingSize(const std::string& sFilePath, int64_t nSizeBytes) noexcept
+{
+	if (sFilePath.compare(0, m_oInit.m_sRecordingDirPath.size() + 1, m_oInit.m_sRecordingDirPath + "/") == 0) {
+		// Not recording directly to a stick
+		m_refRecordingFsPredictor->addRecordingSizeSample(std::chrono::steady_clock::now(), nSizeBytes);
+	}
+}
+bool SonoModel::checkRecordingSizeLimit() noexcept
+{
+	assert(m_refRecordingData);
+	if (m_refRecordingData->m_nCurrentRecordingSizeBytes <= m_oInit.m_nMaxFileSizeBytes) {
+		return false; //--------------------------------------------------------
+	}
+	if (m_oInit.m_bDebug) {
+		m_oLogger("Recording has reached size limit: " + m_sCurrentRecordingFilePath);
+	}
+	if (m_oInit.m_bGaplessRotation) {
+		rotateRecordingProcess();
+	} else {
+		interruptRecordingProcess();
+		m_sCurrentRecordingFilePath.clear();
+		m_refRecordingData.reset();
+		// Relaunched when the process has exited
+	}
+	return true;
+}
+bool SonoModel::checkRecordingRotate() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkRecordingRotate");
+
+	assert(! m_sCurrentRecordingFilePath.empty());
+	assert(m_refRecordingData);
+	rotateRecordingProcess();
+	return false; // connect once
+}
+void SonoModel::rotateRecordingProcess() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::rotateRecordingProcess");
+
+	assert(! m_sCurrentRecordingFilePath.empty());
+	assert(m_refRecordingData);
+
+	if (m_refRotatedRecordingData) {
+		// The previous rotation hasn't finished yet (shouldn't happen)
+		interruptRotatedRecordingProcess();
+	}
+	// The current recording keeps going until the next one has started
+	bool bAlreadyPresent = false;
+	for (auto& oPair : m_aWaitingRecPids) {
+		if (oPair.second == m_sCurrentRecordingFilePath) {
+			bAlreadyPresent = true;
+			break;
+		}
+	}
+	if (! bAlreadyPresent) {
+		m_aWaitingRecPids.push_back(std::make_pair(m_refRecordingData->m_oRecordingPid, m_sCurrentRecordingFilePath));
+	}
+	m_refRotatedRecordingData = std::move(m_refRecordingData);
+	m_refRotatedRecordingData->m_oRecordingTimedOutConn.disconnect();
+	// Interrupted as soon as the next has started, no need to watch it
+	m_refRotatedRecordingData->m_refWatchdog.reset();
+	m_sCurrentRecordingFilePath.clear();
+	//
+	if ((! recordingFsHasFreeSpace()) || (! launchRecordingProcess())) {
+		// Nothing to overlap with: if the size limit was reached stop now,
+		// otherwise let the recording end on its own
+		const bool bTimedOut = (m_refRotatedRecordingData->m_nCurrentRecordingSizeBytes <= m_oInit.m_nMaxFileSizeBytes);
+		if (bTimedOut) {
+			m_refRotatedRecordingData.reset();
+		} else {
+			interruptRotatedRecordingProcess();
+		}
+		return; //--------------------------------------------------------------
+	}
+	m_oLogger("Recording switched to " + m_sCurrentRecordingFilePath);
+	//
+	RecordingData& oRRD = *m_refRotatedRecordingData;
+	oRRD.m_nNextRecordingFirstSizeBytes = -1;
+	oRRD.m_nNextRecordingSizeBytes = -1;
+	oRRD.m_bQueryingNextSize = false;
+	oRRD.m_nRotationOverlapMillisec = 0;
+	oRRD.m_oRotationOverlapConn = Glib::signal_timeout().connect(
+											sigc::mem_fun(*this, &SonoModel::checkRotationOverlap)
+											, s_nGaplessCheckOverlapMillisec);
+	m_oStateChangedSignal.emit();
+}
+bool SonoModel::checkRotationOverlap() noexcept
+{
+	const bool bContinue = true;
+
+	assert(m_refRotatedRecordingData);
+	RecordingData& oRRD = *m_refRotatedRecordingData;
+	oRRD.m_nRotationOverlapMillisec += s_nGaplessCheckOverlapMillisec;
+	if ((! m_sCurrentRecordingFilePath.empty()) && m_refRecordingData && m_refRecordingData->m_refWatchdog) {
+		oRRD.m_nNextRecordingSizeBytes = m_refRecordingData->m_refWatchdog->getSizeBytes();
+	} else if ((! m_sCurrentRecordingFilePath.empty()) && ! oRRD.m_bQueryingNextSize) {
+		// Polled without blocking, the checks below use the latest size
+		const std::string sFilePath = m_sCurrentRecordingFilePath;
+		auto refSizeBytes = std::make_shared<int64_t>(-1);
+		oRRD.m_bQueryingNextSize = m_oIoPool.post(getIoKeyFromPath(sFilePath), s_nIoTimeoutMillisec, [refSizeBytes, sFilePath]()
+		{
+			*refSizeBytes = getFileSize(sFilePath);
+		}, [this, refSizeBytes, sFilePath](bool bTimedOut)
+		{
+			onNextRecordingSizeQueried(sFilePath, (bTimedOut ? -1 : *refSizeBytes));
+		});
+	}
+	// The next recording has started when its file grows past the initial header
+	bool bNextStarted = false;
+	{
+		const int64_t nSizeBytes = oRRD.m_nNextRecordingSizeBytes;
+		if (nSizeBytes > 0) {
+			if (oRRD.m_nNextRecordingFirstSizeBytes < 0) {
+				oRRD.m_nNextRecordingFirstSizeBytes = nSizeBytes;
+			} else if (nSizeBytes > oRRD.m_nNextRecordingFirstSizeBytes) {
+				bNextStarted = true;
+			}
+		}
+	}
+	if ((! bNextStarted) && (oRRD.m_nRotationOverlapMillisec < s_nGaplessMaxOverlapMillisec)) {
+		return bContinue; //----------------------------------------------------
+	}
+	if (m_oInit.m_bDebug) {
+		m_oLogger("Rotation overlap (millisec): " + std::to_string(oRRD.m_nRotationOverlapMillisec));
+	}
+	// The overlap isn't trimmed: the two processes capture independently,
+	// there is no common sample position to cut at and the files might be
+	// compressed. Cutting on an estimate could remove sound that isn't in
+	// the next file, a few duplicated tenths of a second can't lose any.
+	interruptRotatedRecordingProcess();
+	return ! bContinue;
+}
+void SonoModel::onNextRecordingSizeQueried(const std::string& sFilePath, int64_t nSizeBytes) noexcept
+{
+	if ((! m_refRotatedRecordingData) || (sFilePath != m_sCurrentRecordingFilePath)) {
+		// The overlap is over
+		return; //--------------------------------------------------------------
+	}
+	RecordingData& oRRD = *m_refRotatedRecordingData;
+	oRRD.m_bQueryingNextSize = false;
+	oRRD.m_nNextRecordingSizeBytes = nSizeBytes;
+}
+void SonoModel::interruptRotatedRecordingProcess() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::interruptRotatedRecordingProcess");
+
+	assert(m_refRotatedRecordingData);
+	// The pid is still in m_aWaitingRecPids, onRecordingExited() will be called
+	::kill(m_refRotatedRecordingData->m_oRecordingPid, s_nSignalToInterruptChildren);
+	m_refRotatedRecordingData.reset();
+}
+
+
+void SonoModel::schedulePipeline() noexcept
+{
+	if (m_oSchedulePipelineConn.connected()) {
+		// already scheduled
+		return; //--------------------------------------------------------------
+	}
+	// Run from the main loop as soon as possible, but not from within the caller
+	// which might be in the middle of changing state
+	m_oSchedulePipelineConn = Glib::signal_idle().connect(sigc::mem_fun(*this, &SonoModel::runScheduledPipeline));
+}
+bool SonoModel::runScheduledPipeline() noexcept
+{
+	m_oSchedulePipelineConn.disconnect();
+	checkPipeline();
+	return false; // connect once
+}
+bool SonoModel::checkPipeline() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkPipeline");
+
+	const bool bContinue = true;
+	m_aFinishedCopyingDatas.clear();
+	m_aFinishedMountScans.clear();
+	// The transitions since the last run cost one sync
+	flushJournal();
+	// The mounts might have changed
+	updateMirrorDirPath();
+	// Each stage only starts an operation if none of its kind is in progress
+	checkToBeProbedMounts();
+	checkJournaledCopies();
+	checkToBeCopiedRecordings();
+	checkToBeSyncedRecordings();
+	checkToBeVerifiedRecordings();
+	checkToBeRemovedRecordings();
+	return bContinue;
+}
+bool SonoModel::checkToBeProbedMounts() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkToBeProbedMounts");
+
+	const bool bContinue = true;
+	if (! m_sProbingMountRootPath.empty()) {
+		// When done onProbeFinished() is called
+		return bContinue; //----------------------------------------------------
+	}
+	for (MountInfo& oMountInfo : m_aMountInfos) {
+		if ((oMountInfo.m_nWriteBytesPerSecond != 0) || oMountInfo.m_bUnmounting || oMountInfo.isBlacklisted()) {
+			continue;
+		}
+		// Another operation on the stick would spoil the measure
+		if ((getCopyingIdxFromRootPath(oMountInfo.m_sRootPath) >= 0)
+				|| (oMountInfo.m_sRootPath == m_sSyncingMountRootPath)
+				|| (oMountInfo.m_sRootPath == m_sVerifyingMountRootPath)) {
+			continue;
+		}
+		const std::string sProbingFolderPath = oMountInfo.m_sRootPath + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder);
+		m_sProbingMountRootPath = oMountInfo.m_sRootPath;
+		// The probe file is written to the stick: needs to be unmounted before removal
+		oMountInfo.m_bDirty = true;
+		m_oMountsChangedSignal.emit();
+		m_refProbe = std::make_unique<SpeedProbe>(sProbingFolderPath);
+		m_refProbe->m_oFinishedSignal.connect(sigc::mem_fun(*this, &SonoModel::onProbeFinished));
+		if (m_oInit.m_bVerbose) {
+			m_oLogger("Started measuring speed of " + sProbingFolderPath);
+		}
+		// even if it fails onProbeFinished() is called from the main loop
+		m_refProbe->start();
+		break; // for ----------------------------------------------------------
+	}
+	return bContinue;
+}
+void SonoModel::onProbeFinished() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onProbeFinished");
+
+	assert(m_refProbe);
+	const std::string sError = m_refProbe->getError();
+	const int32_t nMountIdx = getMountIdxFromRootPath(m_sProbingMountRootPath);
+	if (sError.empty()) {
+		const int64_t nWriteBytesPerSecond = std::max<int64_t>(1, m_refProbe->getWriteBytesPerSecond());
+		m_oLogger("Speed of " + m_sProbingMountRootPath + ": write "
+					+ std::to_string(nWriteBytesPerSecond / s_nMillionBytes) + " MB/s, read "
+					+ std::to_string(m_refProbe->getReadBytesPerSecond() / s_nMillionBytes) + " MB/s");
+		if (nMountIdx >= 0) {
+			MountInfo& oMountInfo = m_aMountInfos[nMountIdx];
+			oMountInfo.m_nWriteBytesPerSecond = nWriteBytesPerSecond;
+			if (! oMountInfo.m_sUUID.empty()) {
+				// Most recent last
+				auto itFind = std::find_if(m_aMountSpeeds.begin(), m_aMountSpeeds.end(), [&](const std::pair<std::string, int64_t>& oPair)
+				{
+					return (oPair.first == oMountInfo.m_sUUID);
+				});
+				if (itFind != m_aMountSpeeds.end()) {
+					m_aMountSpeeds.erase(itFind);
+				}
+				m_aMountSpeeds.emplace_back(oMountInfo.m_sUUID, nWriteBytesPerSecond);
+				if (static_cast<int32_t>(m_aMountSpeeds.size()) > s_nMaxMountSpeeds) {
+					m_aMountSpeeds.erase(m_aMountSpeeds.begin());
+				}
+				saveMountSpeeds();
+			}
+		}
+	} else {
+		m_oLogger("! " + sError + "\nCould not measure speed of " + m_sProbingMountRootPath);
+		if (nMountIdx >= 0) {
+			// Not retried, ranked like an unknown speed
+			m_aMountInfos[nMountIdx].m_nWriteBytesPerSecond = -1;
+		}
+	}
+	// We are within a signal of the probe, it's deleted later
+	WorkerThread::deleteLater(std::move(m_refProbe));
+	m_sProbingMountRootPath.clear();
+	//
+	sortMounts();
+	m_oMountsChangedSignal.emit();
+	// the mount can now be copied to, probe the next
+	schedulePipeline();
+}
+bool SonoModel::checkToBeCopiedRecordings() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkToBeCopiedRecordings");
+
+	const bool bContinue = true;
+	// A followed recording that has been finished doesn't grow anymore
+	for (auto& refCopyingData : m_aCopyingDatas) {
+		auto& refCopier = refCopyingData->m_refCopier;
+		if (! refCopier->isFollowing()) {
+			continue;
+		}
+		const std::string& sFromPath = refCopier->getFromPath();
+		if ((sFromPath != m_sCurrentRecordingFilePath)
+				&& (std::find(m_aToBeCopiedRecordings.begin(), m_aToBeCopiedRecordings.end(), sFromPath) != m_aToBeCopiedRecordings.end())) {
+			refCopier->finishFollowing();
+		}
+	}
+	// Each running copy has its own mount, the limit keeps the disk
+	// from being too busy for the recording
+	// A mirrored segment is already being written to a mount
+	if (m_oInit.m_bFollowCopy && (! m_sCurrentRecordingFilePath.empty())
+			&& (Glib::path_get_dirname(m_sCurrentRecordingFilePath) == m_oInit.m_sRecordingDirPath)
+			&& ((! m_refCapture) || m_refCapture->getMirrorSegmentPath().empty())
+			&& (static_cast<int32_t>(m_aCopyingDatas.size()) < m_oInit.m_nMaxParallelCopies)
+			&& ! isBeingCopied(m_sCurrentRecordingFilePath)) {
+		// The final size of the recording isn't known yet
+		startCopying(m_sCurrentRecordingFilePath, m_oInit.m_nMaxFileSizeBytes, true);
+	}
+	updateCopyPlan();
+	// Biggest recordings first, they free the most space
+	std::vector<std::string> aPlannedMountRootPaths;
+	for (const PlannedCopy& oPlannedCopy : m_aCopyPlan) {
+		aPlannedMountRootPaths.push_back(oPlannedCopy.m_sMountRootPath);
+	}
+	std::vector<std::string> aBusyMountRootPaths;
+	for (const auto& refCopyingData : m_aCopyingDatas) {
+		aBusyMountRootPaths.push_back(refCopyingData->m_sCopyingToMountRootPath);
+	}
+	if (! m_sProbingMountRootPath.empty()) {
+		aBusyMountRootPaths.push_back(m_sProbingMountRootPath);
+	}
+	const int32_t nFreeSlots = m_oInit.m_nMaxParallelCopies - static_cast<int32_t>(m_aCopyingDatas.size());
+	for (const int32_t nPlannedIdx : getStartableCopies(aPlannedMountRootPaths, aBusyMountRootPaths, nFreeSlots)) {
+		const PlannedCopy& oPlannedCopy = m_aCopyPlan[nPlannedIdx];
+		const int32_t nMountIdx = getMountIdxFromRootPath(oPlannedCopy.m_sMountRootPath);
+		assert(nMountIdx >= 0);
+		startCopyingTo(m_aMountInfos[nMountIdx], oPlannedCopy.m_sRecordingFilePath, oPlannedCopy.m_nSizeBytes, false);
+	}
+	return bContinue;
+}
+std::vector<int32_t> SonoModel::getStartableCopies(const std::vector<std::string>& aPlannedMountRootPaths
+													, const std::vector<std::string>& aBusyMountRootPaths, int32_t nFreeSlots) noexcept
+{
+	std::vector<int32_t> aStartable;
+	std::vector<std::string> aBusy = aBusyMountRootPaths;
+	const int32_t nTotPlanned = static_cast<int32_t>(aPlannedMountRootPaths.size());
+	for (int32_t nPlannedIdx = 0; nPlannedIdx < nTotPlanned; ++nPlannedIdx) {
+		if (static_cast<int32_t>(aStartable.size()) >= nFreeSlots) {
+			break; // for ------------------------------------------------------
+		}
+		const std::string& sMountRootPath = aPlannedMountRootPaths[nPlannedIdx];
+		if (sMountRootPath.empty()) {
+			// fits nowhere for now
+			continue;
+		}
+		if (std::find(aBusy.begin(), aBusy.end(), sMountRootPath) != aBusy.end()) {
+			// the mount is busy, wait for its turn
+			continue;
+		}
+		aStartable.push_back(nPlannedIdx);
+		aBusy.push_back(sMountRootPath);
+	}
+	return aStartable;
+}
+void SonoModel::updateCopyPlan() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::updateCopyPlan");
+
+	m_aNoSizeRecordings.erase(std::remove_if(m_aNoSizeRecordings.begin(), m_aNoSizeRecordings.end(), [&](const std::string& sRecordingFilePath)
+	{
+		return (std::find(m_aToBeCopiedRecordings.begin(), m_aToBeCopiedRecordings.end(), sRecordingFilePath)
+				== m_aToBeCopiedRecordings.end());
+	}), m_aNoSizeRecordings.end());
+	// Forget the recordings that were copied or whose copy has started
+	m_aCopyPlan.erase(std::remove_if(m_aCopyPlan.begin(), m_aCopyPlan.end(), [&](const PlannedCopy& oPlannedCopy)
+	{
+		const std::string& sRecordingFilePath = oPlannedCopy.m_sRecordingFilePath;
+		return isBeingCopied(sRecordingFilePath)
+				|| (std::find(m_aToBeCopiedRecordings.begin(), m_aToBeCopiedRecordings.end(), sRecordingFilePath)
+					== m_aToBeCopiedRecordings.end());
+	}), m_aCopyPlan.end());
+	// Add the new ones, their size doesn't change anymore
+	for (const std::string& sRecordingFilePath : m_aToBeCopiedRecordings) {
+		if (isBeingCopied(sRecordingFilePath)) {
+			continue;
+		}
+		auto itFind = std::find_if(m_aCopyPlan.begin(), m_aCopyPlan.end(), [&](const PlannedCopy& oPlannedCopy)
+		{
+			return (oPlannedCopy.m_sRecordingFilePath == sRecordingFilePath);
+		});
+		if (itFind != m_aCopyPlan.end()) {
+			continue;
+		}
+		const int64_t nSizeBytes = getFileSize(sRecordingFilePath);
+		auto itNoSize = std::find(m_aNoSizeRecordings.begin(), m_aNoSizeRecordings.end(), sRecordingFilePath);
+		if (nSizeBytes < 1) {
+			if (itNoSize == m_aNoSizeRecordings.end()) {
+				// Tried again each time the pipeline runs
+				m_oLogger("Can't get size of file " + sRecordingFilePath);
+				m_aNoSizeRecordings.push_back(sRecordingFilePath);
+			}
+			continue;
+		}
+		if (itNoSize != m_aNoSizeRecordings.end()) {
+			m_aNoSizeRecordings.erase(itNoSize);
+		}
+		m_aCopyPlan.emplace_back();
+		PlannedCopy& oPlannedCopy = m_aCopyPlan.back();
+		oPlannedCopy.m_sRecordingFilePath = sRecordingFilePath;
+		oPlannedCopy.m_nSizeBytes = nSizeBytes;
+	}
+	std::stable_sort(m_aCopyPlan.begin(), m_aCopyPlan.end(), [](const PlannedCopy& oPC1, const PlannedCopy& oPC2)
+	{
+		return (oPC1.m_nSizeBytes > oPC2.m_nSizeBytes);
+	});
+	auto getNeededBytes = [](int64_t nSizeBytes)
+	{
+		return static_cast<int64_t>(s_fMountFreeSpaceToMaxRecordingSizeRatio * nSizeBytes);
+	};
+	// The space left on each mount, -1 if it can't be copied to
+	const int32_t nTotMounts = static_cast<int32_t>(m_aMountInfos.size());
+	std::vector<int64_t> aAvailableBytes(nTotMounts, -1);
+	// The mounts are sorted, those that sortMounts() doesn't tell apart
+	// other than by free space are in the same class
+	std::vector<int32_t> aMountClasses(nTotMounts, 0);
+	auto getMountClassKey = [&](const MountInfo& oMountInfo)
+	{
+		const bool bEnoughSpace = (oMountInfo.m_nFreeMB * s_nMillionBytes
+									>= m_oInit.m_nMaxFileSizeBytes * s_fMountFreeSpaceToMaxRecordingSizeRatio);
+		// The speed is only compared if there's enough space
+		return std::make_tuple(oMountInfo.m_nFailedCopyAttempts, bEnoughSpace
+								, (bEnoughSpace ? getMountSpeedClass(oMountInfo.m_nWriteBytesPerSecond) : 0));
+	};
+	for (int32_t nMountIdx = 0; nMountIdx < nTotMounts; ++nMountIdx) {
+		const MountInfo& oMountInfo = m_aMountInfos[nMountIdx];
+		if (nMountIdx > 0) {
+			const bool bSameClass = (getMountClassKey(oMountInfo) == getMountClassKey(m_aMountInfos[nMountIdx - 1]));
+			aMountClasses[nMountIdx] = aMountClasses[nMountIdx - 1] + (bSameClass ? 0 : 1);
+		}
+		if (oMountInfo.isBlacklisted() || oMountInfo.m_bUnmounting) {
+			continue;
+		}
+		aAvailableBytes[nMountIdx] = oMountInfo.m_nFreeMB * s_nMillionBytes;
 	}
-//std::cout << "killed Pid: " << m_oRecordingPid << '\n';
-}
-bool SonoModel::checkWaitingChild() noexcept
-{
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkWaitingChild");
-
-	const bool bContinue = true;
-//std::cout << "checkWaitingChild() tot=" << m_aWaitingRecPids.size() << '\n';
-	if (m_aWaitingRecPids.empty()) {
-		return bContinue;
+	// The free space of a mount is only updated when its copy has finished
+	for (const auto& refCopyingData : m_aCopyingDatas) {
+		const int32_t nMountIdx = getMountIdxFromRootPath(refCopyingData->m_sCopyingToMountRootPath);
+		if ((nMountIdx >= 0) && (aAvailableBytes[nMountIdx] >= 0)) {
+			aAvailableBytes[nMountIdx] = std::max<int64_t>(0, aAvailableBytes[nMountIdx] - getNeededBytes(refCopyingData->m_nSizeBytes));
+		}
 	}
-	bool bSignalStateChanged = false;
-	auto itPair = m_aWaitingRecPids.begin();
-	while (itPair != m_aWaitingRecPids.end()) {
-		auto& oPair = *itPair;
-		int nWaitStatus;
-		auto nRet = ::waitpid(oPair.first, &nWaitStatus, WNOHANG);
-		if (nRet == 0) {
-			// not terminated yet
-			++itPair;
-//std::cout << "checkWaitingChild() not terminated yet" << '\n';
-		} else if (nRet < 0) {
-			m_oLogger("Error waiting " + std::string{::strerror(errno)});
-			++itPair;
-//std::cout << "checkWaitingChild() error waiting" << '\n';
-		} else {
-//std::cout << "checkWaitingChild() finished" << '\n';
-			const std::string& sRecordingPath = oPair.second;
-			if (WIFEXITED(nWaitStatus)) {
-				//
-				if (m_oInit.m_bDebug) {
-					m_oLogger("Recording has finished with exit status: " + std::to_string(nWaitStatus));
-				}
-			} else if (WIFSIGNALED(nWaitStatus)) {
-				const int32_t nTermSig = WTERMSIG(nWaitStatus);
-				if ((nTermSig != s_nSignalToInterruptChildren) || m_oInit.m_bDebug) {
-					m_oLogger("Recording terminated by signal " + std::to_string(nTermSig));
-				}
-			}
-			if (sRecordingPath == m_sCurrentRecordingFilePath) {
-				m_sCurrentRecordingFilePath.clear();
-				m_refRecordingData.reset();
-			}
-			// triggers copying to mount
-			m_aToBeCopiedRecordings.push_back(sRecordingPath);
-			itPair = m_aWaitingRecPids.erase(itPair);
-			bSignalStateChanged = true;
+	// The current recording or its mirror might be written directly to a mount
+	const std::string sCurrentMirrorFilePath = (m_refCapture ? m_refCapture->getMirrorSegmentPath() : "");
+	for (const auto& oPair : m_aDirectRecordings) {
+		const int32_t nMountIdx = getMountIdxFromRootPath(oPair.first);
+		const bool bCurrent = (oPair.second == m_sCurrentRecordingFilePath) || (oPair.second == sCurrentMirrorFilePath);
+		if (bCurrent && (nMountIdx >= 0) && (aAvailableBytes[nMountIdx] >= 0)) {
+			aAvailableBytes[nMountIdx] = std::max<int64_t>(0, aAvailableBytes[nMountIdx] - getNeededBytes(m_oInit.m_nMaxFileSizeBytes));
 		}
 	}
-	if (m_eState == STATE_RECORDING) {
-		if (m_aWaitingRecPids.empty()) {
-			// keep recording
-			if (! recordingFsHasFreeSpace()) {
-				assert(m_eState == STATE_WAITING_FOR_SPACE);
-				return bContinue; //--------------------------------------------
+	// Keep the assignments that still fit, so that the plan is stable while mounts come and go
+	for (PlannedCopy& oPlannedCopy : m_aCopyPlan) {
+		if (oPlannedCopy.m_sMountRootPath.empty()) {
+			continue;
+		}
+		const int32_t nMountIdx = getMountIdxFromRootPath(oPlannedCopy.m_sMountRootPath);
+		const int64_t nNeededBytes = getNeededBytes(oPlannedCopy.m_nSizeBytes);
+		if ((nMountIdx < 0) || (aAvailableBytes[nMountIdx] < nNeededBytes)) {
+			oPlannedCopy.m_sMountRootPath.clear();
+			continue;
+		}
+		aAvailableBytes[nMountIdx] -= nNeededBytes;
+	}
+	for (PlannedCopy& oPlannedCopy : m_aCopyPlan) {
+		if (! oPlannedCopy.m_sMountRootPath.empty()) {
+			continue;
+		}
+		const std::string sFileName = Glib::path_get_basename(oPlannedCopy.m_sRecordingFilePath);
+		const int64_t nNeededBytes = getNeededBytes(oPlannedCopy.m_nSizeBytes);
+		// A stick that came back with an interrupted copy of the recording is the best
+		auto itInterrupted = std::find_if(m_aMountInfos.begin(), m_aMountInfos.end(), [&](const MountInfo& oMountInfo)
+		{
+			if (oMountInfo.m_sUUID.empty()) {
+				return false;
 			}
-			//
-			if (! launchRecordingProcess()) {
-				return bContinue; //--------------------------------------------
+			return (std::find(m_aInterruptedCopies.begin(), m_aInterruptedCopies.end()
+							, std::make_pair(oMountInfo.m_sUUID, sFileName)) != m_aInterruptedCopies.end());
+		});
+		int32_t nBestMountIdx = -1;
+		if (itInterrupted != m_aMountInfos.end()) {
+			const int32_t nMountIdx = static_cast<int32_t>(std::distance(m_aMountInfos.begin(), itInterrupted));
+			if (aAvailableBytes[nMountIdx] >= nNeededBytes) {
+				nBestMountIdx = nMountIdx;
 			}
-			//
-			m_oLogger("Recording switched to " + m_sCurrentRecordingFilePath);
-			bSignalStateChanged = true;
+		}
+		if (nBestMountIdx < 0) {
+			nBestMountIdx = getBestFitMountIdx(aAvailableBytes, aMountClasses, nNeededBytes);
+		}
+		if (nBestMountIdx < 0) {
+			continue;
+		}
+		aAvailableBytes[nBestMountIdx] -= nNeededBytes;
+		oPlannedCopy.m_sMountRootPath = m_aMountInfos[nBestMountIdx].m_sRootPath;
+		if (m_oInit.m_bVerbose) {
+			m_oLogger("Planned copying " + sFileName + " to " + oPlannedCopy.m_sMountRootPath);
 		}
 	}
-	if (bSignalStateChanged) {
-		m_oStateChangedSignal.emit();
-	}
-	return bContinue;
 }
-bool SonoModel::checkRecordingMaxFileSize() noexcept
+int32_t SonoModel::getBestFitMountIdx(const std::vector<int64_t>& aAvailableBytes, const std::vector<int32_t>& aMountClasses
+										, int64_t nNeededBytes) noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkRecordingMaxFileSize");
-
-	const bool bContinue = true;
-	if (m_sCurrentRecordingFilePath.empty()) {
-		assert(!m_refRecordingData);
-		return bContinue; //----------------------------------------------------
-	}
-	// Note that the size has to stall for two checks to trigger a ::waitpid
-	assert(m_refRecordingData);
-	auto& oRD = *m_refRecordingData;
-	const int64_t nNewLastSize = oRD.m_nCurrentRecordingSizeBytes;
-	oRD.m_nCurrentRecordingSizeBytes = getFileSizeBytes(m_sCurrentRecordingFilePath);
-	if (oRD.m_nCurrentRecordingLastSizeBytes == oRD.m_nCurrentRecordingSizeBytes) {
-		if (m_oInit.m_bDebug) {
-			m_oLogger("Recording size has stalled: " + m_sCurrentRecordingFilePath);
+	assert(aAvailableBytes.size() == aMountClasses.size());
+	const int32_t nTotMounts = static_cast<int32_t>(aAvailableBytes.size());
+	int32_t nBestMountIdx = -1;
+	for (int32_t nMountIdx = 0; nMountIdx < nTotMounts; ++nMountIdx) {
+		if (aAvailableBytes[nMountIdx] < nNeededBytes) {
+			continue;
 		}
-		// value has stalled, check whether child still alive
-		int nWaitStatus;;
-		auto nRet = ::waitpid(oRD.m_oRecordingPid, &nWaitStatus, WNOHANG);
-		if (nRet == 0) {
-			// not terminated yet, keep going
-		} else if (nRet < 0) {
-			m_oLogger("Error waiting " + std::string{::strerror(errno)});
-		} else {
-			// the recording process has terminated already
-			if (WIFEXITED(nWaitStatus)) {
-				//
-				if (m_oInit.m_bDebug) {
-					m_oLogger("Reason: finished with exit status: " + std::to_string(nWaitStatus));
-				}
-			} else if (WIFSIGNALED(nWaitStatus)) {
-				const int32_t nTermSig = WTERMSIG(nWaitStatus);
-				if ((nTermSig != s_nSignalToInterruptChildren) || m_oInit.m_bDebug) {
-					m_oLogger("Reason: terminated by signal " + std::to_string(nTermSig));
-				}
-			}
-			if (m_oInit.m_bDebug) {
-				m_oLogger("Reason: it terminated");
-			}
-			m_sCurrentRecordingFilePath.clear();
-			m_refRecordingData.reset();
-			//
-			m_oStateChangedSignal.emit();
-			//
-			if (m_eState == STATE_RECORDING) {
-				// keep recording
-				if (! recordingFsHasFreeSpace()) {
-					assert(m_eState == STATE_WAITING_FOR_SPACE);
-					return bContinue; //----------------------------------------
-				}
-				//
-				if (! launchRecordingProcess()) {
-					return bContinue; //----------------------------------------
-				}
-				//
-				m_oLogger("Recording switched to " + m_sCurrentRecordingFilePath);
-				m_oStateChangedSignal.emit();
-			}
+		if (nBestMountIdx < 0) {
+			// The first mount that fits is in the best class
+			nBestMountIdx = nMountIdx;
+			continue;
 		}
-		return bContinue; //----------------------------------------------------
-	}
-	oRD.m_nCurrentRecordingLastSizeBytes = nNewLastSize;
-	if (oRD.m_nCurrentRecordingSizeBytes > m_oInit.m_nMaxFileSizeBytes) {
-		if (m_oInit.m_bDebug) {
-			m_oLogger("Recording has reached size limit: " + m_sCurrentRecordingFilePath);
+		if (aMountClasses[nMountIdx] != aMountClasses[nBestMountIdx]) {
+			// A slower mount isn't chosen just because it is fuller
+			break; // for ------------------------------------------------------
+		}
+		// Best fit: the mount with the least space left that can still hold the recording,
+		// so that the mounts with much space stay free for the big ones
+		if (aAvailableBytes[nMountIdx] < aAvailableBytes[nBestMountIdx]) {
+			nBestMountIdx = nMountIdx;
 		}
-		interruptRecordingProcess();
-		m_sCurrentRecordingFilePath.clear();
-		m_refRecordingData.reset();
 	}
-	m_oStateChangedSignal.emit();
-	return bContinue;
+	return nBestMountIdx;
 }
-bool SonoModel::checkRecordingTimedOut() noexcept
+bool SonoModel::startCopying(const std::string& sRecordingFilePath, int64_t nSizeBytes, bool bFollow) noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkRecordingTimedOut");
-
-	#ifndef NDEBUG
-	for (auto& oPair : m_aWaitingRecPids) {
-		if (oPair.second == m_sCurrentRecordingFilePath) {
-			// size check already killed the recording but
-			// it's also supposed to disconnect this signal
-			assert(false);
+	const std::string sFileName = Glib::path_get_basename(sRecordingFilePath);
+	auto isSuitable = [&](const MountInfo& oMountInfo)
+	{
+		if (oMountInfo.isBlacklisted() || oMountInfo.m_bUnmounting) {
+			return false;
+		}
+		if (getCopyingIdxFromRootPath(oMountInfo.m_sRootPath) >= 0) {
+			return false;
+		}
+		if (oMountInfo.m_sRootPath == m_sProbingMountRootPath) {
+			// would spoil the measure
+			return false;
+		}
+		return (1.0 * s_nMillionBytes * oMountInfo.m_nFreeMB >= s_fMountFreeSpaceToMaxRecordingSizeRatio * nSizeBytes);
+	};
+	// A stick that came back with an interrupted copy of the recording is the best
+	auto itMountInfo = std::find_if(m_aMountInfos.begin(), m_aMountInfos.end(), [&](const MountInfo& oMountInfo)
+	{
+		if (oMountInfo.m_sUUID.empty() || ! isSuitable(oMountInfo)) {
+			return false;
 		}
+		return (std::find(m_aInterruptedCopies.begin(), m_aInterruptedCopies.end()
+						, std::make_pair(oMountInfo.m_sUUID, sFileName)) != m_aInterruptedCopies.end());
+	});
+	if (itMountInfo == m_aMountInfos.end()) {
+		// The mounts are sorted: the first suitable one not already copied to is the best
+		itMountInfo = std::find_if(m_aMountInfos.begin(), m_aMountInfos.end(), isSuitable);
 	}
-	#endif //NDEBUG
-	//
-	assert(! m_sCurrentRecordingFilePath.empty());
-	assert(m_refRecordingData);
-	m_aWaitingRecPids.push_back(std::make_pair(m_refRecordingData->m_oRecordingPid, m_sCurrentRecordingFilePath));
-	return false; // connect once
+	if (itMountInfo == m_aMountInfos.end()) {
+		return false; //--------------------------------------------------------
+	}
+	startCopyingTo(*itMountInfo, sRecordingFilePath, nSizeBytes, bFollow);
+	return true;
 }
-
-
-bool SonoModel::checkToBeCopiedRecordings() noexcept
+void SonoModel::startCopyingTo(const MountInfo& oMountInfo, const std::string& sRecordingFilePath, int64_t nSizeBytes, bool bFollow) noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkToBeCopiedRecordings");
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::startCopyingTo");
 
-	const bool bContinue = true;
-	if (! m_sCopyingToMountRootPath.empty()) {
-		// copy operation already in progress
-		return bContinue; //----------------------------------------------------
+	const std::string sFileName = Glib::path_get_basename(sRecordingFilePath);
+	auto itInterrupted = m_aInterruptedCopies.end();
+	if (! oMountInfo.m_sUUID.empty()) {
+		itInterrupted = std::find(m_aInterruptedCopies.begin(), m_aInterruptedCopies.end()
+								, std::make_pair(oMountInfo.m_sUUID, sFileName));
 	}
-	if (m_aToBeCopiedRecordings.empty()) {
-		return bContinue; //----------------------------------------------------
+	const bool bResume = (itInterrupted != m_aInterruptedCopies.end());
+	if (bResume) {
+		// If interrupted again it is added back
+		m_aInterruptedCopies.erase(itInterrupted);
 	}
-	const std::string sRecordingFilePath = m_aToBeCopiedRecordings[0];
 	//
-	if (m_aMountInfos.empty()) {
-		// There is nowhere to copy recording
-		return bContinue; //----------------------------------------------------
-	}
-	// The first mount should already be the best
-	auto& oMountInfo = m_aMountInfos[0];
-	if (oMountInfo.m_nFailedCopyAttempts >= MountInfo::s_nFailedCopyAttemptsToBlacklist) {
-		return bContinue; //----------------------------------------------------
-	}
-	if (oMountInfo.m_bUnmounting) {
-		// There is nowhere to copy recording, shouldn't happen
-		return bContinue; //----------------------------------------------------
-	}
+	auto refCopyingData = std::make_unique<CopyingData>();
+	CopyingData& oCD = *refCopyingData;
+	oCD.m_sCopyingToMountRootPath = oMountInfo.m_sRootPath;
+	oCD.m_sCopyingFileName = sFileName;
+	oCD.m_nSizeBytes = nSizeBytes;
+	const std::string sCopyingFolderPath = oCD.m_sCopyingToMountRootPath + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder);
+	oCD.m_refCopier = std::make_unique<FileCopier>(sRecordingFilePath, sCopyingFolderPath + "/" + oCD.m_sCopyingFileName
+													, bFollow, bResume);
+	oCD.m_refCopier->m_oProgressSignal.connect(sigc::bind(sigc::mem_fun(*this, &SonoModel::onCopyProgress)
+															, oCD.m_sCopyingToMountRootPath));
+	oCD.m_refCopier->m_oFinishedSignal.connect(sigc::bind(sigc::mem_fun(*this, &SonoModel::onCopyFinished)
+															, oCD.m_sCopyingToMountRootPath));
+	oCD.m_oLastProgressTime = std::chrono::steady_clock::now();
 	//
-	assert(! m_refCopyingFile);
-	m_refCopyingFile = Gio::File::create_for_path(sRecordingFilePath);
-	const int64_t nCurrentSizeBytes = getFileSizeBytes(*(m_refCopyingFile.operator->()));
-	if (nCurrentSizeBytes < 1) {
-		m_oLogger("Can't get size of file " + sRecordingFilePath);
-		return bContinue; //----------------------------------------------------
+	m_oLogger(std::string{bFollow ? "Started following " : (bResume ? "Resuming copying " : "Started copying ")}
+				+ oCD.m_sCopyingFileName + " to " + sCopyingFolderPath);
+	m_aCopyingDatas.push_back(std::move(refCopyingData));
+	// even if it fails onCopyFinished() is called from the main loop
+	oCD.m_refCopier->start();
+	m_oStateChangedSignal.emit();
+}
+void SonoModel::onCopyProgress(const std::string& sCopyingToMountRootPath) noexcept
+{
+	const int32_t nCopyingIdx = getCopyingIdxFromRootPath(sCopyingToMountRootPath);
+	if (nCopyingIdx < 0) {
+		return; //--------------------------------------------------------------
 	}
-	if (1.0 * s_nMillionBytes * oMountInfo.m_nFreeMB < s_fMountFreeSpaceToMaxRecordingSizeRatio * nCurrentSizeBytes) {
-		// Not enough space on mount
-		return bContinue; //----------------------------------------------------
+	CopyingData& oCD = *(m_aCopyingDatas[nCopyingIdx]);
+	const auto oNow = std::chrono::steady_clock::now();
+	const double fSeconds = std::chrono::duration<double>(oNow - oCD.m_oLastProgressTime).count();
+	if (fSeconds < s_fCopyProgressMinSeconds) {
+		// Too short to give a meaningful throughput
+		return; //--------------------------------------------------------------
 	}
-	//
-	m_sCopyingToMountRootPath = oMountInfo.m_sRootPath;
-	m_sCopyingFileName = m_refCopyingFile->get_basename();
-	const std::string sCopyingFolderPath = m_sCopyingToMountRootPath + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder);
-	auto refDest = Gio::File::create_for_path(sCopyingFolderPath + "/" + m_sCopyingFileName);
-	//
-	m_oLogger("Started copying " + m_sCopyingFileName + " to " + sCopyingFolderPath);
-	m_refAsyncCopyCancellable = Gio::Cancellable::create();
-	try {
-		m_refCopyingFile->copy_async(refDest, sigc::mem_fun(*this, &SonoModel::onAsyncCopyProgress)
-									, sigc::mem_fun(*this, &SonoModel::onAsyncCopyReady)
-									, m_refAsyncCopyCancellable
-									, Gio::FILE_COPY_OVERWRITE, Glib::PRIORITY_LOW);
-	} catch (const Gio::Error& oErr) {
-		m_oLogger("Failed to copy file " + sRecordingFilePath
-				+ "\n  error: " + oErr.what());
-		m_sCopyingToMountRootPath.clear();
-		m_sCopyingFileName.clear();
-		m_refAsyncCopyCancellable.clear();
-		m_refCopyingFile.reset();
-		return bContinue; //----------------------------------------------------
+	const int64_t nCopiedBytes = oCD.m_refCopier->getCopiedBytes();
+	// The bytes kept when resuming weren't written now
+	const int64_t nFromBytes = std::max(oCD.m_nLastProgressBytes, oCD.m_refCopier->getResumedBytes());
+	oCD.m_fBytesPerSecond = std::max<int64_t>(0, nCopiedBytes - nFromBytes) / fSeconds;
+	oCD.m_fSmoothedBytesPerSecond = getSmoothedBytesPerSecond(oCD.m_fSmoothedBytesPerSecond, oCD.m_fBytesPerSecond);
+	oCD.m_oLastProgressTime = oNow;
+	oCD.m_nLastProgressBytes = nCopiedBytes;
+	// The copiers can report many times a second, the listeners
+	// (ex. the window) needn't be updated as often
+	if (oNow - m_oLastCopyProgressSignalTime >= std::chrono::milliseconds(s_nCopyProgressSignalMillisec)) {
+		m_oLastCopyProgressSignalTime = oNow;
+		m_oCopyProgressSignal.emit();
 	}
-	m_oStateChangedSignal.emit();
-	return bContinue;
 }
-void SonoModel::onAsyncCopyProgress(goffset /*nCurrentBytes*/, goffset /*nTotalBytes*/) noexcept
+double SonoModel::getSmoothedBytesPerSecond(double fSmoothedBytesPerSecond, double fBytesPerSecond) noexcept
+{
+	if (fSmoothedBytesPerSecond <= 0.0) {
+		return fBytesPerSecond; //----------------------------------------------
+	}
+	return fSmoothedBytesPerSecond + s_fCopyThroughputSmoothing * (fBytesPerSecond - fSmoothedBytesPerSecond);
+}
+int32_t SonoModel::getCopyEtaSeconds(int64_t nCopiedBytes, int64_t nTotalBytes, int64_t nSmoothedBytesPerSecond
+									, bool bFollowing) noexcept
 {
-	//TODO
+	if ((nTotalBytes < 0) || (nSmoothedBytesPerSecond <= 0) || bFollowing) {
+		return -1; //-----------------------------------------------------------
+	}
+	const int64_t nLeftBytes = std::max<int64_t>(0, nTotalBytes - nCopiedBytes);
+	return static_cast<int32_t>(nLeftBytes / nSmoothedBytesPerSecond);
 }
-void SonoModel::onAsyncCopyReady(Glib::RefPtr<Gio::AsyncResult>& refResult) noexcept
+void SonoModel::onCopyFinished(const std::string& sCopyingToMountRootPath) noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::onAsyncCopyReady");
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onCopyFinished");
 
-	assert(! m_aToBeCopiedRecordings.empty());
+	const int32_t nCopyingIdx = getCopyingIdxFromRootPath(sCopyingToMountRootPath);
+	if (nCopyingIdx < 0) {
+		m_oLogger("Internal error: copy not found " + sCopyingToMountRootPath);
+		return; //--------------------------------------------------------------
+	}
+	// We are within a signal of the copier, it's deleted later
+	m_aFinishedCopyingDatas.push_back(std::move(m_aCopyingDatas[nCopyingIdx]));
+	m_aCopyingDatas.erase(m_aCopyingDatas.begin() + nCopyingIdx);
+	CopyingData& oCD = *(m_aFinishedCopyingDatas.back());
 
 	bool bSortMounts = false;
 
-	std::string sPreLine;
-	bool bOk = false;
-	try {
-		bOk = m_refCopyingFile->copy_finish(refResult);
-	} catch (const Gio::Error& oErr) {
-		sPreLine = "! copy_finish failed: " + oErr.what() + "\n";
+	const std::string sError = oCD.m_refCopier->getError();
+	const bool bOk = sError.empty();
+	if (bOk && m_oInit.m_bDebug) {
+		static const char* const s_aMethodNames[] = {"none", "copy_file_range", "sendfile", "read/write"};
+		m_oLogger(std::string{"Copied with "} + s_aMethodNames[oCD.m_refCopier->getMethod()]);
 	}
-	const int32_t nMountIdx = getMountIdxFromRootPath(m_sCopyingToMountRootPath);
+	const int32_t nMountIdx = getMountIdxFromRootPath(sCopyingToMountRootPath);
 	if (bOk) {
 		//
-		assert(m_aToBeCopiedRecordings[0] == m_oInit.m_sRecordingDirPath + "/" + m_sCopyingFileName);
-		m_aToBeCopiedRecordings.erase(m_aToBeCopiedRecordings.begin());
+		const std::string sRecordingFilePath = m_oInit.m_sRecordingDirPath + "/" + oCD.m_sCopyingFileName;
+		auto itRecording = std::find(m_aToBeCopiedRecordings.begin(), m_aToBeCopiedRecordings.end(), sRecordingFilePath);
+		assert(itRecording != m_aToBeCopiedRecordings.end());
+		m_aToBeCopiedRecordings.erase(itRecording);
+		// Partial copies on other sticks won't be resumed
+		m_aInterruptedCopies.erase(std::remove_if(m_aInterruptedCopies.begin(), m_aInterruptedCopies.end()
+								, [&](const std::pair<std::string, std::string>& oInterrupted)
+		{
+			return (oInterrupted.second == oCD.m_sCopyingFileName);
+		}), m_aInterruptedCopies.end());
+		if (oCD.m_refCopier->getResumedBytes() > 0) {
+			m_oLogger("Resumed copy kept " + std::to_string(oCD.m_refCopier->getResumedBytes()) + " bytes");
+		}
 		//
 		std::string sCopyingFolderPath;
 		if (nMountIdx >= 0) {
-			// While copying the first mount cannot be sorted elsewhere
-			assert(nMountIdx == 0);
 			auto& oMountInfo = m_aMountInfos[nMountIdx];
 			assert(! oMountInfo.m_bUnmounting);
-			assert(oMountInfo.m_sRootPath == m_sCopyingToMountRootPath);
 			oMountInfo.m_bDirty = true;
-			auto refMount = getGioMountFromRootPath(m_sCopyingToMountRootPath);
-			if (! refMount) {
-				m_oLogger("Internal error: mount not found " + oMountInfo.m_sRootPath);
-			} else {
-				auto refRootFile = refMount->get_root();
-				oMountInfo.m_nFreeMB = getFsFreeMB(*(refRootFile.operator->()));
-			}
+			// An estimate until the file system tells
+			const int64_t nCopiedMB = (oCD.m_refCopier->getTotalBytes() + s_nMillionBytes - 1) / s_nMillionBytes;
+			oMountInfo.m_nFreeMB = std::max<int64_t>(0, oMountInfo.m_nFreeMB - nCopiedMB);
+			queryMountFreeSpace(sCopyingToMountRootPath);
 			//
-			m_aToBeSyncedRecordings.push_back(std::make_pair(m_sCopyingToMountRootPath, m_sCopyingFileName));
+			m_aToBeSyncedRecordings.push_back(std::make_pair(sCopyingToMountRootPath, oCD.m_sCopyingFileName));
+			journalTransition(sRecordingFilePath, JobJournal::STATE_COPIED, sCopyingToMountRootPath);
 			//
 			const bool bWasFailing = (oMountInfo.m_nFailedCopyAttempts > 0);
 			//
 			oMountInfo.m_nFailedCopyAttempts = 0;
 			//
-			sCopyingFolderPath = m_sCopyingToMountRootPath + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder);
-			m_oLogger("Finished copying " + m_sCopyingFileName + " to " + sCopyingFolderPath);
+			sCopyingFolderPath = sCopyingToMountRootPath + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder);
+			m_oLogger("Finished copying " + oCD.m_sCopyingFileName + " to " + sCopyingFolderPath);
 			//
 			if (bWasFailing) {
-				m_oLogger("Promoting " + m_sCopyingToMountRootPath);
+				m_oLogger("Promoting " + sCopyingToMountRootPath);
 				//
 				bSortMounts = true;
 			}
 		} else {
 			// Can't sync a file to a mount that has been removed
 			// this shouldn't happen since a canceled copy results in an error
-			m_oLogger("Internal error copying " + m_sCopyingFileName + " to " + m_sCopyingToMountRootPath);
+			m_oLogger("Internal error copying " + oCD.m_sCopyingFileName + " to " + sCopyingToMountRootPath);
 		}
 	} else  {
-		m_oLogger(sPreLine + "Error copying " + m_sCopyingFileName + " to " + m_sCopyingToMountRootPath);
+		m_oLogger("! " + sError + "\nError copying " + oCD.m_sCopyingFileName + " to " + sCopyingToMountRootPath);
 		//
 		// When a mount is removed the copy is canceled with an error
 		if (nMountIdx >= 0) {
-			auto& oMountInfo = m_aMountInfos[0];
+			auto& oMountInfo = m_aMountInfos[nMountIdx];
 			++oMountInfo.m_nFailedCopyAttempts;
 			if (oMountInfo.m_nFailedCopyAttempts == MountInfo::s_nFailedCopyAttemptsToBlacklist) {
-				m_oLogger("Demoting " + m_sCopyingToMountRootPath);
+				m_oLogger("Demoting " + sCopyingToMountRootPath);
 				//
 				bSortMounts = true;
 			}
 		}
 	}
-	//
-	m_refAsyncCopyCancellable.reset();
-	m_sCopyingToMountRootPath.clear();
-	m_sCopyingFileName.clear();
-	m_refCopyingFile.reset();
 
 	if (bSortMounts) {
 		sortMounts();
 	}
 
 	m_oStateChangedSignal.emit();
+	// sync it and copy the next
+	schedulePipeline();
 }
 
 
@@ -1485,153 +3267,207 @@ bool SonoModel::checkToBeSyncedRecordings() noexcept
 
 	const bool bContinue = true;
 	if (! m_sSyncingMountRootPath.empty()) {
-		assert(m_refSyncingData);
+		assert(m_refSyncer);
 		// Beware! At this point m_sSyncingMountRootPath could identify
 		// a mount that was already removed!
-		SyncingData& oSD = *(m_refSyncingData.operator->());
-		int nWaitStatus;
-		auto nRet = ::waitpid(oSD.m_oSyncingPid, &nWaitStatus, WNOHANG);
-		if (nRet == 0) {
-			// not terminated yet
-			maybeTerminateSyncingProcess();
-			return bContinue; //------------------------------------------------
-		}
-		if (nRet < 0) {
-			m_oLogger("Error waiting '" + s_sSyncProgram + "': " + std::string{::strerror(errno)});
-			// keep waiting
-			// maybe after 3 errors consider the child dead?
-			return bContinue; //------------------------------------------------
-		}
-		bool bRemoveSource = true;
-		if (WIFEXITED(nWaitStatus)) {
-			//
-			const int32_t nIdx = getMountIdxFromRootPath(m_sSyncingMountRootPath);
-			if (nIdx < 0) {
-				// Mount no longer there.
-				// Alas sync program doesn't necessarily fail when a mount is removed
-				// while syncing a file.
-				// Consider the sync failed so that the file can be picked up for
-				// another copying process by the next startup.
-				m_oLogger("Syncing finished on no longer existing mount: " + m_sSyncingMountRootPath);
-				bRemoveSource = false;
-			} else if (! Glib::file_test(m_refSyncingData->m_sSyncingFilePath, Glib::FILE_TEST_EXISTS)) {
-				m_oLogger("Syncing finished but file '" + m_refSyncingData->m_sSyncingFileName + "'"
-							+ "\n  doesn't exist on mount: " + m_sSyncingMountRootPath);
-				bRemoveSource = false;
-			}
-		} else if (WIFSIGNALED(nWaitStatus)) {
-			const int32_t nTermSig = WTERMSIG(nWaitStatus);
-			if ((nTermSig != s_nSignalToInterruptChildren) || m_oInit.m_bDebug) {
-				m_oLogger("Syncing terminated by signal " + std::to_string(nTermSig));
-			}
-			bRemoveSource = false;
-		}
-		//
-		if (bRemoveSource) {
-			m_oLogger("Finished syncing " + oSD.m_sSyncingFilePath);
-			//
-			m_aToBeRemovedRecordings.push_back(m_oInit.m_sRecordingDirPath + "/" + oSD.m_sSyncingFileName);
-		}
-		//
-		m_sSyncingMountRootPath.clear();
-		m_refSyncingData.reset();
+		// When done onSyncFinished() is called
+		return bContinue; //----------------------------------------------------
 	}
 	if (m_aToBeSyncedRecordings.empty()) {
 		return bContinue; //----------------------------------------------------
 	}
-	const auto& oPair = m_aToBeSyncedRecordings[0];
-	std::string sSyncingMountRootPath = oPair.first;
-	std::string sSyncingFileName = oPair.second;
+	// All the files copied to the same mount are synced together
+	const std::string sSyncingMountRootPath = m_aToBeSyncedRecordings[0].first;
+	std::vector<std::string> aSyncingFileNames;
+	m_aToBeSyncedRecordings.erase(std::remove_if(m_aToBeSyncedRecordings.begin(), m_aToBeSyncedRecordings.end()
+								, [&](const std::pair<std::string, std::string>& oPair)
+	{
+		if (oPair.first != sSyncingMountRootPath) {
+			return false;
+		}
+		aSyncingFileNames.push_back(oPair.second);
+		return true;
+	}), m_aToBeSyncedRecordings.end());
 	const int32_t nIdx = getMountIdxFromRootPath(sSyncingMountRootPath);
 	if (nIdx < 0) {
 		// The mount was removed, nothing to sync
-		m_aToBeSyncedRecordings.erase(m_aToBeSyncedRecordings.begin());
+		for (const auto& sFileName : aSyncingFileNames) {
+			if (eraseDirectRecording(sSyncingMountRootPath, sFileName)) {
+				m_oLogger("! Recording might be incomplete, its stick was removed: " + sFileName);
+			} else {
+				requeueForCopying(sFileName);
+			}
+		}
+		schedulePipeline();
 		return bContinue; //----------------------------------------------------
 	}
 	const MountInfo& oMountInfo = m_aMountInfos[nIdx];
 	const std::string sSyncingFolderPath = sSyncingMountRootPath + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder);
-	std::string sSyncingFilePath = sSyncingFolderPath + "/" + sSyncingFileName;
-
-	if (! launchSyncingProcess(std::move(sSyncingMountRootPath), std::move(sSyncingFileName), std::move(sSyncingFilePath))) {
-		return bContinue; //----------------------------------------------------
+	std::vector<std::string> aSyncingFilePaths;
+	for (const auto& sFileName : aSyncingFileNames) {
+		aSyncingFilePaths.push_back(sSyncingFolderPath + "/" + sFileName);
+	}
+	m_sSyncingMountRootPath = sSyncingMountRootPath;
+	m_aSyncingFileNames = std::move(aSyncingFileNames);
+	m_refSyncer = std::make_unique<FileSyncer>(aSyncingFilePaths);
+	m_refSyncer->m_oFinishedSignal.connect(sigc::mem_fun(*this, &SonoModel::onSyncFinished));
+	for (const auto& sSyncingFilePath : aSyncingFilePaths) {
+		m_oLogger("Started syncing of " + sSyncingFilePath);
+	}
+	// even if it fails onSyncFinished() is called from the main loop
+	m_refSyncer->start();
+	m_oStateChangedSignal.emit();
+	return bContinue;
+}
+void SonoModel::onSyncFinished() noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onSyncFinished");
+
+	assert(m_refSyncer);
+	assert(! m_sSyncingMountRootPath.empty());
+	// Beware! At this point m_sSyncingMountRootPath could identify
+	// a mount that was already removed!
+	const std::string sError = m_refSyncer->getError();
+	bool bVerify = sError.empty();
+	if (! bVerify) {
+		m_oLogger("! " + sError + "\nError syncing on " + m_sSyncingMountRootPath);
+	} else if (getMountIdxFromRootPath(m_sSyncingMountRootPath) < 0) {
+		// Mount no longer there.
+		// The sync doesn't necessarily fail when a mount is removed.
+		m_oLogger("Syncing finished on no longer existing mount: " + m_sSyncingMountRootPath);
+		bVerify = false;
+	}
+	for (size_t nIdx = 0; nIdx < m_aSyncingFileNames.size(); ++nIdx) {
+		const std::string& sFileName = m_aSyncingFileNames[nIdx];
+		// There is no source to verify against or to copy again
+		const bool bDirect = eraseDirectRecording(m_sSyncingMountRootPath, sFileName);
+		if (bVerify) {
+			m_oLogger("Finished syncing " + m_refSyncer->getFilePaths()[nIdx]);
+			if (! bDirect) {
+				// The source is only removed once the copy on the device is known to be good
+				m_aToBeVerifiedRecordings.push_back(std::make_pair(m_sSyncingMountRootPath, sFileName));
+				journalTransition(m_oInit.m_sRecordingDirPath + "/" + sFileName, JobJournal::STATE_SYNCED, m_sSyncingMountRootPath);
+			}
+		} else if (bDirect) {
+			m_oLogger("! Recording might be incomplete: " + sFileName);
+		} else {
+			requeueForCopying(sFileName);
+		}
 	}
+	// We are within a signal of the syncer, it's deleted later
+	WorkerThread::deleteLater(std::move(m_refSyncer));
+	m_sSyncingMountRootPath.clear();
+	m_aSyncingFileNames.clear();
 	//
-	m_aToBeSyncedRecordings.erase(m_aToBeSyncedRecordings.begin());
-	//
-	return bContinue;
+	m_oStateChangedSignal.emit();
+	// verify the copies and sync the next
+	schedulePipeline();
 }
-bool SonoModel::launchSyncingProcess(std::string&& sSyncingMountRootPath, std::string&& sSyncingFileName
-									, std::string&& sSyncingFilePath) noexcept
+
+bool SonoModel::checkToBeVerifiedRecordings() noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::launchSyncingProcess");
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkToBeVerifiedRecordings");
 
-	std::vector<std::string> aArgv;
-	aArgv.reserve(3);
-	aArgv.push_back(s_sSyncProgram);
-	aArgv.push_back("-d");
-	aArgv.push_back(sSyncingFilePath);
-	Glib::Pid oPid;
-	int nSyncingCoutFd;
-	int nSyncingCerrFd;
-	try {
-		Glib::spawn_async_with_pipes(m_oInit.m_sRecordingDirPath, aArgv, Glib::SPAWN_SEARCH_PATH | Glib::SPAWN_DO_NOT_REAP_CHILD
-						, Glib::SlotSpawnChildSetup(), &oPid, nullptr
-						, (m_oInit.m_bDebug ? &nSyncingCoutFd : nullptr)
-						, (m_oInit.m_bDebug ? &nSyncingCerrFd : nullptr));
-	} catch (const Glib::SpawnError& oErr) {
-		m_oLogger("Error spawning '" + s_sSyncProgram + "': " + oErr.what());
-		return false; //--------------------------------------------------------
+	const bool bContinue = true;
+	if (! m_sVerifyingMountRootPath.empty()) {
+		// When done onVerifyFinished() is called
+		return bContinue; //----------------------------------------------------
 	}
-	assert(m_sSyncingMountRootPath.empty());
-	m_sSyncingMountRootPath = std::move(sSyncingMountRootPath);
-	m_refSyncingData = std::make_unique<SyncingData>(this, std::move(sSyncingFileName), std::move(sSyncingFilePath)
-													, std::move(oPid), nSyncingCoutFd, nSyncingCerrFd);
-	SyncingData& oSD = *(m_refSyncingData.operator->());
-
-	m_oLogger("Started syncing of " + oSD.m_sSyncingFilePath);
-
-	auto nPrio = ::getpriority(PRIO_PROCESS, oSD.m_oSyncingPid);
-	// lower priority of process running sync
-	auto nRet = ::setpriority(PRIO_PROCESS, oSD.m_oSyncingPid, nPrio + 1);
-	if (nRet < 0) {
-		m_oLogger("Error setting priority of " + s_sSyncProgram);
+	if (m_aToBeVerifiedRecordings.empty()) {
+		return bContinue; //----------------------------------------------------
 	}
-	return true;
+	const auto oPair = m_aToBeVerifiedRecordings[0];
+	m_aToBeVerifiedRecordings.erase(m_aToBeVerifiedRecordings.begin());
+	const int32_t nIdx = getMountIdxFromRootPath(oPair.first);
+	if (nIdx < 0) {
+		m_oLogger("Can't verify " + oPair.second + ", mount was removed: " + oPair.first);
+		requeueForCopying(oPair.second);
+		schedulePipeline();
+		return bContinue; //----------------------------------------------------
+	}
+	const MountInfo& oMountInfo = m_aMountInfos[nIdx];
+	const std::string sVerifyingFolderPath = oPair.first + (oMountInfo.m_sFolder.empty() ? "" : "/" + oMountInfo.m_sFolder);
+	m_sVerifyingMountRootPath = oPair.first;
+	m_sVerifyingFileName = oPair.second;
+	m_refVerifier = std::make_unique<FileVerifier>(sVerifyingFolderPath + "/" + m_sVerifyingFileName);
+	m_refVerifier->m_oFinishedSignal.connect(sigc::mem_fun(*this, &SonoModel::onVerifyFinished));
+	m_oLogger("Started verifying " + m_refVerifier->getFilePath());
+	// even if it fails onVerifyFinished() is called from the main loop
+	m_refVerifier->start();
+	m_oStateChangedSignal.emit();
+	return bContinue;
 }
-void SonoModel::maybeTerminateSyncingProcess() noexcept
+void SonoModel::onVerifyFinished() noexcept
 {
-	DebugCtx<SonoModel> oCtx(this, "SonoModel::maybeTerminateSyncingProcess");
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onVerifyFinished");
 
-	assert(m_refSyncingData);
-	const int32_t nIdx = getMountIdxFromRootPath(m_sSyncingMountRootPath);
-	if (nIdx < 0) {
-		// The mount was already removed, apparently the sync process
-		// is hanging ... kill it explicitely
-		if (m_oInit.m_bVerbose) {
-			m_oLogger("Mount was remved while syncing!");
-			m_oLogger("Terminating " + s_sSyncProgram + " of " + m_refSyncingData->m_sSyncingFilePath);
+	assert(m_refVerifier);
+	const std::string sError = m_refVerifier->getError();
+	if (sError.empty()) {
+		m_oLogger("Finished verifying " + m_refVerifier->getFilePath());
+		//
+		m_aToBeRemovedRecordings.push_back(m_oInit.m_sRecordingDirPath + "/" + m_sVerifyingFileName);
+		journalTransition(m_aToBeRemovedRecordings.back(), JobJournal::STATE_VERIFIED);
+	} else {
+		m_oLogger("! " + sError + "\nError verifying " + m_sVerifyingFileName + " on " + m_sVerifyingMountRootPath);
+		const int32_t nMountIdx = getMountIdxFromRootPath(m_sVerifyingMountRootPath);
+		if (nMountIdx >= 0) {
+			// A stick that corrupts data is like one that fails copying
+			auto& oMountInfo = m_aMountInfos[nMountIdx];
+			++oMountInfo.m_nFailedCopyAttempts;
+			if (oMountInfo.m_nFailedCopyAttempts == MountInfo::s_nFailedCopyAttemptsToBlacklist) {
+				m_oLogger("Demoting " + m_sVerifyingMountRootPath);
+				//
+				sortMounts();
+			}
+		}
+		if ((nMountIdx >= 0) && ! m_aMountInfos[nMountIdx].m_bUnmounting) {
+			// Otherwise the corrupt copy might be resumed rather than replaced
+			removeCorruptCopy(m_sVerifyingMountRootPath, m_refVerifier->getFilePath(), m_sVerifyingFileName);
+		} else {
+			requeueForCopying(m_sVerifyingFileName);
 		}
-		::kill(m_refSyncingData->m_oSyncingPid, s_nSignalToTerminateChildren);
 	}
+	// We are within a signal of the verifier, it's deleted later
+	WorkerThread::deleteLater(std::move(m_refVerifier));
+	m_sVerifyingMountRootPath.clear();
+	m_sVerifyingFileName.clear();
+	//
+	m_oStateChangedSignal.emit();
+	// remove the source or copy it again, verify the next
+	schedulePipeline();
 }
-void SonoModel::onSyncingCout(bool bError, const std::string sLine) noexcept
+void SonoModel::removeCorruptCopy(const std::string& sMountRootPath, const std::string& sCopyPath
+									, const std::string& sFileName) noexcept
 {
-	if (bError) {
-		m_oLogger("Error reading " + s_sSyncProgram + " output: " + sLine);
-		return; //--------------------------------------------------------------
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::removeCorruptCopy");
+
+	const bool bPosted = m_oIoPool.post(sMountRootPath, s_nIoTimeoutMillisec, [sCopyPath]()
+	{
+		::unlink(sCopyPath.c_str());
+		::unlink(FileCopier::getChecksumFilePath(sCopyPath).c_str());
+	}, [this, sCopyPath, sFileName](bool bTimedOut)
+	{
+		if (! bTimedOut) {
+			m_oLogger("Removed corrupt copy " + sCopyPath);
+		}
+		// If hung the mount is blacklisted, it's copied elsewhere
+		requeueForCopying(sFileName);
+		schedulePipeline();
+	});
+	if (! bPosted) {
+		requeueForCopying(sFileName);
 	}
-	m_oLogger(s_sSyncProgram + ": " + sLine);
 }
-void SonoModel::onSyncingCerr(bool bError, const std::string sLine) noexcept
+void SonoModel::requeueForCopying(const std::string& sFileName) noexcept
 {
-	if (bError) {
-		m_oLogger("Error reading " + s_sSyncProgram + " cerr output: " + sLine);
-		return; //--------------------------------------------------------------
+	const std::string sRecordingFilePath = m_oInit.m_sRecordingDirPath + "/" + sFileName;
+	if (std::find(m_aToBeCopiedRecordings.begin(), m_aToBeCopiedRecordings.end(), sRecordingFilePath) == m_aToBeCopiedRecordings.end()) {
+		m_aToBeCopiedRecordings.push_back(sRecordingFilePath);
+		journalTransition(sRecordingFilePath, JobJournal::STATE_QUEUED);
 	}
-	m_oLogger(s_sSyncProgram + " (E): " + sLine);
 }
 
-
 bool SonoModel::checkToBeRemovedRecordings() noexcept
 {
 	DebugCtx<SonoModel> oCtx(this, "SonoModel::checkToBeRemovedRecordings");
@@ -1675,6 +3511,7 @@ void SonoModel::onAsyncRemoveReady(Glib::RefPtr<Gio::AsyncResult>& refResult) no
 	}
 	if (bOk) {
 		//
+		journalTransition(m_aToBeRemovedRecordings[0], JobJournal::STATE_REMOVED);
 		m_aToBeRemovedRecordings.erase(m_aToBeRemovedRecordings.begin());
 		//
 		m_oLogger("Finished removing " + m_sRemovingFileName);
@@ -1686,6 +3523,10 @@ void SonoModel::onAsyncRemoveReady(Glib::RefPtr<Gio::AsyncResult>& refResult) no
 	m_refRemovingFile.reset();
 
 	m_oStateChangedSignal.emit();
+	if (bOk) {
+		// a failed remove is retried by checkPipeline()
+		schedulePipeline();
+	}
 }
 
 bool SonoModel::checkSonoremQuitFile() noexcept
@@ -1703,6 +3544,69 @@ void SonoModel::sonoremQuit() noexcept
 {
 	m_oQuitSignal.emit();
 }
+std::string SonoModel::onControlCommand(const std::string& sCommand) noexcept
+{
+	DebugCtx<SonoModel> oCtx(this, "SonoModel::onControlCommand");
+
+	if (m_oInit.m_bVerbose) {
+		m_oLogger("Received command: " + sCommand);
+	}
+	if (sCommand == "start") {
+		if (m_eState == STATE_RECORDING) {
+			return "Already recording"; //--------------------------------------
+		}
+		startRecording();
+	} else if (sCommand == "stop") {
+		if (m_eState == STATE_STOPPED) {
+			return "Already stopped"; //----------------------------------------
+		}
+		stopRecording();
+	} else if (sCommand == "status") {
+		return getStatusString(); //--------------------------------------------
+	} else if (sCommand == "tell") {
+		m_oTellStatusSignal.emit();
+	} else if (sCommand == "unmount") {
+		unmountNonBusy();
+	} else if (sCommand == "quit") {
+		// The reply is sent first
+		Glib::signal_timeout().connect_once(sigc::mem_fun(*this, &SonoModel::sonoremQuit), 0);
+	} else {
+		return "Unknown command: " + sCommand; //-------------------------------
+	}
+	return "OK";
+}
+std::string SonoModel::getStatusString() const noexcept
+{
+	std::string sStatus;
+	if (m_eState == STATE_STOPPED) {
+		sStatus = "Stopped";
+	} else if (m_eState == STATE_RECORDING) {
+		sStatus = "Recording " + m_sCurrentRecordingFilePath
+					+ " (" + std::to_string(getRecordingElapsedSeconds()) + " s, "
+					+ std::to_string(getRecordingSizeBytes()) + " B)";
+	} else {
+		sStatus = "Waiting for space";
+	}
+	sStatus += "\nFree space: " + std::to_string(m_nRecordingFsFreeMB) + " MB";
+	const int64_t nFullSeconds = getRecordingFsFullSeconds();
+	if (nFullSeconds >= 0) {
+		sStatus += " (full in " + getDurationInSecondsAsString(nFullSeconds) + ")";
+	}
+	if (m_refRecordingFsPredictor) {
+		sStatus += "\nWritten: " + std::to_string(static_cast<int64_t>(m_refRecordingFsPredictor->getWrittenBytesPerSecond()))
+					+ " B/s  freed: " + std::to_string(static_cast<int64_t>(m_refRecordingFsPredictor->getDrainedBytesPerSecond()))
+					+ " B/s";
+	}
+	sStatus += "\nTo be copied: " + std::to_string(getNrToBeCopiedRecordings())
+				+ "  copying: " + std::to_string(getNrCopyingRecordings())
+				+ "  to be synced: " + std::to_string(getNrToBeSyncedRecordings())
+				+ "  to be removed: " + std::to_string(getNrToBeRemovedRecordings());
+	for (const MountInfo& oMountInfo : m_aMountInfos) {
+		sStatus += "\nMount " + oMountInfo.m_sName + " " + oMountInfo.m_sRootPath
+					+ " (" + std::to_string(oMountInfo.m_nFreeMB) + " MB free)";
+	}
+	return sStatus;
+}
 
 
 const std::string& SonoModel::getRecordingFilePath() const noexcept
@@ -1711,15 +3615,45 @@ const std::string& SonoModel::getRecordingFilePath() const noexcept
 }
 std::string SonoModel::getCopyingFromFilePath() const noexcept
 {
-	return (m_sCopyingFileName.empty() ? "" : m_oInit.m_sRecordingDirPath + "/" + m_sCopyingFileName);
+	if (m_aCopyingDatas.empty()) {
+		return "";
+	}
+	const CopyingData& oCD = *(m_aCopyingDatas[0]);
+	return m_oInit.m_sRecordingDirPath + "/" + oCD.m_sCopyingFileName;
 }
 std::string SonoModel::getCopyingToFilePath() const noexcept
 {
-	return (m_sCopyingFileName.empty() ? "" : m_sCopyingToMountRootPath + "/" + m_sCopyingFileName);
+	if (m_aCopyingDatas.empty()) {
+		return "";
+	}
+	const CopyingData& oCD = *(m_aCopyingDatas[0]);
+	return oCD.m_sCopyingToMountRootPath + "/" + oCD.m_sCopyingFileName;
+}
+int32_t SonoModel::getNrCopyingRecordings() const noexcept
+{
+	return static_cast<int32_t>(m_aCopyingDatas.size());
+}
+std::vector<SonoModel::CopyProgress> SonoModel::getCopyProgresses() const noexcept
+{
+	std::vector<CopyProgress> aProgresses;
+	for (const auto& refCopyingData : m_aCopyingDatas) {
+		const CopyingData& oCD = *refCopyingData;
+		CopyProgress oProgress;
+		oProgress.m_sFileName = oCD.m_sCopyingFileName;
+		oProgress.m_sMountRootPath = oCD.m_sCopyingToMountRootPath;
+		oProgress.m_nCopiedBytes = oCD.m_refCopier->getCopiedBytes();
+		oProgress.m_nTotalBytes = oCD.m_refCopier->getTotalBytes();
+		oProgress.m_nBytesPerSecond = static_cast<int64_t>(oCD.m_fBytesPerSecond);
+		oProgress.m_nSmoothedBytesPerSecond = static_cast<int64_t>(oCD.m_fSmoothedBytesPerSecond);
+		oProgress.m_nEtaSeconds = getCopyEtaSeconds(oProgress.m_nCopiedBytes, oProgress.m_nTotalBytes
+													, oProgress.m_nSmoothedBytesPerSecond, oCD.m_refCopier->isFollowing());
+		aProgresses.push_back(std::move(oProgress));
+	}
+	return aProgresses;
 }
 std::string SonoModel::getSyncingFilePath() const noexcept
 {
-	return (m_sSyncingMountRootPath.empty() ? "" : m_refSyncingData->m_sSyncingFilePath);
+	return (m_sSyncingMountRootPath.empty() ? "" : m_refSyncer->getFilePaths()[0]);
 }
 std::string SonoModel::getRemovingFilePath() const noexcept
 {
@@ -1731,7 +3665,9 @@ const std::string& SonoModel::getUnmountingMountRootPath() const noexcept
 }
 int64_t SonoModel::getRecordingSizeBytes() const noexcept
 {
-	if (m_refRecordingData) {
+	if (m_refCapture) {
+		return m_refCapture->getSegmentBytes();
+	} else if (m_refRecordingData) {
 		return m_refRecordingData->m_nCurrentRecordingSizeBytes;
 	} else {
 		return 0;
@@ -1747,7 +3683,8 @@ int64_t SonoModel::getRecordingElapsedSeconds() const noexcept
 }
 int32_t SonoModel::getNrWaitingForKilledProcesses() const noexcept
 {
-	return static_cast<int32_t>(m_aWaitingRecPids.size());
+	// A stopped capture still finishing its last segment is like a killed "rec"
+	return static_cast<int32_t>(m_aWaitingRecPids.size() + m_aStoppingCaptures.size());
 }
 int32_t SonoModel::getNrToBeCopiedRecordings() const noexcept
 {
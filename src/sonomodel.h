@@ -21,7 +21,22 @@
 #ifndef SONO_SONO_MODEL_H
 #define SONO_SONO_MODEL_H
 
+#include "childsupervisor.h"
+#include "controlsocket.h"
+#include "dirwatcher.h"
+#include "filecopier.h"
+#include "filesyncer.h"
+#include "fileverifier.h"
+#include "iopool.h"
+#include "jobjournal.h"
+#include "mountscanner.h"
+#include "recordingtail.h"
+#include "recordingwatchdog.h"
+#include "sonocapture.h"
 #include "sonosources.h"
+#include "spacepredictor.h"
+#include "spacesampler.h"
+#include "speedprobe.h"
 
 #include "debugctx.h"
 
@@ -30,6 +45,7 @@
 
 #include <sigc++/sigc++.h>
 
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -69,6 +85,13 @@ public:
 		bool m_bRfkillWifiOff = false;
 		bool m_bRfkillBluetoothOn = false;
 		bool m_bRfkillBluetoothOff = false;
+		bool m_bGaplessRotation = false; // start next recording before the current ends
+		std::string m_sCaptureSource; // if empty "rec" is used, otherwise see CaptureSource::create()
+		int32_t m_nMaxParallelCopies = 2; // max number of mounts recordings are copied to at the same time
+		bool m_bFollowCopy = false; // copy the current recording to a mount while it grows
+		bool m_bDirectToStick = false; // record to a mount if possible instead of m_sRecordingDirPath
+		bool m_bMirrorToStick = false; // also write the captured segments to a mount if possible
+		std::string m_sControlSocketName; // if empty s_sControlSocketName
 		bool m_bVerbose = false;
 		bool m_bDebug = false;
 	};
@@ -92,6 +115,22 @@ public:
 	};
 	STATE getState() const noexcept;
 
+	// The sonorem.* files found in the root of a mount
+	struct MountControlFiles {
+		bool m_bHasName = false;
+		std::string m_sName; // content of sonorem.name
+		bool m_bHasFolder = false;
+		std::string m_sFolder; // content of sonorem.folder
+		bool m_bFolderExists = false; // whether m_sFolder is a directory in the root
+		bool m_bExclude = false;
+		bool m_bStopRecording = false;
+		bool m_bStartRecording = false;
+		bool m_bUnmountNonBusyDirty = false;
+		bool m_bTellStatus = false;
+		bool m_bQuitProgram = false;
+		bool m_bDontRfkillWifi = false;
+		bool m_bDontRfkillBluetooth = false;
+	};
 	struct MountInfo {
 		std::string m_sRootPath; // the unique key for a mount
 		std::string m_sName; // some generic name given by OS, or content of sonorem.name
@@ -99,22 +138,49 @@ public:
 		std::string m_sFolder; // the root folder if empty, or content of sonorem.folder
 		int64_t m_nFreeMB = 0; // currently free space
 		int32_t m_nFailedCopyAttempts = 0;
+		int64_t m_nWriteBytesPerSecond = 0; // measured when inserted, 0 if not known yet, -1 if it couldn't be measured
 		bool m_bDirty = false; // files were copied to it, needs unmount
 		bool m_bUnmounting = false; // an unmount operation is going on
+		bool m_bHung = false; // a file system call didn't return in time
+		MountControlFiles m_oControlFiles; // updated when they change
 		static constexpr int32_t s_nFailedCopyAttemptsToBlacklist = 4;
 	public:
 		bool isBlacklisted() const noexcept
 		{
-			return (m_nFailedCopyAttempts >= s_nFailedCopyAttemptsToBlacklist);
+			return m_bHung || (m_nFailedCopyAttempts >= s_nFailedCopyAttemptsToBlacklist);
 		}
 	};
 
 	const std::string& getRecordingDirPath() const noexcept;
 	int64_t getRecordingFsFreeMB() const noexcept;
+	/** The estimated time until the free space of the recording directory
+	 * falls below Init::m_nMinFreeSpaceBytes.
+	 * Based on the rates at which the recordings are written and the copied
+	 * recordings removed.
+	 * @return The seconds, 0 if already below or -1 if not decreasing or not known.
+	 */
+	int64_t getRecordingFsFullSeconds() const noexcept;
 
 	const std::string& getRecordingFilePath() const noexcept;
+	/** The source of the first of the currently running copies. */
 	std::string getCopyingFromFilePath() const noexcept;
+	/** The destination of the first of the currently running copies. */
 	std::string getCopyingToFilePath() const noexcept;
+	int32_t getNrCopyingRecordings() const noexcept;
+	struct CopyProgress
+	{
+		std::string m_sFileName;
+		std::string m_sMountRootPath;
+		int64_t m_nCopiedBytes = 0;
+		int64_t m_nTotalBytes = -1; // -1 if not known yet
+		int64_t m_nBytesPerSecond = 0; // since the previous progress
+		int64_t m_nSmoothedBytesPerSecond = 0; // exponential moving average
+		int32_t m_nEtaSeconds = -1; // -1 if not known, ex. still following a recording
+	};
+	/** The progress of the currently running copies.
+	 * @return The progresses in the order the copies were started.
+	 */
+	std::vector<CopyProgress> getCopyProgresses() const noexcept;
 	std::string getSyncingFilePath() const noexcept;
 	std::string getRemovingFilePath() const noexcept;
 	const std::string& getUnmountingMountRootPath() const noexcept;
@@ -132,6 +198,8 @@ public:
 	sigc::signal<void> m_oMountsChangedSignal;
 
 	sigc::signal<void> m_oStateChangedSignal;
+	/* Emits at most once a second while copying. See getCopyProgresses(). */
+	sigc::signal<void> m_oCopyProgressSignal;
 
 	sigc::signal<void> m_oRecordingFsFreeMBChangedSignal;
 
@@ -141,11 +209,17 @@ public:
 
 	static std::string getNowString() noexcept;
 	static std::string getShortNowString() noexcept;
+	/** Like getNowString() but never returns the same string twice.
+	 * A string within the same second as the previous one gets a milliseconds suffix.
+	 */
+	static std::string getUniqueNowString() noexcept;
 	static std::string getDurationInSecondsAsString(int64_t nDuration) noexcept;
 
 	const std::string& getRecordingFileExt() const noexcept;
 
 	static const std::string s_sRecordingProgram;
+	/** The name of the control socket in the abstract namespace. See sonorem --send. */
+	static const std::string s_sControlSocketName;
 	static const std::string s_sRecordingDefaultFileExt;
 	static const int32_t s_nMaxSonoremNameLen;
 
@@ -153,17 +227,52 @@ public:
 
 protected:
 	bool matchRecordingFileName(const std::string& sFileName) noexcept;
+	/** Chooses the mount a recording is copied to.
+	 * Among the mounts of the best class the recording fits, the one with
+	 * the least space that can still hold it (best fit).
+	 * @param aAvailableBytes The space left on each mount from the best, -1 if it can't be copied to.
+	 * @param aMountClasses The class of each mount. The mounts of a class are consecutive.
+	 * @param nNeededBytes The space the recording needs.
+	 * @return The index of the mount or -1 if the recording fits nowhere.
+	 */
+	static int32_t getBestFitMountIdx(const std::vector<int64_t>& aAvailableBytes, const std::vector<int32_t>& aMountClasses
+									, int64_t nNeededBytes) noexcept;
+	/** Chooses the planned copies that can be started now.
+	 * A mount is copied to by at most one copy at a time.
+	 * @param aPlannedMountRootPaths The mount of each planned copy in the order they should
+	 *                               be started, empty if the recording fits nowhere.
+	 * @param aBusyMountRootPaths The mounts that are already copied to or probed.
+	 * @param nFreeSlots The number of copies that can still be started.
+	 * @return The indexes of the planned copies to start.
+	 */
+	static std::vector<int32_t> getStartableCopies(const std::vector<std::string>& aPlannedMountRootPaths
+													, const std::vector<std::string>& aBusyMountRootPaths, int32_t nFreeSlots) noexcept;
+	/** The exponential moving average of the throughput of a copy.
+	 * @param fSmoothedBytesPerSecond The average so far, 0 if none yet.
+	 * @param fBytesPerSecond The throughput since the previous progress.
+	 * @return The new average.
+	 */
+	static double getSmoothedBytesPerSecond(double fSmoothedBytesPerSecond, double fBytesPerSecond) noexcept;
+	/** The seconds until a copy is finished.
+	 * @param nCopiedBytes The bytes copied so far.
+	 * @param nTotalBytes The size of the file or -1 if not known.
+	 * @param nSmoothedBytesPerSecond The smoothed throughput.
+	 * @param bFollowing Whether the file is still being recorded.
+	 * @return The seconds or -1 if not known.
+	 */
+	static int32_t getCopyEtaSeconds(int64_t nCopiedBytes, int64_t nTotalBytes, int64_t nSmoothedBytesPerSecond
+									, bool bFollowing) noexcept;
 
 private:
 	void initMountableVolumes() noexcept;
 
-	bool isMountExcluded(Gio::Mount& oMount, const std::string& sName, const std::string& sRootPath) noexcept;
-	bool sonoremFileExists(const std::string& sRootPath, const std::string& sFileExt) noexcept;
+	bool isMountExcluded(Gio::Mount& oMount, const MountControlFiles& oControlFiles, const std::string& sName
+						, const std::string& sRootPath) noexcept;
 
-	int64_t getFileSizeBytes(const std::string& sPath) const noexcept;
-	int64_t getFileSizeBytes(Gio::File& oFile) const noexcept;
-	int64_t getFsFreeMB(const std::string& sPath) const noexcept;
-	int64_t getFsFreeMB(Gio::File& oFile) const noexcept;
+	int64_t sampleRecordingFsFreeMB() noexcept;
+	bool checkRecordingFsFreeSpace() noexcept;
+	void checkRecordingFsFull() noexcept;
+	void onRecordingFsFreeBytesChanged(const std::string& sDirPath, int64_t nFreeBytes) noexcept;
 
 	void onVolumeAdded(const Glib::RefPtr<Gio::Volume>& refVolume) noexcept;
 	void onVolumeAddedOut(Gio::Volume* p0Volume) noexcept;
@@ -173,43 +282,108 @@ private:
 	void onMountRemoved(const Glib::RefPtr<Gio::Mount>& refMount) noexcept;
 	void onMountChanged(const Glib::RefPtr<Gio::Mount>& refMount) noexcept;
 
-	void getMountOverridables(const std::string& sRootPath, std::string& sName, std::string& sFolder) noexcept;
+	void startMountScan(const Glib::RefPtr<Gio::Mount>& refMount, bool bAtStartup, bool bRefresh) noexcept;
+	void onMountScanFinished(MountScanner* p0Scanner) noexcept;
+	void refreshMountControlFiles(const std::string& sRootPath, const MountControlFiles& oControlFiles) noexcept;
+	void onMountRootChanged(const std::string& sRootPath, const std::string& sFileName, uint32_t nMask) noexcept;
+	void applyStartupMountFiles(const MountControlFiles& oControlFiles) noexcept;
+	void applyMountControlFiles(const MountControlFiles& oControlFiles, const std::string& sRootPath) noexcept;
+	void applyRfkillOptions() noexcept;
+	void getMountOverridables(const MountControlFiles& oControlFiles, const std::string& sRootPath
+							, std::string& sName, std::string& sFolder) noexcept;
 	bool updateMountsFreeSpace() noexcept;
+	void queryMountFreeSpace(const std::string& sRootPath) noexcept;
+	void onMountFreeSpaceQueried(const std::string& sRootPath, int64_t nFreeBytes) noexcept;
+	std::string getIoKeyFromPath(const std::string& sPath) const noexcept;
+	void onIoHung(const std::string& sIoKey) noexcept;
+	bool interruptDirectRecording(const std::string& sMountRootPath, const std::string& sLogPrefix) noexcept;
+	void switchInterruptedRecording() noexcept;
 
 	Glib::RefPtr<Gio::Mount> getGioMountFromRootPath(const std::string& sMountRootPath) noexcept;
 	int32_t getMountIdxFromRootPath(const std::string& sMountRootPath) noexcept;
+	int32_t getCopyingIdxFromRootPath(const std::string& sMountRootPath) const noexcept;
+	bool isBeingCopied(const std::string& sRecordingFilePath) const noexcept;
+	int32_t getDirectRecordingMountIdx() noexcept;
+	int32_t getRecordingMountIdx() noexcept;
+	int32_t getMountIdxFromFolderPath(const std::string& sFolderPath) noexcept;
+	void updateMirrorDirPath() noexcept;
+	void trackMirrorSegment() noexcept;
+	void queueFinishedSegment(const SonoCapture::FinishedSegment& oSegment) noexcept;
+	bool hasDirectRecordings(const std::string& sMountRootPath) const noexcept;
+	bool eraseDirectRecording(const std::string& sMountRootPath, const std::string& sFileName) noexcept;
+	void queueFinishedRecording(const std::string& sRecordingFilePath) noexcept;
 
 	void sortMounts() noexcept;
+	int64_t getKnownMountSpeed(const std::string& sUUID) const noexcept;
+	void loadMountSpeeds() noexcept;
+	void saveMountSpeeds() noexcept;
 
 	bool recordingFsHasFreeSpace() noexcept;
 
 	bool launchRecordingProcess() noexcept;
+	bool launchCapture() noexcept;
+	void stopCapture() noexcept;
+	void onCaptureStopped(SonoCapture* p0Capture, bool bFailedBeforeStop) noexcept;
+	void onCaptureChanged() noexcept;
 	void interruptRecordingProcess() noexcept;
-	bool checkRecordingTimedOut() noexcept;
+	bool keepRecording() noexcept;
+	bool relaunchRecording() noexcept;
+	bool checkRecordingRotate() noexcept;
+	void rotateRecordingProcess() noexcept;
+	bool checkRotationOverlap() noexcept;
+	void onNextRecordingSizeQueried(const std::string& sFilePath, int64_t nSizeBytes) noexcept;
+	void interruptRotatedRecordingProcess() noexcept;
 	bool checkWaitingForFreeSpace() noexcept;
 	bool checkRecordingMaxFileSize() noexcept;
+	void onRecordingSizeQueried(const std::string& sFilePath, int64_t nSizeBytes) noexcept;
+	void watchRecording() noexcept;
+	void keepRecordingTail() noexcept;
+	bool updateRecordingTail(const shared_ptr<RecordingTail>& refTail, bool bSync) noexcept;
+	void saveRecordingTail(const shared_ptr<RecordingTail>& refTail) noexcept;
+	void onRecordingSizeChanged(const std::string& sFilePath, int64_t nSizeBytes) noexcept;
+	void onRecordingStalled(const std::string& sFilePath) noexcept;
+	void sampleRecordingSize(const std::string& sFilePath, int64_t nSizeBytes) noexcept;
+	// Returns whether the limit was reached
+	bool checkRecordingSizeLimit() noexcept;
 	void onRecordingCout(bool bError, const std::string sLine) noexcept;
 	void onRecordingCerr(bool bError, const std::string sLine) noexcept;
-	bool checkWaitingChild() noexcept;
+	void onRecordingExited(Glib::Pid oPid, int nWaitStatus) noexcept;
+	void schedulePipeline() noexcept;
+	bool runScheduledPipeline() noexcept;
+	bool checkPipeline() noexcept;
+	bool checkToBeProbedMounts() noexcept;
+	void onProbeFinished() noexcept;
 	bool checkToBeCopiedRecordings() noexcept;
+	void updateCopyPlan() noexcept;
+	bool startCopying(const std::string& sRecordingFilePath, int64_t nSizeBytes, bool bFollow) noexcept;
+	void startCopyingTo(const MountInfo& oMountInfo, const std::string& sRecordingFilePath, int64_t nSizeBytes, bool bFollow) noexcept;
 	bool checkToBeSyncedRecordings() noexcept;
-	bool launchSyncingProcess(std::string&& sSyncingMountRootPath, std::string&& sSyncingFileName
-							, std::string&& sSyncingFilePath) noexcept;
-	void maybeTerminateSyncingProcess() noexcept;
-	void onSyncingCout(bool bError, const std::string sLine) noexcept;
-	void onSyncingCerr(bool bError, const std::string sLine) noexcept;
+	void onSyncFinished() noexcept;
+	bool checkToBeVerifiedRecordings() noexcept;
+	void onVerifyFinished() noexcept;
+	void removeCorruptCopy(const std::string& sMountRootPath, const std::string& sCopyPath
+							, const std::string& sFileName) noexcept;
+	void requeueForCopying(const std::string& sFileName) noexcept;
 	bool checkToBeRemovedRecordings() noexcept;
 	bool checkSonoremQuitFile() noexcept;
 	void sonoremQuit() noexcept;
+	std::string onControlCommand(const std::string& sCommand) noexcept;
+	std::string getStatusString() const noexcept;
 
-	void onAsyncCopyProgress(goffset nCurrentBytes, goffset nTotalBytes) noexcept;
-	void onAsyncCopyReady(Glib::RefPtr<Gio::AsyncResult>& refResult) noexcept;
+	void onCopyProgress(const std::string& sCopyingToMountRootPath) noexcept;
+	void onCopyFinished(const std::string& sCopyingToMountRootPath) noexcept;
 	void onAsyncRemoveReady(Glib::RefPtr<Gio::AsyncResult>& refResult) noexcept;
 	void onAsyncUnmountReady(Glib::RefPtr<Gio::AsyncResult>& refResult) noexcept;
 	void onAsyncUnmountNext() noexcept;
 
 	std::string getRecordingFileName(const std::string& sNow) noexcept;
 	void pickupLeftoverToBeCopiedRecordings() noexcept;
+	void replayJournal() noexcept;
+	void journalTransition(const std::string& sRecordingFilePath, JobJournal::STATE eState
+							, const std::string& sMountRootPath = "") noexcept;
+	void flushJournal() noexcept;
+	bool checkJournaledCopies() noexcept;
+	void onJournaledCopyChecked(const JobJournal::Entry& oEntry, const std::string& sMountRootPath, bool bExists) noexcept;
 
 private:
 	friend struct DebugCtx<SonoModel>;
@@ -224,30 +398,45 @@ private:
 
 	STATE m_eState = STATE_STOPPED;
 	sigc::connection m_oWaitingForFreeSpaceConn;
+	// Set when a recording couldn't be (re)started and is retried later
+	sigc::connection m_oRelaunchRecordingConn;
+	// Set when the copy, sync and remove pipeline is about to run
+	sigc::connection m_oSchedulePipelineConn;
+
+	// Reaps the "rec" child processes
+	ChildSupervisor m_oChildSupervisor;
 
 	// recording, copying, syncing, unmounting can go in parallel
-	std::string m_sCopyingToMountRootPath; // if empty not copying
-	std::string m_sCopyingFileName; // The file name being copied to m_sCopyingToMountRootPath
-	Glib::RefPtr<Gio::File> m_refCopyingFile; // the source
-	Glib::RefPtr<Gio::Cancellable> m_refAsyncCopyCancellable;
-	//
-	std::string m_sSyncingMountRootPath; // if empty not syncing
-	struct SyncingData
+	struct CopyingData
 	{
-		SyncingData(SonoModel* p0This, std::string&& sSyncingFileName, std::string&& sSyncingFilePath
-					, Glib::Pid&& oPid, int nSyncingCoutFd, int nSyncingCerrFd) noexcept;
-		~SyncingData() noexcept;
-		std::string m_sSyncingFileName; // The file name being synced on mount m_sSyncingMountRootPath
-		std::string m_sSyncingFilePath; // The full path of the file being synced
-		Glib::Pid m_oSyncingPid;
-		Glib::RefPtr<PipeInputSource> m_refSyncingCout;
-		sigc::connection m_oSyncingCoutConn;
-		Glib::RefPtr<PipeInputSource> m_refSyncingCerr;
-		sigc::connection m_oSyncingCerrConn;
-	private:
-		SyncingData() = delete;
+		std::string m_sCopyingToMountRootPath;
+		std::string m_sCopyingFileName; // The file name being copied to m_sCopyingToMountRootPath
+		int64_t m_nSizeBytes = 0; // the space reserved on the mount
+		unique_ptr<FileCopier> m_refCopier;
+		std::chrono::steady_clock::time_point m_oLastProgressTime;
+		int64_t m_nLastProgressBytes = 0;
+		double m_fBytesPerSecond = 0.0;
+		double m_fSmoothedBytesPerSecond = 0.0;
 	};
-	unique_ptr<SyncingData> m_refSyncingData;
+	// The running copies, at most one per mount and m_oInit.m_nMaxParallelCopies in total
+	std::vector<unique_ptr<CopyingData>> m_aCopyingDatas;
+	std::chrono::steady_clock::time_point m_oLastCopyProgressSignalTime;
+	// Finished copies can't be deleted from within their signal, it's done later
+	std::vector<unique_ptr<CopyingData>> m_aFinishedCopyingDatas;
+	// Copies canceled because the stick was removed (mount UUID, file name),
+	// resumed if the stick comes back
+	std::vector<std::pair<std::string, std::string>> m_aInterruptedCopies;
+	//
+	std::string m_sVerifyingMountRootPath; // if empty not verifying
+	std::string m_sVerifyingFileName;
+	unique_ptr<FileVerifier> m_refVerifier;
+	//
+	std::string m_sProbingMountRootPath; // if empty not probing
+	unique_ptr<SpeedProbe> m_refProbe;
+	//
+	std::string m_sSyncingMountRootPath; // if empty not syncing
+	std::vector<std::string> m_aSyncingFileNames; // The file names being synced on mount m_sSyncingMountRootPath
+	unique_ptr<FileSyncer> m_refSyncer;
 	//
 	std::string m_sRemovingFileName; // The file name being removed, if empty not removing
 	Glib::RefPtr<Gio::File> m_refRemovingFile;
@@ -277,19 +466,104 @@ private:
 		//sigc::connection m_oCurrentRecordingConn; // max recording size check
 		int64_t m_nCurrentRecordingSizeBytes;
 		int64_t m_nCurrentRecordingLastSizeBytes;
+		bool m_bQueryingSize = false; // the size of the current recording, see m_oIoPool
+		// Follows the size of the current recording, if null the size is polled
+		unique_ptr<RecordingWatchdog> m_refWatchdog;
+		// Recording directly to a stick: the end that isn't synced yet, shared with the I/O pool
+		shared_ptr<RecordingTail> m_refTail;
+		sigc::connection m_oTailConn; // updates m_refTail
+		// Gapless rotation: set when this recording is being replaced by the next
+		sigc::connection m_oRotationOverlapConn; // polls the size of the next recording
+		int64_t m_nNextRecordingFirstSizeBytes;
+		int64_t m_nNextRecordingSizeBytes = -1; // the last queried
+		bool m_bQueryingNextSize = false;
+		int32_t m_nRotationOverlapMillisec;
 	private:
 		RecordingData() = delete;
 	};
 	unique_ptr<RecordingData> m_refRecordingData;
+	// Gapless rotation: the recording that keeps going until the next one has started
+	unique_ptr<RecordingData> m_refRotatedRecordingData;
+	// In-process recording, used instead of m_refRecordingData if m_oInit.m_sCaptureSource not empty
+	unique_ptr<SonoCapture> m_refCapture;
+	sigc::connection m_oCaptureChangedConn;
+	// Stopped, their threads are still finishing the last segment
+	std::vector<unique_ptr<SonoCapture>> m_aStoppingCaptures;
+	// The last capture whose threads have terminated, deleted later
+	unique_ptr<SonoCapture> m_refStoppedCapture;
+	int32_t m_nCaptureLastXruns = 0;
+	std::string m_sCaptureMirrorDirPath; // the mount folder passed to the capture, empty if none
 
 	std::string m_sSonoremQuitFilePath;
+	// Guards against a second instance and receives the commands sent with --send
+	ControlSocket m_oControlSocket;
+	// The file system calls that can block on a stick, keyed by mount root path
+	// (or the recording directory), are done by the workers of the pool
+	static constexpr int32_t s_nTotIoWorkers = 2;
+	IoPool m_oIoPool{s_nTotIoWorkers};
+	// The free space of the recording directory, sampled often since it's cheap
+	static constexpr int32_t s_nRecordingFsMaxStaleMillisec = 250;
+	SpaceSampler m_oRecordingFsSampler{s_nRecordingFsMaxStaleMillisec};
+	// Fed with the samples of the free space and of the recording size, decides
+	// how often the free space is checked
+	unique_ptr<SpacePredictor> m_refRecordingFsPredictor;
+	sigc::connection m_oCheckRecordingFsFreeSpaceConn;
+	int32_t m_nCheckRecordingFsFreeSpaceSeconds = 0;
+	int32_t m_nWaitingForFreeSpaceSeconds = 0;
+	bool m_bRecordingFsFullWarned = false;
+	// The journaled copies whose existence on the stick is being checked
+	std::vector<std::string> m_aCheckingJournaledCopies;
+	std::string m_sMountSpeedsFilePath;
+	// (mount UUID, write bytes per second) of the sticks that were probed, the most recent last
+	std::vector<std::pair<std::string, int64_t>> m_aMountSpeeds;
+	struct MountScanData
+	{
+		Glib::RefPtr<Gio::Mount> m_refMount;
+		std::string m_sName;
+		std::string m_sUUID;
+		bool m_bAtStartup = false;
+		bool m_bRefresh = false; // only the control files of an added mount
+		bool m_bRescan = false; // the control files changed during the scan
+		unique_ptr<MountScanner> m_refScanner;
+	};
+	// The mounts being looked at before being added to m_aMountInfos
+	std::vector<unique_ptr<MountScanData>> m_aMountScans;
+	std::vector<unique_ptr<MountScanData>> m_aFinishedMountScans;
+	// The roots of the added mounts, to refresh their control files
+	DirWatcher m_oMountRootsWatcher;
+	// The rfkill options are applied when the mounts present at startup were scanned
+	int32_t m_nPendingStartupMountScans = 0;
+	// The state of the recordings in the recording directory, null if it couldn't be opened
+	unique_ptr<JobJournal> m_refJournal;
+	// Recordings that were copied to a stick before the program was restarted
+	// and are waiting for it to be inserted to be synced or verified there
+	std::vector<JobJournal::Entry> m_aJournaledCopies;
 
 	// "rec" child processes that have to finish (killed or because about to exit)
 	std::vector< std::pair<Glib::Pid, std::string> > m_aWaitingRecPids; // Value: (pid, sRecordingFilePath)
+	// The stalled ones among them, their recording was already queued
+	std::vector< std::pair<Glib::Pid, sigc::connection> > m_aStalledRecPids; // Value: (pid, kill timeout)
+	// (mount root path, file path) of the recordings written directly to a mount,
+	// from when they are started until they are synced, and of the mirrors of
+	// the captured segments until they are finished
+	std::vector<std::pair<std::string, std::string>> m_aDirectRecordings;
 	// file paths that need to be moved from main disk to a mount
 	std::vector<std::string> m_aToBeCopiedRecordings;
+	struct PlannedCopy
+	{
+		std::string m_sRecordingFilePath;
+		int64_t m_nSizeBytes = 0;
+		std::string m_sMountRootPath; // if empty it doesn't fit any mount
+	};
+	// The recordings of m_aToBeCopiedRecordings not being copied, sorted by decreasing size
+	// and assigned to the mounts best-fit-decreasing. See updateCopyPlan().
+	std::vector<PlannedCopy> m_aCopyPlan;
+	// The recordings to be copied whose size couldn't be read, logged only once
+	std::vector<std::string> m_aNoSizeRecordings;
 	// (mount root path, file name) that need to be synced on a mount
 	std::vector<std::pair<std::string, std::string>> m_aToBeSyncedRecordings;
+	// (mount root path, file name) synced on a mount that need to be checked against their checksum
+	std::vector<std::pair<std::string, std::string>> m_aToBeVerifiedRecordings;
 	// file paths that need to be removed from main disk
 	std::vector<std::string> m_aToBeRemovedRecordings;
 	// the currently mounted usb sticks
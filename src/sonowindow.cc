@@ -157,6 +157,17 @@ SonoWindow::SonoWindow(SonoModel& oModel, bool bVerbose, bool bDebug, const std:
 				m_p0EntryCopyingFilePath->set_hexpand(true);
 			//
 			++nGridRow;
+			Gtk::Label* m_p0LabelCopyingProgress = Gtk::manage(new Gtk::Label("        progress:"));
+			m_p0GridState->attach(*m_p0LabelCopyingProgress, 0, nGridRow, 1, 1);
+                m_p0LabelCopyingProgress->set_halign(Gtk::Align::ALIGN_START);
+			//
+			m_p0EntryCopyingProgress = Gtk::manage(new Gtk::Entry());
+			m_p0GridState->attach(*m_p0EntryCopyingProgress, 1, nGridRow, 1, 1);
+				m_p0EntryCopyingProgress->set_can_focus(false);
+				m_p0EntryCopyingProgress->set_editable(false);
+				m_p0EntryCopyingProgress->set_hexpand(true);
+			//
+			++nGridRow;
 			Gtk::Label* m_p0LabelSyncingFilePath = Gtk::manage(new Gtk::Label("Syncing file:"));
 			m_p0GridState->attach(*m_p0LabelSyncingFilePath, 0, nGridRow, 1, 1);
                 m_p0LabelSyncingFilePath->set_halign(Gtk::Align::ALIGN_START);
@@ -237,6 +248,7 @@ SonoWindow::SonoWindow(SonoModel& oModel, bool bVerbose, bool bDebug, const std:
 			m_p0ScrolledMounts->add(*m_p0TreeViewMounts);
 				m_p0TreeViewMounts->append_column("Path", m_oMountsColumns.m_oColMountRoot);
 				m_p0TreeViewMounts->append_column("Free (MB)", m_oMountsColumns.m_oMountFreeSpace);
+				m_p0TreeViewMounts->append_column("Write (MB/s)", m_oMountsColumns.m_oMountWriteSpeed);
 				m_p0TreeViewMounts->append_column("Name", m_oMountsColumns.m_oColMountName);
 				m_p0TreeViewMounts->append_column("UUID", m_oMountsColumns.m_oColMountUUID);
 				m_p0TreeViewMounts->set_can_focus(false);
@@ -343,6 +355,7 @@ SonoWindow::SonoWindow(SonoModel& oModel, bool bVerbose, bool bDebug, const std:
 
 	m_oModel.m_oMountsChangedSignal.connect( sigc::mem_fun(this, &SonoWindow::mountsChanged) );
 	m_oModel.m_oStateChangedSignal.connect( sigc::mem_fun(this, &SonoWindow::stateChangedSignal) );
+	m_oModel.m_oCopyProgressSignal.connect( sigc::mem_fun(this, &SonoWindow::refreshCopyProgress) );
 	m_oModel.m_oRecordingFsFreeMBChangedSignal.connect( sigc::mem_fun(this, &SonoWindow::stateChangedSignal) );
 	m_oModel.m_oTellStatusSignal.connect( sigc::mem_fun(this, &SonoWindow::tellStatus) );
 	m_oModel.m_oQuitSignal.connect( sigc::mem_fun(this, &SonoWindow::quitSignal) );
@@ -378,6 +391,10 @@ bool SonoWindow::isWindowActive() const noexcept
 }
 void SonoWindow::autoStart() noexcept
 {
+	if (! m_oModel.isAutoStart()) {
+		// A stick found after the window was created said not to
+		return; //--------------------------------------------------------------
+	}
 	log("Autostart recording");
 	startRecording();
 }
@@ -552,11 +569,22 @@ void SonoWindow::refreshState() noexcept
 
 	//
 	const int64_t nFreeMB = m_oModel.getRecordingFsFreeMB();
-	m_p0EntryFreeDiskSpace->set_text(std::to_string(nFreeMB));
+	std::string sFreeDiskSpace = std::to_string(nFreeMB);
+	const int64_t nFullSeconds = m_oModel.getRecordingFsFullSeconds();
+	if (nFullSeconds > 0) {
+		sFreeDiskSpace += "  (full in " + SonoModel::getDurationInSecondsAsString(nFullSeconds) + ")";
+	}
+	m_p0EntryFreeDiskSpace->set_text(sFreeDiskSpace);
 	//
-	const std::string sCopyingFile = m_oModel.getCopyingFromFilePath();
+	std::string sCopyingFile = m_oModel.getCopyingFromFilePath();
+	const int32_t nNrCopying = m_oModel.getNrCopyingRecordings();
+	if (nNrCopying > 1) {
+		sCopyingFile += " (+" + std::to_string(nNrCopying - 1) + ")";
+	}
 	m_p0EntryCopyingFilePath->set_text(sCopyingFile);
 	//
+	refreshCopyProgress();
+	//
 	const std::string sSyncingFile = m_oModel.getSyncingFilePath();
 	m_p0EntrySyncingFilePath->set_text(sSyncingFile);
 	//
@@ -575,6 +603,17 @@ void SonoWindow::refreshState() noexcept
 	const std::string& sUnmountingDir = m_oModel.getUnmountingMountRootPath();
 	m_p0EntryUnmountingRootPath->set_text(sUnmountingDir);
 }
+void SonoWindow::refreshCopyProgress() noexcept
+{
+	std::string sProgress;
+	for (const auto& oProgress : m_oModel.getCopyProgresses()) {
+		if (! sProgress.empty()) {
+			sProgress += " | ";
+		}
+		sProgress += getCopyProgressString(oProgress, false);
+	}
+	m_p0EntryCopyingProgress->set_text(sProgress);
+}
 void SonoWindow::regenerateMountsList() noexcept
 {
 	DebugCtx<SonoWindow> oCtx(this, "SonoWindow::regenerateMountsList");
@@ -591,6 +630,10 @@ void SonoWindow::regenerateMountsList() noexcept
 		oRow[m_oMountsColumns.m_oColMountRoot] = oMountInfo.m_sRootPath;
 		oRow[m_oMountsColumns.m_oColMountUUID] = oMountInfo.m_sUUID;
 		oRow[m_oMountsColumns.m_oMountFreeSpace] = oMountInfo.m_nFreeMB;
+		const int64_t nWriteBytesPerSecond = oMountInfo.m_nWriteBytesPerSecond;
+		oRow[m_oMountsColumns.m_oMountWriteSpeed] = ((nWriteBytesPerSecond > 0)
+													? Glib::ustring{std::to_string(nWriteBytesPerSecond / 1000000)}
+													: Glib::ustring{(nWriteBytesPerSecond == 0) ? "?" : "-"});
 	}
 	m_p0TreeViewMounts->expand_all();
 	m_bRegenerateMountsInProgress = false;
@@ -654,6 +697,26 @@ std::string SonoWindow::getSizeStringFromBytes(int64_t nSizeBytes, bool bLongUni
 	}();
 	return std::to_string(nSizeInUnit) + " " + sUnit;
 }
+std::string SonoWindow::getCopyProgressString(const SonoModel::CopyProgress& oProgress, bool bLongUnit) const noexcept
+{
+	std::string sRes;
+	if (oProgress.m_nTotalBytes > 0) {
+		const int64_t nPercent = std::min<int64_t>(100, oProgress.m_nCopiedBytes * 100 / oProgress.m_nTotalBytes);
+		sRes += std::to_string(nPercent) + (bLongUnit ? " percent" : "%") + " of ";
+	}
+	sRes += getSizeStringFromBytes(std::max<int64_t>(0, oProgress.m_nTotalBytes), bLongUnit);
+	if (oProgress.m_nSmoothedBytesPerSecond > 0) {
+		sRes += ", " + getSizeStringFromBytes(oProgress.m_nSmoothedBytesPerSecond, bLongUnit) + (bLongUnit ? " per second" : "/s");
+	}
+	if (oProgress.m_nEtaSeconds >= 0) {
+		if (bLongUnit) {
+			sRes += ", " + getTimeStringFromSeconds(oProgress.m_nEtaSeconds) + " left";
+		} else {
+			sRes += ", ETA " + SonoModel::getDurationInSecondsAsString(oProgress.m_nEtaSeconds);
+		}
+	}
+	return sRes;
+}
 std::string SonoWindow::getTimeStringFromSeconds(int64_t nSeconds) const noexcept
 {
 	std::string sRes;
@@ -722,7 +785,12 @@ void SonoWindow::tellStatus() noexcept
 	case 4: {
 		const int32_t nNrToBeCopied = m_oModel.getNrToBeCopiedRecordings();
 		if (nNrToBeCopied > 0) {
-			tellString("Number of to be copied files: " + std::to_string(nNrToBeCopied));
+			std::string sTell = "Number of to be copied files: " + std::to_string(nNrToBeCopied) + ".";
+			const auto aProgresses = m_oModel.getCopyProgresses();
+			if (! aProgresses.empty()) {
+				sTell += " Copying: " + getCopyProgressString(aProgresses[0], true) + ".";
+			}
+			tellString(sTell);
 			break;
 		}
 		++m_nStatusCounter;
@@ -780,7 +848,12 @@ void SonoWindow::tellStatus() noexcept
 	} // fallthrough
 	case 9: {
 		const int32_t nMainFreeMB = m_oModel.getRecordingFsFreeMB();
-		tellString("Free disk: " + std::to_string(nMainFreeMB) + " Megabytes");
+		std::string sTell = "Free disk: " + std::to_string(nMainFreeMB) + " Megabytes.";
+		const int64_t nFullSeconds = m_oModel.getRecordingFsFullSeconds();
+		if (nFullSeconds > 0) {
+			sTell += " Full in " + getTimeStringFromSeconds(nFullSeconds) + ".";
+		}
+		tellString(sTell);
 		break;
 	}
 	case 10: {
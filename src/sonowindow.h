@@ -57,6 +57,7 @@ private:
 	bool resetStatusCounter() noexcept;
 	void tellString(const std::string& sStr) noexcept;
 	std::string getSizeStringFromBytes(int64_t nSizeBytes, bool bLongUnit) const noexcept;
+	std::string getCopyProgressString(const SonoModel::CopyProgress& oProgress, bool bLongUnit) const noexcept;
 	std::string getTimeStringFromSeconds(int64_t nRecordingElapsedSeconds) const noexcept;
 
 	void onNotebookSwitchPage(Gtk::Widget*, guint nPageNum) noexcept;
@@ -74,6 +75,7 @@ private:
 	void mountsChanged() noexcept;
 	void stateChangedSignal() noexcept;
 	void refreshState() noexcept;
+	void refreshCopyProgress() noexcept;
 	void regenerateMountsList() noexcept;
 
 	bool toTheFront() noexcept;
@@ -112,6 +114,8 @@ private:
 				Gtk::Entry* m_p0EntryFreeDiskSpace = nullptr;
 				//Gtk::Label* m_p0LabelCopyingFilePath = nullptr;
 				Gtk::Entry* m_p0EntryCopyingFilePath = nullptr;
+				//Gtk::Label* m_p0LabelCopyingProgress = nullptr;
+				Gtk::Entry* m_p0EntryCopyingProgress = nullptr;
 				//Gtk::Label* m_p0LabelSyncingFilePath = nullptr;
 				Gtk::Entry* m_p0EntrySyncingFilePath = nullptr;
 				//Gtk::Label* m_p0LabelRemovingFilePath = nullptr;
@@ -175,12 +179,13 @@ private:
 		MountsColumns() noexcept
 		{
 			add(m_oColMountName); add(m_oColMountRoot); add(m_oColMountUUID);
-			add(m_oMountFreeSpace);
+			add(m_oMountFreeSpace); add(m_oMountWriteSpeed);
 		}
 		Gtk::TreeModelColumn<Glib::ustring> m_oColMountName;
 		Gtk::TreeModelColumn<Glib::ustring> m_oColMountRoot;
 		Gtk::TreeModelColumn<Glib::ustring> m_oColMountUUID;
 		Gtk::TreeModelColumn<int64_t> m_oMountFreeSpace;
+		Gtk::TreeModelColumn<Glib::ustring> m_oMountWriteSpeed;
 	};
 	MountsColumns m_oMountsColumns;
 	Glib::RefPtr<Gtk::TreeStore> m_refTreeModelMounts;
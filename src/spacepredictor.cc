@@ -0,0 +1,145 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   spacepredictor.cc
+ */
+
+#include "spacepredictor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace sono
+{
+
+SpacePredictor::SpacePredictor(int64_t nMinFreeBytes, int32_t nSmoothingSeconds) noexcept
+: m_nMinFreeBytes(nMinFreeBytes)
+, m_nSmoothingSeconds(nSmoothingSeconds)
+{
+	assert(nMinFreeBytes >= 0);
+	assert(nSmoothingSeconds > 0);
+	reset();
+}
+void SpacePredictor::reset() noexcept
+{
+	m_bFreeSampled = false;
+	m_nFreeBytes = -1;
+	m_nTotFreeRates = 0;
+	m_fConsumedBytesPerSecond = 0.0;
+	m_bSizeSampled = false;
+	m_nSizeBytes = -1;
+	m_fWrittenBytesPerSecond = 0.0;
+}
+double SpacePredictor::getWeight(const TimePoint& oFrom, const TimePoint& oTo) const noexcept
+{
+	const double fSeconds = std::chrono::duration<double>(oTo - oFrom).count();
+	// The older the previous sample the more the new rate counts
+	return 1.0 - std::exp(- fSeconds / m_nSmoothingSeconds);
+}
+void SpacePredictor::addFreeSample(const TimePoint& oTime, int64_t nFreeBytes) noexcept
+{
+	if (nFreeBytes < 0) {
+		return; //--------------------------------------------------------------
+	}
+	if (m_bFreeSampled) {
+		if (oTime <= m_oFreeSampleTime) {
+			return; //----------------------------------------------------------
+		}
+		const double fSeconds = std::chrono::duration<double>(oTime - m_oFreeSampleTime).count();
+		const double fRate = (m_nFreeBytes - nFreeBytes) / fSeconds;
+		if (m_nTotFreeRates == 0) {
+			m_fConsumedBytesPerSecond = fRate;
+		} else {
+			const double fWeight = getWeight(m_oFreeSampleTime, oTime);
+			m_fConsumedBytesPerSecond += fWeight * (fRate - m_fConsumedBytesPerSecond);
+		}
+		++m_nTotFreeRates;
+	}
+	m_bFreeSampled = true;
+	m_oFreeSampleTime = oTime;
+	m_nFreeBytes = nFreeBytes;
+}
+void SpacePredictor::addRecordingSizeSample(const TimePoint& oTime, int64_t nSizeBytes) noexcept
+{
+	if (nSizeBytes < 0) {
+		return; //--------------------------------------------------------------
+	}
+	if (m_bSizeSampled) {
+		if (oTime <= m_oSizeSampleTime) {
+			return; //----------------------------------------------------------
+		}
+		const double fSeconds = std::chrono::duration<double>(oTime - m_oSizeSampleTime).count();
+		// A smaller size means a new recording was started in the meantime
+		const int64_t nWrittenBytes = ((nSizeBytes >= m_nSizeBytes) ? nSizeBytes - m_nSizeBytes : nSizeBytes);
+		const double fRate = nWrittenBytes / fSeconds;
+		const double fWeight = getWeight(m_oSizeSampleTime, oTime);
+		m_fWrittenBytesPerSecond += fWeight * (fRate - m_fWrittenBytesPerSecond);
+	}
+	m_bSizeSampled = true;
+	m_oSizeSampleTime = oTime;
+	m_nSizeBytes = nSizeBytes;
+}
+void SpacePredictor::recordingStopped() noexcept
+{
+	m_bSizeSampled = false;
+	m_nSizeBytes = -1;
+	m_fWrittenBytesPerSecond = 0.0;
+}
+double SpacePredictor::getDrainedBytesPerSecond() const noexcept
+{
+	return std::max(0.0, m_fWrittenBytesPerSecond - m_fConsumedBytesPerSecond);
+}
+int64_t SpacePredictor::getSecondsToLimit() const noexcept
+{
+	if (m_nTotFreeRates == 0) {
+		return -1; //-----------------------------------------------------------
+	}
+	if (m_nFreeBytes <= m_nMinFreeBytes) {
+		return 0; //------------------------------------------------------------
+	}
+	if (m_fConsumedBytesPerSecond < 1.0) {
+		return -1; //-----------------------------------------------------------
+	}
+	return static_cast<int64_t>((m_nFreeBytes - m_nMinFreeBytes) / m_fConsumedBytesPerSecond);
+}
+int64_t SpacePredictor::getSecondsToFreed() const noexcept
+{
+	if (m_nTotFreeRates == 0) {
+		return -1; //-----------------------------------------------------------
+	}
+	if (m_nFreeBytes > m_nMinFreeBytes) {
+		return 0; //------------------------------------------------------------
+	}
+	if (m_fConsumedBytesPerSecond > -1.0) {
+		return -1; //-----------------------------------------------------------
+	}
+	return static_cast<int64_t>(std::ceil((m_nMinFreeBytes - m_nFreeBytes + 1) / - m_fConsumedBytesPerSecond));
+}
+int32_t SpacePredictor::getCheckIntervalSeconds(int32_t nMinSeconds, int32_t nMaxSeconds) const noexcept
+{
+	assert((nMinSeconds > 0) && (nMinSeconds <= nMaxSeconds));
+	const int64_t nSeconds = ((m_nFreeBytes > m_nMinFreeBytes) ? getSecondsToLimit() : getSecondsToFreed());
+	if (nSeconds < 0) {
+		return nMaxSeconds; //--------------------------------------------------
+	}
+	// Check a few times before the estimated time since the rates might change
+	constexpr int64_t nChecksBefore = 4;
+	return static_cast<int32_t>(std::max<int64_t>(nMinSeconds, std::min<int64_t>(nMaxSeconds, nSeconds / nChecksBefore)));
+}
+
+} // namespace sono
@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   spacepredictor.h
+ */
+
+#ifndef SONO_SPACE_PREDICTOR_H
+#define SONO_SPACE_PREDICTOR_H
+
+#include <chrono>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Predicts when the free space of a file system reaches a limit.
+ * The rate at which the free space is consumed (the recordings minus what is
+ * freed by the removal of the copied recordings) and the rate at which the
+ * recordings are written are exponential moving averages of the samples,
+ * weighted by the time elapsed between them.
+ */
+class SpacePredictor
+{
+public:
+	using TimePoint = std::chrono::steady_clock::time_point;
+	/** Constructor.
+	 * @param nMinFreeBytes The limit. Cannot be negative.
+	 * @param nSmoothingSeconds The time constant of the averages. Must be positive.
+	 */
+	SpacePredictor(int64_t nMinFreeBytes, int32_t nSmoothingSeconds) noexcept;
+
+	/** Forgets the samples.
+	 */
+	void reset() noexcept;
+
+	/** Adds a sample of the free space.
+	 * Samples not newer than the previous are ignored.
+	 * @param oTime The time of the sample.
+	 * @param nFreeBytes The free bytes. If negative the sample is ignored.
+	 */
+	void addFreeSample(const TimePoint& oTime, int64_t nFreeBytes) noexcept;
+	/** Adds a sample of the size of the current recording.
+	 * A size smaller than the previous is the start of a new recording.
+	 * @param oTime The time of the sample.
+	 * @param nSizeBytes The size. If negative the sample is ignored.
+	 */
+	void addRecordingSizeSample(const TimePoint& oTime, int64_t nSizeBytes) noexcept;
+	/** Tells that no recording is going on.
+	 * The write rate becomes zero.
+	 */
+	void recordingStopped() noexcept;
+
+	/** The rate at which the free space decreases.
+	 * @return The bytes per second. Negative if the free space increases.
+	 */
+	double getConsumedBytesPerSecond() const noexcept { return m_fConsumedBytesPerSecond; }
+	/** The rate at which the recordings are written.
+	 * @return The bytes per second.
+	 */
+	double getWrittenBytesPerSecond() const noexcept { return m_fWrittenBytesPerSecond; }
+	/** The rate at which space is freed.
+	 * It's the difference between the written and the consumed rates.
+	 * @return The bytes per second.
+	 */
+	double getDrainedBytesPerSecond() const noexcept;
+
+	/** The estimated time until the free space reaches the limit.
+	 * @return The seconds, 0 if already below or -1 if not decreasing or not known.
+	 */
+	int64_t getSecondsToLimit() const noexcept;
+	/** The estimated time until the free space is above the limit again.
+	 * @return The seconds, 0 if already above or -1 if not increasing or not known.
+	 */
+	int64_t getSecondsToFreed() const noexcept;
+
+	/** The interval until the free space should be checked again.
+	 * The nearer the limit the shorter the interval.
+	 * @param nMinSeconds The minimum. Must be positive.
+	 * @param nMaxSeconds The maximum. Returned if nothing is expected to happen.
+	 * @return The seconds.
+	 */
+	int32_t getCheckIntervalSeconds(int32_t nMinSeconds, int32_t nMaxSeconds) const noexcept;
+
+private:
+	double getWeight(const TimePoint& oFrom, const TimePoint& oTo) const noexcept;
+private:
+	const int64_t m_nMinFreeBytes;
+	const int32_t m_nSmoothingSeconds;
+	bool m_bFreeSampled;
+	TimePoint m_oFreeSampleTime;
+	int64_t m_nFreeBytes;
+	int32_t m_nTotFreeRates; // the number of rates averaged
+	double m_fConsumedBytesPerSecond;
+	bool m_bSizeSampled;
+	TimePoint m_oSizeSampleTime;
+	int64_t m_nSizeBytes;
+	double m_fWrittenBytesPerSecond;
+private:
+	SpacePredictor() = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_SPACE_PREDICTOR_H */
@@ -0,0 +1,132 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   spacesampler.cc
+ */
+
+#include "spacesampler.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+SpaceSampler::SpaceSampler(int32_t nMaxStaleMillisec) noexcept
+: m_nMaxStaleMillisec(nMaxStaleMillisec)
+{
+	assert(nMaxStaleMillisec >= 0);
+}
+SpaceSampler::~SpaceSampler() noexcept
+{
+	for (auto& oDir : m_aDirs) {
+		::close(oDir.m_nFd);
+	}
+}
+std::vector<SpaceSampler::Dir>::iterator SpaceSampler::findDir(const std::string& sDirPath) noexcept
+{
+	return std::find_if(m_aDirs.begin(), m_aDirs.end(), [&](const Dir& oDir)
+	{
+		return (oDir.m_sDirPath == sDirPath);
+	});
+}
+std::string SpaceSampler::addDir(const std::string& sDirPath) noexcept
+{
+	if (findDir(sDirPath) != m_aDirs.end()) {
+		return ""; //-----------------------------------------------------------
+	}
+	// O_PATH is enough for fstatvfs and needs no read permission
+	const int nFd = ::open(sDirPath.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+	if (nFd < 0) {
+		return "Could not open " + sDirPath + ": " + getErrnoString(errno); //--
+	}
+	Dir oDir;
+	oDir.m_sDirPath = sDirPath;
+	oDir.m_nFd = nFd;
+	m_aDirs.push_back(std::move(oDir));
+	return "";
+}
+void SpaceSampler::removeDir(const std::string& sDirPath) noexcept
+{
+	auto itDir = findDir(sDirPath);
+	if (itDir == m_aDirs.end()) {
+		return; //--------------------------------------------------------------
+	}
+	::close(itDir->m_nFd);
+	m_aDirs.erase(itDir);
+}
+void SpaceSampler::setMaxStaleMillisec(int32_t nMaxStaleMillisec) noexcept
+{
+	assert(nMaxStaleMillisec >= 0);
+	m_nMaxStaleMillisec = nMaxStaleMillisec;
+}
+bool SpaceSampler::sampleDir(Dir& oDir, const std::chrono::steady_clock::time_point& oNow) noexcept
+{
+	if (oDir.m_bSampled) {
+		const int64_t nAgeMillisec = std::chrono::duration_cast<std::chrono::milliseconds>(oNow - oDir.m_oSampleTime).count();
+		if (nAgeMillisec < m_nMaxStaleMillisec) {
+			return false; //----------------------------------------------------
+		}
+	}
+	struct statvfs oStatVfs;
+	int64_t nFreeBytes = -1;
+	if (::fstatvfs(oDir.m_nFd, &oStatVfs) == 0) {
+		// Like the free space reported by Gio
+		nFreeBytes = static_cast<int64_t>(oStatVfs.f_bavail) * oStatVfs.f_frsize;
+	}
+	const bool bChanged = oDir.m_bSampled && (nFreeBytes != oDir.m_nFreeBytes);
+	oDir.m_bSampled = true;
+	oDir.m_oSampleTime = oNow;
+	oDir.m_nFreeBytes = nFreeBytes;
+	return bChanged;
+}
+int64_t SpaceSampler::getFreeBytes(const std::string& sDirPath) noexcept
+{
+	auto itDir = findDir(sDirPath);
+	if (itDir == m_aDirs.end()) {
+		return getFsFreeBytes(sDirPath); //-------------------------------------
+	}
+	const bool bChanged = sampleDir(*itDir, std::chrono::steady_clock::now());
+	// Copied, the signal might remove the directory
+	const int64_t nFreeBytes = itDir->m_nFreeBytes;
+	if (bChanged) {
+		m_oFreeBytesChangedSignal.emit(sDirPath, nFreeBytes);
+	}
+	return nFreeBytes;
+}
+void SpaceSampler::sample() noexcept
+{
+	const auto oNow = std::chrono::steady_clock::now();
+	std::vector<std::pair<std::string, int64_t>> aChanged;
+	for (auto& oDir : m_aDirs) {
+		if (sampleDir(oDir, oNow)) {
+			aChanged.emplace_back(oDir.m_sDirPath, oDir.m_nFreeBytes);
+		}
+	}
+	for (const auto& oPair : aChanged) {
+		m_oFreeBytesChangedSignal.emit(oPair.first, oPair.second);
+	}
+}
+
+} // namespace sono
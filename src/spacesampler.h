@@ -0,0 +1,110 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   spacesampler.h
+ */
+
+#ifndef SONO_SPACE_SAMPLER_H
+#define SONO_SPACE_SAMPLER_H
+
+#include <sigc++/sigc++.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Samples the free space of file systems with fstatvfs.
+ * Each directory is opened once and the descriptor is kept, so that sampling
+ * is a single system call and the path isn't resolved again. The samples are
+ * cached for a configurable time.
+ * Since the descriptors keep the file systems busy, don't add the directories
+ * of mounts that have to be unmounted.
+ */
+class SpaceSampler
+{
+public:
+	/** Constructor.
+	 * @param nMaxStaleMillisec How long a sample is used before it is taken again. Cannot be negative.
+	 */
+	explicit SpaceSampler(int32_t nMaxStaleMillisec) noexcept;
+	/** Destructor.
+	 * Closes the descriptors.
+	 */
+	~SpaceSampler() noexcept;
+
+	/** Opens a directory for sampling.
+	 * Does nothing if already added.
+	 * @param sDirPath The directory.
+	 * @return The error or empty if successful.
+	 */
+	std::string addDir(const std::string& sDirPath) noexcept;
+	/** Closes a directory.
+	 * Does nothing if not added.
+	 * @param sDirPath The directory.
+	 */
+	void removeDir(const std::string& sDirPath) noexcept;
+
+	void setMaxStaleMillisec(int32_t nMaxStaleMillisec) noexcept;
+	int32_t getMaxStaleMillisec() const noexcept { return m_nMaxStaleMillisec; }
+
+	/** The space available to unprivileged users.
+	 * The cached sample is returned if not stale.
+	 * If the directory wasn't added (ex. it couldn't be opened) it is
+	 * sampled by path without caching.
+	 * @param sDirPath The directory.
+	 * @return The bytes or -1 if error.
+	 */
+	int64_t getFreeBytes(const std::string& sDirPath) noexcept;
+	/** Samples all the directories whose sample is stale.
+	 * Emits m_oFreeBytesChangedSignal for those that have changed.
+	 */
+	void sample() noexcept;
+
+	/** Emitted when a new sample differs from the previous.
+	 * Params: the directory, the free bytes (-1 if error).
+	 */
+	sigc::signal<void, const std::string&, int64_t> m_oFreeBytesChangedSignal;
+
+private:
+	struct Dir
+	{
+		std::string m_sDirPath;
+		int m_nFd = -1;
+		bool m_bSampled = false;
+		std::chrono::steady_clock::time_point m_oSampleTime;
+		int64_t m_nFreeBytes = -1;
+	};
+	std::vector<Dir>::iterator findDir(const std::string& sDirPath) noexcept;
+	// Returns whether changed
+	bool sampleDir(Dir& oDir, const std::chrono::steady_clock::time_point& oNow) noexcept;
+
+	int32_t m_nMaxStaleMillisec;
+	std::vector<Dir> m_aDirs;
+private:
+	SpaceSampler() = delete;
+	SpaceSampler(const SpaceSampler& oSource) = delete;
+	SpaceSampler& operator=(const SpaceSampler& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_SPACE_SAMPLER_H */
@@ -0,0 +1,159 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   speedprobe.cc
+ */
+
+#include "speedprobe.h"
+
+#include "util.h"
+
+#include <glibmm.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+static const std::string s_sProbeFileName = ".sonorem.probe";
+static constexpr int64_t s_nProbeChunkBytes = 4 * 1024 * 1024;
+static constexpr int32_t s_nProbeMaxChunks = 8;
+// Slow sticks write less than s_nProbeMaxChunks chunks
+static constexpr int32_t s_nProbeMaxWriteMillisec = 3000;
+static constexpr size_t s_nBufferAlignment = 4096;
+
+static int64_t getBytesPerSecond(int64_t nBytes, std::chrono::steady_clock::duration oDuration) noexcept
+{
+	const int64_t nMicrosec = std::chrono::duration_cast<std::chrono::microseconds>(oDuration).count();
+	return nBytes * 1000000 / std::max<int64_t>(1, nMicrosec);
+}
+
+SpeedProbe::SpeedProbe(const std::string& sDirPath) noexcept
+: WorkerThread("probe", false)
+, m_sDirPath(sDirPath)
+, m_sProbeFilePath(sDirPath + "/" + s_sProbeFileName)
+, m_refResult(std::make_shared<Result>())
+{
+}
+std::function<void(WorkerThread::Status& oStatus)> SpeedProbe::createJob() noexcept
+{
+	const std::string sProbeFilePath = m_sProbeFilePath;
+	auto refResult = m_refResult;
+	return [sProbeFilePath, refResult](Status& oStatus)
+	{
+		probe(sProbeFilePath, *refResult, oStatus);
+	};
+}
+int64_t SpeedProbe::getWriteBytesPerSecond() const noexcept
+{
+	return m_refResult->m_nWriteBytesPerSecond;
+}
+int64_t SpeedProbe::getReadBytesPerSecond() const noexcept
+{
+	return m_refResult->m_nReadBytesPerSecond;
+}
+void SpeedProbe::probe(const std::string& sProbeFilePath, Result& oResult, Status& oStatus) noexcept
+{
+	void* p0Buffer = nullptr;
+	if (::posix_memalign(&p0Buffer, s_nBufferAlignment, s_nProbeChunkBytes) != 0) {
+		oStatus.setError("Could not allocate probe buffer");
+	} else {
+		// Not compressible by smart controllers
+		uint32_t nValue = static_cast<uint32_t>(::getpid());
+		uint32_t* p0Values = static_cast<uint32_t*>(p0Buffer);
+		for (int64_t nIdx = 0; nIdx < s_nProbeChunkBytes / 4; ++nIdx) {
+			nValue = nValue * 1664525 + 1013904223;
+			p0Values[nIdx] = nValue;
+		}
+		const int nFd = ::open(sProbeFilePath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (nFd < 0) {
+			oStatus.setError("Could not create " + sProbeFilePath + ": " + getErrnoString(errno));
+		} else {
+			int64_t nWrittenBytes = 0;
+			if (writeProbeFile(sProbeFilePath, nFd, static_cast<char*>(p0Buffer), nWrittenBytes, oResult, oStatus)) {
+				readProbeFile(sProbeFilePath, nFd, static_cast<char*>(p0Buffer), nWrittenBytes, oResult, oStatus);
+			}
+			::close(nFd);
+			::unlink(sProbeFilePath.c_str());
+			// Otherwise the removal might still be pending when the stick is pulled
+			const int nDirFd = ::open(Glib::path_get_dirname(sProbeFilePath).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (nDirFd >= 0) {
+				::fsync(nDirFd);
+				::close(nDirFd);
+			}
+		}
+	}
+	std::free(p0Buffer);
+}
+bool SpeedProbe::writeProbeFile(const std::string& sProbeFilePath, int nFd, char* p0Buffer, int64_t& nWrittenBytes
+								, Result& oResult, Status& oStatus) noexcept
+{
+	const auto oStart = std::chrono::steady_clock::now();
+	const auto oMaxEnd = oStart + std::chrono::milliseconds(s_nProbeMaxWriteMillisec);
+	for (int32_t nChunk = 0; nChunk < s_nProbeMaxChunks; ++nChunk) {
+		if (oStatus.isCanceled()) {
+			oStatus.setError("Canceled");
+			return false; //----------------------------------------------------
+		}
+		if (! pwriteAll(nFd, p0Buffer, s_nProbeChunkBytes, nWrittenBytes)) {
+			oStatus.setError("Error writing " + sProbeFilePath + ": " + getErrnoString(errno));
+			return false; //----------------------------------------------------
+		}
+		nWrittenBytes += s_nProbeChunkBytes;
+		// Make it go to the device, otherwise the page cache is measured
+		if (::fdatasync(nFd) != 0) {
+			oStatus.setError("fdatasync " + sProbeFilePath + ": " + getErrnoString(errno));
+			return false; //----------------------------------------------------
+		}
+		if (std::chrono::steady_clock::now() >= oMaxEnd) {
+			break;
+		}
+	}
+	oResult.m_nWriteBytesPerSecond = getBytesPerSecond(nWrittenBytes, std::chrono::steady_clock::now() - oStart);
+	return true;
+}
+bool SpeedProbe::readProbeFile(const std::string& sProbeFilePath, int nFd, char* p0Buffer, int64_t nWrittenBytes
+								, Result& oResult, Status& oStatus) noexcept
+{
+	// The pages are clean, dropping them makes the reads go to the device
+	::posix_fadvise(nFd, 0, 0, POSIX_FADV_DONTNEED);
+	const auto oStart = std::chrono::steady_clock::now();
+	int64_t nReadBytes = 0;
+	while (nReadBytes < nWrittenBytes) {
+		if (oStatus.isCanceled()) {
+			oStatus.setError("Canceled");
+			return false; //----------------------------------------------------
+		}
+		const int64_t nRead = preadAll(nFd, p0Buffer, s_nProbeChunkBytes, nReadBytes);
+		if (nRead <= 0) {
+			oStatus.setError("Error reading " + sProbeFilePath + ": " + ((nRead < 0) ? getErrnoString(errno) : "file too short"));
+			return false; //----------------------------------------------------
+		}
+		nReadBytes += nRead;
+	}
+	oResult.m_nReadBytesPerSecond = getBytesPerSecond(nReadBytes, std::chrono::steady_clock::now() - oStart);
+	return true;
+}
+
+} // namespace sono
@@ -0,0 +1,85 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   speedprobe.h
+ */
+
+#ifndef SONO_SPEED_PROBE_H
+#define SONO_SPEED_PROBE_H
+
+#include "workerthread.h"
+
+#include <memory>
+#include <string>
+
+#include <stdint.h>
+
+namespace sono
+{
+
+/** Measures the write and read speed of a file system in a worker thread.
+ * A temporary file of at most a few tens of MB is written, synced, read back
+ * bypassing the page cache and removed. The measure is bounded in time.
+ * When canceled m_oFinishedSignal is emitted with an error.
+ */
+class SpeedProbe : public WorkerThread
+{
+public:
+	/** Constructor.
+	 * @param sDirPath The directory where the temporary file is created.
+	 */
+	explicit SpeedProbe(const std::string& sDirPath) noexcept;
+
+	const std::string& getDirPath() const noexcept { return m_sDirPath; }
+	/** The measured write speed including the sync.
+	 * Only meaningful when finished successfully.
+	 */
+	int64_t getWriteBytesPerSecond() const noexcept;
+	/** The measured read speed.
+	 * Only meaningful when finished successfully.
+	 */
+	int64_t getReadBytesPerSecond() const noexcept;
+
+protected:
+	std::function<void(Status& oStatus)> createJob() noexcept override;
+
+private:
+	struct Result
+	{
+		int64_t m_nWriteBytesPerSecond = 0;
+		int64_t m_nReadBytesPerSecond = 0;
+	};
+	static void probe(const std::string& sProbeFilePath, Result& oResult, Status& oStatus) noexcept;
+	static bool writeProbeFile(const std::string& sProbeFilePath, int nFd, char* p0Buffer, int64_t& nWrittenBytes
+								, Result& oResult, Status& oStatus) noexcept;
+	static bool readProbeFile(const std::string& sProbeFilePath, int nFd, char* p0Buffer, int64_t nWrittenBytes
+								, Result& oResult, Status& oStatus) noexcept;
+
+private:
+	const std::string m_sDirPath;
+	const std::string m_sProbeFilePath;
+	// Written by the thread, read by the main thread only when finished
+	std::shared_ptr<Result> m_refResult;
+private:
+	SpeedProbe() = delete;
+	SpeedProbe(const SpeedProbe& oSource) = delete;
+	SpeedProbe& operator=(const SpeedProbe& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_SPEED_PROBE_H */
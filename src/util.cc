@@ -25,6 +25,8 @@
 #include <cassert>
 #include <stdexcept>
 #include <chrono>
+#include <limits>
+#include <system_error>
 
 #include <array>
 #include <string.h>
@@ -32,6 +34,8 @@
 
 #include <errno.h>
 #include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
 
 namespace sono
 {
@@ -164,6 +168,43 @@ std::string strToInt32(const std::string& sStr, int32_t& nRes) noexcept
 	}
 	return "";
 }
+std::string strToMemSize(const std::string& sStr, int64_t& nBytes) noexcept
+{
+	std::string sSize = strStrip(sStr);
+	const auto nPos = sSize.find_first_not_of("0123456789");
+	std::string sUnit;
+	if (nPos != std::string::npos) {
+		sUnit = sSize.substr(nPos);
+		sSize = sSize.substr(0, nPos);
+	}
+	int64_t nValue;
+	try {
+		nValue = std::stoll(sSize);
+	} catch (std::invalid_argument& ) {
+		return "Invalid number";
+	} catch (std::out_of_range& ) {
+		return "Invalid number";
+	}
+	int64_t nMul = 1;
+	if (sUnit.empty() || (sUnit == "B")) {
+		//
+	} else if (sUnit == "KB") {
+		nMul = 1000;
+	} else if (sUnit == "MB") {
+		nMul = 1000000;
+	} else if (sUnit == "GB") {
+		nMul = 1000000000;
+	} else if (sUnit == "TB") {
+		nMul = 1000000000000;
+	} else {
+		return "Wrong unit";
+	}
+	if ((std::numeric_limits<int64_t>::max() / nMul) <= nValue) {
+		return "Integer too big";
+	}
+	nBytes = nValue * nMul;
+	return "";
+}
 
 std::string getEnvString(const char* p0Name) noexcept
 {
@@ -172,6 +213,150 @@ std::string getEnvString(const char* p0Name) noexcept
 	return sValue;
 }
 
+std::string getErrnoString(int nErrno) noexcept
+{
+	// strerror is not thread safe
+	return std::generic_category().message(nErrno);
+}
+
+bool pwriteAll(int nFd, const void* p0Buf, int64_t nBytes, int64_t nOffset) noexcept
+{
+	const char* p0Cur = static_cast<const char*>(p0Buf);
+	while (nBytes > 0) {
+		const auto nWritten = ::pwrite(nFd, p0Cur, nBytes, nOffset);
+		if (nWritten < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false; //----------------------------------------------------
+		}
+		if (nWritten == 0) {
+			// Shouldn't happen for a regular file, retrying would spin forever
+			errno = ENOSPC;
+			return false; //----------------------------------------------------
+		}
+		p0Cur += nWritten;
+		nBytes -= nWritten;
+		nOffset += nWritten;
+	}
+	return true;
+}
+int64_t preadAll(int nFd, void* p0Buf, int64_t nBytes, int64_t nOffset) noexcept
+{
+	char* p0Cur = static_cast<char*>(p0Buf);
+	int64_t nRead = 0;
+	while (nRead < nBytes) {
+		const auto nCurRead = ::pread(nFd, p0Cur + nRead, nBytes - nRead, nOffset + nRead);
+		if (nCurRead < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1; //-------------------------------------------------------
+		}
+		if (nCurRead == 0) {
+			// end of file
+			break;
+		}
+		nRead += nCurRead;
+	}
+	return nRead;
+}
+int64_t getFsFreeBytes(const std::string& sPath) noexcept
+{
+	struct statvfs oStatVfs;
+	if (::statvfs(sPath.c_str(), &oStatVfs) != 0) {
+		return -1; //-----------------------------------------------------------
+	}
+	return static_cast<int64_t>(oStatVfs.f_bavail) * oStatVfs.f_frsize;
+}
+int64_t getFileSize(const std::string& sPath) noexcept
+{
+	struct stat oStat;
+	if (::stat(sPath.c_str(), &oStat) != 0) {
+		return -1; //-----------------------------------------------------------
+	}
+	return oStat.st_size;
+}
+
+static std::array<uint32_t, 256> getCrc32cTable() noexcept
+{
+	std::array<uint32_t, 256> aTable;
+	for (uint32_t nIdx = 0; nIdx < 256; ++nIdx) {
+		uint32_t nValue = nIdx;
+		for (int32_t nBit = 0; nBit < 8; ++nBit) {
+			// reversed Castagnoli polynomial
+			nValue = (nValue >> 1) ^ ((nValue & 1) ? 0x82F63B78u : 0u);
+		}
+		aTable[nIdx] = nValue;
+	}
+	return aTable;
+}
+uint32_t crc32c(uint32_t nCrc, const void* p0Data, int64_t nBytes) noexcept
+{
+	static const std::array<uint32_t, 256> s_aTable = getCrc32cTable();
+	const uint8_t* p0Cur = static_cast<const uint8_t*>(p0Data);
+	nCrc = ~nCrc;
+	for (int64_t nIdx = 0; nIdx < nBytes; ++nIdx) {
+		nCrc = s_aTable[(nCrc ^ p0Cur[nIdx]) & 0xFF] ^ (nCrc >> 8);
+	}
+	return ~nCrc;
+}
+// The checksum register after n zero bits is a linear function of the register,
+// represented by a matrix over GF(2) (see zlib's crc32_combine)
+static uint32_t gf2MatrixTimes(const uint32_t* p0Matrix, uint32_t nVector) noexcept
+{
+	uint32_t nSum = 0;
+	while (nVector != 0) {
+		if ((nVector & 1) != 0) {
+			nSum ^= *p0Matrix;
+		}
+		nVector >>= 1;
+		++p0Matrix;
+	}
+	return nSum;
+}
+static void gf2MatrixSquare(uint32_t* p0Square, const uint32_t* p0Matrix) noexcept
+{
+	for (int32_t nIdx = 0; nIdx < 32; ++nIdx) {
+		p0Square[nIdx] = gf2MatrixTimes(p0Matrix, p0Matrix[nIdx]);
+	}
+}
+uint32_t crc32cCombine(uint32_t nCrc1, uint32_t nCrc2, int64_t nBytes2) noexcept
+{
+	if (nBytes2 <= 0) {
+		return nCrc1; //--------------------------------------------------------
+	}
+	std::array<uint32_t, 32> aEven;
+	std::array<uint32_t, 32> aOdd;
+	// the operator for one zero bit
+	aOdd[0] = 0x82F63B78;
+	uint32_t nRow = 1;
+	for (int32_t nIdx = 1; nIdx < 32; ++nIdx) {
+		aOdd[nIdx] = nRow;
+		nRow <<= 1;
+	}
+	// two and four zero bits
+	gf2MatrixSquare(aEven.data(), aOdd.data());
+	gf2MatrixSquare(aOdd.data(), aEven.data());
+	// apply nBytes2 zero bytes to nCrc1, the first square gives the operator for one zero byte
+	do {
+		gf2MatrixSquare(aEven.data(), aOdd.data());
+		if ((nBytes2 & 1) != 0) {
+			nCrc1 = gf2MatrixTimes(aEven.data(), nCrc1);
+		}
+		nBytes2 >>= 1;
+		if (nBytes2 == 0) {
+			break;
+		}
+		gf2MatrixSquare(aOdd.data(), aEven.data());
+		if ((nBytes2 & 1) != 0) {
+			nCrc1 = gf2MatrixTimes(aOdd.data(), nCrc1);
+		}
+		nBytes2 >>= 1;
+	} while (nBytes2 != 0);
+	return nCrc1 ^ nCrc2;
+}
+
 bool execCmd(const char* sCmd, std::string& sResult, std::string& sError) noexcept
 {
 	::fflush(nullptr);
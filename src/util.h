@@ -24,6 +24,8 @@
 #include <string>
 #include <vector>
 
+#include <stdint.h>
+
 namespace sono
 {
 
@@ -39,9 +41,64 @@ std::vector<std::string> strSplit(const std::string& sStr, const std::string& sS
 std::vector<std::string> strSplit(const std::string& sStr) noexcept;
 
 std::string strToInt32(const std::string& sStr, int32_t& nRes) noexcept;
+/* Converts an integer optionally followed by B, KB, MB, GB or TB.
+ * @param sStr The string. Example: "200MB".
+ * @param nBytes The result.
+ * @return Empty string if no error, otherwise error.
+ */
+std::string strToMemSize(const std::string& sStr, int64_t& nBytes) noexcept;
 
 std::string getEnvString(const char* p0Name) noexcept;
 
+/* Thread safe version of strerror.
+ * @param nErrno The error number.
+ * @return The description.
+ */
+std::string getErrnoString(int nErrno) noexcept;
+/* Writes all the bytes at an offset retrying if interrupted.
+ * @param nFd The file descriptor.
+ * @param p0Buf The bytes.
+ * @param nBytes The number of bytes.
+ * @param nOffset The offset in the file.
+ * @return Whether successful. If false see errno (ENOSPC if nothing could be written).
+ */
+bool pwriteAll(int nFd, const void* p0Buf, int64_t nBytes, int64_t nOffset) noexcept;
+/* Reads bytes at an offset retrying if interrupted until nBytes or end of file.
+ * @param nFd The file descriptor.
+ * @param p0Buf The buffer. Must be at least nBytes long.
+ * @param nBytes The number of bytes.
+ * @param nOffset The offset in the file.
+ * @return The number of bytes read or -1 if error (see errno).
+ */
+int64_t preadAll(int nFd, void* p0Buf, int64_t nBytes, int64_t nOffset) noexcept;
+/* The space available to unprivileged users on the file system of a path.
+ * Like the free space reported by Gio. Can be called from any thread.
+ * @param sPath The path.
+ * @return The bytes or -1 if error (see errno).
+ */
+int64_t getFsFreeBytes(const std::string& sPath) noexcept;
+/* The size of a file. Can be called from any thread.
+ * @param sPath The path.
+ * @return The bytes or -1 if error (see errno).
+ */
+int64_t getFileSize(const std::string& sPath) noexcept;
+/* Computes the CRC-32C (Castagnoli) checksum.
+ * To checksum data in pieces pass the result of the previous call as nCrc.
+ * @param nCrc The checksum of the preceding data or 0.
+ * @param p0Data The data.
+ * @param nBytes The number of bytes.
+ * @return The checksum.
+ */
+uint32_t crc32c(uint32_t nCrc, const void* p0Data, int64_t nBytes) noexcept;
+/* Combines the CRC-32C checksums of two consecutive pieces of data.
+ * Allows to checksum data whose beginning is rewritten last, like a header.
+ * @param nCrc1 The checksum of the first piece.
+ * @param nCrc2 The checksum of the second piece.
+ * @param nBytes2 The number of bytes of the second piece.
+ * @return The checksum of the two pieces.
+ */
+uint32_t crc32cCombine(uint32_t nCrc1, uint32_t nCrc2, int64_t nBytes2) noexcept;
+
 bool execCmd(const char* sCmd, std::string& sResult, std::string& sError) noexcept;
 
 } // namespace sono
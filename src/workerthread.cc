@@ -0,0 +1,150 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   workerthread.cc
+ */
+
+#include "workerthread.h"
+
+#include <cassert>
+#include <system_error>
+
+namespace sono
+{
+
+WorkerThread::WorkerThread(const std::string& sJobName, bool bAbandonOnCancel) noexcept
+: m_sJobName(sJobName)
+, m_bAbandonOnCancel(bAbandonOnCancel)
+, m_refStatus(std::make_shared<Status>())
+, m_bFinishedEmitted(false)
+{
+	m_refStatus->m_p0Dispatcher = &m_oDispatcher;
+	m_oDispatcher.connect(sigc::mem_fun(*this, &WorkerThread::onDispatched));
+}
+WorkerThread::~WorkerThread() noexcept
+{
+	m_refStatus->m_bCanceled = true;
+	if (m_bAbandonOnCancel) {
+		// Don't emit, the dispatcher is about to be destroyed
+		abandon();
+	}
+	if (m_oThread.joinable()) {
+		m_oThread.join();
+	}
+}
+void WorkerThread::start() noexcept
+{
+	assert(! m_oThread.joinable());
+	assert(! m_refStatus->m_bFinished);
+	try {
+		m_oThread = std::thread(&WorkerThread::run, m_refStatus, createJob());
+	} catch (const std::system_error& oErr) {
+		m_refStatus->setError("Could not start " + m_sJobName + " thread: " + oErr.what());
+		m_refStatus->m_bFinished = true;
+		m_oDispatcher.emit();
+	}
+}
+void WorkerThread::cancel() noexcept
+{
+	m_refStatus->m_bCanceled = true;
+	if (m_bAbandonOnCancel && abandon()) {
+		m_oDispatcher.emit();
+	}
+}
+bool WorkerThread::isFinished() const noexcept
+{
+	return m_refStatus->m_bFinished;
+}
+std::string WorkerThread::getError() const noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_refStatus->m_oMutex);
+	return m_refStatus->m_sError;
+}
+void WorkerThread::deleteLater(std::unique_ptr<WorkerThread>&& refWorker) noexcept
+{
+	assert(refWorker);
+	std::shared_ptr<WorkerThread> refDeleted = std::move(refWorker);
+	Glib::signal_idle().connect_once([refDeleted]() mutable
+	{
+		refDeleted.reset();
+	});
+}
+void WorkerThread::Status::setError(const std::string& sError) noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	if (m_sError.empty()) {
+		m_sError = sError;
+	}
+}
+void WorkerThread::Status::notifyProgress() noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	if (m_bAbandoned) {
+		// The dispatcher might be gone
+		return; //--------------------------------------------------------------
+	}
+	m_p0Dispatcher->emit();
+}
+void WorkerThread::run(std::shared_ptr<Status> refStatus, std::function<void(Status& oStatus)> oJob) noexcept
+{
+	oJob(*refStatus);
+	std::lock_guard<std::mutex> oLock(refStatus->m_oMutex);
+	if (refStatus->m_bAbandoned) {
+		// Nobody is waiting anymore
+		return; //--------------------------------------------------------------
+	}
+	refStatus->m_bFinished = true;
+	refStatus->m_p0Dispatcher->emit();
+}
+bool WorkerThread::abandon() noexcept
+{
+	if (! m_oThread.joinable()) {
+		return false; //--------------------------------------------------------
+	}
+	{
+		std::lock_guard<std::mutex> oLock(m_refStatus->m_oMutex);
+		if (m_refStatus->m_bFinished) {
+			// The job is done, the thread is joined by onDispatched()
+			return false; //----------------------------------------------------
+		}
+		m_refStatus->m_bAbandoned = true;
+		if (m_refStatus->m_sError.empty()) {
+			m_refStatus->m_sError = "Canceled";
+		}
+		m_refStatus->m_bFinished = true;
+	}
+	m_oThread.detach();
+	return true;
+}
+void WorkerThread::onDispatched() noexcept
+{
+	if (m_bFinishedEmitted) {
+		return; //--------------------------------------------------------------
+	}
+	if (! m_refStatus->m_bFinished) {
+		m_oProgressSignal.emit();
+		return; //--------------------------------------------------------------
+	}
+	if (m_oThread.joinable()) {
+		// the thread has nothing left to do
+		m_oThread.join();
+	}
+	m_bFinishedEmitted = true;
+	m_oFinishedSignal.emit();
+}
+
+} // namespace sono
@@ -0,0 +1,143 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   workerthread.h
+ */
+
+#ifndef SONO_WORKER_THREAD_H
+#define SONO_WORKER_THREAD_H
+
+#include <glibmm.h>
+
+#include <sigc++/sigc++.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace sono
+{
+
+/** Base class of the objects doing a job in a worker thread.
+ * The result is delivered in the main thread through m_oFinishedSignal,
+ * the job can also report its progress through m_oProgressSignal.
+ *
+ * An instance runs a single job. Threads that live as long as their owner
+ * and are fed through a queue (IoPool, MirrorWriter) or that have real-time
+ * constraints (SonoCapture) manage their thread themselves.
+ */
+class WorkerThread
+{
+public:
+	/** Destructor.
+	 * Cancels the job if still running and waits for the thread to terminate
+	 * unless the job is abandoned on cancel.
+	 */
+	virtual ~WorkerThread() noexcept;
+
+	/** Starts the job.
+	 * m_oFinishedSignal is emitted even if the thread couldn't be started.
+	 */
+	void start() noexcept;
+	/** Cancels the job.
+	 * If the job checks for it m_oFinishedSignal will be emitted with an error.
+	 * If the job is abandoned on cancel the thread is detached and left to
+	 * terminate on its own, m_oFinishedSignal is emitted with an error
+	 * without waiting for it.
+	 */
+	void cancel() noexcept;
+
+	/** Whether the job has terminated. */
+	bool isFinished() const noexcept;
+	/** The error or empty if successful.
+	 * Only meaningful when finished.
+	 */
+	std::string getError() const noexcept;
+
+	/** Emitted in the main thread when the job calls Status::notifyProgress().
+	 * Not emitted anymore once the job has terminated.
+	 */
+	sigc::signal<void> m_oProgressSignal;
+	/** Emitted in the main thread once, when the job has terminated.
+	 * The instance can't be deleted from within this signal, see deleteLater().
+	 */
+	sigc::signal<void> m_oFinishedSignal;
+
+	/** Deletes a worker from the main loop.
+	 * Can be called from within its m_oFinishedSignal.
+	 * @param refWorker The worker. Cannot be null.
+	 */
+	static void deleteLater(std::unique_ptr<WorkerThread>&& refWorker) noexcept;
+
+protected:
+	/** What the job shares with the worker. */
+	class Status
+	{
+	public:
+		bool isCanceled() const noexcept { return m_bCanceled; }
+		/** Only the first error is kept. */
+		void setError(const std::string& sError) noexcept;
+		/** Makes the worker emit m_oProgressSignal. */
+		void notifyProgress() noexcept;
+	private:
+		friend class WorkerThread;
+		Glib::Dispatcher* m_p0Dispatcher = nullptr;
+		std::atomic<bool> m_bCanceled{false};
+		std::atomic<bool> m_bFinished{false};
+		mutable std::mutex m_oMutex;
+		// Protected by m_oMutex
+		std::string m_sError;
+		bool m_bAbandoned = false; // if true the worker and its dispatcher might be gone
+	};
+	/** Constructor.
+	 * @param sJobName Used in the error if the thread can't be started.
+	 * @param bAbandonOnCancel Whether to detach the thread rather than waiting
+	 *                         for the job when canceled. For jobs that can block
+	 *                         in a system call that can't be interrupted.
+	 */
+	WorkerThread(const std::string& sJobName, bool bAbandonOnCancel) noexcept;
+	/** Creates the job run in the thread.
+	 * Called once by start(). The job must only access what it captured by value,
+	 * the results it writes must only be read by the worker when finished.
+	 */
+	virtual std::function<void(Status& oStatus)> createJob() noexcept = 0;
+
+private:
+	static void run(std::shared_ptr<Status> refStatus, std::function<void(Status& oStatus)> oJob) noexcept;
+	bool abandon() noexcept;
+	void onDispatched() noexcept;
+
+private:
+	const std::string m_sJobName;
+	const bool m_bAbandonOnCancel;
+	std::shared_ptr<Status> m_refStatus;
+	std::thread m_oThread;
+	bool m_bFinishedEmitted;
+
+	Glib::Dispatcher m_oDispatcher;
+private:
+	WorkerThread() = delete;
+	WorkerThread(const WorkerThread& oSource) = delete;
+	WorkerThread& operator=(const WorkerThread& oSource) = delete;
+};
+
+} // namespace sono
+
+#endif /* SONO_WORKER_THREAD_H */
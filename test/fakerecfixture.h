@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   fakerecfixture.h
+ */
+
+#ifndef SONOREM_FAKE_REC_FIXTURE_H_
+#define SONOREM_FAKE_REC_FIXTURE_H_
+
+#include <string>
+
+#include <stdint.h>
+
+namespace sono
+{
+namespace testing
+{
+
+/** Scripts the "fake" capture source, so that tests don't need "rec" and a microphone.
+ * See CaptureSource::create().
+ */
+class FakeRecFixture
+{
+public:
+	int64_t m_nBytesPerSecond = 10 * 1000 * 1000;
+	int64_t m_nFailAfterBytes = -1; // never if negative
+	int64_t m_nStallAfterBytes = -1; // never if negative
+	int32_t m_nStallSeconds = 10;
+	int32_t m_nXrunEveryPeriods = 0; // never if 0
+
+	/** The value for SonoModel::Init::m_sCaptureSource.
+	 * @return The source string.
+	 */
+	std::string getCaptureSource() const
+	{
+		std::string sSource = "fake:rate=" + std::to_string(m_nBytesPerSecond);
+		if (m_nFailAfterBytes >= 0) {
+			sSource += ",fail=" + std::to_string(m_nFailAfterBytes);
+		}
+		if (m_nStallAfterBytes >= 0) {
+			sSource += ",stall=" + std::to_string(m_nStallAfterBytes);
+			sSource += ",stallsec=" + std::to_string(m_nStallSeconds);
+		}
+		if (m_nXrunEveryPeriods > 0) {
+			sSource += ",xrun=" + std::to_string(m_nXrunEveryPeriods);
+		}
+		return sSource;
+	}
+};
+
+} // namespace testing
+} // namespace sono
+
+#endif	/* SONOREM_FAKE_REC_FIXTURE_H_ */
@@ -0,0 +1,121 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testChildSupervisor.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "childsupervisor.h"
+
+#include "mainloopfixture.h"
+#include "fixtureGlib.h"
+
+#include <glibmm.h>
+
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+
+namespace sono
+{
+
+namespace testing
+{
+
+static Glib::Pid spawnChild(const std::vector<std::string>& aArgv)
+{
+	Glib::Pid oPid;
+	// The runner might ignore SIGINT (background job), the child would inherit it
+	Glib::spawn_async("/tmp", aArgv, Glib::SPAWN_SEARCH_PATH | Glib::SPAWN_DO_NOT_REAP_CHILD
+					, []() { ::signal(SIGINT, SIG_DFL); }, &oPid);
+	return oPid;
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "ChildSupervisorExited")
+{
+	ChildSupervisor oSupervisor;
+	int32_t nExited = 0;
+	int nTrueStatus = -1;
+	int nKilledStatus = -1;
+
+	const Glib::Pid oTruePid = spawnChild({"true"});
+	oSupervisor.watch(oTruePid, [&](Glib::Pid oPid, int nWaitStatus)
+	{
+		REQUIRE(oPid == oTruePid);
+		// already reaped
+		REQUIRE_FALSE(oSupervisor.isWatched(oPid));
+		nTrueStatus = nWaitStatus;
+		++nExited;
+	});
+	// Like rec interrupted by the user
+	const Glib::Pid oKilledPid = spawnChild({"sh", "-c", "kill -INT $$"});
+	oSupervisor.watch(oKilledPid, [&](Glib::Pid oPid, int nWaitStatus)
+	{
+		REQUIRE(oPid == oKilledPid);
+		nKilledStatus = nWaitStatus;
+		++nExited;
+	});
+	REQUIRE(oSupervisor.getTotWatched() == 2);
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nExited < 2) && (nTicks < 100);
+	}, 50);
+
+	REQUIRE(nExited == 2);
+	REQUIRE(oSupervisor.getTotWatched() == 0);
+	REQUIRE(WIFEXITED(nTrueStatus));
+	REQUIRE(WEXITSTATUS(nTrueStatus) == 0);
+	REQUIRE(WIFSIGNALED(nKilledStatus));
+	REQUIRE(WTERMSIG(nKilledStatus) == SIGINT);
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "ChildSupervisorWaitAll")
+{
+	ChildSupervisor oSupervisor;
+	int32_t nExited = 0;
+	const Glib::Pid oPid = spawnChild({"sleep", "0.2"});
+	oSupervisor.watch(oPid, [&](Glib::Pid /*oPid*/, int /*nWaitStatus*/)
+	{
+		++nExited;
+	});
+	REQUIRE(oSupervisor.isWatched(oPid));
+	oSupervisor.waitAll();
+	REQUIRE(oSupervisor.getTotWatched() == 0);
+	// The slot is not called
+	REQUIRE(nExited == 0);
+	// The main loop doesn't report it either
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nTicks < 5);
+	}, 50);
+	REQUIRE(nExited == 0);
+}
+
+} // namespace testing
+
+} // namespace sono
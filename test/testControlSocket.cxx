@@ -0,0 +1,105 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testControlSocket.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "controlsocket.h"
+
+#include "mainloopfixture.h"
+#include "fixtureGlib.h"
+
+#include <glibmm.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+namespace sono
+{
+
+namespace testing
+{
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "ControlSocketSingleInstance")
+{
+	// Not the name used by a possibly running sonorem
+	const std::string sName = "sonoremtest" + std::to_string(::getpid());
+	ControlSocket oSocket1;
+	bool bAlreadyBound = true;
+	std::string sError = oSocket1.listen(sName, bAlreadyBound);
+	REQUIRE(sError.empty());
+	REQUIRE_FALSE(bAlreadyBound);
+	REQUIRE(oSocket1.isListening());
+
+	ControlSocket oSocket2;
+	sError = oSocket2.listen(sName, bAlreadyBound);
+	REQUIRE_FALSE(sError.empty());
+	REQUIRE(bAlreadyBound);
+	REQUIRE_FALSE(oSocket2.isListening());
+
+	std::string sReply;
+	sError = ControlSocket::send(sName + "none", "status", sReply);
+	REQUIRE_FALSE(sError.empty());
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "ControlSocketCommand")
+{
+	const std::string sName = "sonoremtest" + std::to_string(::getpid());
+	ControlSocket oSocket;
+	bool bAlreadyBound = true;
+	const std::string sError = oSocket.listen(sName, bAlreadyBound);
+	REQUIRE(sError.empty());
+	std::string sReceived;
+	oSocket.m_oCommandSignal.connect([&](const std::string& sCommand) -> std::string
+	{
+		sReceived = sCommand;
+		return "Done " + sCommand;
+	});
+
+	// send() blocks until the main loop replies
+	std::string sSendError;
+	std::string sReply;
+	std::atomic<bool> bSent{false};
+	std::thread oThread([&]()
+	{
+		sSendError = ControlSocket::send(sName, "stop\n", sReply);
+		bSent = true;
+	});
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (! bSent) && (nTicks < 100);
+	}, 50);
+	oThread.join();
+
+	REQUIRE(sSendError.empty());
+	REQUIRE(sReceived == "stop");
+	REQUIRE(sReply == "Done stop");
+}
+
+} // namespace testing
+
+} // namespace sono
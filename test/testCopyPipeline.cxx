@@ -0,0 +1,165 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testCopyPipeline.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "sonomodel.h"
+#include "jobjournal.h"
+
+#include "fakerecfixture.h"
+#include "mainloopfixture.h"
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <glibmm.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace sono
+{
+
+using std::unique_ptr;
+
+namespace testing
+{
+
+class TestSonoModel : public SonoModel
+{
+public:
+	using SonoModel::SonoModel;
+	using SonoModel::init;
+	using SonoModel::getStartableCopies;
+	using SonoModel::getSmoothedBytesPerSecond;
+	using SonoModel::getCopyEtaSeconds;
+};
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "CopyPipelineParallel")
+{
+	// Three sticks, four planned recordings, the last fits nowhere
+	const std::vector<std::string> aPlanned{"/media/a", "/media/b", "/media/a", "/media/c", ""};
+	// One copy per stick at the same time
+	REQUIRE(TestSonoModel::getStartableCopies(aPlanned, {}, 3) == std::vector<int32_t>({0, 1, 3}));
+	// The limit leaves some of the sticks idle
+	REQUIRE(TestSonoModel::getStartableCopies(aPlanned, {}, 2) == std::vector<int32_t>({0, 1}));
+	// A stick being copied to or probed waits for its turn
+	REQUIRE(TestSonoModel::getStartableCopies(aPlanned, {"/media/a"}, 2) == std::vector<int32_t>({1, 3}));
+	REQUIRE(TestSonoModel::getStartableCopies(aPlanned, {"/media/a", "/media/b", "/media/c"}, 2).empty());
+	REQUIRE(TestSonoModel::getStartableCopies(aPlanned, {}, 0).empty());
+	REQUIRE(TestSonoModel::getStartableCopies({"", ""}, {}, 2).empty());
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "CopyPipelineProgress")
+{
+	// The first measure is taken as is
+	double fSmoothed = TestSonoModel::getSmoothedBytesPerSecond(0.0, 1000.0);
+	REQUIRE(fSmoothed == Approx(1000.0));
+	// A spike only moves the average part of the way
+	fSmoothed = TestSonoModel::getSmoothedBytesPerSecond(fSmoothed, 5000.0);
+	REQUIRE(fSmoothed > 1000.0);
+	REQUIRE(fSmoothed < 5000.0);
+	// and it converges
+	for (int32_t nCount = 0; nCount < 100; ++nCount) {
+		fSmoothed = TestSonoModel::getSmoothedBytesPerSecond(fSmoothed, 2000.0);
+	}
+	REQUIRE(fSmoothed == Approx(2000.0));
+
+	REQUIRE(TestSonoModel::getCopyEtaSeconds(1000, 21000, 2000, false) == 10);
+	REQUIRE(TestSonoModel::getCopyEtaSeconds(21000, 21000, 2000, false) == 0);
+	// Not known
+	REQUIRE(TestSonoModel::getCopyEtaSeconds(1000, -1, 2000, false) == -1);
+	REQUIRE(TestSonoModel::getCopyEtaSeconds(1000, 21000, 0, false) == -1);
+	// The recording still grows
+	REQUIRE(TestSonoModel::getCopyEtaSeconds(1000, 21000, 2000, true) == -1);
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "CopyPipelineScheduledOnSegmentEnd")
+{
+	TempDir oDir("sonoremtest");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sJournalPath = sDirPath + "/sonorem.journal";
+	const std::string sQueuedLineStart = std::string{JobJournal::getStateName(JobJournal::STATE_QUEUED)} + " ";
+
+	// No need for rec and a microphone
+	FakeRecFixture oFakeRec;
+	oFakeRec.m_nBytesPerSecond = 100 * 1000;
+	unique_ptr<TestSonoModel> refSonoModel;
+	{
+		SonoModel::Init oInit;
+		oInit.m_bExcludeAllMountNames = true;
+		oInit.m_bRfkillBluetoothOff = true;
+		oInit.m_bRfkillWifiOff = true;
+		oInit.m_sRecordingDirPath = sDirPath;
+		// Tests can run in parallel and next to a running sonorem
+		oInit.m_sControlSocketName = "sonoremtest" + std::to_string(::getpid());
+		oInit.m_nMaxFileSizeBytes = 1000 * 1000;
+		oInit.m_nMaxRecordingDurationSeconds = 1;
+		oInit.m_nMinFreeSpaceBytes = 2 * 1000 * 1000;
+		oInit.m_sCaptureSource = oFakeRec.getCaptureSource();
+		refSonoModel = std::make_unique<TestSonoModel>([](const std::string&){});
+		const std::string sError = refSonoModel->init(std::move(oInit));
+		if (! sError.empty()) {
+			std::cout << "Could not create model: " << sError << '\n';
+		}
+		REQUIRE(sError.empty());
+	}
+	refSonoModel->startRecording();
+	REQUIRE(refSonoModel->getState() == SonoModel::STATE_RECORDING);
+
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point oQueuedTime;
+	bool bQueued = false;
+	bool bJournaled = false;
+	int64_t nJournaledMillisec = -1;
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		if (! bQueued) {
+			if (refSonoModel->getNrToBeCopiedRecordings() > 0) {
+				bQueued = true;
+				oQueuedTime = Clock::now();
+			}
+		} else {
+			// The pipeline runs (and flushes the journal) right after a segment is queued,
+			// not when the retry timer fires
+			const std::string sContents = Glib::file_get_contents(sJournalPath);
+			bJournaled = (sContents.find(sQueuedLineStart) != std::string::npos);
+			nJournaledMillisec = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - oQueuedTime).count();
+		}
+		return (! bJournaled) && (nTicks < 200);
+	}, 50);
+
+	refSonoModel->stopRecording();
+	REQUIRE(bQueued);
+	REQUIRE(bJournaled);
+	REQUIRE(nJournaledMillisec < 2000);
+	refSonoModel.reset();
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,71 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testCopyPlan.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "sonomodel.h"
+
+#include "fixtureGlib.h"
+
+#include <vector>
+
+namespace sono
+{
+
+namespace testing
+{
+
+class TestSonoModel : public SonoModel
+{
+public:
+	using SonoModel::getBestFitMountIdx;
+};
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "CopyPlanBestFitWithinClass")
+{
+	// The first two mounts are equally fast, the third is slower
+	const std::vector<int32_t> aMountClasses{0, 0, 1};
+	const std::vector<int64_t> aAvailableBytes{100, 50, 20};
+	// The fuller of the fast mounts
+	REQUIRE(TestSonoModel::getBestFitMountIdx(aAvailableBytes, aMountClasses, 30) == 1);
+	// Not the slower mount even if it fits best
+	REQUIRE(TestSonoModel::getBestFitMountIdx(aAvailableBytes, aMountClasses, 10) == 1);
+	REQUIRE(TestSonoModel::getBestFitMountIdx(aAvailableBytes, aMountClasses, 60) == 0);
+	REQUIRE(TestSonoModel::getBestFitMountIdx(aAvailableBytes, aMountClasses, 101) == -1);
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "CopyPlanNextClass")
+{
+	const std::vector<int32_t> aMountClasses{0, 0, 1, 1, 2};
+	// The second mount can't be copied to
+	const std::vector<int64_t> aAvailableBytes{10, -1, 80, 40, 35};
+	// The fast mounts are too full
+	REQUIRE(TestSonoModel::getBestFitMountIdx(aAvailableBytes, aMountClasses, 30) == 3);
+	REQUIRE(TestSonoModel::getBestFitMountIdx(aAvailableBytes, aMountClasses, 50) == 2);
+	REQUIRE(TestSonoModel::getBestFitMountIdx(aAvailableBytes, aMountClasses, 0) == 0);
+	// On a tie the first (better sorted) mount
+	REQUIRE(TestSonoModel::getBestFitMountIdx({40, 40}, {0, 0}, 20) == 0);
+	REQUIRE(TestSonoModel::getBestFitMountIdx({}, {}, 20) == -1);
+}
+
+} // namespace testing
+
+} // namespace sono
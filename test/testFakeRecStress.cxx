@@ -0,0 +1,166 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFakeRecStress.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "sonomodel.h"
+#include "util.h"
+
+#include "fakerecfixture.h"
+#include "fsfakerfixture.h"
+#include "mainloopfixture.h"
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <fspropfaker/fspropfaker.h>
+
+#include <unistd.h>
+
+
+namespace sono
+{
+
+using std::shared_ptr;
+using std::unique_ptr;
+using std::make_unique;
+
+namespace testing
+{
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "SonoModelFakeRecStress")
+{
+	FsFakerFixture oFFF("sonoremtest");
+
+	auto& refFaker = oFFF.m_refFaker;
+	const auto nBlockSize = refFaker->getBlockSize();
+
+	// if something goes wrong you will probably need to fusermount -u manually
+	std::cout << "Mount path is " << refFaker->getMountPath() << '\n';
+
+	constexpr int64_t nMegaByte = fspf::FsPropFaker::s_nMegaByteBytes;
+	refFaker->setFakeDiskFreeSizeInBlocks(1000 * nMegaByte / nBlockSize);
+	::sleep(1);
+
+	// Many times real time, the recording crashes after 35MB
+	FakeRecFixture oFakeRec;
+	oFakeRec.m_nBytesPerSecond = 50 * nMegaByte;
+	oFakeRec.m_nFailAfterBytes = 35 * nMegaByte;
+	constexpr int64_t nMaxFileSizeBytes = 10 * nMegaByte;
+
+	class TestSonoModel : public SonoModel
+	{
+	public:
+		using SonoModel::SonoModel;
+		using SonoModel::init;
+		using SonoModel::matchRecordingFileName;
+	};
+	int32_t nFailures = 0;
+	std::string sError;
+	unique_ptr<TestSonoModel> refSonoModel;
+	auto oInitModel = [&]()
+	{
+		SonoModel::Init oInit;
+		oInit.m_bExcludeAllMountNames = true;
+		oInit.m_sRecordingDirPath = oFFF.getFakeFsPath();
+		// Tests can run in parallel and next to a running sonorem
+		oInit.m_sControlSocketName = "sonoremtest" + std::to_string(::getpid());
+		oInit.m_nMaxFileSizeBytes = nMaxFileSizeBytes;
+		oInit.m_nMaxRecordingDurationSeconds = 60 * 60;
+		oInit.m_nMinFreeSpaceBytes = 100 * nMegaByte;
+		oInit.m_sCaptureSource = oFakeRec.getCaptureSource();
+		refSonoModel = std::make_unique<TestSonoModel>([&](const std::string& sStr)
+		{
+			if (sStr.substr(0, 16) == "Recording failed") {
+				++nFailures;
+			}
+		});
+		sError = refSonoModel->init(std::move(oInit));
+		if (! sError.empty()) {
+			std::cout << "Could not create model: " << sError << '\n';
+		}
+		REQUIRE(sError.empty());
+		REQUIRE(refSonoModel->getRecordingFileExt() == "wav");
+	};
+	MainLoopFixture oMainLoop;
+	const int32_t nTestIntervalMillisec = 100;
+	// 4 seconds of recording
+	const int32_t nRecordingTicks = 40;
+	int32_t nProgress = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		const bool bContinue = true;
+		++nProgress;
+		if (nProgress == 1) {
+			oInitModel();
+		} else if (nProgress == 2) {
+			REQUIRE(refSonoModel->getState() == SonoModel::STATE_STOPPED);
+			refSonoModel->startRecording();
+			REQUIRE(refSonoModel->getState() == SonoModel::STATE_RECORDING);
+		} else if (nProgress < 2 + nRecordingTicks) {
+			// crashes restart the recording
+			REQUIRE(refSonoModel->getState() == SonoModel::STATE_RECORDING);
+		} else if (nProgress == 2 + nRecordingTicks) {
+			refSonoModel->stopRecording();
+			REQUIRE(refSonoModel->getState() == SonoModel::STATE_STOPPED);
+		} else if (refSonoModel->getNrWaitingForKilledProcesses() > 0) {
+			// The last segment is finished in the background
+			REQUIRE(nProgress < 2 + nRecordingTicks + 50);
+		} else {
+			return ! bContinue;
+		}
+		return bContinue;
+	}, nTestIntervalMillisec);
+
+	REQUIRE(nFailures >= 2);
+
+	Glib::Dir oDir(oFFF.getRealFsPath());
+	int32_t nGeneratedRecordings = 0;
+	int64_t nTotDataBytes = 0;
+	for (const auto& sFileName : oDir) {
+		const std::string sFilePath = oFFF.getRealFsPath() + "/" + sFileName;
+		if (Glib::file_test(sFilePath, Glib::FILE_TEST_IS_DIR)) {
+			continue;
+		}
+		if (sFileName.compare(0, 8, "sonorem.") == 0) {
+			// control files (journal, speeds)
+			continue;
+		}
+		REQUIRE(refSonoModel->matchRecordingFileName(sFileName));
+		++nGeneratedRecordings;
+		const int64_t nDataBytes = getWavDataBytes(sFilePath);
+		REQUIRE(nDataBytes >= 0);
+		REQUIRE(nDataBytes + 44 <= nMaxFileSizeBytes);
+		nTotDataBytes += nDataBytes;
+	}
+	std::cout << "Recordings: " << nGeneratedRecordings << "  Total bytes: " << nTotDataBytes << '\n';
+	// at least the bytes of two failed sessions
+	REQUIRE(nTotDataBytes >= 2 * oFakeRec.m_nFailAfterBytes);
+	REQUIRE(nGeneratedRecordings >= 8);
+	REQUIRE(refSonoModel->getNrToBeCopiedRecordings() == nGeneratedRecordings);
+
+	refSonoModel.reset();
+	sError = refFaker->unmount();
+	REQUIRE(sError.empty());
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,279 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFileCopier.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "filecopier.h"
+
+#include "mainloopfixture.h"
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <fstream>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+using std::unique_ptr;
+
+namespace testing
+{
+
+static std::string createTestFile(const std::string& sPath, int64_t nBytes)
+{
+	std::ofstream oOut(sPath, std::ios::binary | std::ios::trunc);
+	uint32_t nValue = 12345;
+	for (int64_t nIdx = 0; nIdx < nBytes; ++nIdx) {
+		nValue = nValue * 1103515245 + 12345;
+		oOut.put(static_cast<char>(nValue >> 16));
+	}
+	return (oOut.good() ? "" : "Could not write " + sPath);
+}
+static bool sameContent(const std::string& sPath1, const std::string& sPath2)
+{
+	std::ifstream oIn1(sPath1, std::ios::binary);
+	std::ifstream oIn2(sPath2, std::ios::binary);
+	const std::string sContent1{std::istreambuf_iterator<char>(oIn1), std::istreambuf_iterator<char>()};
+	const std::string sContent2{std::istreambuf_iterator<char>(oIn2), std::istreambuf_iterator<char>()};
+	return oIn1.good() && oIn2.good() && (sContent1 == sContent2);
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "FileCopierCopy")
+{
+	TempDir oDir("sonoremcopier");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFromPath = sDirPath + "/from.wav";
+	const std::string sToPath = sDirPath + "/to.wav";
+
+	// More than one chunk and not a multiple of the chunk size
+	constexpr int64_t nFileBytes = 20 * 1000 * 1000 + 17;
+	REQUIRE(createTestFile(sFromPath, nFileBytes).empty());
+
+	auto refCopier = std::make_unique<FileCopier>(sFromPath, sToPath);
+	int32_t nProgress = 0;
+	int32_t nFinished = 0;
+	refCopier->m_oProgressSignal.connect([&]()
+	{
+		++nProgress;
+	});
+	refCopier->m_oFinishedSignal.connect([&]()
+	{
+		++nFinished;
+	});
+	refCopier->start();
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nFinished == 0) && (nTicks < 100);
+	}, 100);
+
+	REQUIRE(nFinished == 1);
+	REQUIRE(refCopier->isFinished());
+	REQUIRE(refCopier->getError().empty());
+	REQUIRE(refCopier->getMethod() != FileCopier::METHOD_NONE);
+	REQUIRE(refCopier->getTotalBytes() == nFileBytes);
+	REQUIRE(refCopier->getCopiedBytes() == nFileBytes);
+	REQUIRE(sameContent(sFromPath, sToPath));
+
+	refCopier.reset();
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "FileCopierCancel")
+{
+	TempDir oDir("sonoremcopier");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFromPath = sDirPath + "/from.wav";
+	const std::string sToPath = sDirPath + "/to.wav";
+
+	constexpr int64_t nFileBytes = 100 * 1000 * 1000;
+	REQUIRE(createTestFile(sFromPath, nFileBytes).empty());
+
+	auto refCopier = std::make_unique<FileCopier>(sFromPath, sToPath);
+	int32_t nFinished = 0;
+	refCopier->m_oFinishedSignal.connect([&]()
+	{
+		++nFinished;
+	});
+	refCopier->start();
+	refCopier->cancel();
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nFinished == 0) && (nTicks < 100);
+	}, 100);
+
+	REQUIRE(nFinished == 1);
+	REQUIRE_FALSE(refCopier->getError().empty());
+	// the partial copy was removed
+	REQUIRE_FALSE(fileExists(sToPath));
+
+	refCopier.reset();
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "FileCopierResume")
+{
+	TempDir oDir("sonoremcopier");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFromPath = sDirPath + "/from.wav";
+	const std::string sToPath = sDirPath + "/to.wav";
+
+	constexpr int64_t nFileBytes = 20 * 1000 * 1000;
+	REQUIRE(createTestFile(sFromPath, nFileBytes).empty());
+	// An interrupted copy: the first 12MB of which the part after 9MB never reached the device
+	constexpr int64_t nCorruptOffset = 9 * 1000 * 1000;
+	{
+		std::ifstream oIn(sFromPath, std::ios::binary);
+		std::string sPartial(12 * 1000 * 1000, '\0');
+		oIn.read(&sPartial[0], sPartial.size());
+		REQUIRE(oIn.good());
+		std::fill(sPartial.begin() + nCorruptOffset, sPartial.end(), '\0');
+		// the header doesn't need to be equal
+		sPartial.replace(0, 4, "XXXX");
+		std::ofstream oOut(sToPath, std::ios::binary | std::ios::trunc);
+		oOut.write(sPartial.data(), sPartial.size());
+		REQUIRE(oOut.good());
+	}
+
+	auto refCopier = std::make_unique<FileCopier>(sFromPath, sToPath, false, true);
+	int32_t nFinished = 0;
+	refCopier->m_oFinishedSignal.connect([&]()
+	{
+		++nFinished;
+	});
+	refCopier->start();
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nFinished == 0) && (nTicks < 100);
+	}, 100);
+
+	REQUIRE(nFinished == 1);
+	REQUIRE(refCopier->getError().empty());
+	REQUIRE(refCopier->getResumedBytes() > 0);
+	REQUIRE(refCopier->getResumedBytes() <= nCorruptOffset);
+	REQUIRE(refCopier->getCopiedBytes() == nFileBytes);
+	REQUIRE(sameContent(sFromPath, sToPath));
+
+	// Canceling keeping the partial copy
+	refCopier = std::make_unique<FileCopier>(sFromPath, sToPath);
+	nFinished = 0;
+	refCopier->m_oFinishedSignal.connect([&]()
+	{
+		++nFinished;
+	});
+	refCopier->start();
+	refCopier->cancel(true);
+	nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nFinished == 0) && (nTicks < 100);
+	}, 100);
+
+	REQUIRE(nFinished == 1);
+	REQUIRE_FALSE(refCopier->getError().empty());
+	REQUIRE(fileExists(sToPath));
+
+	refCopier.reset();
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "FileCopierFollow")
+{
+	TempDir oDir("sonoremcopier");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sDataPath = sDirPath + "/data.wav";
+	const std::string sFromPath = sDirPath + "/from.wav";
+	const std::string sToPath = sDirPath + "/to.wav";
+
+	constexpr int64_t nFileBytes = 10 * 1000 * 1000 + 3;
+	REQUIRE(createTestFile(sDataPath, nFileBytes).empty());
+	std::string sData;
+	{
+		std::ifstream oIn(sDataPath, std::ios::binary);
+		sData.assign(std::istreambuf_iterator<char>(oIn), std::istreambuf_iterator<char>());
+	}
+	REQUIRE(static_cast<int64_t>(sData.size()) == nFileBytes);
+
+	// The source doesn't exist yet, like a recording that is about to start
+	auto refCopier = std::make_unique<FileCopier>(sFromPath, sToPath, true);
+	int32_t nFinished = 0;
+	refCopier->m_oFinishedSignal.connect([&]()
+	{
+		++nFinished;
+	});
+	refCopier->start();
+	REQUIRE(refCopier->isFollowing());
+
+	std::ofstream oOut;
+	int64_t nWrittenBytes = 0;
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		if (nTicks == 3) {
+			oOut.open(sFromPath, std::ios::binary | std::ios::trunc);
+		}
+		if ((nTicks >= 3) && (nWrittenBytes < nFileBytes)) {
+			// grows in 5 steps
+			const int64_t nBytes = std::min<int64_t>(nFileBytes / 5 + 1, nFileBytes - nWrittenBytes);
+			oOut.write(sData.data() + nWrittenBytes, nBytes);
+			oOut.flush();
+			nWrittenBytes += nBytes;
+		} else if (nWrittenBytes == nFileBytes) {
+			// rewrite the header as a recorder does when it finishes
+			oOut.seekp(0);
+			oOut.write("RIFF", 4);
+			oOut.close();
+			refCopier->finishFollowing();
+			++nWrittenBytes;
+		}
+		return (nFinished == 0) && (nTicks < 200);
+	}, 100);
+
+	REQUIRE(nFinished == 1);
+	REQUIRE_FALSE(refCopier->isFollowing());
+	REQUIRE(refCopier->getError().empty());
+	REQUIRE(refCopier->getTotalBytes() == nFileBytes);
+	REQUIRE(sameContent(sFromPath, sToPath));
+
+	refCopier.reset();
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,93 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFileSyncer.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "filesyncer.h"
+
+#include "mainloopfixture.h"
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <fstream>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+using std::unique_ptr;
+
+namespace testing
+{
+
+static std::string runSyncer(const std::vector<std::string>& aFilePaths)
+{
+	auto refSyncer = std::make_unique<FileSyncer>(aFilePaths);
+	int32_t nFinished = 0;
+	refSyncer->m_oFinishedSignal.connect([&]()
+	{
+		++nFinished;
+	});
+	refSyncer->start();
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nFinished == 0) && (nTicks < 100);
+	}, 100);
+
+	REQUIRE(nFinished == 1);
+	REQUIRE(refSyncer->isFinished());
+	return refSyncer->getError();
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "FileSyncerSync")
+{
+	TempDir oDir("sonoremsyncer");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFile1Path = sDirPath + "/file1.wav";
+	const std::string sFile2Path = sDirPath + "/file2.wav";
+	{
+		std::ofstream oOut1(sFile1Path, std::ios::binary | std::ios::trunc);
+		oOut1 << "RIFF1";
+		std::ofstream oOut2(sFile2Path, std::ios::binary | std::ios::trunc);
+		oOut2 << "RIFF2";
+	}
+	// fdatasync
+	REQUIRE(runSyncer({sFile1Path}).empty());
+	// syncfs
+	REQUIRE(runSyncer({sFile1Path, sFile2Path}).empty());
+
+	::unlink(sFile2Path.c_str());
+	// the error tells which file is missing
+	const std::string sError = runSyncer({sFile1Path, sFile2Path});
+	REQUIRE_FALSE(sError.empty());
+	REQUIRE(sError.find(sFile2Path) != std::string::npos);
+}
+
+} // namespace testing
+
+} // namespace sono
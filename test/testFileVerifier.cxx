@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFileVerifier.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "fileverifier.h"
+#include "filecopier.h"
+#include "util.h"
+
+#include "mainloopfixture.h"
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <glibmm.h>
+
+#include <cstdio>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+namespace testing
+{
+
+static std::string runVerifier(const std::string& sFilePath)
+{
+	auto refVerifier = std::make_unique<FileVerifier>(sFilePath);
+	int32_t nFinished = 0;
+	refVerifier->m_oFinishedSignal.connect([&]()
+	{
+		++nFinished;
+	});
+	refVerifier->start();
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nFinished == 0) && (nTicks < 100);
+	}, 100);
+
+	REQUIRE(nFinished == 1);
+	REQUIRE(refVerifier->isFinished());
+	return refVerifier->getError();
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "FileVerifierCorruptByte")
+{
+	TempDir oDir("sonoremverifier");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFilePath = sDirPath + "/20200724-085905-317.wav";
+	const std::string sChecksumFilePath = FileCopier::getChecksumFilePath(sFilePath);
+
+	std::string sContent;
+	for (int32_t nIdx = 0; nIdx < 100000; ++nIdx) {
+		sContent += static_cast<char>(nIdx % 251);
+	}
+	Glib::file_set_contents(sFilePath, sContent);
+	// No sidecar
+	REQUIRE_FALSE(runVerifier(sFilePath).empty());
+
+	char aChecksum[16];
+	std::snprintf(aChecksum, sizeof(aChecksum), "%08x", crc32c(0, sContent.data(), sContent.size()));
+	Glib::file_set_contents(sChecksumFilePath, std::string{aChecksum} + "  " + Glib::path_get_basename(sFilePath) + "\n");
+	REQUIRE(runVerifier(sFilePath).empty());
+
+	// A single byte in the middle
+	sContent[sContent.size() / 2] ^= 0x01;
+	Glib::file_set_contents(sFilePath, sContent);
+	const std::string sError = runVerifier(sFilePath);
+	REQUIRE(sError.find("mismatch") != std::string::npos);
+}
+
+} // namespace testing
+
+} // namespace sono
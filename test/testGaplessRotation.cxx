@@ -0,0 +1,217 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testGaplessRotation.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "sonomodel.h"
+#include "util.h"
+
+#include "fsfakerfixture.h"
+#include "mainloopfixture.h"
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <fspropfaker/fspropfaker.h>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+using std::shared_ptr;
+using std::unique_ptr;
+using std::make_unique;
+
+namespace testing
+{
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "SonoModelGaplessRotation")
+{
+	// Needs the sox tools and a sound device to record from
+	if (Glib::find_program_in_path("rec").empty() || Glib::find_program_in_path("soxi").empty()) {
+		WARN("Skipped: rec or soxi not installed");
+		return; //--------------------------------------------------------------
+	}
+	{
+		std::string sResult;
+		std::string sCmdError;
+		if (! execCmd("rec -q -n trim 0 0.1", sResult, sCmdError)) {
+			WARN("Skipped: no sound device to record from");
+			return; //----------------------------------------------------------
+		}
+	}
+	FsFakerFixture oFFF("sonoremtest");
+
+	auto& refFaker = oFFF.m_refFaker;
+	const auto nBlockSize = refFaker->getBlockSize();
+
+	// if something goes wrong you will probably need to fusermount -u manually
+	std::cout << "Mount path is " << refFaker->getMountPath() << '\n';
+
+	constexpr int64_t nMegaByte = fspf::FsPropFaker::s_nMegaByteBytes;
+	refFaker->setFakeDiskFreeSizeInBlocks(500 * nMegaByte / nBlockSize);
+	::sleep(1);
+
+	class TestSonoModel : public SonoModel
+	{
+	public:
+		using SonoModel::SonoModel;
+		using SonoModel::init;
+		using SonoModel::matchRecordingFileName;
+	};
+	std::string sError;
+	unique_ptr<TestSonoModel> refSonoModel;
+	auto oInitModel = [&]()
+	{
+		SonoModel::Init oInit;
+		oInit.m_bExcludeAllMountNames = true;
+		oInit.m_sRecordingDirPath = oFFF.getFakeFsPath();
+		// Tests can run in parallel and next to a running sonorem
+		oInit.m_sControlSocketName = "sonoremtest" + std::to_string(::getpid());
+		oInit.m_sRecordingFileExt = "wav";
+		oInit.m_nMaxFileSizeBytes = 100 * nMegaByte;
+		oInit.m_nMaxRecordingDurationSeconds = 5;
+		oInit.m_nMinFreeSpaceBytes = 100 * nMegaByte;
+		oInit.m_bGaplessRotation = true;
+		refSonoModel = std::make_unique<TestSonoModel>([](const std::string&){});
+		sError = refSonoModel->init(std::move(oInit));
+		if (! sError.empty()) {
+			std::cout << "Could not create model: " << sError << '\n';
+		}
+		REQUIRE(sError.empty());
+	};
+	// Three switches of recording file
+	constexpr int32_t nRecordingMillisec = 12 * 1000;
+	constexpr int32_t nMaxWaitForProcessesMillisec = 6 * 1000;
+
+	using Clock = std::chrono::steady_clock;
+	auto oMillisecSince = [](const Clock::time_point& oTime) -> int64_t
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - oTime).count();
+	};
+	Clock::time_point oStartTime;
+	Clock::time_point oStopTime;
+	int32_t nSamplesWithoutRecording = 0;
+	int32_t nSamples = 0;
+
+	MainLoopFixture oMainLoop;
+	const int32_t nTestIntervalMillisec = 20;
+	int32_t nProgress = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		const bool bContinue = true;
+		if (nProgress == 0) {
+			oInitModel();
+			++nProgress;
+		} else if (nProgress == 1) {
+			REQUIRE(refSonoModel->getState() == SonoModel::STATE_STOPPED);
+			refSonoModel->startRecording();
+			REQUIRE(refSonoModel->getState() == SonoModel::STATE_RECORDING);
+			oStartTime = Clock::now();
+			++nProgress;
+		} else if (nProgress == 2) {
+			// While recording there must always be a running "rec"
+			++nSamples;
+			if (refSonoModel->getRecordingFilePath().empty()) {
+				++nSamplesWithoutRecording;
+			}
+			if (oMillisecSince(oStartTime) >= nRecordingMillisec) {
+				refSonoModel->stopRecording();
+				oStopTime = Clock::now();
+				++nProgress;
+			}
+		} else if (nProgress == 3) {
+			if ((refSonoModel->getNrWaitingForKilledProcesses() == 0)
+					|| (oMillisecSince(oStopTime) >= nMaxWaitForProcessesMillisec)) {
+				++nProgress;
+			}
+		} else {
+			return ! bContinue;
+		}
+		return bContinue;
+	}, nTestIntervalMillisec);
+
+	REQUIRE(refSonoModel->getNrWaitingForKilledProcesses() == 0);
+	REQUIRE(nSamples > 0);
+	REQUIRE(nSamplesWithoutRecording == 0);
+
+	// The recorded sound should cover the whole recording session
+	const double fSessionSeconds = std::chrono::duration_cast<std::chrono::milliseconds>(oStopTime - oStartTime).count() / 1000.0;
+	double fRecordedSeconds = 0.0;
+	// Each recording's start and end in seconds since the epoch
+	std::vector<std::pair<double, double>> aRecordingSpans;
+	Glib::Dir oDir(oFFF.getRealFsPath());
+	int32_t nGeneratedRecordings = 0;
+	for (const auto& sFileName : oDir) {
+		const std::string sFilePath = oFFF.getRealFsPath() + "/" + sFileName;
+		if (Glib::file_test(sFilePath, Glib::FILE_TEST_IS_DIR)) {
+			continue;
+		}
+		if (sFileName.compare(0, 8, "sonorem.") == 0) {
+			// control files (journal, speeds)
+			continue;
+		}
+		REQUIRE(refSonoModel->matchRecordingFileName(sFileName));
+		++nGeneratedRecordings;
+		std::string sResult;
+		std::string sCmdError;
+		const std::string sCmd = "soxi -D " + sFilePath;
+		const bool bOk = execCmd(sCmd.c_str(), sResult, sCmdError);
+		REQUIRE(bOk);
+		const double fDurationSeconds = Glib::Ascii::strtod(strStrip(sResult));
+		fRecordedSeconds += fDurationSeconds;
+		// The file was last written when its "rec" was stopped
+		struct stat oStat;
+		REQUIRE(::stat(sFilePath.c_str(), &oStat) == 0);
+		const double fEndSeconds = oStat.st_mtim.tv_sec + oStat.st_mtim.tv_nsec / 1000000000.0;
+		aRecordingSpans.emplace_back(fEndSeconds - fDurationSeconds, fEndSeconds);
+	}
+	const double fGapSeconds = fSessionSeconds - fRecordedSeconds;
+	std::cout << "Session: " << fSessionSeconds << " sec  Recorded: " << fRecordedSeconds << " sec"
+				<< "  Files: " << nGeneratedRecordings << "  Gap: " << fGapSeconds << " sec" << '\n';
+	REQUIRE(nGeneratedRecordings >= 3);
+	// Only the start latency of the first "rec" is allowed (overlaps give negative gaps)
+	REQUIRE(fGapSeconds < 0.5);
+	// A gap at one rotation could be hidden by the overlap at another: check each.
+	// The next file must start before the previous ends (negative gap), the
+	// tolerance covers the imprecision of the modification time
+	constexpr double fMaxRotationGapSeconds = 0.1;
+	std::sort(aRecordingSpans.begin(), aRecordingSpans.end());
+	for (size_t nIdx = 1; nIdx < aRecordingSpans.size(); ++nIdx) {
+		const double fRotationGapSeconds = aRecordingSpans[nIdx].first - aRecordingSpans[nIdx - 1].second;
+		std::cout << "Rotation " << nIdx << "  Gap: " << fRotationGapSeconds << " sec" << '\n';
+		REQUIRE(fRotationGapSeconds < fMaxRotationGapSeconds);
+	}
+
+	refSonoModel.reset();
+	sError = refFaker->unmount();
+	REQUIRE(sError.empty());
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,121 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testIoPool.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "iopool.h"
+
+#include "mainloopfixture.h"
+#include "fixtureGlib.h"
+
+#include <glibmm.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+namespace sono
+{
+
+namespace testing
+{
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "IoPoolCompletion")
+{
+	IoPool oPool(2);
+	auto refResult = std::make_shared<int32_t>(0);
+	int32_t nDone = 0;
+	bool bTimedOut = true;
+	const bool bPosted = oPool.post("/media/stick1", 5000, [refResult]()
+	{
+		*refResult = 77;
+	}, [&](bool bCurTimedOut)
+	{
+		++nDone;
+		bTimedOut = bCurTimedOut;
+	});
+	REQUIRE(bPosted);
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nDone == 0) && (nTicks < 100);
+	}, 20);
+
+	REQUIRE(nDone == 1);
+	REQUIRE_FALSE(bTimedOut);
+	REQUIRE(*refResult == 77);
+	REQUIRE_FALSE(oPool.isHung("/media/stick1"));
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "IoPoolHung")
+{
+	IoPool oPool(1);
+	std::string sHungKey;
+	oPool.m_oHungSignal.connect([&](const std::string& sKey)
+	{
+		sHungKey = sKey;
+	});
+	int32_t nTimedOut = 0;
+	int32_t nDone = 0;
+	auto oDone = [&](bool bTimedOut)
+	{
+		++nDone;
+		if (bTimedOut) {
+			++nTimedOut;
+		}
+	};
+	// Stands for a stick that doesn't answer
+	REQUIRE(oPool.post("/media/stick1", 200, []()
+	{
+		::usleep(2000 * 1000);
+	}, oDone));
+	// Queued behind the hung one for the same stick
+	REQUIRE(oPool.post("/media/stick1", 200, [](){}, oDone));
+	// Done by the worker that replaces the hung one
+	REQUIRE(oPool.post("/media/stick2", 200, [](){}, oDone));
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nDone < 3) && (nTicks < 100);
+	}, 20);
+
+	REQUIRE(nDone == 3);
+	REQUIRE(nTimedOut == 2);
+	REQUIRE(sHungKey == "/media/stick1");
+	REQUIRE(oPool.isHung("/media/stick1"));
+	REQUIRE_FALSE(oPool.isHung("/media/stick2"));
+	REQUIRE_FALSE(oPool.post("/media/stick1", 200, [](){}, oDone));
+
+	oPool.clearHung("/media/stick1");
+	REQUIRE(oPool.post("/media/stick1", 200, [](){}, oDone));
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,117 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testJobJournal.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "jobjournal.h"
+
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <glibmm.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+using std::unique_ptr;
+
+namespace testing
+{
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "JobJournalReplay")
+{
+	TempDir oDir("sonoremjournal");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sJournalPath = sDirPath + "/sonorem.journal";
+
+	{
+		JobJournal oJournal(sJournalPath);
+		bool bExisted = true;
+		REQUIRE(oJournal.open(bExisted).empty());
+		REQUIRE_FALSE(bExisted);
+		oJournal.append("a.wav", JobJournal::STATE_RECORDING, "");
+		oJournal.append("b.wav", JobJournal::STATE_RECORDING, "");
+		oJournal.append("a.wav", JobJournal::STATE_QUEUED, "");
+		oJournal.append("a.wav", JobJournal::STATE_COPIED, "1234-ABCD");
+		REQUIRE(oJournal.flush().empty());
+		oJournal.append("b.wav", JobJournal::STATE_REMOVED, "");
+		// not flushed explicitly, the destructor does
+	}
+	// A crash while appending
+	{
+		const std::string sContents = Glib::file_get_contents(sJournalPath);
+		Glib::file_set_contents(sJournalPath, sContents + "synced 1234-AB");
+	}
+	{
+		JobJournal oJournal(sJournalPath);
+		bool bExisted = false;
+		REQUIRE(oJournal.open(bExisted).empty());
+		REQUIRE(bExisted);
+		const auto& aEntries = oJournal.getEntries();
+		REQUIRE(aEntries.size() == 1);
+		REQUIRE(aEntries[0].m_sFileName == "a.wav");
+		REQUIRE(aEntries[0].m_eState == JobJournal::STATE_COPIED);
+		REQUIRE(aEntries[0].m_sMountUUID == "1234-ABCD");
+		// rewritten compacted
+		REQUIRE(Glib::file_get_contents(sJournalPath) == "copied 1234-ABCD a.wav\n");
+		//
+		int32_t nCount = 0;
+		while (! oJournal.needsCompaction()) {
+			oJournal.append("c.wav", JobJournal::STATE_QUEUED, "");
+			++nCount;
+			REQUIRE(nCount < 10000);
+		}
+		REQUIRE(oJournal.flush().empty());
+		REQUIRE(oJournal.compact().empty());
+		REQUIRE_FALSE(oJournal.needsCompaction());
+		REQUIRE(oJournal.getEntries().size() == 2);
+		oJournal.append("c.wav", JobJournal::STATE_VERIFIED, "");
+	}
+	{
+		JobJournal oJournal(sJournalPath);
+		bool bExisted = false;
+		REQUIRE(oJournal.open(bExisted).empty());
+		const auto& aEntries = oJournal.getEntries();
+		REQUIRE(aEntries.size() == 2);
+		REQUIRE(aEntries[1].m_sFileName == "c.wav");
+		REQUIRE(aEntries[1].m_eState == JobJournal::STATE_VERIFIED);
+		REQUIRE(aEntries[1].m_sMountUUID.empty());
+		// A removed entry leaves a hole until compacted
+		oJournal.append("a.wav", JobJournal::STATE_REMOVED, "");
+		oJournal.append("d.wav", JobJournal::STATE_RECORDING, "");
+		oJournal.append("c.wav", JobJournal::STATE_REMOVED, "");
+		oJournal.append("c.wav", JobJournal::STATE_QUEUED, "");
+		REQUIRE(oJournal.getEntries().size() == 2);
+		REQUIRE(oJournal.getEntries()[0].m_sFileName == "d.wav");
+		REQUIRE(oJournal.compact().empty());
+		REQUIRE(Glib::file_get_contents(sJournalPath) == "recording - d.wav\nqueued - c.wav\n");
+		oJournal.append("d.wav", JobJournal::STATE_QUEUED, "");
+		REQUIRE(oJournal.getEntries()[0].m_eState == JobJournal::STATE_QUEUED);
+	}
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,156 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testLogWriter.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "logwriter.h"
+
+#include "testutil.h"
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+namespace testing
+{
+
+static std::vector<std::string> readLines(const std::string& sFilePath)
+{
+	std::vector<std::string> aLines;
+	std::ifstream oStream(sFilePath);
+	std::string sLine;
+	while (std::getline(oStream, sLine)) {
+		// Without the time
+		const auto nPos = sLine.find(' ');
+		aLines.push_back((nPos == std::string::npos) ? sLine : sLine.substr(nPos + 1));
+	}
+	return aLines;
+}
+
+TEST_CASE("LogWriterRepeated")
+{
+	TempDir oDir("sonoremlog");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sLogPath = sDirPath + "/sonorem.log";
+	{
+		LogWriter::Init oInit;
+		oInit.m_sFilePath = sLogPath;
+		LogWriter oWriter(std::move(oInit));
+		REQUIRE(oWriter.start().empty());
+		oWriter.log("Started");
+		oWriter.log("Waiting");
+		oWriter.log("Waiting");
+		oWriter.log("Waiting");
+		oWriter.log("");
+		oWriter.log("Stopped");
+		// The lines are written when stopped at the latest
+		oWriter.stop();
+		REQUIRE(oWriter.getTotDropped() == 0);
+	}
+	const auto aLines = readLines(sLogPath);
+	REQUIRE(aLines.size() == 4);
+	REQUIRE(aLines[0] == "Started");
+	REQUIRE(aLines[1] == "Waiting");
+	REQUIRE(aLines[2] == "Waiting  (x2)");
+	REQUIRE(aLines[3] == "Stopped");
+}
+
+TEST_CASE("LogWriterThreads")
+{
+	TempDir oDir("sonoremlog");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sLogPath = sDirPath + "/sonorem.log";
+	constexpr int32_t nTotThreads = 4;
+	constexpr int32_t nTotThreadLines = 1000;
+	{
+		LogWriter::Init oInit;
+		oInit.m_sFilePath = sLogPath;
+		oInit.m_nMaxFileBytes = 0;
+		LogWriter oWriter(std::move(oInit));
+		REQUIRE(oWriter.start().empty());
+		std::vector<std::thread> aThreads;
+		for (int32_t nThread = 0; nThread < nTotThreads; ++nThread) {
+			aThreads.emplace_back([&oWriter, nThread]()
+			{
+				for (int32_t nLine = 0; nLine < nTotThreadLines; ++nLine) {
+					oWriter.log("Thread " + std::to_string(nThread) + " line " + std::to_string(nLine));
+				}
+			});
+		}
+		for (auto& oThread : aThreads) {
+			oThread.join();
+		}
+		oWriter.stop();
+		// Fits in the queue
+		REQUIRE(oWriter.getTotDropped() == 0);
+	}
+	const auto aLines = readLines(sLogPath);
+	REQUIRE(aLines.size() == nTotThreads * nTotThreadLines);
+	// The order of the lines of a thread is kept
+	std::vector<int32_t> aNextLine(nTotThreads, 0);
+	for (const auto& sLine : aLines) {
+		int nThread = -1;
+		int nLine = -1;
+		REQUIRE(::sscanf(sLine.c_str(), "Thread %d line %d", &nThread, &nLine) == 2);
+		REQUIRE(nLine == aNextLine[nThread]);
+		++aNextLine[nThread];
+	}
+}
+
+TEST_CASE("LogWriterRotation")
+{
+	TempDir oDir("sonoremlog");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sLogPath = sDirPath + "/sonorem.log";
+	{
+		LogWriter::Init oInit;
+		oInit.m_sFilePath = sLogPath;
+		oInit.m_nMaxFileBytes = 100;
+		oInit.m_nTotRotatedFiles = 2;
+		LogWriter oWriter(std::move(oInit));
+		REQUIRE(oWriter.start().empty());
+		for (int32_t nBatch = 0; nBatch < 4; ++nBatch) {
+			oWriter.log("Batch " + std::to_string(nBatch) + " " + std::string(80, 'x'));
+			// Written in separate batches
+			::usleep(300 * 1000);
+		}
+	}
+	REQUIRE(readLines(sLogPath)[0].substr(0, 7) == "Batch 3");
+	REQUIRE(readLines(sLogPath + ".1")[0].substr(0, 7) == "Batch 2");
+	REQUIRE(readLines(sLogPath + ".2")[0].substr(0, 7) == "Batch 1");
+	// The oldest was overwritten
+	REQUIRE(::access((sLogPath + ".3").c_str(), F_OK) != 0);
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,140 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testMirrorWriter.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "mirrorwriter.h"
+
+#include "fixtureGlib.h"
+#include "testutil.h"
+
+#include <glibmm.h>
+
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+namespace testing
+{
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "MirrorWriterWrite")
+{
+	TempDir oDir("sonoremmirror");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFilePath = sDirPath + "/segment.wav";
+	const std::string sChecksumFilePath = sDirPath + "/segment.wav.crc32c";
+	{
+		MirrorWriter oWriter(1000);
+		REQUIRE(oWriter.start().empty());
+		oWriter.open(sFilePath);
+		REQUIRE(oWriter.write("defg", 4, 4));
+		// Rewriting the header
+		REQUIRE(oWriter.write("abcd", 4, 0));
+		bool bDone = false;
+		std::string sDoneError = "not called";
+		oWriter.close(sChecksumFilePath, "0000000a  segment.wav\n", [&](const std::string& sError)
+		{
+			bDone = true;
+			sDoneError = sError;
+		});
+		REQUIRE(oWriter.stop(-1));
+		REQUIRE(bDone);
+		REQUIRE(sDoneError.empty());
+		REQUIRE(oWriter.getWriteStats().m_nWrites == 2);
+	}
+	REQUIRE(Glib::file_get_contents(sFilePath) == "abcddefg");
+	REQUIRE(Glib::file_get_contents(sChecksumFilePath) == "0000000a  segment.wav\n");
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "MirrorWriterDropWhenTooSlow")
+{
+	TempDir oDir("sonoremmirror");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFilePath = sDirPath + "/segment.wav";
+	const std::string sChecksumFilePath = sDirPath + "/segment.wav.crc32c";
+	const std::string sNextFilePath = sDirPath + "/next.wav";
+	const std::string sData(200, 'x');
+	{
+		MirrorWriter oWriter(100);
+		REQUIRE(oWriter.start().empty());
+		oWriter.open(sFilePath);
+		REQUIRE(oWriter.write(sData.data(), 50, 0));
+		// More than can be queued, even if the thread were idle
+		REQUIRE_FALSE(oWriter.write(sData.data(), 200, 50));
+		REQUIRE(oWriter.hasFileFailed());
+		REQUIRE_FALSE(oWriter.write(sData.data(), 10, 250));
+		std::string sDoneError;
+		oWriter.close(sChecksumFilePath, "", [&](const std::string& sError)
+		{
+			sDoneError = sError;
+		});
+		// The next file is mirrored again
+		oWriter.open(sNextFilePath);
+		REQUIRE_FALSE(oWriter.hasFileFailed());
+		REQUIRE(oWriter.write(sData.data(), 50, 0));
+		std::string sNextDoneError = "not called";
+		oWriter.close("", "", [&](const std::string& sError)
+		{
+			sNextDoneError = sError;
+		});
+		REQUIRE(oWriter.stop(-1));
+		REQUIRE(sDoneError.find("too slow") != std::string::npos);
+		REQUIRE(sNextDoneError.empty());
+	}
+	// The dropped file is removed
+	REQUIRE_FALSE(fileExists(sFilePath));
+	REQUIRE_FALSE(fileExists(sChecksumFilePath));
+	REQUIRE(Glib::file_get_contents(sNextFilePath) == sData.substr(0, 50));
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "MirrorWriterNoOverwrite")
+{
+	TempDir oDir("sonoremmirror");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFilePath = sDirPath + "/segment.wav";
+	Glib::file_set_contents(sFilePath, "old");
+	{
+		MirrorWriter oWriter(1000);
+		REQUIRE(oWriter.start().empty());
+		oWriter.open(sFilePath);
+		oWriter.write("new", 3, 0);
+		std::string sDoneError;
+		oWriter.close("", "", [&](const std::string& sError)
+		{
+			sDoneError = sError;
+		});
+		REQUIRE(oWriter.stop(-1));
+		REQUIRE_FALSE(sDoneError.empty());
+	}
+	// Left alone
+	REQUIRE(Glib::file_get_contents(sFilePath) == "old");
+}
+
+} // namespace testing
+
+} // namespace sono
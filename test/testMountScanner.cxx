@@ -0,0 +1,90 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testMountScanner.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "mountscanner.h"
+
+#include "mainloopfixture.h"
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <glibmm.h>
+
+#include <algorithm>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+using std::unique_ptr;
+
+namespace testing
+{
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "MountScannerFiles")
+{
+	TempDir oDir("sonoremscan");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	Glib::file_set_contents(sDirPath + "/sonorem.name", "Stick1\n");
+	Glib::file_set_contents(sDirPath + "/Sonorem.Stop", "");
+	Glib::file_set_contents(sDirPath + "/other.txt", "Other");
+
+	auto refScanner = std::make_unique<MountScanner>(sDirPath, "sonorem.");
+	int32_t nFinished = 0;
+	refScanner->m_oFinishedSignal.connect([&]()
+	{
+		++nFinished;
+	});
+	refScanner->start();
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nFinished == 0) && (nTicks < 100);
+	}, 100);
+
+	REQUIRE(nFinished == 1);
+	REQUIRE(refScanner->isFinished());
+	std::vector<MountScanner::File> aFiles = refScanner->getFiles();
+	std::sort(aFiles.begin(), aFiles.end(), [](const MountScanner::File& oF1, const MountScanner::File& oF2)
+	{
+		return (oF1.m_sName < oF2.m_sName);
+	});
+	REQUIRE(aFiles.size() == 2);
+	REQUIRE(aFiles[0].m_sName == "name");
+	REQUIRE(aFiles[0].m_sContents == "Stick1\n");
+	// vfat sticks keep the case the file was created with
+	REQUIRE(aFiles[1].m_sName == "stop");
+	REQUIRE(aFiles[1].m_sContents.empty());
+	REQUIRE(refScanner->getFreeBytes() > 0);
+
+	refScanner.reset();
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,107 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testRecordingTail.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "recordingtail.h"
+
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <glibmm.h>
+
+#include <cstdio>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+namespace testing
+{
+
+static void appendToFile(const std::string& sFilePath, const std::string& sStr)
+{
+	FILE* p0File = std::fopen(sFilePath.c_str(), "a");
+	REQUIRE(p0File != nullptr);
+	REQUIRE(std::fputs(sStr.c_str(), p0File) >= 0);
+	REQUIRE(std::fclose(p0File) == 0);
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "RecordingTailSave")
+{
+	TempDir oDir("sonoremtail");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFilePath = sDirPath + "/rec.ogg";
+	const std::string sSaved1Path = sDirPath + "/saved1.ogg";
+	const std::string sSaved2Path = sDirPath + "/saved2.ogg";
+	{
+		RecordingTail oTail(sFilePath, 4, 1000);
+		// Not created yet
+		REQUIRE(oTail.update(false) == -1);
+		appendToFile(sFilePath, "HEADabc");
+		REQUIRE(oTail.update(false) == 7);
+		appendToFile(sFilePath, "def");
+		REQUIRE(oTail.update(false) == 10);
+		REQUIRE(oTail.getUnsyncedBytes() == 10);
+		REQUIRE(oTail.getSyncedBytes() == 0);
+		// The head isn't written twice
+		REQUIRE(oTail.save(sSaved1Path).empty());
+		REQUIRE(Glib::file_get_contents(sSaved1Path) == "HEADabcdef");
+		// Doesn't overwrite
+		REQUIRE(! oTail.save(sSaved1Path).empty());
+
+		REQUIRE(oTail.update(true) == 10);
+		REQUIRE(oTail.getUnsyncedBytes() == 0);
+		REQUIRE(oTail.getSyncedBytes() == 10);
+		appendToFile(sFilePath, "ghi");
+		REQUIRE(oTail.update(false) == 13);
+		REQUIRE(oTail.getUnsyncedBytes() == 3);
+		// Only what might not be on the stick, after the head
+		REQUIRE(oTail.save(sSaved2Path).empty());
+		REQUIRE(Glib::file_get_contents(sSaved2Path) == "HEADghi");
+	}
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "RecordingTailMaxBytes")
+{
+	TempDir oDir("sonoremtail");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFilePath = sDirPath + "/rec.ogg";
+	const std::string sSavedPath = sDirPath + "/saved.ogg";
+	{
+		RecordingTail oTail(sFilePath, 2, 5);
+		appendToFile(sFilePath, "HD0123456789");
+		REQUIRE(oTail.update(false) == 12);
+		// The oldest unsynced bytes are lost
+		REQUIRE(oTail.getUnsyncedBytes() == 5);
+		REQUIRE(oTail.save(sSavedPath).empty());
+		REQUIRE(Glib::file_get_contents(sSavedPath) == "HD56789");
+	}
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,131 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testRecordingWatchdog.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "recordingwatchdog.h"
+
+#include "mainloopfixture.h"
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <glibmm.h>
+
+#include <cstdio>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+namespace testing
+{
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "RecordingWatchdogStalled")
+{
+	TempDir oDir("sonoremwatch");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFilePath = sDirPath + "/rec.ogg";
+	{
+		RecordingWatchdog oWatchdog(sFilePath, 300, 300);
+		REQUIRE(oWatchdog.start().empty());
+		REQUIRE(oWatchdog.getSizeBytes() == -1);
+		int64_t nLastSizeBytes = -1;
+		int32_t nStalled = 0;
+		oWatchdog.m_oSizeChangedSignal.connect([&](int64_t nSizeBytes)
+		{
+			nLastSizeBytes = nSizeBytes;
+		});
+		oWatchdog.m_oStalledSignal.connect([&]()
+		{
+			++nStalled;
+		});
+
+		std::FILE* p0File = std::fopen(sFilePath.c_str(), "w");
+		REQUIRE(p0File != nullptr);
+		MainLoopFixture oMainLoop;
+		int32_t nTicks = 0;
+		int32_t nStalledTick = -1;
+		oMainLoop.run([&]() -> bool
+		{
+			++nTicks;
+			if (nTicks <= 10) {
+				// The writer produces bytes for half a second
+				std::fwrite("0123456789", 1, 10, p0File);
+				std::fflush(p0File);
+			} else if ((nStalled > 0) && (nStalledTick < 0)) {
+				nStalledTick = nTicks;
+			}
+			return (nTicks < 40);
+		}, 50);
+		std::fclose(p0File);
+
+		REQUIRE(nLastSizeBytes == 100);
+		REQUIRE(oWatchdog.getSizeBytes() == 100);
+		REQUIRE_FALSE(oWatchdog.isClosed());
+		// Once and not before the writer stopped
+		REQUIRE(nStalled == 1);
+		REQUIRE(nStalledTick > 10);
+	}
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "RecordingWatchdogClosed")
+{
+	TempDir oDir("sonoremwatch");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	const std::string sFilePath = sDirPath + "/rec.ogg";
+	{
+		RecordingWatchdog oWatchdog(sFilePath, 200, 200);
+		REQUIRE(oWatchdog.start().empty());
+		int32_t nStalled = 0;
+		oWatchdog.m_oStalledSignal.connect([&]()
+		{
+			++nStalled;
+		});
+
+		MainLoopFixture oMainLoop;
+		int32_t nTicks = 0;
+		oMainLoop.run([&]() -> bool
+		{
+			++nTicks;
+			if (nTicks == 1) {
+				// Not Glib::file_set_contents(), it renames a temporary file
+				std::FILE* p0File = std::fopen(sFilePath.c_str(), "w");
+				std::fputs("Finished recording", p0File);
+				std::fclose(p0File);
+			}
+			return (nTicks < 20);
+		}, 50);
+
+		REQUIRE(oWatchdog.isClosed());
+		REQUIRE(oWatchdog.getSizeBytes() == 18);
+		// The writer is done, not stalled
+		REQUIRE(nStalled == 0);
+	}
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,206 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testSonoCapture.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "sonocapture.h"
+#include "filecopier.h"
+#include "util.h"
+
+#include "mainloopfixture.h"
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <glibmm.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+using std::unique_ptr;
+
+namespace testing
+{
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "SonoCaptureSegments")
+{
+	TempDir oDir("sonoremcapture");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+
+	constexpr int32_t nSampleRate = 8000;
+	constexpr int32_t nChannels = 2;
+	constexpr int32_t nFrameBytes = nChannels * 2;
+	// A segment lasts one second
+	int32_t nCounter = 0;
+	SonoCapture::Init oInit;
+	oInit.m_sSource = "tone";
+	oInit.m_nSampleRate = nSampleRate;
+	oInit.m_nChannels = nChannels;
+	oInit.m_nMaxSegmentSeconds = 1;
+	oInit.m_nMaxSegmentBytes = 1000 * 1000;
+	oInit.m_oNextSegmentPath = [&]()
+	{
+		++nCounter;
+		return sDirPath + "/segment" + std::to_string(nCounter) + ".wav";
+	};
+	auto refCapture = std::make_unique<SonoCapture>(std::move(oInit));
+
+	std::vector<std::string> aSegments;
+	int32_t nChanged = 0;
+	refCapture->m_oChangedSignal.connect([&]()
+	{
+		++nChanged;
+		std::string sPath;
+		while (refCapture->popFinishedSegment(sPath)) {
+			aSegments.push_back(sPath);
+		}
+	});
+
+	const std::string sError = refCapture->start();
+	REQUIRE(sError.empty());
+	REQUIRE(fileExists(refCapture->getSegmentPath()));
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		// 3.5 seconds
+		return (nTicks < 35);
+	}, 100);
+
+	refCapture->stop();
+	// Doesn't block, the last segment is finished in the background
+	nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		REQUIRE(nTicks < 50);
+		return ! refCapture->isStopped();
+	}, 100);
+	REQUIRE_FALSE(refCapture->hasFailed());
+	std::string sPath;
+	while (refCapture->popFinishedSegment(sPath)) {
+		aSegments.push_back(sPath);
+	}
+	REQUIRE(nChanged >= 3);
+	REQUIRE(aSegments.size() == 4);
+	int64_t nTotFrames = 0;
+	for (size_t nIdx = 0; nIdx < aSegments.size(); ++nIdx) {
+		const int64_t nDataBytes = getWavDataBytes(aSegments[nIdx]);
+		REQUIRE(nDataBytes >= 0);
+		const int64_t nFrames = nDataBytes / nFrameBytes;
+		if (nIdx + 1 < aSegments.size()) {
+			// switching file happens at sample boundaries
+			REQUIRE(nFrames == nSampleRate);
+		}
+		nTotFrames += nFrames;
+	}
+	REQUIRE(nTotFrames * nFrameBytes == refCapture->getTotalBytes());
+	REQUIRE(refCapture->getXruns() == 0);
+
+	refCapture.reset();
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "SonoCaptureMirror")
+{
+	TempDir oDir("sonoremcapture");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	TempDir oMirrorDir("sonoremmirror");
+	REQUIRE_FALSE(oMirrorDir.getPath().empty());
+	const std::string sMirrorDirPath = oMirrorDir.getPath();
+
+	int32_t nCounter = 0;
+	SonoCapture::Init oInit;
+	oInit.m_sSource = "tone";
+	oInit.m_nSampleRate = 8000;
+	oInit.m_nChannels = 2;
+	oInit.m_nMaxSegmentSeconds = 1;
+	oInit.m_nMaxSegmentBytes = 1000 * 1000;
+	oInit.m_oNextSegmentPath = [&]()
+	{
+		++nCounter;
+		return sDirPath + "/segment" + std::to_string(nCounter) + ".wav";
+	};
+	auto refCapture = std::make_unique<SonoCapture>(std::move(oInit));
+	refCapture->setMirrorDirPath(sMirrorDirPath);
+
+	const std::string sError = refCapture->start();
+	REQUIRE(sError.empty());
+	// Created by the mirror thread
+	REQUIRE(! refCapture->getMirrorSegmentPath().empty());
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		if (nTicks == 5) {
+			// The second segment isn't mirrored
+			refCapture->setMirrorDirPath("");
+		}
+		// 1.5 seconds
+		return (nTicks < 15);
+	}, 100);
+
+	bool bStopped = false;
+	refCapture->m_oStoppedSignal.connect([&]()
+	{
+		bStopped = true;
+	});
+	refCapture->stop();
+	nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		REQUIRE(nTicks < 50);
+		return ! bStopped;
+	}, 100);
+	REQUIRE(refCapture->isStopped());
+	REQUIRE_FALSE(refCapture->hasFailed());
+	std::vector<SonoCapture::FinishedSegment> aSegments;
+	SonoCapture::FinishedSegment oSegment;
+	while (refCapture->popFinishedSegment(oSegment)) {
+		aSegments.push_back(oSegment);
+	}
+	REQUIRE(aSegments.size() == 2);
+	REQUIRE(aSegments[0].m_sError.empty());
+	REQUIRE(aSegments[0].m_sMirrorPath == sMirrorDirPath + "/segment1.wav");
+	REQUIRE(aSegments[1].m_sMirrorPath.empty());
+	// The mirror is identical and its checksum was computed while writing
+	const std::string sContent = Glib::file_get_contents(aSegments[0].m_sPath);
+	REQUIRE(Glib::file_get_contents(aSegments[0].m_sMirrorPath) == sContent);
+	const std::string sChecksumFilePath = FileCopier::getChecksumFilePath(aSegments[0].m_sMirrorPath);
+	const std::string sChecksumContent = Glib::file_get_contents(sChecksumFilePath);
+	REQUIRE(std::stoul(sChecksumContent.substr(0, 8), nullptr, 16) == crc32c(0, sContent.data(), sContent.size()));
+	REQUIRE(refCapture->getWriteStats(true).m_nWrites > 0);
+	REQUIRE(refCapture->getWriteStats(false).m_nWrites > refCapture->getWriteStats(true).m_nWrites);
+
+	refCapture.reset();
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testSpacePredictor.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "spacepredictor.h"
+
+#include <chrono>
+
+namespace sono
+{
+
+namespace testing
+{
+
+static constexpr int64_t s_nMegaByte = 1000 * 1000;
+
+static SpacePredictor::TimePoint getTime(int32_t nSeconds)
+{
+	return SpacePredictor::TimePoint{} + std::chrono::seconds(nSeconds);
+}
+
+TEST_CASE("SpacePredictorFilling")
+{
+	SpacePredictor oPredictor(100 * s_nMegaByte, 60);
+	REQUIRE(oPredictor.getSecondsToLimit() == -1);
+	REQUIRE(oPredictor.getCheckIntervalSeconds(1, 30) == 30);
+
+	// Recording at 1 MB/s, nothing removed
+	for (int32_t nSecond = 0; nSecond <= 100; nSecond += 10) {
+		oPredictor.addFreeSample(getTime(nSecond), (1000 - nSecond) * s_nMegaByte);
+		oPredictor.addRecordingSizeSample(getTime(nSecond), nSecond * s_nMegaByte);
+	}
+	REQUIRE(oPredictor.getConsumedBytesPerSecond() == Approx(1.0 * s_nMegaByte));
+	REQUIRE(oPredictor.getWrittenBytesPerSecond() > 0.5 * s_nMegaByte);
+	REQUIRE(oPredictor.getDrainedBytesPerSecond() < 0.5 * s_nMegaByte);
+	// 900 MB free, 800 MB to go
+	REQUIRE(oPredictor.getSecondsToLimit() == 800);
+	REQUIRE(oPredictor.getSecondsToFreed() == 0);
+	REQUIRE(oPredictor.getCheckIntervalSeconds(1, 30) == 30);
+
+	// Nearer the limit
+	oPredictor.addFreeSample(getTime(880), 120 * s_nMegaByte);
+	REQUIRE(oPredictor.getSecondsToLimit() == 20);
+	REQUIRE(oPredictor.getCheckIntervalSeconds(1, 30) == 5);
+
+	oPredictor.addFreeSample(getTime(905), 95 * s_nMegaByte);
+	REQUIRE(oPredictor.getSecondsToLimit() == 0);
+}
+
+TEST_CASE("SpacePredictorDraining")
+{
+	SpacePredictor oPredictor(100 * s_nMegaByte, 60);
+	// Waiting for space while the copied recordings are removed at 2 MB/s
+	oPredictor.addFreeSample(getTime(0), 40 * s_nMegaByte);
+	oPredictor.addFreeSample(getTime(10), 60 * s_nMegaByte);
+	REQUIRE(oPredictor.getConsumedBytesPerSecond() == Approx(-2.0 * s_nMegaByte));
+	REQUIRE(oPredictor.getDrainedBytesPerSecond() == Approx(2.0 * s_nMegaByte));
+	REQUIRE(oPredictor.getSecondsToLimit() == 0);
+	REQUIRE(oPredictor.getSecondsToFreed() == 21);
+	REQUIRE(oPredictor.getCheckIntervalSeconds(1, 5) == 5);
+	REQUIRE(oPredictor.getCheckIntervalSeconds(1, 3) == 3);
+
+	// Old or invalid samples are ignored
+	oPredictor.addFreeSample(getTime(5), 0);
+	oPredictor.addFreeSample(getTime(20), -1);
+	REQUIRE(oPredictor.getSecondsToFreed() == 21);
+
+	oPredictor.reset();
+	REQUIRE(oPredictor.getSecondsToFreed() == -1);
+	REQUIRE(oPredictor.getConsumedBytesPerSecond() == 0.0);
+}
+
+TEST_CASE("SpacePredictorNewRecording")
+{
+	SpacePredictor oPredictor(0, 1);
+	oPredictor.addRecordingSizeSample(getTime(0), 90 * s_nMegaByte);
+	// A new recording was started, 10 MB written in 10 seconds
+	oPredictor.addRecordingSizeSample(getTime(10), 10 * s_nMegaByte);
+	// The time constant is short, the last rate dominates
+	REQUIRE(oPredictor.getWrittenBytesPerSecond() == Approx(1.0 * s_nMegaByte).epsilon(0.01));
+	oPredictor.recordingStopped();
+	REQUIRE(oPredictor.getWrittenBytesPerSecond() == 0.0);
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -0,0 +1,82 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testSpaceSampler.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "spacesampler.h"
+
+#include "testutil.h"
+#include "util.h"
+
+#include <glibmm.h>
+
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+namespace testing
+{
+
+TEST_CASE("SpaceSamplerCached")
+{
+	TempDir oDir("sonoremspace");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+	{
+		SpaceSampler oSampler(60 * 1000);
+		int32_t nChanged = 0;
+		oSampler.m_oFreeBytesChangedSignal.connect([&](const std::string& /*sDirPath*/, int64_t /*nFreeBytes*/)
+		{
+			++nChanged;
+		});
+		REQUIRE(oSampler.addDir(sDirPath).empty());
+		const int64_t nFreeBytes = oSampler.getFreeBytes(sDirPath);
+		REQUIRE(nFreeBytes > 0);
+
+		// Not stale: the file doesn't change the sample
+		Glib::file_set_contents(sDirPath + "/big", std::string(1024 * 1024, 'x'));
+		oSampler.sample();
+		REQUIRE(oSampler.getFreeBytes(sDirPath) == nFreeBytes);
+		REQUIRE(nChanged == 0);
+		REQUIRE(::unlink((sDirPath + "/big").c_str()) == 0);
+
+		oSampler.removeDir(sDirPath);
+		// Sampled by path
+		REQUIRE(oSampler.getFreeBytes(sDirPath) > 0);
+	}
+}
+
+TEST_CASE("SpaceSamplerNotExisting")
+{
+	SpaceSampler oSampler(0);
+	REQUIRE_FALSE(oSampler.addDir("/tmp/sonoremspace/not/existing").empty());
+	REQUIRE(oSampler.getFreeBytes("/tmp/sonoremspace/not/existing") == -1);
+	oSampler.setMaxStaleMillisec(1000);
+	REQUIRE(oSampler.getMaxStaleMillisec() == 1000);
+}
+
+} // namespace testing
+
+} // namespace sono
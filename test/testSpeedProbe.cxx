@@ -0,0 +1,84 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testSpeedProbe.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "speedprobe.h"
+
+#include "mainloopfixture.h"
+#include "testutil.h"
+#include "fixtureGlib.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+using std::unique_ptr;
+
+namespace testing
+{
+
+static unique_ptr<SpeedProbe> runProbe(const std::string& sDirPath)
+{
+	auto refProbe = std::make_unique<SpeedProbe>(sDirPath);
+	int32_t nFinished = 0;
+	refProbe->m_oFinishedSignal.connect([&]()
+	{
+		++nFinished;
+	});
+	refProbe->start();
+
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nFinished == 0) && (nTicks < 300);
+	}, 100);
+
+	REQUIRE(nFinished == 1);
+	REQUIRE(refProbe->isFinished());
+	return refProbe;
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "SpeedProbeMeasure")
+{
+	TempDir oDir("sonoremprobe");
+	REQUIRE_FALSE(oDir.getPath().empty());
+	const std::string sDirPath = oDir.getPath();
+
+	auto refProbe = runProbe(sDirPath);
+	REQUIRE(refProbe->getError().empty());
+	REQUIRE(refProbe->getWriteBytesPerSecond() > 0);
+	REQUIRE(refProbe->getReadBytesPerSecond() > 0);
+	// the probe file is removed, rmdir would fail otherwise
+	REQUIRE(::rmdir(sDirPath.c_str()) == 0);
+
+	// the directory doesn't exist anymore
+	refProbe = runProbe(sDirPath);
+	REQUIRE_FALSE(refProbe->getError().empty());
+}
+
+} // namespace testing
+
+} // namespace sono
@@ -24,6 +24,7 @@
 #include "sonomodel.h"
 #include "util.h"
 
+#include "fakerecfixture.h"
 #include "fsfakerfixture.h"
 #include "mainloopfixture.h"
 #include "testutil.h"
@@ -31,6 +32,8 @@
 
 #include <fspropfaker/fspropfaker.h>
 
+#include <unistd.h>
+
 
 namespace sono
 {
@@ -63,6 +66,9 @@ TEST_CASE_METHOD(STFX<GlibFixture>, "SonoModelWaitingState")
 		using SonoModel::init;
 		using SonoModel::matchRecordingFileName;
 	};
+	// No need for rec and a microphone
+	FakeRecFixture oFakeRec;
+	oFakeRec.m_nBytesPerSecond = 1 * nMegaByte;
 	std::string sError;
 	unique_ptr<TestSonoModel> refSonoModel;
 	auto oInitModel = [&]()
@@ -73,9 +79,12 @@ TEST_CASE_METHOD(STFX<GlibFixture>, "SonoModelWaitingState")
 		oInit.m_bRfkillBluetoothOff = true;
 		oInit.m_bRfkillWifiOff = true;
 		oInit.m_sRecordingDirPath = oFFF.getFakeFsPath();
+		// Tests can run in parallel and next to a running sonorem
+		oInit.m_sControlSocketName = "sonoremtest" + std::to_string(::getpid());
 		oInit.m_nMaxFileSizeBytes = 1000 * nMegaByte;
 		oInit.m_nMaxRecordingDurationSeconds = 10;
 		oInit.m_nMinFreeSpaceBytes = 10 * nMegaByte;
+		oInit.m_sCaptureSource = oFakeRec.getCaptureSource();
 		refSonoModel = std::make_unique<TestSonoModel>([](const std::string&){});
 		sError = refSonoModel->init(std::move(oInit));
 		if (! sError.empty()) {
@@ -108,16 +117,16 @@ TEST_CASE_METHOD(STFX<GlibFixture>, "SonoModelWaitingState")
 		} else if (nProgress == 7) {
 			REQUIRE(refSonoModel->getState() == SonoModel::STATE_RECORDING);
 		} else if (nProgress == 8) {
-			::sleep(1); // give time to rec process to start
+			::sleep(1); // give time to recording to start
 		} else if (nProgress == 9) {
-			::sleep(1); // give time to rec process to start
+			::sleep(1); // give time to recording to start
 		} else if (nProgress == 10) {
 			refSonoModel->stopRecording();
-			::sleep(1); // give time to rec process to finish
+			::sleep(1); // give time to recording to finish
 		} else if (nProgress == 11) {
-			::sleep(1); // give time to rec process to finish
+			::sleep(1); // give time to recording to finish
 		} else if (nProgress == 12) {
-			::sleep(1); // give time to rec process to finish
+			::sleep(1); // give time to recording to finish
 			REQUIRE(refSonoModel->getNrToBeCopiedRecordings() == 1);
 		} else {
 			return ! bContinue;
@@ -133,6 +142,10 @@ TEST_CASE_METHOD(STFX<GlibFixture>, "SonoModelWaitingState")
 		if (Glib::file_test(sFilePath, Glib::FILE_TEST_IS_DIR)) {
 			continue;
 		}
+		if (sFileName.compare(0, 8, "sonorem.") == 0) {
+			// control files (journal, speeds)
+			continue;
+		}
 		REQUIRE(refSonoModel->matchRecordingFileName(sFileName));
 		++nGeneratedRecordings;
 	}
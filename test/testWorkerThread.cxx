@@ -0,0 +1,166 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testWorkerThread.cxx
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include "workerthread.h"
+
+#include "mainloopfixture.h"
+#include "fixtureGlib.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sono
+{
+
+using std::unique_ptr;
+
+namespace testing
+{
+
+// Blocks reading a pipe like a sync blocks on a dead device
+class PipeWorker : public WorkerThread
+{
+public:
+	explicit PipeWorker(int nReadFd, bool bNotifyProgress = false)
+	: WorkerThread("pipe", true)
+	, m_nReadFd(nReadFd)
+	, m_bNotifyProgress(bNotifyProgress)
+	{
+	}
+protected:
+	std::function<void(Status& oStatus)> createJob() noexcept override
+	{
+		const int nReadFd = m_nReadFd;
+		const bool bNotifyProgress = m_bNotifyProgress;
+		return [nReadFd, bNotifyProgress](Status& oStatus)
+		{
+			if (bNotifyProgress) {
+				oStatus.notifyProgress();
+			}
+			char c;
+			if (::read(nReadFd, &c, 1) != 1) {
+				oStatus.setError("Pipe closed");
+			}
+			::close(nReadFd);
+		};
+	}
+private:
+	const int m_nReadFd;
+	const bool m_bNotifyProgress;
+};
+
+static int32_t runUntilFinished(WorkerThread& oWorker)
+{
+	int32_t nFinished = 0;
+	oWorker.m_oFinishedSignal.connect([&]()
+	{
+		++nFinished;
+	});
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return (nFinished == 0) && (nTicks < 50);
+	}, 100);
+	return nFinished;
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "WorkerThreadFinished")
+{
+	int aFds[2];
+	REQUIRE(::pipe2(aFds, O_CLOEXEC) == 0);
+	REQUIRE(::write(aFds[1], "x", 1) == 1);
+	auto refWorker = std::make_unique<PipeWorker>(aFds[0]);
+	refWorker->start();
+	REQUIRE(runUntilFinished(*refWorker) == 1);
+	REQUIRE(refWorker->isFinished());
+	REQUIRE(refWorker->getError().empty());
+	// too late, the result is kept
+	refWorker->cancel();
+	REQUIRE(refWorker->getError().empty());
+	refWorker.reset();
+	::close(aFds[1]);
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "WorkerThreadProgress")
+{
+	int aFds[2];
+	REQUIRE(::pipe2(aFds, O_CLOEXEC) == 0);
+	auto refWorker = std::make_unique<PipeWorker>(aFds[0], true);
+	int32_t nProgress = 0;
+	refWorker->m_oProgressSignal.connect([&]()
+	{
+		++nProgress;
+	});
+	refWorker->start();
+	{
+		MainLoopFixture oMainLoop;
+		int32_t nTicks = 0;
+		oMainLoop.run([&]() -> bool
+		{
+			++nTicks;
+			return (nProgress == 0) && (nTicks < 50);
+		}, 100);
+	}
+	REQUIRE(nProgress == 1);
+	// still blocked
+	REQUIRE_FALSE(refWorker->isFinished());
+	REQUIRE(::write(aFds[1], "x", 1) == 1);
+	REQUIRE(runUntilFinished(*refWorker) == 1);
+	REQUIRE(refWorker->getError().empty());
+	REQUIRE(nProgress == 1);
+	refWorker.reset();
+	::close(aFds[1]);
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "WorkerThreadAbandonOnCancel")
+{
+	int aFds[2];
+	REQUIRE(::pipe2(aFds, O_CLOEXEC) == 0);
+	auto refWorker = std::make_unique<PipeWorker>(aFds[0]);
+	refWorker->start();
+	refWorker->cancel();
+	// the job is still blocked
+	REQUIRE(runUntilFinished(*refWorker) == 1);
+	REQUIRE(refWorker->isFinished());
+	REQUIRE(refWorker->getError() == "Canceled");
+	refWorker.reset();
+	// the abandoned job terminates without a worker
+	::close(aFds[1]);
+}
+
+TEST_CASE_METHOD(STFX<GlibFixture>, "WorkerThreadAbandonOnDelete")
+{
+	int aFds[2];
+	REQUIRE(::pipe2(aFds, O_CLOEXEC) == 0);
+	auto refWorker = std::make_unique<PipeWorker>(aFds[0]);
+	refWorker->start();
+	// doesn't wait for the blocked job
+	refWorker.reset();
+	::close(aFds[1]);
+}
+
+} // namespace testing
+
+} // namespace sono
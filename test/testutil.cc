@@ -24,12 +24,15 @@
 #include <iostream>
 #include <cassert>
 #include <array>
+#include <fstream>
 
 #include <string.h>
 #include <stdlib.h>
 
 #include <errno.h>
+#include <ftw.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 namespace sono
 {
@@ -44,4 +47,52 @@ bool fileExists(const std::string& sPath) noexcept
 	return ((oInfo.st_mode & S_IFREG) != 0);
 }
 
+int64_t getWavDataBytes(const std::string& sPath) noexcept
+{
+	std::ifstream oFile(sPath, std::ios_base::binary);
+	char aHeader[44];
+	if (! oFile.read(aHeader, sizeof(aHeader))) {
+		return -1; //-----------------------------------------------------------
+	}
+	if ((std::string(aHeader, 4) != "RIFF") || (std::string(aHeader + 8, 4) != "WAVE")
+			|| (std::string(aHeader + 36, 4) != "data")) {
+		return -1; //-----------------------------------------------------------
+	}
+	uint32_t nDataBytes = 0;
+	for (int32_t nByte = 3; nByte >= 0; --nByte) {
+		nDataBytes = (nDataBytes << 8) | static_cast<uint8_t>(aHeader[40 + nByte]);
+	}
+	oFile.seekg(0, std::ios_base::end);
+	if (static_cast<int64_t>(oFile.tellg()) != static_cast<int64_t>(sizeof(aHeader)) + nDataBytes) {
+		return -1; //-----------------------------------------------------------
+	}
+	return nDataBytes;
+}
+
+static int removeEntry(const char* p0Path, const struct ::stat* /*p0Stat*/, int nFlag, struct ::FTW* /*p0Ftw*/)
+{
+	if (nFlag == FTW_DP) {
+		::rmdir(p0Path);
+	} else {
+		::unlink(p0Path);
+	}
+	return 0;
+}
+
+TempDir::TempDir(const std::string& sPrefix) noexcept
+{
+	std::string sTemplate = "/tmp/" + sPrefix + "XXXXXX";
+	if (::mkdtemp(&(sTemplate[0])) != nullptr) {
+		m_sPath = sTemplate;
+	}
+}
+TempDir::~TempDir() noexcept
+{
+	if (m_sPath.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	// Depth first, don't follow the links
+	::nftw(m_sPath.c_str(), &removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
 } // namespace sono
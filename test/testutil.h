@@ -24,11 +24,39 @@
 #include <string>
 #include <vector>
 
+#include <stdint.h>
+
 namespace sono
 {
 
 bool fileExists(const std::string& sPath) noexcept;
 
+/* The size of the data chunk of a wav file as written by SonoCapture.
+ * @param sPath The file path.
+ * @return The size in bytes or -1 if not a valid file.
+ */
+int64_t getWavDataBytes(const std::string& sPath) noexcept;
+
+/* A temporary directory removed with all its contents when destroyed.
+ */
+class TempDir
+{
+public:
+	/* Creates the directory.
+	 * @param sPrefix The start of the name of the directory in /tmp.
+	 */
+	explicit TempDir(const std::string& sPrefix) noexcept;
+	~TempDir() noexcept;
+	/* The path of the directory or empty if it couldn't be created. */
+	const std::string& getPath() const noexcept { return m_sPath; }
+private:
+	std::string m_sPath;
+private:
+	TempDir() = delete;
+	TempDir(const TempDir& oSource) = delete;
+	TempDir& operator=(const TempDir& oSource) = delete;
+};
+
 } // namespace sono
 
 #endif /* FSPF_TEST_UTIL_H */